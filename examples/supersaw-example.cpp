@@ -1,8 +1,8 @@
 /*------------------------------------------------------------------------
  * Supersaw example:
  *
- * Demonstrates using Signal's multichannel expansion and mixdown
- * to create complex harmonics.
+ * Demonstrates the Unison oscillator, which generates several detuned,
+ * band-limited sawtooths and spreads them across the stereo field.
  *-----------------------------------------------------------------------*/
 
 #include <signal/signal.h>
@@ -17,20 +17,16 @@ int main()
 	AudioGraphRef graph = new AudioGraph();
 
 	/*------------------------------------------------------------------------
-	 * Create 6 mono channels of sawtooth with varying frequencies.
-	 * This is shorthand for:
+	 * Create 7 sawtooth voices around 60Hz, detuned by up to a quarter
+	 * of a semitone either side, and panned from left to right.
 	 *
-	 * NodeRef multiplex = new Multiplex({ 58.3, 59.1, 60.0, 60.3, 60.5 });
-	 * NodeRef saw = new Saw(multiplex);
-	 *-----------------------------------------------------------------------*/
-	NodeRef saw = new Saw({ 58.3, 59.1, 60.0, 60.3, 60.5 });
-
-	/*------------------------------------------------------------------------
-	 * Mixer up-mixes or down-mixes between different numbers of channels.
-	 * Downmixing 6 channels to 2 creates a stereo spread of six sawtooths
-	 * between the L and R speaker.
+	 * The same sound can be built from separate oscillators, with
+	 * multichannel expansion and a Mixer to spread them over two channels:
+	 *
+	 * NodeRef saw = new Saw({ 58.3, 59.1, 60.0, 60.3, 60.5 });
+	 * NodeRef mix = new Mixer(saw, 2);
 	 *-----------------------------------------------------------------------*/
-	NodeRef mix = new Mixer(saw, 2);
+	NodeRef mix = new Unison(60, 7, 0.25, 1.0, SIGNAL_SHAPE_SAW, 2);
 
 	/*------------------------------------------------------------------------
 	 * To add some life, add a resonant filter with wandering cutoff
@@ -28,9 +28,21 @@ Buffer::Buffer(int num_channels, int num_frames)
 
 Buffer::Buffer(const char *filename)
 {
+	this->num_channels = 0;
+	this->data = NULL;
 	this->open(filename);
 }
 
+Buffer::~Buffer()
+{
+	if (this->data)
+	{
+		for (int channel = 0; channel < this->num_channels; channel++)
+			free(this->data[channel]);
+		free(this->data);
+	}
+}
+
 void Buffer::open(const char *filename)
 {
 	#ifdef HAVE_SNDFILE
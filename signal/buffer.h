@@ -10,14 +10,22 @@
 
 #include <math.h>
 #include <memory>
+#include <algorithm>
 
 #define SIGNAL_ENVELOPE_BUFFER_LENGTH 1024
 #define SIGNAL_ENVELOPE_BUFFER_HALF_LENGTH (SIGNAL_ENVELOPE_BUFFER_LENGTH / 2)
 
+/*------------------------------------------------------------------------
+ * Interpolation between samples. Allpass interpolation is recursive,
+ * so is only supported by delay lines, which read their samples in
+ * order.
+ *-----------------------------------------------------------------------*/
 typedef enum
 {
 	SIGNAL_INTERPOLATE_NONE,
-	SIGNAL_INTERPOLATE_LINEAR
+	SIGNAL_INTERPOLATE_LINEAR,
+	SIGNAL_INTERPOLATE_CUBIC,
+	SIGNAL_INTERPOLATE_ALLPASS
 } signal_interpolate_t;
 
 /**------------------------------------------------------------------------
@@ -33,6 +41,7 @@ namespace libsignal
 	public:
 		Buffer(int num_channels, int num_frames);
 		Buffer(const char *filename);
+		virtual ~Buffer();
 
 		void open(const char *filename);
 		void save(const char *filename);
@@ -74,6 +83,20 @@ namespace libsignal
 				sample rv = ((1.0 - frame_frac) * this->data[0][(int) frame]) + (frame_frac * this->data[0][(int) ceil(frame)]);
 				return rv;
 			}
+			else if (this->interpolate == SIGNAL_INTERPOLATE_CUBIC)
+			{
+				int index = (int) frame;
+				int last = this->num_frames - 1;
+				sample frac = frame - index;
+				sample y0 = this->data[0][std::max(index - 1, 0)];
+				sample y1 = this->data[0][index];
+				sample y2 = this->data[0][std::min(index + 1, last)];
+				sample y3 = this->data[0][std::min(index + 2, last)];
+				sample c1 = 0.5 * (y2 - y0);
+				sample c2 = y0 - 2.5 * y1 + 2.0 * y2 - 0.5 * y3;
+				sample c3 = 0.5 * (y3 - y0) + 1.5 * (y1 - y2);
+				return ((c3 * frac + c2) * frac + c1) * frac + y1;
+			}
 			else
 			{
 				return this->data[0][(int) frame];
@@ -11,6 +11,7 @@ namespace libsignal
 Dust::Dust(NodeRef frequency) : frequency(frequency)
 {
 	this->steps_remaining = 0;
+	this->shared_state = true;
 
 	this->name = "dust";
 	this->add_input("frequency", this->frequency);
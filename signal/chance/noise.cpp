@@ -4,6 +4,7 @@
 #include "../util.h"
 #include "../graph.h"
 
+#include <algorithm>
 #include <limits>
 
 namespace libsignal
@@ -17,6 +18,8 @@ Noise::Noise(NodeRef frequency, bool interpolate, NodeRef min, NodeRef max) : fr
 	this->add_input("max", this->max);
 
 	this->interpolate = interpolate;
+	this->shared_state = true;
+	this->can_process_at_control_rate = true;
 
 	for (int i = 0; i < SIGNAL_MAX_CHANNELS; i++)
 		this->value[i] = std::numeric_limits<float>::max();
@@ -24,6 +27,34 @@ Noise::Noise(NodeRef frequency, bool interpolate, NodeRef min, NodeRef max) : fr
 	memset(this->step_change, 0, sizeof(int) * SIGNAL_MAX_CHANNELS);
 }
 
+void Noise::next_target(int channel, float min, float max, float frequency)
+{
+	if (!frequency)
+		frequency = this->graph->sample_rate;
+
+	// pick a new target value
+	float target = random_uniform(min, max);
+
+	if (frequency > 0)
+	{
+		this->steps_remaining[channel] = random_integer(0, this->graph->sample_rate / (frequency / 2.0));
+		if (this->steps_remaining[channel] == 0)
+			this->steps_remaining[channel] = 1;
+		this->step_change[channel] = (target - this->value[channel]) / this->steps_remaining[channel];
+	}
+	else
+	{
+		this->steps_remaining[channel] = 0;
+		this->step_change[channel] = target - this->value[channel];
+	}
+
+	if (!this->interpolate)
+	{
+		this->value[channel] = target;
+		this->step_change[channel] = 0;
+	}
+}
+
 void Noise::process(sample **out, int num_frames)
 {
 	for (int channel = 0; channel < this->num_output_channels; channel++)
@@ -35,38 +66,37 @@ void Noise::process(sample **out, int num_frames)
 			this->value[channel] = this->min->out[0][0];
 		}
 
+		if (this->rate == SIGNAL_RATE_CONTROL)
+		{
+			/*------------------------------------------------------------------------
+			 * At control rate, output the value at the start of the block,
+			 * then advance the random walk by the full block in segments
+			 * between successive targets.
+			 *-----------------------------------------------------------------------*/
+			this->write_control_value(out, num_frames, channel, this->value[channel]);
+
+			int frames_remaining = num_frames;
+			while (frames_remaining > 0)
+			{
+				if (this->steps_remaining[channel] <= 0)
+					this->next_target(channel, this->min->out[channel][0], this->max->out[channel][0], this->frequency->out[channel][0]);
+
+				int steps = std::max(1, std::min(frames_remaining, this->steps_remaining[channel]));
+				this->value[channel] += this->step_change[channel] * steps;
+				this->steps_remaining[channel] -= steps;
+				frames_remaining -= steps;
+			}
+			continue;
+		}
+
 		for (int frame = 0; frame < num_frames; frame++)
 		{
 			float min = this->min->out[channel][frame];
 			float max = this->max->out[channel][frame];
 			float frequency = this->frequency->out[channel][frame];
-			if (!frequency)
-				frequency = this->graph->sample_rate;
 
 			if (this->steps_remaining[channel] <= 0)
-			{
-				// pick a new target value
-				float target = random_uniform(min, max);
-
-				if (frequency > 0)
-				{
-					this->steps_remaining[channel] = random_integer(0, this->graph->sample_rate / (frequency / 2.0));
-					if (this->steps_remaining[channel] == 0)
-						this->steps_remaining[channel] = 1;
-					this->step_change[channel] = (target - this->value[channel]) / this->steps_remaining[channel];
-				}
-				else
-				{
-					this->steps_remaining[channel] = 0;
-					this->step_change[channel] = target - this->value[channel];
-				}
-
-				if (!this->interpolate)
-				{
-					this->value[channel] = target;
-					this->step_change[channel] = 0;
-				}
-			}
+				this->next_target(channel, min, max, frequency);
 
 			this->value[channel] += this->step_change[channel];
 
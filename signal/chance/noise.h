@@ -33,6 +33,8 @@ namespace libsignal
 	
 	private:
 
+		void next_target(int channel, float min, float max, float frequency);
+
 		int steps_remaining[SIGNAL_MAX_CHANNELS];
 		float step_change[SIGNAL_MAX_CHANNELS];
 
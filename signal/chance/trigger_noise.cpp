@@ -13,24 +13,27 @@ TriggerNoise::TriggerNoise(NodeRef min, NodeRef max, NodeRef clock) : min(min),
 	this->add_input("min", this->min);
 	this->add_input("max", this->max);
 	this->add_input("clock", this->clock);
+	this->shared_state = true;
 
 	for (int i = 0; i < SIGNAL_MAX_CHANNELS; i++)
 		this->value[i] = std::numeric_limits<float>::max();
+	this->triggered = false;
 }
 
 void TriggerNoise::trigger(std::string name, float value)
 {
-	for (int channel = 0; channel < SIGNAL_MAX_CHANNELS; channel++)
-	{
-		this->value[channel] = random_uniform(this->min->out[channel][0], this->max->out[channel][0]);
-	}
+	/*------------------------------------------------------------------------
+	 * Our inputs' output buffers are only valid during processing, so
+	 * pick new values at the start of the next block.
+	 *-----------------------------------------------------------------------*/
+	this->triggered = true;
 }
 
 void TriggerNoise::process(sample **out, int num_frames)
 {
 	for (int channel = 0; channel < this->num_output_channels; channel++)
 	{
-		if (this->value[channel] == std::numeric_limits<float>::max())
+		if (this->value[channel] == std::numeric_limits<float>::max() || this->triggered)
 		{
 			this->value[channel] = random_uniform(this->min->out[channel][0], this->max->out[channel][0]);
 		}
@@ -47,6 +50,7 @@ void TriggerNoise::process(sample **out, int num_frames)
 			this->out[channel][frame] = this->value[channel];
 		}
 	}
+	this->triggered = false;
 }
 
 }
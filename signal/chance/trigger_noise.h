@@ -14,6 +14,7 @@ namespace libsignal
 		NodeRef clock;
 
 		sample value[SIGNAL_MAX_CHANNELS];
+		bool triggered;
 
 		virtual void process(sample **out, int num_frames);
 		virtual void trigger(std::string = SIGNAL_DEFAULT_TRIGGER, float value = 0.0);
@@ -0,0 +1,66 @@
+#include "collector.h"
+
+#include <chrono>
+
+/*------------------------------------------------------------------------
+ * Interval between collection passes, in milliseconds.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_COLLECTOR_INTERVAL 10
+
+namespace libsignal
+{
+
+GarbageCollector::GarbageCollector(int capacity) : retired(capacity)
+{
+	this->num_retired = 0;
+	this->num_reclaimed = 0;
+	this->running = true;
+	this->thread = std::thread(&GarbageCollector::run, this);
+}
+
+GarbageCollector::~GarbageCollector()
+{
+	this->running = false;
+	this->thread.join();
+	this->collect();
+}
+
+void GarbageCollector::retire(std::shared_ptr<void> object)
+{
+	if (!object)
+		return;
+
+	if (this->retired.push(std::move(object)))
+		this->num_retired++;
+}
+
+long GarbageCollector::get_pending_count()
+{
+	return this->num_retired - this->num_reclaimed;
+}
+
+long GarbageCollector::get_reclaimed_count()
+{
+	return this->num_reclaimed;
+}
+
+void GarbageCollector::collect()
+{
+	std::shared_ptr<void> object;
+	while (this->retired.pop(object))
+	{
+		object.reset();
+		this->num_reclaimed++;
+	}
+}
+
+void GarbageCollector::run()
+{
+	while (this->running)
+	{
+		this->collect();
+		std::this_thread::sleep_for(std::chrono::milliseconds(SIGNAL_COLLECTOR_INTERVAL));
+	}
+}
+
+}
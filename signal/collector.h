@@ -0,0 +1,51 @@
+#pragma once
+
+/**-------------------------------------------------------------------------
+ * @file collector.h
+ * @brief GarbageCollector releases objects dropped by the audio thread
+ *        on a background thread.
+ *-----------------------------------------------------------------------*/
+
+#include "constants.h"
+#include "ringbuffer.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace libsignal
+{
+	class GarbageCollector
+	{
+		public:
+			GarbageCollector(int capacity = SIGNAL_MAX_RETIRED_OBJECTS);
+			~GarbageCollector();
+
+			/**------------------------------------------------------------------------
+			 * Hand over a reference to an object that is no longer needed by the
+			 * audio thread. If this was the last reference, the object is
+			 * destroyed on the collector thread. Never blocks, allocates or frees,
+			 * unless the queue is full, in which case the reference is released
+			 * in place.
+			 *------------------------------------------------------------------------*/
+			void retire(std::shared_ptr<void> object);
+
+			/**------------------------------------------------------------------------
+			 * Number of references retired but not yet released, and the total
+			 * number released so far.
+			 *------------------------------------------------------------------------*/
+			long get_pending_count();
+			long get_reclaimed_count();
+
+		private:
+			void run();
+			void collect();
+
+			LockFreeRingBuffer<std::shared_ptr<void>> retired;
+			std::atomic<long> num_retired;
+			std::atomic<long> num_reclaimed;
+
+			std::atomic<bool> running;
+			std::thread thread;
+	};
+}
@@ -13,16 +13,49 @@ typedef RingBuffer <sample> SampleRingBuffer;
 #define SIGNAL_MAX_CHANNELS 32
 
 /*------------------------------------------------------------------------
- * Max supported number of FFT bins.
+ * Max supported number of voices in a Unison oscillator.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_UNISON_MAX_VOICES 16
+
+/*------------------------------------------------------------------------
+ * Number of frames that channel-parallel filters interleave at once.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_LANES_BLOCK_SIZE 32
+
+/*------------------------------------------------------------------------
+ * Max number of coefficients and of control inputs per channel of a
+ * channel-parallel filter, and of identical sections in a Biquad
+ * cascade.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_FILTER_MAX_COEFFICIENTS 6
+#define SIGNAL_FILTER_MAX_CONTROLS 5
+#define SIGNAL_BIQUAD_MAX_STAGES 4
+
+/*------------------------------------------------------------------------
+ * Max supported number of FFT bins, and the default number of samples
+ * between successive FFT windows.
  *-----------------------------------------------------------------------*/
 #define SIGNAL_DEFAULT_FFT_SIZE 8192
 #define SIGNAL_MAX_FFT_SIZE 8192
+#define SIGNAL_DEFAULT_FFT_HOP_SIZE 256
+
+/*------------------------------------------------------------------------
+ * Max number of frames transformed together in one batch, across hops
+ * and channels.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_FFT_MAX_BATCH 16
 
 /*------------------------------------------------------------------------
  * Default sample block size unless otherwise specified.
  *-----------------------------------------------------------------------*/
 #define SIGNAL_DEFAULT_BLOCK_SIZE 256
 
+/*------------------------------------------------------------------------
+ * Default maximum number of frames processed in one block. Larger
+ * hardware buffers are processed in several blocks.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_DEFAULT_MAX_BLOCK_SIZE 1024
+
 /*------------------------------------------------------------------------
  * The default size of a node's output buffer, in samples.
  * Needed because nodes such as AudioOut may be instantiated before the
@@ -30,6 +63,19 @@ typedef RingBuffer <sample> SampleRingBuffer;
  *-----------------------------------------------------------------------*/
 #define SIGNAL_NODE_BUFFER_SIZE 44100
 
+/*------------------------------------------------------------------------
+ * Max number of graph transactions that can be queued for the audio
+ * thread at once. When full, the control thread waits for the next
+ * block boundary.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_MAX_PENDING_TRANSACTIONS 1024
+
+/*------------------------------------------------------------------------
+ * Max number of objects released by the audio thread that can await
+ * collection at once.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_MAX_RETIRED_OBJECTS 4096
+
 /*------------------------------------------------------------------------
  * The default trigger name, used when node->trigger() is called
  * without any parameters.
@@ -64,3 +110,60 @@ typedef enum
 
 #define N_CHANNELS -1
 
+/*------------------------------------------------------------------------
+ * Rate at which a node computes its output: every frame (audio rate),
+ * or once per block (control rate).
+ *-----------------------------------------------------------------------*/
+typedef enum
+{
+	SIGNAL_RATE_AUDIO,
+	SIGNAL_RATE_CONTROL
+} signal_rate_t;
+
+
+/*------------------------------------------------------------------------
+ * Whether an oscillator generates its waveform naively, or with
+ * band-limiting corrections at its discontinuities to reduce aliasing.
+ *-----------------------------------------------------------------------*/
+typedef enum
+{
+	SIGNAL_WAVEFORM_NAIVE,
+	SIGNAL_WAVEFORM_BAND_LIMITED
+} signal_waveform_t;
+
+/*------------------------------------------------------------------------
+ * Waveform shapes for oscillators that can generate several.
+ *-----------------------------------------------------------------------*/
+typedef enum
+{
+	SIGNAL_SHAPE_SAW,
+	SIGNAL_SHAPE_SQUARE,
+	SIGNAL_SHAPE_TRIANGLE
+} signal_shape_t;
+
+/*------------------------------------------------------------------------
+ * Frequency responses for filters that can produce several.
+ *-----------------------------------------------------------------------*/
+typedef enum
+{
+	SIGNAL_FILTER_LOW_PASS,
+	SIGNAL_FILTER_HIGH_PASS,
+	SIGNAL_FILTER_BAND_PASS,
+	SIGNAL_FILTER_NOTCH,
+	SIGNAL_FILTER_PEAK,
+	SIGNAL_FILTER_LOW_SHELF,
+	SIGNAL_FILTER_HIGH_SHELF
+} signal_filter_type_t;
+
+/*------------------------------------------------------------------------
+ * Implementations of the FFT. The default is the fastest available:
+ * Accelerate on Apple platforms, then FFTW if found at configure
+ * time, then the built-in portable implementation.
+ *-----------------------------------------------------------------------*/
+typedef enum
+{
+	SIGNAL_FFT_BACKEND_DEFAULT,
+	SIGNAL_FFT_BACKEND_PORTABLE,
+	SIGNAL_FFT_BACKEND_ACCELERATE,
+	SIGNAL_FFT_BACKEND_FFTW
+} signal_fft_backend_t;
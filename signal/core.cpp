@@ -5,12 +5,14 @@
 #include <stdarg.h>
 
 #include "util.h"
+#include "kernels/kernels.h"
 
 using namespace libsignal;
 
 void signal_init()
 {
 	random_init();
+	vector_kernels_init();
 }
 
 void signal_debug(char const * msg, ... )
@@ -8,6 +8,7 @@ ASR::ASR(NodeRef attack, NodeRef sustain, NodeRef release, NodeRef clock) :
 	attack(attack), sustain(sustain), release(release), clock(clock)
 {
 	this->phase = 0.0;
+	this->can_process_at_control_rate = true;
 
 	this->name = "env-asr";
 	this->add_input("clock", this->clock);
@@ -24,9 +25,66 @@ void ASR::trigger(std::string name, float value)
 	}
 }
 
+sample ASR::get_value(float attack, float sustain, float release)
+{
+	if (this->phase < attack)
+	{
+		/*------------------------------------------------------------------------
+		 * Attack phase.
+		 *-----------------------------------------------------------------------*/
+		return (this->phase / attack);
+	}
+	else if (this->phase <= attack + sustain)
+	{
+		/*------------------------------------------------------------------------
+		 * Sutain phase.
+		 *-----------------------------------------------------------------------*/
+		return 1.0;
+	}
+	else if (this->phase < attack + sustain + release)
+	{
+		/*------------------------------------------------------------------------
+		 * Release phase.
+		 *-----------------------------------------------------------------------*/
+		return 1.0 - (this->phase - (attack + sustain)) / release;
+	}
+	else
+	{
+		/*------------------------------------------------------------------------
+		 * Envelope has finished.
+		 *-----------------------------------------------------------------------*/
+		return 0.0;
+	}
+}
+
 void ASR::process(sample **out, int num_frames)
 {
-	sample rv;
+	if (this->rate == SIGNAL_RATE_CONTROL)
+	{
+		/*------------------------------------------------------------------------
+		 * At control rate, the envelope is evaluated once at the start of the
+		 * block. A trigger mid-block restarts the phase from that frame.
+		 *-----------------------------------------------------------------------*/
+		int trigger_frame = -1;
+		if (this->clock)
+		{
+			for (int frame = 0; frame < num_frames; frame++)
+			{
+				if (SIGNAL_CHECK_TRIGGER(this->clock, frame))
+					trigger_frame = frame;
+			}
+		}
+
+		sample rv = this->get_value(this->attack->out[0][0], this->sustain->out[0][0], this->release->out[0][0]);
+		for (int channel = 0; channel < this->num_output_channels; channel++)
+			this->write_control_value(out, num_frames, channel, rv);
+
+		if (trigger_frame >= 0)
+			this->phase = (num_frames - trigger_frame) / this->graph->sample_rate;
+		else
+			this->phase += num_frames / this->graph->sample_rate;
+		return;
+	}
 
 	for (int frame = 0; frame < num_frames; frame++)
 	{
@@ -38,35 +96,7 @@ void ASR::process(sample **out, int num_frames)
 		float attack = this->attack->out[0][frame];
 		float sustain = this->sustain->out[0][frame];
 		float release = this->release->out[0][frame];
-
-		if (this->phase < attack)
-		{
-			/*------------------------------------------------------------------------
-			 * Attack phase.
-			 *-----------------------------------------------------------------------*/
-			rv = (this->phase / attack);
-		}
-		else if (this->phase <= attack + sustain)
-		{
-			/*------------------------------------------------------------------------
-			 * Sutain phase.
-			 *-----------------------------------------------------------------------*/
-			rv = 1.0;
-		}
-		else if (this->phase < attack + sustain + release)
-		{
-			/*------------------------------------------------------------------------
-			 * Release phase.
-			 *-----------------------------------------------------------------------*/
-			rv = 1.0 - (this->phase - (attack + sustain)) / release;
-		}
-		else
-		{
-			/*------------------------------------------------------------------------
-			 * Envelope has finished.
-			 *-----------------------------------------------------------------------*/
-			rv = 0.0;
-		}
+		sample rv = this->get_value(attack, sustain, release);
 
 		this->phase += 1.0 / this->graph->sample_rate;
 
@@ -20,6 +20,9 @@ class ASR : public Node
 
 		virtual void trigger(std::string name = SIGNAL_DEFAULT_TRIGGER, float value = 1.0);
 		virtual void process(sample **out, int num_frames);
+
+	private:
+		sample get_value(float attack, float sustain, float release);
 };
 
 REGISTER(ASR, "env-asr");
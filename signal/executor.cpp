@@ -0,0 +1,337 @@
+#include "executor.h"
+#include "core.h"
+
+#include <chrono>
+
+#ifdef __linux__
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+/*------------------------------------------------------------------------
+ * Number of empty polls before an idle worker yields, and then sleeps.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_EXECUTOR_SPIN_COUNT 2048
+#define SIGNAL_EXECUTOR_YIELD_COUNT 4096
+
+namespace libsignal
+{
+
+TaskDeque::TaskDeque(int capacity)
+{
+	this->tasks = std::unique_ptr<std::atomic<int>[]>(new std::atomic<int>[capacity]);
+	this->mask = capacity - 1;
+	this->top = 0;
+	this->bottom = 0;
+}
+
+void TaskDeque::push(int task)
+{
+	long b = this->bottom.load(std::memory_order_relaxed);
+	this->tasks[b & this->mask].store(task, std::memory_order_relaxed);
+	this->bottom.store(b + 1, std::memory_order_release);
+}
+
+bool TaskDeque::pop(int &task)
+{
+	long b = this->bottom.load(std::memory_order_relaxed) - 1;
+	this->bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long t = this->top.load(std::memory_order_relaxed);
+
+	if (t > b)
+	{
+		/*------------------------------------------------------------------------
+		 * Deque was empty.
+		 *-----------------------------------------------------------------------*/
+		this->bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	task = this->tasks[b & this->mask].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		/*------------------------------------------------------------------------
+		 * Last remaining item: race against any concurrent thieves.
+		 *-----------------------------------------------------------------------*/
+		bool won = this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		this->bottom.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+
+	return true;
+}
+
+bool TaskDeque::steal(int &task)
+{
+	long t = this->top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long b = this->bottom.load(std::memory_order_acquire);
+
+	if (t >= b)
+		return false;
+
+	task = this->tasks[t & this->mask].load(std::memory_order_relaxed);
+	return this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+ParallelExecutor::ParallelExecutor(int num_threads, bool deterministic)
+{
+	this->num_threads = num_threads;
+	this->deterministic = deterministic;
+	this->num_frames = 0;
+	this->remaining = 0;
+	this->tasks = NULL;
+
+	this->running = true;
+	this->suspended = false;
+	this->busy_workers = 0;
+
+	/*------------------------------------------------------------------------
+	 * Worker 0 is the thread that calls process() (normally the audio
+	 * thread), so we only need to spawn num_threads - 1 workers.
+	 *-----------------------------------------------------------------------*/
+	for (int index = 1; index < num_threads; index++)
+		this->threads.push_back(std::thread(&ParallelExecutor::run_worker, this, index));
+
+	signal_debug("ParallelExecutor: started %d worker threads", num_threads - 1);
+}
+
+ParallelExecutor::~ParallelExecutor()
+{
+	this->running = false;
+	this->condition.notify_all();
+
+	for (std::thread &thread : this->threads)
+		thread.join();
+}
+
+ParallelTaskGraph *ParallelExecutor::compile(std::vector<AudioGraphStep> &schedule)
+{
+	ParallelTaskGraph *tasks = new ParallelTaskGraph();
+	int num_tasks = schedule.size();
+
+	tasks->dependency_count.assign(num_tasks, 0);
+
+	/*------------------------------------------------------------------------
+	 * Each step depends upon the steps that generate its inputs, and
+	 * upon the last readers of any pooled buffers that it reuses.
+	 * In deterministic mode, steps with shared state are additionally
+	 * chained together in schedule order.
+	 *-----------------------------------------------------------------------*/
+	std::vector<std::pair<int, int>> edges;
+	int last_shared_task = -1;
+
+	for (int index = 0; index < num_tasks; index++)
+	{
+		Node *node = schedule[index].node.get();
+		tasks->steps.push_back(&schedule[index]);
+		tasks->shared_state.push_back(node->shared_state);
+
+		for (int input : schedule[index].inputs)
+			edges.push_back(std::make_pair(input, index));
+
+		for (int dependency : schedule[index].buffer_dependencies)
+			edges.push_back(std::make_pair(dependency, index));
+
+		if (node->shared_state)
+		{
+			if (this->deterministic && last_shared_task >= 0)
+				edges.push_back(std::make_pair(last_shared_task, index));
+			last_shared_task = index;
+			tasks->shared_tasks.push_back(index);
+		}
+	}
+
+	tasks->dependents_offset.assign(num_tasks + 1, 0);
+	for (auto edge : edges)
+	{
+		tasks->dependents_offset[edge.first + 1]++;
+		tasks->dependency_count[edge.second]++;
+	}
+	for (int index = 0; index < num_tasks; index++)
+		tasks->dependents_offset[index + 1] += tasks->dependents_offset[index];
+
+	std::vector<int> fill(tasks->dependents_offset.begin(), tasks->dependents_offset.end() - 1);
+	tasks->dependents.assign(edges.size(), 0);
+	for (auto edge : edges)
+		tasks->dependents[fill[edge.first]++] = edge.second;
+
+	tasks->pending = std::unique_ptr<std::atomic<int>[]>(new std::atomic<int>[num_tasks]);
+	tasks->shared_task_done.assign(tasks->shared_tasks.size(), false);
+
+	int capacity = 1;
+	while (capacity <= num_tasks)
+		capacity *= 2;
+	for (int index = 0; index < this->num_threads; index++)
+		tasks->deques.push_back(std::unique_ptr<TaskDeque>(new TaskDeque(capacity)));
+
+	signal_debug("ParallelExecutor: compiled %d tasks, %d edges", num_tasks, (int) edges.size());
+
+	return tasks;
+}
+
+void ParallelExecutor::install(ParallelTaskGraph *tasks)
+{
+	/*------------------------------------------------------------------------
+	 * Wait for any workers that are mid-way through polling to finish
+	 * before we replace the structures that they read.
+	 *-----------------------------------------------------------------------*/
+	this->suspended = true;
+	while (this->busy_workers > 0)
+		std::this_thread::yield();
+
+	this->tasks = tasks;
+
+	this->suspended = false;
+}
+
+void ParallelExecutor::process(int num_frames)
+{
+	ParallelTaskGraph *tasks = this->tasks;
+	int num_tasks = tasks->steps.size();
+
+	this->num_frames = num_frames;
+	for (int index = 0; index < num_tasks; index++)
+		tasks->pending[index].store(tasks->dependency_count[index], std::memory_order_relaxed);
+	tasks->shared_task_done.assign(tasks->shared_tasks.size(), false);
+	this->remaining.store(num_tasks, std::memory_order_release);
+
+	/*------------------------------------------------------------------------
+	 * Seed our own deque with every task that has no dependencies;
+	 * idle workers will steal from it.
+	 *-----------------------------------------------------------------------*/
+	for (int index = 0; index < num_tasks; index++)
+	{
+		if (tasks->dependency_count[index] == 0 && !tasks->shared_state[index])
+			tasks->deques[0]->push(index);
+	}
+	this->condition.notify_all();
+
+	while (this->remaining.load(std::memory_order_acquire) > 0)
+	{
+		/*------------------------------------------------------------------------
+		 * Tasks with shared state are only ever run on this thread.
+		 *-----------------------------------------------------------------------*/
+		bool ran_shared = false;
+		for (int index = 0; index < (int) tasks->shared_tasks.size(); index++)
+		{
+			if (tasks->shared_task_done[index])
+				continue;
+
+			int task = tasks->shared_tasks[index];
+			if (tasks->pending[task].load(std::memory_order_acquire) == 0)
+			{
+				this->run_task(task, 0);
+				tasks->shared_task_done[index] = true;
+				ran_shared = true;
+				break;
+			}
+
+			if (this->deterministic)
+				break;
+		}
+
+		if (!ran_shared)
+			this->run_next(0);
+	}
+}
+
+void ParallelExecutor::run_task(int task_index, int worker_index)
+{
+	ParallelTaskGraph *tasks = this->tasks;
+	tasks->steps[task_index]->process(this->num_frames);
+
+	/*------------------------------------------------------------------------
+	 * Release any dependents that are now ready. These go on our own
+	 * deque, so that they are likely to run while our output is in cache.
+	 *-----------------------------------------------------------------------*/
+	for (int index = tasks->dependents_offset[task_index]; index < tasks->dependents_offset[task_index + 1]; index++)
+	{
+		int dependent = tasks->dependents[index];
+		if (tasks->pending[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1 && !tasks->shared_state[dependent])
+			tasks->deques[worker_index]->push(dependent);
+	}
+
+	this->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool ParallelExecutor::run_next(int worker_index)
+{
+	ParallelTaskGraph *tasks = this->tasks;
+	int task;
+
+	if (!tasks)
+		return false;
+
+	if (tasks->deques[worker_index]->pop(task))
+	{
+		this->run_task(task, worker_index);
+		return true;
+	}
+
+	for (int offset = 1; offset < this->num_threads; offset++)
+	{
+		int victim = (worker_index + offset) % this->num_threads;
+		if (tasks->deques[victim]->steal(task))
+		{
+			this->run_task(task, worker_index);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ParallelExecutor::run_worker(int worker_index)
+{
+	#ifdef __linux__
+
+		/*------------------------------------------------------------------------
+		 * Pin each worker to its own core to preserve cache locality.
+		 *-----------------------------------------------------------------------*/
+		int num_cores = std::thread::hardware_concurrency();
+		if (num_cores > 0)
+		{
+			cpu_set_t cpu_set;
+			CPU_ZERO(&cpu_set);
+			CPU_SET(worker_index % num_cores, &cpu_set);
+			pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+		}
+
+	#endif
+
+	int idle_count = 0;
+
+	while (this->running)
+	{
+		bool ran = false;
+
+		this->busy_workers++;
+		if (!this->suspended)
+			ran = this->run_next(worker_index);
+		this->busy_workers--;
+
+		if (ran)
+		{
+			idle_count = 0;
+		}
+		else if (++idle_count > SIGNAL_EXECUTOR_YIELD_COUNT)
+		{
+			/*------------------------------------------------------------------------
+			 * The audio thread never takes this lock: it only notifies.
+			 * A missed notification costs at most one timeout, during which
+			 * the audio thread processes the block itself.
+			 *-----------------------------------------------------------------------*/
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->condition.wait_for(lock, std::chrono::milliseconds(1));
+			idle_count = SIGNAL_EXECUTOR_SPIN_COUNT;
+		}
+		else if (idle_count > SIGNAL_EXECUTOR_SPIN_COUNT)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+/**-------------------------------------------------------------------------
+ * @file executor.h
+ * @brief ParallelExecutor processes a compiled AudioGraph schedule
+ *        across a pool of worker threads.
+ *-----------------------------------------------------------------------*/
+
+#include "graph.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * Fixed-capacity Chase-Lev work-stealing deque of task indices.
+	 *
+	 * The owning thread pushes and pops at the bottom; any other thread
+	 * may steal from the top. Capacity must be a power of two, and greater
+	 * than the number of tasks that can be enqueued at once.
+	 *------------------------------------------------------------------------*/
+	class TaskDeque
+	{
+		public:
+			TaskDeque(int capacity);
+
+			void push(int task);
+			bool pop(int &task);
+			bool steal(int &task);
+
+		private:
+			std::unique_ptr<std::atomic<int>[]> tasks;
+			long mask;
+			std::atomic<long> top;
+			std::atomic<long> bottom;
+	};
+
+	/**------------------------------------------------------------------------
+	 * The task graph of one compiled schedule, built by
+	 * ParallelExecutor::compile() off the audio thread, and owned by
+	 * the schedule.
+	 *------------------------------------------------------------------------*/
+	class ParallelTaskGraph
+	{
+		public:
+			/*------------------------------------------------------------------------
+			 * Task graph, in compressed form: the dependents of task i are
+			 * dependents[dependents_offset[i] .. dependents_offset[i + 1]].
+			 *-----------------------------------------------------------------------*/
+			std::vector<AudioGraphStep *> steps;
+			std::vector<int> dependency_count;
+			std::vector<int> dependents_offset;
+			std::vector<int> dependents;
+			std::vector<bool> shared_state;
+
+			/*------------------------------------------------------------------------
+			 * Tasks touching shared state are never stolen; they are run by the
+			 * audio thread, in schedule order when deterministic.
+			 *-----------------------------------------------------------------------*/
+			std::vector<int> shared_tasks;
+			std::vector<bool> shared_task_done;
+
+			std::unique_ptr<std::atomic<int>[]> pending;
+			std::vector<std::unique_ptr<TaskDeque>> deques;
+	};
+
+	class ParallelExecutor
+	{
+		public:
+			ParallelExecutor(int num_threads, bool deterministic = false);
+			~ParallelExecutor();
+
+			/**------------------------------------------------------------------------
+			 * Build the task dependency graph for a compiled schedule. Allocates,
+			 * so is called off the audio thread; the result is handed to
+			 * install() once the schedule is in place.
+			 *------------------------------------------------------------------------*/
+			ParallelTaskGraph *compile(std::vector<AudioGraphStep> &schedule);
+
+			/**------------------------------------------------------------------------
+			 * Process subsequent blocks with `tasks`. Called from the audio
+			 * thread (or before processing begins), and doesn't allocate.
+			 *------------------------------------------------------------------------*/
+			void install(ParallelTaskGraph *tasks);
+
+			/**------------------------------------------------------------------------
+			 * Process one block of the schedule. The calling thread participates
+			 * in processing, and returns once every step has completed.
+			 *------------------------------------------------------------------------*/
+			void process(int num_frames);
+
+			int num_threads;
+			bool deterministic;
+
+		private:
+
+			void run_worker(int worker_index);
+			bool run_next(int worker_index);
+			void run_task(int task_index, int worker_index);
+
+			ParallelTaskGraph *tasks;
+			std::atomic<int> remaining;
+			int num_frames;
+
+			/*------------------------------------------------------------------------
+			 * Worker pool state. Workers spin briefly when idle, then sleep
+			 * until woken at the start of the next block.
+			 *-----------------------------------------------------------------------*/
+			std::vector<std::thread> threads;
+			std::atomic<bool> running;
+			std::atomic<bool> suspended;
+			std::atomic<int> busy_workers;
+			std::mutex mutex;
+			std::condition_variable condition;
+	};
+}
@@ -0,0 +1,21 @@
+#include "fastmath.h"
+
+#include <math.h>
+
+namespace libsignal
+{
+
+/*--------------------------------------------------------------------*
+ * Built once, before main(), in full precision.
+ *--------------------------------------------------------------------*/
+static const float *build_midi_note_frequencies()
+{
+	static float table[128];
+	for (int note = 0; note < 128; note++)
+		table[note] = 440.0 * pow(2.0, (note - 69) / 12.0);
+	return table;
+}
+
+const float *midi_note_frequencies = build_midi_note_frequencies();
+
+}
@@ -0,0 +1,260 @@
+/*--------------------------------------------------------------------*
+ * fastmath.h: Fast approximations to transcendental functions.
+ *
+ * For per-sample use in node process() loops. Each function is inline,
+ * branch-free and calls no library functions, so that loops which
+ * call it can be vectorised by the compiler. Arguments are assumed to
+ * be finite; error bounds are given for each function, measured over
+ * the stated range.
+ *--------------------------------------------------------------------*/
+
+#pragma once
+
+#include "constants.h"
+
+#include <stdint.h>
+
+namespace libsignal
+{
+	/*--------------------------------------------------------------------*
+	 * Reinterpret the bits of a float as an integer, and back.
+	 *--------------------------------------------------------------------*/
+	union fast_float_bits
+	{
+		float value;
+		int32_t bits;
+	};
+
+	inline float fast_bits_to_float(int32_t bits)
+	{
+		fast_float_bits converter;
+		converter.bits = bits;
+		return converter.value;
+	}
+
+	inline int32_t fast_float_to_bits(float value)
+	{
+		fast_float_bits converter;
+		converter.value = value;
+		return converter.bits;
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_clamp(): Constrain x between two bounds. Written with bit
+	 * masks, as GCC turns a float select into a branch when the result
+	 * is used in further arithmetic, and then can't vectorise.
+	 *--------------------------------------------------------------------*/
+	inline float fast_clamp(float x, float min, float max)
+	{
+		int32_t below = -(int32_t) (x < min);
+		int32_t above = -(int32_t) (x > max);
+		int32_t bits = fast_float_to_bits(x);
+		bits = (bits & ~below) | (fast_float_to_bits(min) & below);
+		bits = (bits & ~above) | (fast_float_to_bits(max) & above);
+		return fast_bits_to_float(bits);
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_select(): a if condition is true, otherwise b. Bit masks, for
+	 * the same reason as fast_clamp().
+	 *--------------------------------------------------------------------*/
+	inline float fast_select(bool condition, float a, float b)
+	{
+		int32_t mask = -(int32_t) condition;
+		return fast_bits_to_float((fast_float_to_bits(a) & mask) | (fast_float_to_bits(b) & ~mask));
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_floor_int(), fast_floor(): Largest integer not greater than x,
+	 * for |x| < 2^31. The correction is applied in integers, as GCC
+	 * does not vectorise the equivalent float select.
+	 *--------------------------------------------------------------------*/
+	inline int32_t fast_floor_int(float x)
+	{
+		int32_t whole = (int32_t) x;
+		return whole - (x < (float) whole);
+	}
+
+	inline float fast_floor(float x)
+	{
+		return (float) fast_floor_int(x);
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_exp2(): 2^x. Relative error < 2e-7.
+	 * Results are clamped to the range 2^-126 to 2^126.
+	 *--------------------------------------------------------------------*/
+	inline float fast_exp2(float x)
+	{
+		x = fast_clamp(x, -126.0f, 126.0f);
+
+		/*--------------------------------------------------------------------*
+		 * 2^x = 2^i * 2^f, with i an integer and f in [-0.5, 0.5].
+		 * Adding 1.5 * 2^23 rounds x to an integer, which can then be read
+		 * from the bits of the sum.
+		 * Minimax polynomial for 2^f from Cephes exp2f.
+		 *--------------------------------------------------------------------*/
+		float shifted = x + 12582912.0f;
+		int32_t whole = fast_float_to_bits(shifted) - 0x4b400000;
+		float f = x - (shifted - 12582912.0f);
+		float p = 1.535336188319500e-4f;
+		p = p * f + 1.339887440266574e-3f;
+		p = p * f + 9.618437357674640e-3f;
+		p = p * f + 5.550332471162809e-2f;
+		p = p * f + 2.402264791363012e-1f;
+		p = p * f + 6.931472028550421e-1f;
+		p = p * f + 1.0f;
+
+		return p * fast_bits_to_float((whole + 127) << 23);
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_log2(): log2(x), for normal x > 0. Absolute error < 2e-7
+	 * for x in [0.5, 2], and relative error < 1e-7 elsewhere.
+	 *--------------------------------------------------------------------*/
+	inline float fast_log2(float x)
+	{
+		/*--------------------------------------------------------------------*
+		 * x = m * 2^e, with m in [sqrt(0.5), sqrt(2)).
+		 * Minimax polynomial for log(1 + z) from Cephes logf.
+		 *--------------------------------------------------------------------*/
+		int32_t bits = fast_float_to_bits(x);
+		int32_t mantissa = (bits & 0x007fffff) | 0x3f800000;
+		int32_t high = mantissa > 0x3fb504f3;
+		float m = fast_bits_to_float(mantissa - (high << 23));
+		float exponent = (float) (((bits >> 23) & 0xff) - 127 + high);
+
+		float z = m - 1.0f;
+		float z2 = z * z;
+		float p = 7.0376836292e-2f;
+		p = p * z - 1.1514610310e-1f;
+		p = p * z + 1.1676998740e-1f;
+		p = p * z - 1.2420140846e-1f;
+		p = p * z + 1.4249322787e-1f;
+		p = p * z - 1.6668057665e-1f;
+		p = p * z + 2.0000714765e-1f;
+		p = p * z - 2.4999993993e-1f;
+		p = p * z + 3.3333331174e-1f;
+		float log_m = z + (z * z2 * p - 0.5f * z2);
+
+		return log_m * 1.44269504088896f + exponent;
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_pow(): x^y, for x > 0, as 2^(y * log2(x)).
+	 * Relative error < 2e-7 + |y * log2(x)| * 1.2e-7.
+	 *--------------------------------------------------------------------*/
+	inline float fast_pow(float x, float y)
+	{
+		return fast_exp2(y * fast_log2(x));
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_sin_phase(): sin(2 * pi * phase), for phase in [0, 1].
+	 * Absolute error < 3e-7. The same polynomial as the sine kernel.
+	 *--------------------------------------------------------------------*/
+	inline float fast_sin_phase(float phase)
+	{
+		float y = phase - 0.5f;
+		float z = (y < 0.5f - y) ? y : 0.5f - y;
+		z = (z > -0.5f - z) ? z : -0.5f - z;
+
+		float z2 = z * z;
+		float p = 1.509464258e+01f;
+		p = p * z2 - 4.205869394e+01f;
+		p = p * z2 + 7.670585975e+01f;
+		p = p * z2 - 8.160524928e+01f;
+		p = p * z2 + 4.134170224e+01f;
+		p = p * z2 - 6.283185307e+00f;
+		return p * z;
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_sin(), fast_cos(): Absolute error < 5e-7 for |x| <= pi. Range
+	 * reduction loses precision as |x| grows, to 3e-5 for |x| < 256.
+	 *--------------------------------------------------------------------*/
+	inline float fast_sin(float x)
+	{
+		float phase = x * 0.159154943f;
+		return fast_sin_phase(phase - fast_floor(phase));
+	}
+
+	inline float fast_cos(float x)
+	{
+		float phase = x * 0.159154943f + 0.25f;
+		return fast_sin_phase(phase - fast_floor(phase));
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_atan2(): atan2(y, x), in [-pi, pi]. Absolute error < 3e-7.
+	 * Returns 0 where x and y are both 0.
+	 *--------------------------------------------------------------------*/
+	inline float fast_atan2(float y, float x)
+	{
+		float ax = fast_bits_to_float(fast_float_to_bits(x) & 0x7fffffff);
+		float ay = fast_bits_to_float(fast_float_to_bits(y) & 0x7fffffff);
+		bool steep = ay > ax;
+		float big = fast_select(steep, ay, ax);
+		float small = fast_select(steep, ax, ay);
+
+		/*--------------------------------------------------------------------*
+		 * atan(t), for t = small / big in [0, 1]. Above tan(pi/8), use
+		 * atan(t) = pi/4 + atan((t - 1) / (t + 1)).
+		 * Minimax polynomial from Cephes atanf.
+		 *--------------------------------------------------------------------*/
+		float t = small / (big + 1e-37f);
+		bool high = t > 0.414213562f;
+		t = fast_select(high, (t - 1.0f) / (t + 1.0f), t);
+		float z = t * t;
+		float p = 8.05374449538e-2f;
+		p = p * z - 1.38776856032e-1f;
+		p = p * z + 1.99777106478e-1f;
+		p = p * z - 3.33329491539e-1f;
+		float r = p * z * t + t + fast_select(high, 0.785398163f, 0.0f);
+
+		r = fast_select(steep, 1.57079633f - r, r);
+		r = fast_select(x < 0.0f, 3.14159265f - r, r);
+		return fast_bits_to_float(fast_float_to_bits(r) | (fast_float_to_bits(y) & 0x80000000));
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_tanh(): Absolute error < 3e-7.
+	 *--------------------------------------------------------------------*/
+	inline float fast_tanh(float x)
+	{
+		float sign = (x < 0) ? -1.0f : 1.0f;
+		float magnitude = x * sign;
+		magnitude = fast_clamp(magnitude, 0.0f, 9.0f);
+		float e = fast_exp2(magnitude * 2.88539008f);
+		return sign * (1.0f - 2.0f / (e + 1.0f));
+	}
+
+	/*--------------------------------------------------------------------*
+	 * fast_freq_to_midi(), fast_midi_to_freq(): As freq_to_midi() and
+	 * midi_to_freq(). Absolute error < 2e-5 semitones for frequencies
+	 * in the audible range, and relative error < 5e-7 in frequency.
+	 *--------------------------------------------------------------------*/
+	inline float fast_freq_to_midi(float frequency)
+	{
+		return 69.0f + 12.0f * fast_log2(frequency * (1.0f / 440.0f));
+	}
+
+	inline float fast_midi_to_freq(float midi)
+	{
+		return 440.0f * fast_exp2((midi - 69.0f) * (1.0f / 12.0f));
+	}
+
+	/*--------------------------------------------------------------------*
+	 * Frequency of each MIDI note from 0 to 127, exact to float precision.
+	 *--------------------------------------------------------------------*/
+	extern const float *midi_note_frequencies;
+
+	/*--------------------------------------------------------------------*
+	 * midi_note_to_freq(): Frequency of a whole-numbered MIDI note, read
+	 * from the table for notes 0 to 127.
+	 *--------------------------------------------------------------------*/
+	inline float midi_note_to_freq(int note)
+	{
+		return ((unsigned int) note < 128) ? midi_note_frequencies[note] : fast_midi_to_freq(note);
+	}
+}
@@ -0,0 +1,101 @@
+#include "abstract.h"
+#include "portable.h"
+#include "accelerate.h"
+#include "fftw.h"
+
+#include "../../kernels/kernels.h"
+
+#include <math.h>
+#include <stdexcept>
+
+namespace libsignal
+{
+
+FFTBackend_Abstract::FFTBackend_Abstract(int fft_size)
+{
+	if (fft_size < 4 || (fft_size & (fft_size - 1)))
+		throw std::runtime_error("FFT size must be a power of two, and at least 4");
+
+	this->fft_size = fft_size;
+	this->num_bins = fft_size / 2;
+}
+
+FFTBackend_Abstract *FFTBackend_Abstract::create(int fft_size, signal_fft_backend_t backend)
+{
+	if (backend == SIGNAL_FFT_BACKEND_DEFAULT)
+	{
+		#if defined(__APPLE__)
+		backend = SIGNAL_FFT_BACKEND_ACCELERATE;
+		#elif defined(HAVE_FFTW3F)
+		backend = SIGNAL_FFT_BACKEND_FFTW;
+		#else
+		backend = SIGNAL_FFT_BACKEND_PORTABLE;
+		#endif
+	}
+
+	switch (backend)
+	{
+		#ifdef __APPLE__
+		case SIGNAL_FFT_BACKEND_ACCELERATE:
+			return new FFTBackend_Accelerate(fft_size);
+		#endif
+
+		#ifdef HAVE_FFTW3F
+		case SIGNAL_FFT_BACKEND_FFTW:
+			return new FFTBackend_FFTW(fft_size);
+		#endif
+
+		case SIGNAL_FFT_BACKEND_PORTABLE:
+			return new FFTBackend_Portable(fft_size);
+
+		default:
+			throw std::runtime_error("FFT backend is not available on this system");
+	}
+}
+
+void FFTBackend_Abstract::forward_batch(const sample *in, sample *out, int count)
+{
+	for (int index = 0; index < count; index++)
+		this->forward(in + index * this->fft_size, out + index * this->fft_size);
+}
+
+void FFTBackend_Abstract::inverse_batch(const sample *in, sample *out, int count)
+{
+	for (int index = 0; index < count; index++)
+		this->inverse(in + index * this->fft_size, out + index * this->fft_size);
+}
+
+void fft_hann_window(sample *window, int fft_size)
+{
+	/*------------------------------------------------------------------------
+	 * vDSP_HANN_NORM scales the window by sqrt(2/3), for unity gain when
+	 * windowed frames overlap by 75% and are windowed again on resynthesis.
+	 *-----------------------------------------------------------------------*/
+	for (int n = 0; n < fft_size; n++)
+		window[n] = sqrt(2.0 / 3.0) * 0.5 * (1.0 - cos(2.0 * M_PI * n / fft_size));
+}
+
+void fft_to_polar(const sample *spectrum, sample *magnitudes, sample *phases, int num_bins)
+{
+	vector_fft_polar(spectrum, spectrum + num_bins, magnitudes, phases, num_bins);
+}
+
+void fft_from_polar(const sample *magnitudes, const sample *phases, sample *spectrum, int num_bins)
+{
+	vector_fft_cartesian(magnitudes, phases, spectrum, spectrum + num_bins, num_bins);
+}
+
+void fft_multiply_accumulate(const sample *a, const sample *b, sample *out, int num_bins)
+{
+	/*------------------------------------------------------------------------
+	 * DC and Nyquist are real, so bin 0 is two products rather than one
+	 * complex product.
+	 *-----------------------------------------------------------------------*/
+	sample dc = out[0] + a[0] * b[0];
+	sample nyquist = out[num_bins] + a[num_bins] * b[num_bins];
+	vector_complex_mac(a, a + num_bins, b, b + num_bins, out, out + num_bins, num_bins);
+	out[0] = dc;
+	out[num_bins] = nyquist;
+}
+
+}
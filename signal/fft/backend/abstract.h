@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../../constants.h"
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * A real-to-complex FFT of one size.
+	 *
+	 * Spectra are packed split complex, as vDSP_fft_zrip: the real parts
+	 * of bins 0 to fft_size/2 - 1 are followed by their imaginary parts,
+	 * with the (real) Nyquist bin held in place of bin 0's imaginary
+	 * part. Every backend matches vDSP's scaling, so the forward
+	 * transform is twice the DFT, and a forward then inverse transform
+	 * scales the signal by 2 * fft_size.
+	 *
+	 * Buffers are fft_size samples, and may not overlap.
+	 *------------------------------------------------------------------------*/
+	class FFTBackend_Abstract
+	{
+		public:
+			FFTBackend_Abstract(int fft_size);
+			virtual ~FFTBackend_Abstract() {}
+
+			virtual void forward(const sample *in, sample *out) = 0;
+			virtual void inverse(const sample *in, sample *out) = 0;
+
+			/*------------------------------------------------------------------------
+			 * Transform `count` consecutive frames of fft_size samples. Backends
+			 * which can run transforms side by side override these.
+			 *-----------------------------------------------------------------------*/
+			virtual void forward_batch(const sample *in, sample *out, int count);
+			virtual void inverse_batch(const sample *in, sample *out, int count);
+
+			/*------------------------------------------------------------------------
+			 * Create a backend of the given type. Throws if the backend was not
+			 * compiled in, or if fft_size is not a power of two.
+			 *-----------------------------------------------------------------------*/
+			static FFTBackend_Abstract *create(int fft_size,
+			                                   signal_fft_backend_t backend = SIGNAL_FFT_BACKEND_DEFAULT);
+
+			int fft_size;
+			int num_bins;
+	};
+
+	/*------------------------------------------------------------------------
+	 * Hann window, scaled as vDSP_HANN_NORM.
+	 *-----------------------------------------------------------------------*/
+	void fft_hann_window(sample *window, int fft_size);
+
+	/*------------------------------------------------------------------------
+	 * Convert between a packed split spectrum and magnitudes and phases.
+	 * As vDSP_polar, bin 0 pairs DC and Nyquist as if they were the real
+	 * and imaginary parts of one value.
+	 *-----------------------------------------------------------------------*/
+	void fft_to_polar(const sample *spectrum, sample *magnitudes, sample *phases, int num_bins);
+	void fft_from_polar(const sample *magnitudes, const sample *phases, sample *spectrum, int num_bins);
+
+	/*------------------------------------------------------------------------
+	 * Multiply two packed split spectra and add the result to `out`, which
+	 * may not overlap either of them.
+	 *-----------------------------------------------------------------------*/
+	void fft_multiply_accumulate(const sample *a, const sample *b, sample *out, int num_bins);
+}
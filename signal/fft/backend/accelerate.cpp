@@ -0,0 +1,87 @@
+#include "accelerate.h"
+
+#ifdef __APPLE__
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace libsignal
+{
+
+FFTBackend_Accelerate::FFTBackend_Accelerate(int fft_size) : FFTBackend_Abstract(fft_size)
+{
+	this->log2N = (int) log2((float) fft_size);
+	this->fft_setup = vDSP_create_fftsetup(this->log2N, FFT_RADIX2);
+	this->buffer = (sample *) calloc(fft_size, sizeof(sample));
+	this->batch_buffer = (sample *) calloc(fft_size * SIGNAL_FFT_MAX_BATCH, sizeof(sample));
+}
+
+FFTBackend_Accelerate::~FFTBackend_Accelerate()
+{
+	vDSP_destroy_fftsetup(this->fft_setup);
+	free(this->buffer);
+	free(this->batch_buffer);
+}
+
+void FFTBackend_Accelerate::forward(const sample *in, sample *out)
+{
+	DSPSplitComplex output_split = { out, out + this->num_bins };
+
+	/*------------------------------------------------------------------------
+	 * Convert from interleaved format (sequential pairs) to split format,
+	 * as required by the vDSP real-to-complex functions, then transform
+	 * in place.
+	 *-----------------------------------------------------------------------*/
+	vDSP_ctoz((const DSPComplex *) in, 2, &output_split, 1, this->num_bins);
+	vDSP_fft_zrip(this->fft_setup, &output_split, 1, this->log2N, FFT_FORWARD);
+}
+
+void FFTBackend_Accelerate::inverse(const sample *in, sample *out)
+{
+	DSPSplitComplex buffer_split = { this->buffer, this->buffer + this->num_bins };
+
+	memcpy(this->buffer, in, this->fft_size * sizeof(sample));
+	vDSP_fft_zrip(this->fft_setup, &buffer_split, 1, this->log2N, FFT_INVERSE);
+	vDSP_ztoc(&buffer_split, 1, (DSPComplex *) out, 2, this->num_bins);
+}
+
+/*------------------------------------------------------------------------
+ * vDSP_fftm_zrip transforms a batch of packed spectra, each starting
+ * fft_size samples after the last, in one call.
+ *-----------------------------------------------------------------------*/
+void FFTBackend_Accelerate::forward_batch(const sample *in, sample *out, int count)
+{
+	for (int index = 0; index < count; index++)
+	{
+		DSPSplitComplex output_split = { out + index * this->fft_size, out + index * this->fft_size + this->num_bins };
+		vDSP_ctoz((const DSPComplex *) (in + index * this->fft_size), 2, &output_split, 1, this->num_bins);
+	}
+
+	DSPSplitComplex output_split = { out, out + this->num_bins };
+	vDSP_fftm_zrip(this->fft_setup, &output_split, 1, this->fft_size, this->log2N, count, FFT_FORWARD);
+}
+
+void FFTBackend_Accelerate::inverse_batch(const sample *in, sample *out, int count)
+{
+	for (int first = 0; first < count; first += SIGNAL_FFT_MAX_BATCH)
+	{
+		int batch = std::min(SIGNAL_FFT_MAX_BATCH, count - first);
+		DSPSplitComplex buffer_split = { this->batch_buffer, this->batch_buffer + this->num_bins };
+
+		memcpy(this->batch_buffer, in + first * this->fft_size, batch * this->fft_size * sizeof(sample));
+		vDSP_fftm_zrip(this->fft_setup, &buffer_split, 1, this->fft_size, this->log2N, batch, FFT_INVERSE);
+
+		for (int index = 0; index < batch; index++)
+		{
+			DSPSplitComplex frame_split = { this->batch_buffer + index * this->fft_size,
+			                                this->batch_buffer + index * this->fft_size + this->num_bins };
+			vDSP_ztoc(&frame_split, 1, (DSPComplex *) (out + (first + index) * this->fft_size), 2, this->num_bins);
+		}
+	}
+}
+
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#ifdef __APPLE__
+
+#include "abstract.h"
+
+#include <Accelerate/Accelerate.h>
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * FFT from Accelerate's vDSP, on macOS and iOS.
+	 *------------------------------------------------------------------------*/
+	class FFTBackend_Accelerate : public FFTBackend_Abstract
+	{
+		public:
+			FFTBackend_Accelerate(int fft_size);
+			virtual ~FFTBackend_Accelerate();
+
+			virtual void forward(const sample *in, sample *out);
+			virtual void inverse(const sample *in, sample *out);
+			virtual void forward_batch(const sample *in, sample *out, int count);
+			virtual void inverse_batch(const sample *in, sample *out, int count);
+
+		private:
+			int log2N;
+			FFTSetup fft_setup;
+			sample *buffer;
+			sample *batch_buffer;
+	};
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include "fftw.h"
+
+#ifdef HAVE_FFTW3F
+
+#include <string.h>
+
+namespace libsignal
+{
+
+FFTBackend_FFTW::FFTBackend_FFTW(int fft_size) : FFTBackend_Abstract(fft_size)
+{
+	/*------------------------------------------------------------------------
+	 * Plans are made on FFTW's own aligned buffers, so that the
+	 * vectorised codelets can be used. FFTW_ESTIMATE avoids timing
+	 * trial transforms, as nodes may be created on the audio thread.
+	 *-----------------------------------------------------------------------*/
+	this->signal = fftwf_alloc_real(fft_size);
+	this->spectrum = fftwf_alloc_complex(fft_size / 2 + 1);
+	this->forward_plan = fftwf_plan_dft_r2c_1d(fft_size, this->signal, this->spectrum, FFTW_ESTIMATE);
+	this->inverse_plan = fftwf_plan_dft_c2r_1d(fft_size, this->spectrum, this->signal, FFTW_ESTIMATE);
+}
+
+FFTBackend_FFTW::~FFTBackend_FFTW()
+{
+	fftwf_destroy_plan(this->forward_plan);
+	fftwf_destroy_plan(this->inverse_plan);
+	fftwf_free(this->signal);
+	fftwf_free(this->spectrum);
+}
+
+void FFTBackend_FFTW::forward(const sample *in, sample *out)
+{
+	int num_bins = this->num_bins;
+	sample *out_real = out;
+	sample *out_imag = out + num_bins;
+
+	memcpy(this->signal, in, this->fft_size * sizeof(sample));
+	fftwf_execute(this->forward_plan);
+
+	out_real[0] = 2.0 * this->spectrum[0][0];
+	out_imag[0] = 2.0 * this->spectrum[num_bins][0];
+	for (int bin = 1; bin < num_bins; bin++)
+	{
+		out_real[bin] = 2.0 * this->spectrum[bin][0];
+		out_imag[bin] = 2.0 * this->spectrum[bin][1];
+	}
+}
+
+void FFTBackend_FFTW::inverse(const sample *in, sample *out)
+{
+	int num_bins = this->num_bins;
+	const sample *in_real = in;
+	const sample *in_imag = in + num_bins;
+
+	/*------------------------------------------------------------------------
+	 * FFTW's inverse is unnormalised, as vDSP's. The spectrum still holds
+	 * the forward factor of two, so the round trip scales by 2 * fft_size.
+	 *-----------------------------------------------------------------------*/
+	this->spectrum[0][0] = in_real[0];
+	this->spectrum[0][1] = 0.0;
+	this->spectrum[num_bins][0] = in_imag[0];
+	this->spectrum[num_bins][1] = 0.0;
+	for (int bin = 1; bin < num_bins; bin++)
+	{
+		this->spectrum[bin][0] = in_real[bin];
+		this->spectrum[bin][1] = in_imag[bin];
+	}
+
+	fftwf_execute(this->inverse_plan);
+	memcpy(out, this->signal, this->fft_size * sizeof(sample));
+}
+
+}
+
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#ifdef HAVE_FFTW3F
+
+#include "abstract.h"
+
+#include <fftw3.h>
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * FFT from FFTW, where it was found at configure time.
+	 *
+	 * FFTW's half-complex spectra are converted to and from the packed
+	 * split format, and scaled to match.
+	 *------------------------------------------------------------------------*/
+	class FFTBackend_FFTW : public FFTBackend_Abstract
+	{
+		public:
+			FFTBackend_FFTW(int fft_size);
+			virtual ~FFTBackend_FFTW();
+
+			virtual void forward(const sample *in, sample *out);
+			virtual void inverse(const sample *in, sample *out);
+
+		private:
+			float *signal;
+			fftwf_complex *spectrum;
+			fftwf_plan forward_plan;
+			fftwf_plan inverse_plan;
+	};
+}
+
+#endif
@@ -0,0 +1,160 @@
+#include "portable.h"
+
+#include "../../kernels/kernels.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <utility>
+
+namespace libsignal
+{
+
+FFTBackend_Portable::FFTBackend_Portable(int fft_size) : FFTBackend_Abstract(fft_size)
+{
+	this->num_points = fft_size / 2;
+
+	/*------------------------------------------------------------------------
+	 * A radix-4 pass over sub-transforms of n points has n / 4 groups of
+	 * butterflies, each with three twiddle factors, exp(-2 pi i j p / n).
+	 *-----------------------------------------------------------------------*/
+	int num_twiddles = 0;
+	for (int n = this->num_points; n >= 4; n /= 4)
+		num_twiddles += 6 * (n / 4);
+
+	this->twiddles = (sample *) calloc(num_twiddles + 1, sizeof(sample));
+	sample *twiddle = this->twiddles;
+	for (int n = this->num_points; n >= 4; n /= 4)
+	{
+		int num_groups = n / 4;
+		for (int j = 1; j <= 3; j++)
+		{
+			for (int group = 0; group < num_groups; group++)
+			{
+				double angle = -2.0 * M_PI * j * group / n;
+				twiddle[group] = cos(angle);
+				twiddle[num_groups + group] = sin(angle);
+			}
+			twiddle += 2 * num_groups;
+		}
+	}
+
+	/*------------------------------------------------------------------------
+	 * Rotations to split the half-length complex transform into the
+	 * spectrum of the real input, exp(-2 pi i k / fft_size), and back.
+	 * Only the first half is needed (see vector_fft_real_split).
+	 *-----------------------------------------------------------------------*/
+	int num_rotations = this->num_points / 2 + 1;
+	this->rotation_real = (sample *) calloc(num_rotations, sizeof(sample));
+	this->rotation_imag = (sample *) calloc(num_rotations, sizeof(sample));
+	this->inverse_rotation_real = (sample *) calloc(num_rotations, sizeof(sample));
+	for (int k = 0; k < num_rotations; k++)
+	{
+		this->rotation_real[k] = cos(2.0 * M_PI * k / fft_size);
+		this->rotation_imag[k] = sin(2.0 * M_PI * k / fft_size);
+		this->inverse_rotation_real[k] = -this->rotation_real[k];
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		this->real[i] = (sample *) calloc(this->num_points, sizeof(sample));
+		this->imag[i] = (sample *) calloc(this->num_points, sizeof(sample));
+	}
+}
+
+FFTBackend_Portable::~FFTBackend_Portable()
+{
+	free(this->twiddles);
+	free(this->rotation_real);
+	free(this->rotation_imag);
+	free(this->inverse_rotation_real);
+	for (int i = 0; i < 2; i++)
+	{
+		free(this->real[i]);
+		free(this->imag[i]);
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Complex FFT of num_points, in place, using the second pair of work
+ * buffers for alternate passes. The inverse transform is the forward
+ * transform of the input with real and imaginary parts swapped, which
+ * inverse() does by swapping the arguments.
+ *-----------------------------------------------------------------------*/
+void FFTBackend_Portable::transform(sample *real, sample *imag)
+{
+	sample *from_real = real, *from_imag = imag;
+	sample *to_real = this->real[1], *to_imag = this->imag[1];
+	const sample *twiddle = this->twiddles;
+	int stride = 1;
+	int n = this->num_points;
+
+	for (; n >= 4; n /= 4)
+	{
+		vector_fft_radix4(from_real, from_imag, twiddle, n / 4, stride, to_real, to_imag);
+		twiddle += 6 * (n / 4);
+		stride *= 4;
+		std::swap(from_real, to_real);
+		std::swap(from_imag, to_imag);
+	}
+	if (n == 2)
+	{
+		vector_fft_radix2(from_real, from_imag, stride, to_real, to_imag);
+		std::swap(from_real, to_real);
+		std::swap(from_imag, to_imag);
+	}
+
+	if (from_real != real)
+	{
+		vector_copy(from_real, real, this->num_points);
+		vector_copy(from_imag, imag, this->num_points);
+	}
+}
+
+void FFTBackend_Portable::forward(const sample *in, sample *out)
+{
+	int num_points = this->num_points;
+	sample *z_real = this->real[0];
+	sample *z_imag = this->imag[0];
+	sample *out_real = out;
+	sample *out_imag = out + num_points;
+
+	/*------------------------------------------------------------------------
+	 * Even and odd input samples become the real and imaginary parts of
+	 * a half-length complex signal, z.
+	 *-----------------------------------------------------------------------*/
+	sample *split[2] = { z_real, z_imag };
+	vector_deinterleave(in, 2, split, num_points);
+	this->transform(z_real, z_imag);
+
+	/*------------------------------------------------------------------------
+	 * With Z the transform of z, the spectrum is twice
+	 *   (Z[k] + Z*[M-k]) / 2 - i exp(-2 pi i k / N) (Z[k] - Z*[M-k]) / 2
+	 * and bin 0 holds DC and Nyquist.
+	 *-----------------------------------------------------------------------*/
+	out_real[0] = 2.0 * (z_real[0] + z_imag[0]);
+	out_imag[0] = 2.0 * (z_real[0] - z_imag[0]);
+	vector_fft_real_split(z_real, z_imag, this->rotation_real, this->rotation_imag, num_points, out_real, out_imag);
+}
+
+void FFTBackend_Portable::inverse(const sample *in, sample *out)
+{
+	int num_points = this->num_points;
+	sample *z_real = this->real[0];
+	sample *z_imag = this->imag[0];
+	const sample *in_real = in;
+	const sample *in_imag = in + num_points;
+
+	/*------------------------------------------------------------------------
+	 * The reverse of forward(), giving 4Z.
+	 *-----------------------------------------------------------------------*/
+	z_real[0] = in_real[0] + in_imag[0];
+	z_imag[0] = in_real[0] - in_imag[0];
+	vector_fft_real_split(in_real, in_imag, this->inverse_rotation_real, this->rotation_imag, num_points, z_real, z_imag);
+
+	this->transform(z_imag, z_real);
+
+	sample *split[2] = { z_real, z_imag };
+	vector_interleave(split, 2, out, num_points);
+}
+
+}
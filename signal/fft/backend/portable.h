@@ -0,0 +1,36 @@
+#pragma once
+
+#include "abstract.h"
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * Built-in FFT, with no external dependencies.
+	 *
+	 * The real input is transformed as a complex signal of half the
+	 * length, by radix-4 Stockham passes (plus one radix-2 pass for odd
+	 * powers of two) which run on the vector kernels. Stockham passes
+	 * are out-of-place but need no bit-reversal, and every pass reads and
+	 * writes contiguous runs.
+	 *------------------------------------------------------------------------*/
+	class FFTBackend_Portable : public FFTBackend_Abstract
+	{
+		public:
+			FFTBackend_Portable(int fft_size);
+			virtual ~FFTBackend_Portable();
+
+			virtual void forward(const sample *in, sample *out);
+			virtual void inverse(const sample *in, sample *out);
+
+		private:
+			void transform(sample *real, sample *imag);
+
+			int num_points;
+			sample *twiddles;
+			sample *rotation_real;
+			sample *rotation_imag;
+			sample *inverse_rotation_real;
+			sample *real[2];
+			sample *imag[2];
+	};
+}
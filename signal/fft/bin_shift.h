@@ -0,0 +1,68 @@
+#pragma once
+
+#include "fftnode.h"
+#include "spectral_kernels.h"
+
+#include <math.h>
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * Spectral frequency shift. Moves each bin up by `shift` bins (or
+	 * down, if negative), shifting every partial by shift * sample_rate /
+	 * fft_size Hz, which makes harmonic sounds inharmonic.
+	 *
+	 * The phases of the moved bins are advanced to match their new
+	 * frequency at each frame's timestamp, so that overlapping frames
+	 * stay coherent. DC and Nyquist (bin 0) are left as they are, and
+	 * partials moved beyond either end of the spectrum are lost.
+	 *------------------------------------------------------------------------*/
+	class FFTBinShift : public FFTOpNode
+	{
+		public:
+			FFTBinShift(NodeRef input = nullptr, NodeRef shift = 0) :
+				FFTOpNode(input), shift(shift)
+			{
+				this->name = "fft_bin_shift";
+
+				this->add_input("shift", this->shift);
+			}
+
+			NodeRef shift;
+
+			virtual void process(sample **out, int num_frames)
+			{
+				SpectralStream *in = this->begin_block(num_frames);
+				if (!in)
+					return;
+
+				int shift = (int) roundf(this->shift->out[0][0]);
+				int num_channels = std::min(this->stream->num_channels, in->num_channels);
+
+				for (int index = 0; index < in->num_frames; index++)
+				{
+					int64_t timestamp = in->timestamp(index);
+					if (!this->stream->append(timestamp))
+						break;
+
+					/*------------------------------------------------------------------------
+					 * A frame's phases are relative to the start of its window, so a
+					 * partial moved up by `shift` bins has turned a further
+					 * shift * timestamp / fft_size cycles since the stream began.
+					 *-----------------------------------------------------------------------*/
+					int64_t cycles = ((int64_t) shift * timestamp) % this->fft_size;
+					sample rotation = 2.0 * M_PI * cycles / this->fft_size;
+
+					for (int channel = 0; channel < num_channels; channel++)
+					{
+						sample *phases = this->stream->phases(index, channel);
+						spectral_shift(in->magnitudes(index, channel), shift, this->stream->magnitudes(index, channel), this->num_bins);
+						spectral_shift(in->phases(index, channel), shift, phases, this->num_bins);
+						vector_add_scalar(phases + 1, rotation, phases + 1, this->num_bins - 1);
+					}
+				}
+			}
+	};
+
+	REGISTER(FFTBinShift, "fft_bin_shift");
+}
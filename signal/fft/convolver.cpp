@@ -0,0 +1,565 @@
+#include "convolver.h"
+
+#include "backend/abstract.h"
+#include "../graph.h"
+#include "../ringbuffer.h"
+#include "../kernels/kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+/*------------------------------------------------------------------------
+ * Longest the background thread sleeps between checks for work, in
+ * milliseconds, and the most partitions it can have queued.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_CONVOLVER_INTERVAL 1
+#define SIGNAL_CONVOLVER_MAX_JOBS 64
+
+namespace libsignal
+{
+
+/*------------------------------------------------------------------------
+ * Smallest power of two that is at least `size`.
+ *-----------------------------------------------------------------------*/
+static int convolver_ring_size(int size)
+{
+	int ring_size = 1;
+	while (ring_size < size)
+		ring_size *= 2;
+	return ring_size;
+}
+
+ConvolverIR::ConvolverIR(BufferRef buffer) : buffer(buffer)
+{
+	this->num_channels = buffer->num_channels;
+	this->length = buffer->num_frames;
+
+	int head_size = SIGNAL_CONVOLVER_HEAD_SIZE;
+	this->head.resize(this->num_channels * head_size);
+	for (int channel = 0; channel < this->num_channels; channel++)
+		for (int tap = 0; tap < std::min(head_size, this->length); tap++)
+			this->head[channel * head_size + head_size - 1 - tap] = buffer->data[channel][tap];
+
+	/*------------------------------------------------------------------------
+	 * Give each level enough partitions that the next, four times the
+	 * size, can start two of its own partitions into the response.
+	 *-----------------------------------------------------------------------*/
+	int offset = head_size;
+	int partition_size = head_size;
+	while (offset < this->length)
+	{
+		int next_size = std::min(partition_size * 4, SIGNAL_CONVOLVER_MAX_PARTITION_SIZE);
+		int num_remaining = (this->length - offset + partition_size - 1) / partition_size;
+		int num_partitions = num_remaining;
+		if (next_size > partition_size)
+			num_partitions = std::min(num_remaining, (2 * next_size - offset + partition_size - 1) / partition_size);
+
+		Level level;
+		level.partition_size = partition_size;
+		level.offset = offset;
+		level.num_partitions = num_partitions;
+		level.spectra.resize(this->num_channels * num_partitions * 2 * partition_size);
+
+		/*------------------------------------------------------------------------
+		 * Transform each partition, zero-padded to twice its size. The
+		 * product of two forward transforms, inverse transformed, is scaled
+		 * by 4 * fft_size, so scale that out here.
+		 *-----------------------------------------------------------------------*/
+		int fft_size = 2 * partition_size;
+		std::unique_ptr<FFTBackend_Abstract> backend(FFTBackend_Abstract::create(fft_size));
+		std::vector<sample> frame(fft_size);
+		for (int channel = 0; channel < this->num_channels; channel++)
+		{
+			for (int partition = 0; partition < num_partitions; partition++)
+			{
+				int start = offset + partition * partition_size;
+				int count = std::min(partition_size, this->length - start);
+				std::fill(frame.begin(), frame.end(), 0.0);
+				memcpy(frame.data(), buffer->data[channel] + start, count * sizeof(sample));
+
+				sample *spectrum = &level.spectra[(channel * num_partitions + partition) * fft_size];
+				backend->forward(frame.data(), spectrum);
+				vector_multiply_scalar(spectrum, 1.0 / (4.0 * fft_size), spectrum, fft_size);
+			}
+		}
+
+		this->levels.push_back(std::move(level));
+		offset += num_partitions * partition_size;
+		partition_size = next_size;
+	}
+}
+
+std::shared_ptr<ConvolverIR> ConvolverIR::get(BufferRef buffer)
+{
+	/*------------------------------------------------------------------------
+	 * A response holds a reference to its buffer, so a buffer can't be
+	 * freed and another allocated in its place while its entry is live.
+	 *-----------------------------------------------------------------------*/
+	static std::mutex mutex;
+	static std::map<Buffer *, std::weak_ptr<ConvolverIR>> responses;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto it = responses.begin(); it != responses.end(); )
+	{
+		if (it->second.expired())
+			it = responses.erase(it);
+		else
+			++it;
+	}
+
+	std::shared_ptr<ConvolverIR> ir = responses[buffer.get()].lock();
+	if (!ir)
+	{
+		ir = std::make_shared<ConvolverIR>(buffer);
+		responses[buffer.get()] = ir;
+	}
+	return ir;
+}
+
+/**------------------------------------------------------------------------
+ * The running state of a Convolver, for one response, number of
+ * channels and maximum block size.
+ *
+ * Each level is a uniformly partitioned convolution by overlap-save:
+ * as each block of partition_size input samples completes, the
+ * transform of it and the block before is kept, and multiplied by the
+ * spectrum of each partition with that of the block as many blocks
+ * earlier. The second half of the inverse transform of their sum is
+ * written to the level's output ring, at the block's start plus the
+ * level's offset into the response.
+ *------------------------------------------------------------------------*/
+class ConvolverEngine
+{
+	public:
+		ConvolverEngine(std::shared_ptr<ConvolverIR> ir, int num_channels, int max_block_size, bool background);
+		~ConvolverEngine();
+
+		/*------------------------------------------------------------------------
+		 * Convolve one input block per channel.
+		 *-----------------------------------------------------------------------*/
+		void process(const sample * const *in, sample **out, int num_frames);
+
+		std::shared_ptr<ConvolverIR> ir;
+		int num_channels;
+		int max_block_size;
+
+		/*------------------------------------------------------------------------
+		 * A block of output for channels that are convolved but not used.
+		 *-----------------------------------------------------------------------*/
+		std::vector<sample> discard;
+
+	private:
+		class Level
+		{
+			public:
+				const ConvolverIR::Level *ir;
+				bool background;
+				std::unique_ptr<FFTBackend_Abstract> backend;
+
+				/*------------------------------------------------------------------------
+				 * Spectra of the last num_partitions input blocks of each channel,
+				 * each in the slot of its block index modulo num_partitions.
+				 *-----------------------------------------------------------------------*/
+				std::vector<sample> inputs;
+
+				/*------------------------------------------------------------------------
+				 * The samples to transform for a block, for each channel. Levels on
+				 * the background thread have two sets, for alternate blocks.
+				 *-----------------------------------------------------------------------*/
+				std::vector<sample> windows;
+
+				std::vector<sample> spectrum;
+				std::vector<sample> frame;
+
+				/*------------------------------------------------------------------------
+				 * Output ring of each channel, indexed by time modulo output_size.
+				 *-----------------------------------------------------------------------*/
+				std::vector<sample> output;
+				int output_size;
+
+				/*------------------------------------------------------------------------
+				 * Number of blocks computed, in order, by the background thread.
+				 *-----------------------------------------------------------------------*/
+				std::atomic<int64_t> num_completed;
+		};
+
+		class Job
+		{
+			public:
+				int level;
+				int64_t block;
+		};
+
+		void compute(Level *level, int64_t block, const sample *windows);
+		void wait(Level *level, int64_t num_blocks);
+		void run();
+
+		std::vector<std::unique_ptr<Level>> levels;
+		int64_t position;
+
+		/*------------------------------------------------------------------------
+		 * Input ring of each channel, indexed by time modulo input_size, and
+		 * the last SIGNAL_CONVOLVER_HEAD_SIZE - 1 input samples followed by
+		 * the current block, for the head.
+		 *-----------------------------------------------------------------------*/
+		std::vector<sample> input;
+		int input_size;
+		std::vector<sample> history;
+		int history_size;
+
+		LockFreeRingBuffer<Job> jobs;
+		std::atomic<bool> running;
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::thread thread;
+};
+
+ConvolverEngine::ConvolverEngine(std::shared_ptr<ConvolverIR> ir, int num_channels, int max_block_size, bool background) :
+	ir(ir), num_channels(num_channels), max_block_size(max_block_size), jobs(SIGNAL_CONVOLVER_MAX_JOBS)
+{
+	this->position = 0;
+	this->running = false;
+	this->discard.resize(max_block_size);
+
+	int max_partition_size = SIGNAL_CONVOLVER_HEAD_SIZE;
+	bool any_background = false;
+	for (const ConvolverIR::Level &ir_level : ir->levels)
+	{
+		int partition_size = ir_level.partition_size;
+		int fft_size = 2 * partition_size;
+
+		Level *level = new Level();
+		level->ir = &ir_level;
+		level->background = background && partition_size >= SIGNAL_CONVOLVER_BACKGROUND_PARTITION_SIZE;
+		level->backend.reset(FFTBackend_Abstract::create(fft_size));
+		level->inputs.resize(num_channels * ir_level.num_partitions * fft_size);
+		level->windows.resize((level->background ? 2 : 1) * num_channels * fft_size);
+		level->spectrum.resize(fft_size);
+		level->frame.resize(fft_size);
+
+		/*------------------------------------------------------------------------
+		 * A block is written up to offset + partition_size samples after
+		 * the start of the block in which it completes, and the oldest
+		 * samples still to be read are up to max_block_size before that.
+		 *-----------------------------------------------------------------------*/
+		level->output_size = convolver_ring_size(ir_level.offset + partition_size + max_block_size);
+		level->output.resize(num_channels * level->output_size);
+		level->num_completed = 0;
+
+		this->levels.push_back(std::unique_ptr<Level>(level));
+		max_partition_size = std::max(max_partition_size, partition_size);
+		any_background = any_background || level->background;
+	}
+
+	this->input_size = convolver_ring_size(2 * max_partition_size + max_block_size);
+	this->input.resize(num_channels * this->input_size);
+	this->history_size = SIGNAL_CONVOLVER_HEAD_SIZE - 1 + max_block_size;
+	this->history.resize(num_channels * this->history_size);
+
+	if (any_background)
+	{
+		this->running = true;
+		this->thread = std::thread(&ConvolverEngine::run, this);
+	}
+}
+
+ConvolverEngine::~ConvolverEngine()
+{
+	if (this->running)
+	{
+		this->running = false;
+		this->condition.notify_one();
+		this->thread.join();
+	}
+}
+
+void ConvolverEngine::compute(Level *level, int64_t block, const sample *windows)
+{
+	const ConvolverIR::Level *ir_level = level->ir;
+	int partition_size = ir_level->partition_size;
+	int fft_size = 2 * partition_size;
+	int num_partitions = ir_level->num_partitions;
+	int mask = level->output_size - 1;
+	int start = (int) ((block * partition_size + ir_level->offset) & mask);
+	int run = std::min(partition_size, level->output_size - start);
+
+	for (int channel = 0; channel < this->num_channels; channel++)
+	{
+		sample *inputs = &level->inputs[channel * num_partitions * fft_size];
+		level->backend->forward(windows + channel * fft_size, inputs + (block % num_partitions) * fft_size);
+
+		/*------------------------------------------------------------------------
+		 * Blocks before the first are silent, so skip their partitions.
+		 *-----------------------------------------------------------------------*/
+		int ir_channel = channel % this->ir->num_channels;
+		std::fill(level->spectrum.begin(), level->spectrum.end(), 0.0);
+		for (int partition = 0; partition < num_partitions && partition <= block; partition++)
+			fft_multiply_accumulate(inputs + ((block - partition) % num_partitions) * fft_size,
+			                        ir_level->get_spectrum(ir_channel, partition),
+			                        level->spectrum.data(), partition_size);
+
+		level->backend->inverse(level->spectrum.data(), level->frame.data());
+
+		sample *output = &level->output[channel * level->output_size];
+		memcpy(output + start, level->frame.data() + partition_size, run * sizeof(sample));
+		memcpy(output, level->frame.data() + partition_size + run, (partition_size - run) * sizeof(sample));
+	}
+}
+
+void ConvolverEngine::wait(Level *level, int64_t num_blocks)
+{
+	while (level->num_completed.load(std::memory_order_acquire) < num_blocks)
+		std::this_thread::yield();
+}
+
+void ConvolverEngine::run()
+{
+	while (this->running)
+	{
+		Job job;
+		while (this->jobs.pop(job))
+		{
+			Level *level = this->levels[job.level].get();
+			int window_size = this->num_channels * 2 * level->ir->partition_size;
+			this->compute(level, job.block, &level->windows[(job.block & 1) * window_size]);
+			level->num_completed.store(job.block + 1, std::memory_order_release);
+		}
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->condition.wait_for(lock, std::chrono::milliseconds(SIGNAL_CONVOLVER_INTERVAL));
+	}
+}
+
+void ConvolverEngine::process(const sample * const *in, sample **out, int num_frames)
+{
+	int head_size = SIGNAL_CONVOLVER_HEAD_SIZE;
+	int64_t start = this->position;
+	int64_t end = start + num_frames;
+
+	/*------------------------------------------------------------------------
+	 * Keep the input, and convolve it with the head directly.
+	 *-----------------------------------------------------------------------*/
+	int input_mask = this->input_size - 1;
+	int input_start = (int) (start & input_mask);
+	int input_run = std::min(num_frames, this->input_size - input_start);
+	for (int channel = 0; channel < this->num_channels; channel++)
+	{
+		sample *input = &this->input[channel * this->input_size];
+		memcpy(input + input_start, in[channel], input_run * sizeof(sample));
+		memcpy(input, in[channel] + input_run, (num_frames - input_run) * sizeof(sample));
+
+		sample *history = &this->history[channel * this->history_size];
+		const sample *head = this->ir->get_head(channel % this->ir->num_channels);
+		memcpy(history + head_size - 1, in[channel], num_frames * sizeof(sample));
+		for (int frame = 0; frame < num_frames; frame++)
+			out[channel][frame] = vector_dot(history + frame, head, head_size);
+		memmove(history, history + num_frames, (head_size - 1) * sizeof(sample));
+	}
+
+	/*------------------------------------------------------------------------
+	 * Compute, or queue, each block completed in this one. A background
+	 * level's windows for a block can be reused once the block two
+	 * before it is done.
+	 *-----------------------------------------------------------------------*/
+	for (int index = 0; index < (int) this->levels.size(); index++)
+	{
+		Level *level = this->levels[index].get();
+		int partition_size = level->ir->partition_size;
+		int fft_size = 2 * partition_size;
+		int window_size = this->num_channels * fft_size;
+
+		for (int64_t boundary = (start / partition_size + 1) * partition_size; boundary <= end; boundary += partition_size)
+		{
+			int64_t block = boundary / partition_size - 1;
+			sample *windows = level->windows.data();
+			if (level->background)
+			{
+				this->wait(level, block - 1);
+				windows += (block & 1) * window_size;
+			}
+
+			int window_start = (int) ((boundary - fft_size) & input_mask);
+			int window_run = std::min(fft_size, this->input_size - window_start);
+			for (int channel = 0; channel < this->num_channels; channel++)
+			{
+				sample *input = &this->input[channel * this->input_size];
+				memcpy(windows + channel * fft_size, input + window_start, window_run * sizeof(sample));
+				memcpy(windows + channel * fft_size + window_run, input, (fft_size - window_run) * sizeof(sample));
+			}
+
+			if (level->background)
+			{
+				this->jobs.push({ index, block });
+				this->condition.notify_one();
+			}
+			else
+			{
+				this->compute(level, block, windows);
+			}
+		}
+	}
+
+	/*------------------------------------------------------------------------
+	 * Add the output of each level, once every block that it needs is
+	 * complete.
+	 *-----------------------------------------------------------------------*/
+	for (auto &level : this->levels)
+	{
+		const ConvolverIR::Level *ir_level = level->ir;
+		if (level->background && end > ir_level->offset)
+			this->wait(level.get(), (end - 1 - ir_level->offset) / ir_level->partition_size + 1);
+
+		int mask = level->output_size - 1;
+		int output_start = (int) (start & mask);
+		int output_run = std::min(num_frames, level->output_size - output_start);
+		for (int channel = 0; channel < this->num_channels; channel++)
+		{
+			sample *output = &level->output[channel * level->output_size];
+			vector_add(out[channel], output + output_start, out[channel], output_run);
+			vector_add(out[channel] + output_run, output, out[channel] + output_run, num_frames - output_run);
+		}
+	}
+
+	this->position = end;
+}
+
+/*------------------------------------------------------------------------
+ * Number of channels to convolve for the given input and response.
+ *-----------------------------------------------------------------------*/
+static int convolver_num_channels(const NodeRef &input, const BufferRef &buffer)
+{
+	int input_channels = input ? input->num_output_channels : 1;
+	int buffer_channels = buffer ? buffer->num_channels : 1;
+	return std::max(input_channels, buffer_channels);
+}
+
+Convolver::Convolver(NodeRef input, BufferRef buffer, bool background) :
+	input(input), buffer(buffer), background(background)
+{
+	this->name = "convolver";
+
+	this->add_input("input", this->input);
+	this->add_buffer("buffer", this->buffer);
+
+	this->engine = this->create_engine(this->input, this->buffer);
+}
+
+std::shared_ptr<ConvolverEngine> Convolver::create_engine(NodeRef input, BufferRef buffer)
+{
+	if (!buffer)
+		return nullptr;
+
+	int max_block_size = this->graph ? this->graph->max_block_size : SIGNAL_DEFAULT_BLOCK_SIZE;
+	return std::make_shared<ConvolverEngine>(ConvolverIR::get(buffer), convolver_num_channels(input, buffer),
+	                                         max_block_size, this->background);
+}
+
+void Convolver::update_channels()
+{
+	this->num_input_channels = this->input ? this->input->num_output_channels : 1;
+	this->num_output_channels = convolver_num_channels(this->input, this->buffer);
+}
+
+void Convolver::set_input(std::string name, const NodeRef &node)
+{
+	/*------------------------------------------------------------------------
+	 * On the audio thread (as when a Synth reroutes its inputs), keep the
+	 * engine we have; see process().
+	 *-----------------------------------------------------------------------*/
+	if (name != "input" || (this->graph && this->graph->is_audio_thread()))
+	{
+		Node::set_input(name, node);
+		return;
+	}
+
+	this->swap_engine(name, node, this->buffer);
+}
+
+void Convolver::set_buffer(std::string name, BufferRef buffer)
+{
+	if (name != "buffer")
+	{
+		Node::set_buffer(name, buffer);
+		return;
+	}
+
+	this->swap_engine(name, this->input, buffer);
+}
+
+void Convolver::swap_engine(std::string name, NodeRef input, BufferRef buffer)
+{
+	/*------------------------------------------------------------------------
+	 * Partitioning the response and starting the engine are slow, so do
+	 * them on the calling thread, and only swap them on the audio thread.
+	 *-----------------------------------------------------------------------*/
+	std::shared_ptr<ConvolverEngine> engine = this->create_engine(input, buffer);
+
+	AudioGraphTransactionScope transaction(this->is_deferring() ? this->graph : NULL);
+	if (this->is_deferring())
+	{
+		if (name == "input")
+		{
+			this->graph->stage_input(this, name, input);
+			if (input)
+				input->reserve_output(this, name);
+		}
+		this->graph->stage_channels(this, convolver_num_channels(input, buffer));
+	}
+
+	this->defer_edit([this, name, input, buffer, engine]
+	{
+		if (name == "input")
+			this->Node::set_input(name, input);
+		else
+			this->Node::set_buffer(name, buffer);
+
+		std::shared_ptr<ConvolverEngine> previous = this->engine;
+		this->engine = engine;
+		if (this->graph)
+		{
+			this->graph->retire(std::move(previous));
+			this->graph->invalidate_schedule();
+		}
+		this->update_channels();
+	});
+	transaction.commit();
+}
+
+void Convolver::process(sample **out, int num_frames)
+{
+	if (!this->engine || !this->input)
+	{
+		for (int channel = 0; channel < this->num_output_channels; channel++)
+			memset(out[channel], 0, num_frames * sizeof(sample));
+		return;
+	}
+
+	/*------------------------------------------------------------------------
+	 * Convolve the channels the engine was built for, sending any we don't
+	 * output to its discard block, and silence any more. Blocks longer than
+	 * the engine's are convolved in parts.
+	 *-----------------------------------------------------------------------*/
+	ConvolverEngine *engine = this->engine.get();
+	for (int channel = engine->num_channels; channel < this->num_output_channels; channel++)
+		memset(out[channel], 0, num_frames * sizeof(sample));
+
+	for (int offset = 0; offset < num_frames; offset += engine->max_block_size)
+	{
+		const sample *in[SIGNAL_MAX_CHANNELS];
+		sample *engine_out[SIGNAL_MAX_CHANNELS];
+		for (int channel = 0; channel < engine->num_channels; channel++)
+		{
+			in[channel] = this->input->out[channel % this->input->num_output_channels] + offset;
+			engine_out[channel] = (channel < this->num_output_channels) ? out[channel] + offset : engine->discard.data();
+		}
+
+		engine->process(in, engine_out, std::min(engine->max_block_size, num_frames - offset));
+	}
+}
+
+}
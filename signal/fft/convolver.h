@@ -0,0 +1,144 @@
+#pragma once
+
+#include "../node.h"
+#include "../buffer.h"
+
+#include <memory>
+#include <vector>
+
+/*------------------------------------------------------------------------
+ * Length of the head of the impulse response, which is convolved
+ * directly, and of the smallest partition.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_CONVOLVER_HEAD_SIZE 64
+
+/*------------------------------------------------------------------------
+ * Largest partition, and the smallest that is processed on the
+ * background thread.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_CONVOLVER_MAX_PARTITION_SIZE 16384
+#define SIGNAL_CONVOLVER_BACKGROUND_PARTITION_SIZE 1024
+
+namespace libsignal
+{
+	class ConvolverEngine;
+
+	/**------------------------------------------------------------------------
+	 * The spectra of an impulse response, split into partitions.
+	 *
+	 * The first SIGNAL_CONVOLVER_HEAD_SIZE samples are kept as they are,
+	 * to be convolved directly. The rest is split into levels of equal
+	 * partitions, each level's partitions four times the size of the
+	 * last, up to SIGNAL_CONVOLVER_MAX_PARTITION_SIZE. Each level starts
+	 * at least two of its partitions into the response, so that its
+	 * output isn't needed until one partition after its input is
+	 * complete, giving it that long to compute.
+	 *
+	 * Spectra are scaled for the transforms of the partitions' inputs, so
+	 * a product only needs an inverse transform. Built once, and shared
+	 * by every Convolver of the same Buffer (see get()).
+	 *------------------------------------------------------------------------*/
+	class ConvolverIR
+	{
+		public:
+			ConvolverIR(BufferRef buffer);
+
+			/*------------------------------------------------------------------------
+			 * Returns the partitioned response of `buffer`, sharing it with any
+			 * other node that already has one. The buffer's contents are read
+			 * once, so later changes to them are not seen.
+			 *-----------------------------------------------------------------------*/
+			static std::shared_ptr<ConvolverIR> get(BufferRef buffer);
+
+			class Level
+			{
+				public:
+					int partition_size;
+					int offset;
+					int num_partitions;
+
+					/*------------------------------------------------------------------------
+					 * The packed spectrum of each partition of each channel, of
+					 * 2 * partition_size samples.
+					 *-----------------------------------------------------------------------*/
+					std::vector<sample> spectra;
+
+					const sample *get_spectrum(int channel, int partition) const
+					{
+						return &this->spectra[(channel * this->num_partitions + partition) * 2 * this->partition_size];
+					}
+			};
+
+			/*------------------------------------------------------------------------
+			 * The head of each channel, reversed.
+			 *-----------------------------------------------------------------------*/
+			const sample *get_head(int channel) const
+			{
+				return &this->head[channel * SIGNAL_CONVOLVER_HEAD_SIZE];
+			}
+
+			BufferRef buffer;
+			int num_channels;
+			int length;
+			std::vector<Level> levels;
+
+		private:
+			std::vector<sample> head;
+	};
+
+	/**------------------------------------------------------------------------
+	 * Convolves its input with the impulse response in `buffer`, with no
+	 * latency, for reverb and speaker cabinet simulation.
+	 *
+	 * The head of the response is convolved directly, and the rest by
+	 * partitioned FFT convolution with partitions that grow along the
+	 * response (see ConvolverIR), so that the cost per sample is low
+	 * even for responses of several seconds. If `background` is set,
+	 * levels of SIGNAL_CONVOLVER_BACKGROUND_PARTITION_SIZE samples and up
+	 * are computed on a thread of their own, spreading their work over
+	 * the blocks before it is due. Should that thread fall behind, the
+	 * audio thread waits for it.
+	 *
+	 * Output channel n convolves input channel (n % input channels) with
+	 * channel (n % buffer channels) of the response, so a mono input can
+	 * be given a stereo response. The response is used at its own
+	 * sample rate, without resampling.
+	 *
+	 * The engine is built off the audio thread, whenever the response or
+	 * input is set. Should the input's number of channels change under
+	 * the convolver, the channels the engine was built for are still
+	 * convolved, and any more are silent, until the next is set.
+	 *------------------------------------------------------------------------*/
+	class Convolver : public Node
+	{
+		public:
+			Convolver(NodeRef input = nullptr, BufferRef buffer = nullptr, bool background = true);
+
+			virtual void update_channels();
+			virtual void set_input(std::string name, const NodeRef &node);
+			virtual void set_buffer(std::string name, BufferRef buffer);
+			virtual void process(sample **out, int num_frames);
+
+			NodeRef input;
+			BufferRef buffer;
+			bool background;
+
+		private:
+			/*------------------------------------------------------------------------
+			 * Returns a new engine for the response of `buffer`, or none if it
+			 * is null, for the channels given by `input` and the graph's
+			 * max_block_size.
+			 *-----------------------------------------------------------------------*/
+			std::shared_ptr<ConvolverEngine> create_engine(NodeRef input, BufferRef buffer);
+
+			/*------------------------------------------------------------------------
+			 * Set the input or buffer `name` (to `input` or `buffer`), with an
+			 * engine built for both, swapping them in on the audio thread.
+			 *-----------------------------------------------------------------------*/
+			void swap_engine(std::string name, NodeRef input, BufferRef buffer);
+
+			std::shared_ptr<ConvolverEngine> engine;
+	};
+
+	REGISTER(Convolver, "convolver");
+}
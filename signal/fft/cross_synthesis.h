@@ -0,0 +1,77 @@
+#pragma once
+
+#include "fftnode.h"
+#include "spectral_kernels.h"
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * Spectral cross-synthesis. Crossfades the magnitudes of the carrier
+	 * (`input`) towards those of `modulator` by `amount`, keeping the
+	 * carrier's phases, so that at an amount of 1 the carrier takes on the
+	 * modulator's spectral envelope.
+	 *
+	 * The modulator should be an FFT of the same size and hop as the
+	 * carrier, and run in step with it. Frames of the carrier with no
+	 * modulator frame of the same timestamp pass through unchanged, as
+	 * does channel n of the carrier where the modulator has fewer than
+	 * n + 1 channels.
+	 *------------------------------------------------------------------------*/
+	class FFTCrossSynthesis : public FFTOpNode
+	{
+		public:
+			FFTCrossSynthesis(NodeRef input = nullptr, NodeRef modulator = nullptr, NodeRef amount = 1.0) :
+				FFTOpNode(input), modulator(modulator), amount(amount)
+			{
+				this->name = "fft_cross_synthesis";
+
+				this->add_input("modulator", this->modulator);
+				this->add_input("amount", this->amount);
+			}
+
+			NodeRef modulator;
+			NodeRef amount;
+
+			virtual void process(sample **out, int num_frames)
+			{
+				SpectralStream *in = this->begin_block(num_frames);
+				if (!in)
+					return;
+
+				/*------------------------------------------------------------------------
+				 * The modulator's stream, if it is of our size.
+				 *-----------------------------------------------------------------------*/
+				FFTNode *modulator_node = dynamic_cast<FFTNode *>(this->modulator.get());
+				SpectralStream *modulator = modulator_node ? modulator_node->stream.get() : NULL;
+				if (modulator && (modulator->fft_size != this->fft_size || modulator->hop_size != this->hop_size))
+					modulator = NULL;
+
+				sample amount = this->amount->out[0][0];
+				int num_channels = std::min(this->stream->num_channels, in->num_channels);
+
+				for (int index = 0; index < in->num_frames; index++)
+				{
+					int64_t timestamp = in->timestamp(index);
+					if (!this->stream->append(timestamp))
+						break;
+
+					bool in_step = modulator && index < modulator->num_frames && modulator->timestamp(index) == timestamp;
+					for (int channel = 0; channel < num_channels; channel++)
+					{
+						if (in_step && channel < modulator->num_channels)
+						{
+							spectral_cross(in->magnitudes(index, channel), modulator->magnitudes(index, channel), amount,
+							               this->stream->magnitudes(index, channel), this->num_bins);
+							vector_copy(in->phases(index, channel), this->stream->phases(index, channel), this->num_bins);
+						}
+						else
+						{
+							vector_copy(in->frame(index, channel), this->stream->frame(index, channel), this->fft_size);
+						}
+					}
+				}
+			}
+	};
+
+	REGISTER(FFTCrossSynthesis, "fft_cross_synthesis");
+}
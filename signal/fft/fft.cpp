@@ -1,78 +1,107 @@
-#ifdef __APPLE__
-
 #include "fft.h"
 
-#include <assert.h>
+#include "../graph.h"
+#include "../kernels/kernels.h"
+
+#include <algorithm>
 
 namespace libsignal
 {
-			FFT::FFT(NodeRef input, int fft_size) :
-				FFTNode(fft_size), input(input)
+			FFTState::FFTState(int fft_size, int hop_size, int num_channels, int max_block_size)
 			{
-				this->name = "fft";
-
-				this->add_input("input", this->input);
-
 				/*------------------------------------------------------------------------
-				 * Initial FFT setup.
+				 * Initial FFT setup, and a Hann window for overlap/add.
 				 *-----------------------------------------------------------------------*/
-				this->log2N = (int) log2((float) fft_size);
-				this->fft_setup = vDSP_create_fftsetup(this->log2N, FFT_RADIX2);
+				this->backend = FFTBackend_Abstract::create(fft_size);
+				this->window = (sample *) calloc(fft_size, sizeof(sample));
+				fft_hann_window(this->window, fft_size);
 
 				/*------------------------------------------------------------------------
-				 * Temp buffers for FFT calculations.
+				 * Temp buffers for FFT calculations, for as many frames as a block
+				 * can produce, up to the maximum batch.
 				 *-----------------------------------------------------------------------*/
-				this->buffer = (sample *) calloc(fft_size, sizeof(sample));
-				this->buffer2 = (sample *) calloc(fft_size, sizeof(sample));
-
-				this->hop_size = 256;
+				int max_frames_per_block = (max_block_size + hop_size - 1) / hop_size;
+				this->batch_size = std::min(SIGNAL_FFT_MAX_BATCH, num_channels * max_frames_per_block);
+				this->buffer = (sample *) calloc(this->batch_size * fft_size, sizeof(sample));
+				this->buffer2 = (sample *) calloc(this->batch_size * fft_size, sizeof(sample));
 
 				/*------------------------------------------------------------------------
 				 * To perform an FFT, we have to enqueue at least `fft_size` samples.
-				 * inbuf stores our backlog, so make sure we've allocated enough space.
-				 * inbuf_size records the current number of frames we have buffered.
+				 * inbuf stores our backlog, which is never more than fft_size - 1
+				 * samples plus the current block. inbuf_size records the current
+				 * number of frames we have buffered.
 				 *-----------------------------------------------------------------------*/
-				this->inbuf = (sample *) calloc(SIGNAL_MAX_FFT_SIZE * 2, sizeof(sample));
 				this->inbuf_size = 0;
+				this->inbuf_capacity = fft_size + max_block_size;
+				this->inbuf_channels = num_channels;
+				this->inbuf = (sample *) calloc(num_channels * this->inbuf_capacity, sizeof(sample));
+			}
 
-				/*------------------------------------------------------------------------
-				 * Hann window for overlap/add
-				 *-----------------------------------------------------------------------*/
-				this->window = (sample *) calloc(fft_size, sizeof(sample));
-				memset(this->window, 0, sizeof(float) * this->fft_size);
+			FFTState::~FFTState()
+			{
+				delete this->backend;
+				free(this->buffer);
+				free(this->buffer2);
+				free(this->inbuf);
+				free(this->window);
+			}
 
-				vDSP_hann_window(this->window, fft_size, vDSP_HANN_NORM);
+			FFT::FFT(NodeRef input, int fft_size, int hop_size) :
+				FFTNode(fft_size, hop_size), input(input)
+			{
+				this->name = "fft";
+
+				this->add_input("input", this->input);
+
+				this->state = std::make_shared<FFTState>(this->fft_size, this->hop_size,
+				                                         this->staged_channels, this->staged_block_size);
 			}
 
-			FFT::~FFT()
+			std::function<void()> FFT::create_stream(int fft_size, int hop_size, int num_channels, int max_block_size)
 			{
-				vDSP_destroy_fftsetup(this->fft_setup);
-				free(this->buffer);
+				std::function<void()> swap = FFTNode::create_stream(fft_size, hop_size, num_channels, max_block_size);
+				std::shared_ptr<FFTState> state = std::make_shared<FFTState>(fft_size, hop_size, num_channels, max_block_size);
+
+				return [this, swap, state]
+				{
+					swap();
+
+					/*------------------------------------------------------------------------
+					 * Keep the backlog of as many channels as before, if it still fits.
+					 *-----------------------------------------------------------------------*/
+					std::shared_ptr<FFTState> previous = this->state;
+					this->state = state;
+					if (!previous)
+						return;
+
+					if (previous->inbuf_size < this->fft_size)
+					{
+						state->inbuf_size = previous->inbuf_size;
+						for (int channel = 0; channel < std::min(state->inbuf_channels, previous->inbuf_channels); channel++)
+							memcpy(state->inbuf + channel * state->inbuf_capacity,
+							       previous->inbuf + channel * previous->inbuf_capacity,
+							       state->inbuf_size * sizeof(sample));
+					}
+
+					if (this->graph)
+						this->graph->retire(std::move(previous));
+				};
 			}
 
 			void FFT::fft(sample *in, sample *out, bool polar, bool do_window)
 			{
-				DSPSplitComplex buffer_split = { buffer, buffer + fft_size/2 };
-				DSPSplitComplex output_split = { out, out + fft_size/2 };
+				sample *buffer = this->state->buffer;
+				sample *buffer2 = this->state->buffer2;
 
 				if (do_window)
-					vDSP_vmul(in, 1, this->window, 1, buffer2, 1, fft_size);
+					vector_multiply(in, this->state->window, buffer2, fft_size);
 				else
 					memcpy(buffer2, in, fft_size * sizeof(sample));
 
 				/*------------------------------------------------------------------------
-				 * Convert from interleaved format (sequential pairs) to split format,
-				 * as required by the vDSP real-to-complex functions.
-				 * 
-				 * Stride of 2 is the smallest permissible value, denoting no gap
-				 * between "pairs" of samples".
+				 * Perform single-precision FFT, giving a packed split spectrum.
 				 *-----------------------------------------------------------------------*/
-				vDSP_ctoz((DSPComplex *) buffer2, 2, &buffer_split, 1, fft_size/2);
-
-				/*------------------------------------------------------------------------
-				 * Perform single-precision FFT, in-place (overwriting real values).
-				 *-----------------------------------------------------------------------*/
-				vDSP_fft_zrip(fft_setup, &buffer_split, 1, log2N, FFT_FORWARD);
+				this->state->backend->forward(buffer2, buffer);
 
 				/*------------------------------------------------------------------------
 				 * Now, calculate magnitudes and phases, stored in our output buffer.
@@ -83,50 +112,91 @@ namespace libsignal
 				 *-----------------------------------------------------------------------*/
 				if (polar)
 				{
-					vDSP_ztoc(&buffer_split, 1, (DSPComplex *) buffer2, 2, fft_size/2);
-					vDSP_polar(buffer2, 2, buffer, 2, fft_size/2);
-					vDSP_ctoz((DSPComplex *) buffer, 2, &output_split, 1, fft_size/2);
+					fft_to_polar(buffer, out, out + fft_size/2, fft_size/2);
 				}
 
 				/*------------------------------------------------------------------------
-				 * 2. Sending cartesian values
+				 * 2. Sending cartesian values, as sequential (real, imaginary) pairs
 				 *-----------------------------------------------------------------------*/
 				else
 				{
-					vDSP_ztoc(&buffer_split, 1, (DSPComplex *) out, 2, fft_size/2);
+					sample *split[2] = { buffer, buffer + fft_size/2 };
+					vector_interleave(split, 2, out, fft_size/2);
 				}
+			}
+
+			/*------------------------------------------------------------------------
+			 * Transform the windowed frames in buffer2, writing magnitudes and
+			 * phases to each of `frames`.
+			 *-----------------------------------------------------------------------*/
+			void FFT::transform_batch(sample **frames, int count)
+			{
+				FFTState *state = this->state.get();
+				state->backend->forward_batch(state->buffer2, state->buffer, count);
 
+				for (int index = 0; index < count; index++)
+					fft_to_polar(state->buffer + index * fft_size, frames[index], frames[index] + fft_size/2, fft_size/2);
 			}
 
 			void FFT::process(sample **out, int num_frames)
 			{
+				SpectralStream *stream = this->stream.get();
+				FFTState *state = this->state.get();
+				int num_channels = stream->num_channels;
+				stream->begin_block(stream->position + num_frames);
+
 				/*------------------------------------------------------------------------
 				 * Append the incoming buffer onto our inbuf.
-				 * Perform repeated window and FFT by stepping forward hop_size frames.
 				 *-----------------------------------------------------------------------*/
-				memcpy(this->inbuf + this->inbuf_size, this->input->out[0], num_frames * sizeof(sample));
-				this->inbuf_size += num_frames;
+				for (int channel = 0; channel < num_channels; channel++)
+					memcpy(state->inbuf + channel * state->inbuf_capacity + state->inbuf_size,
+					       this->input->out[channel], num_frames * sizeof(sample));
+				state->inbuf_size += num_frames;
 
 				/*------------------------------------------------------------------------
-				 * Calculate the number of hops to perform.
-				 * Each hop is stored in an output channel so we can't have > 32.
+				 * Window each complete window of fft_size samples, stepping forward
+				 * hop_size samples, and transform them in batches directly into the
+				 * stream. The window at offset 0 started inbuf_size samples before
+				 * the end of this block.
 				 *-----------------------------------------------------------------------*/
-				this->num_hops = (this->inbuf_size - this->fft_size) / this->hop_size;
-				if (this->num_hops < 0)
-					this->num_hops = 0;
-				assert(this->num_hops <= SIGNAL_MAX_CHANNELS);
-
-				for (int hop = 0; hop < this->num_hops; hop++)
+				int64_t inbuf_start = stream->position - state->inbuf_size;
+				sample *frames[SIGNAL_FFT_MAX_BATCH];
+				int batch = 0;
+				int offset = 0;
+				for (; offset + this->fft_size <= state->inbuf_size; offset += this->hop_size)
 				{
-					this->fft(this->inbuf + (hop * this->hop_size), this->out[hop]);
+					/*------------------------------------------------------------------------
+					 * If the stream is full, drop the window, so that the backlog
+					 * still stays within its capacity.
+					 *-----------------------------------------------------------------------*/
+					sample *frame = stream->append(inbuf_start + offset);
+					if (!frame)
+						continue;
+
+					for (int channel = 0; channel < num_channels; channel++)
+					{
+						vector_multiply(state->inbuf + channel * state->inbuf_capacity + offset, state->window,
+						                state->buffer2 + batch * this->fft_size, this->fft_size);
+						frames[batch++] = frame + channel * this->fft_size;
+						if (batch == state->batch_size)
+						{
+							this->transform_batch(frames, batch);
+							batch = 0;
+						}
+					}
 				}
+				if (batch > 0)
+					this->transform_batch(frames, batch);
 
-				int frames_processed = this->hop_size * this->num_hops;
-				int frames_remaining = this->inbuf_size - frames_processed;
-
-				memcpy(this->inbuf, this->inbuf + frames_processed, frames_remaining * sizeof(sample));
-				this->inbuf_size -= frames_processed;
+				/*------------------------------------------------------------------------
+				 * Keep the backlog, from the start of the next window, which is
+				 * always less than fft_size samples.
+				 *-----------------------------------------------------------------------*/
+				for (int channel = 0; channel < num_channels; channel++)
+				{
+					sample *channel_inbuf = state->inbuf + channel * state->inbuf_capacity;
+					memmove(channel_inbuf, channel_inbuf + offset, (state->inbuf_size - offset) * sizeof(sample));
+				}
+				state->inbuf_size -= offset;
 			}
 }
-
-#endif
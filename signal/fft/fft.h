@@ -1,31 +1,65 @@
 #pragma once
 
 #include "fftnode.h"
-
-#include <Accelerate/Accelerate.h>
+#include "backend/abstract.h"
 
 namespace libsignal
 {
-	class FFT : public FFTNode
+	/**------------------------------------------------------------------------
+	 * The transform, window and buffers of an FFT, for a given FFT and hop
+	 * size, number of channels and maximum block size.
+	 *------------------------------------------------------------------------*/
+	class FFTState
 	{
 		public:
-			FFT(NodeRef input = 0.0, int fft_size = SIGNAL_DEFAULT_FFT_SIZE);
-			~FFT();
+			FFTState(int fft_size, int hop_size, int num_channels, int max_block_size);
+			~FFTState();
 
-			virtual void fft(sample *in, sample *out, bool polar = true, bool do_window = true);
-			virtual void process(sample **out, int num_frames);
+			FFTBackend_Abstract *backend;
+			sample *window;
 
-			NodeRef input;
-			int hop_size;
-			int log2N;
-			FFTSetup fft_setup;
+			/*------------------------------------------------------------------------
+			 * Spectra and windowed input for a batch of batch_size frames.
+			 *-----------------------------------------------------------------------*/
 			sample *buffer;
 			sample *buffer2;
+			int batch_size;
+
+			/*------------------------------------------------------------------------
+			 * Input backlog of each channel, inbuf_capacity samples apart.
+			 *-----------------------------------------------------------------------*/
 			sample *inbuf;
 			int inbuf_size;
-			sample *window;
+			int inbuf_capacity;
+			int inbuf_channels;
+	};
+
+	/**------------------------------------------------------------------------
+	 * Short-time Fourier transform of the input, producing a frame of
+	 * magnitudes and phases for each window of fft_size samples, with
+	 * windows starting every hop_size samples.
+	 *
+	 * Every channel of the input is transformed. The windows of all
+	 * channels and hops in a block are transformed in batches of up to
+	 * SIGNAL_FFT_MAX_BATCH, for backends that can run them together.
+	 *------------------------------------------------------------------------*/
+	class FFT : public FFTNode
+	{
+		public:
+			FFT(NodeRef input = 0.0, int fft_size = SIGNAL_DEFAULT_FFT_SIZE, int hop_size = SIGNAL_DEFAULT_FFT_HOP_SIZE);
+
+			virtual void fft(sample *in, sample *out, bool polar = true, bool do_window = true);
+			virtual void process(sample **out, int num_frames);
+
+			NodeRef input;
+			std::shared_ptr<FFTState> state;
+
+		protected:
+			virtual std::function<void()> create_stream(int fft_size, int hop_size, int num_channels, int max_block_size);
+
+		private:
+			void transform_batch(sample **frames, int count);
 	};
 
 	REGISTER(FFT, "fft");
 }
-
@@ -0,0 +1,161 @@
+#include "fftnode.h"
+
+#include "../graph.h"
+
+#include <algorithm>
+
+namespace libsignal
+{
+
+FFTNode::FFTNode(int fft_size, int hop_size) : Node()
+{
+	/*------------------------------------------------------------------------
+	 * Frames persist between blocks, and are read in place downstream.
+	 *-----------------------------------------------------------------------*/
+	this->no_output_pooling = true;
+
+	this->resize_stream(fft_size, hop_size, 1, this->graph ? this->graph->max_block_size : SIGNAL_DEFAULT_BLOCK_SIZE)();
+}
+
+void FFTNode::allocate_output(int num_channels, int num_frames)
+{
+	Node::allocate_output(num_channels, num_frames);
+
+	if (num_channels != this->staged_channels || num_frames > this->staged_block_size)
+		this->resize_stream(this->staged_fft_size, this->staged_hop_size,
+		                    num_channels, std::max(num_frames, this->staged_block_size))();
+}
+
+std::function<void()> FFTNode::prepare_output(int num_channels, int num_frames)
+{
+	std::function<void()> install = Node::prepare_output(num_channels, num_frames);
+	if (num_channels == this->staged_channels && num_frames <= this->staged_block_size)
+		return install;
+
+	/*------------------------------------------------------------------------
+	 * The stream, and any state that subclasses keep alongside it, are
+	 * built here, and swapped in with our output storage.
+	 *-----------------------------------------------------------------------*/
+	std::function<void()> swap = this->resize_stream(this->staged_fft_size, this->staged_hop_size,
+	                                                 num_channels, std::max(num_frames, this->staged_block_size));
+	return [install, swap]
+	{
+		install();
+		swap();
+	};
+}
+
+void FFTNode::set_fft_size(int fft_size, int hop_size)
+{
+	this->defer_edit(this->resize_stream(fft_size, hop_size, this->staged_channels, this->staged_block_size));
+}
+
+std::function<void()> FFTNode::create_stream(int fft_size, int hop_size, int num_channels, int max_block_size)
+{
+	std::shared_ptr<SpectralStream> stream = std::make_shared<SpectralStream>(fft_size, hop_size, num_channels, max_block_size);
+
+	return [this, stream]
+	{
+		this->fft_size = stream->fft_size;
+		this->num_bins = stream->num_bins;
+		this->hop_size = stream->hop_size;
+
+		/*------------------------------------------------------------------------
+		 * The new stream continues from the old one's position.
+		 *-----------------------------------------------------------------------*/
+		std::shared_ptr<SpectralStream> previous = this->stream;
+		this->stream = stream;
+		if (previous)
+		{
+			stream->position = previous->position;
+			if (this->graph)
+				this->graph->retire(std::move(previous));
+		}
+	};
+}
+
+std::function<void()> FFTNode::resize_stream(int fft_size, int hop_size, int num_channels, int max_block_size)
+{
+	this->staged_fft_size = fft_size;
+	this->staged_hop_size = hop_size;
+	this->staged_channels = num_channels;
+	this->staged_block_size = max_block_size;
+
+	return this->create_stream(fft_size, hop_size, num_channels, max_block_size);
+}
+
+/*------------------------------------------------------------------------
+ * The input of a spectral node, if it is an FFTNode.
+ *-----------------------------------------------------------------------*/
+static FFTNode *fft_input(const NodeRef &input)
+{
+	return dynamic_cast<FFTNode *>(input.get());
+}
+
+FFTOpNode::FFTOpNode(NodeRef input) :
+	FFTNode(fft_input(input) ? fft_input(input)->staged_fft_size : SIGNAL_DEFAULT_FFT_SIZE,
+	        fft_input(input) ? fft_input(input)->staged_hop_size : SIGNAL_DEFAULT_FFT_HOP_SIZE),
+	input(input)
+{
+	this->add_input("input", this->input);
+}
+
+void FFTOpNode::update_channels()
+{
+	if (this->input)
+	{
+		this->num_input_channels = this->input->num_output_channels;
+		this->num_output_channels = this->input->num_output_channels;
+	}
+}
+
+SpectralStream *FFTOpNode::begin_block(int num_frames)
+{
+	FFTNode *fftnode = fft_input(this->input);
+	if (!fftnode || fftnode->stream->fft_size != this->fft_size || fftnode->stream->hop_size != this->hop_size)
+	{
+		this->stream->begin_block(this->stream->position + num_frames);
+		return NULL;
+	}
+
+	this->stream->begin_block(fftnode->stream->position);
+	return fftnode->stream.get();
+}
+
+void FFTOpNode::set_input(std::string name, const NodeRef &node)
+{
+	FFTNode *fftnode = fft_input(node);
+	if (name != "input" || !fftnode ||
+	    (fftnode->staged_fft_size == this->staged_fft_size && fftnode->staged_hop_size == this->staged_hop_size))
+	{
+		FFTNode::set_input(name, node);
+		return;
+	}
+
+	/*------------------------------------------------------------------------
+	 * Follow the size of the new input, building our stream for it here
+	 * and swapping it in with the edit.
+	 *-----------------------------------------------------------------------*/
+	std::function<void()> swap = this->resize_stream(fftnode->staged_fft_size, fftnode->staged_hop_size,
+	                                                 this->staged_channels, this->staged_block_size);
+
+	AudioGraphTransactionScope transaction(this->is_deferring() ? this->graph : NULL);
+	FFTNode::set_input(name, node);
+	this->defer_edit(swap);
+	transaction.commit();
+}
+
+std::shared_ptr<sample> fft_allocate(int size)
+{
+	return std::shared_ptr<sample>((sample *) calloc(size, sizeof(sample)), free);
+}
+
+void fft_swap(AudioGraph *graph, std::shared_ptr<sample> &buffer, const std::shared_ptr<sample> &replacement)
+{
+	std::shared_ptr<sample> previous = buffer;
+	buffer = replacement;
+	if (graph)
+		graph->retire(std::move(previous));
+}
+
+}
@@ -1,60 +1,102 @@
 #pragma once
 
 #include "../node.h"
+#include "spectral_stream.h"
+
+#include <memory>
 
 namespace libsignal
 {
+	/**------------------------------------------------------------------------
+	 * A node whose output is a SpectralStream rather than audio.
+	 *
+	 * Downstream spectral nodes read the frames of `stream` in place. The
+	 * stream has one spectrum per output channel. The audio output is
+	 * silent, so that spectral nodes can still be connected, scheduled
+	 * and monitored like any other node.
+	 *------------------------------------------------------------------------*/
 	class FFTNode : public Node
 	{
 		public:
+			FFTNode(int fft_size, int hop_size = SIGNAL_DEFAULT_FFT_HOP_SIZE);
+
+			/*------------------------------------------------------------------------
+			 * Sizes the stream to hold every frame of a block of num_frames,
+			 * with num_channels spectra each.
+			 *-----------------------------------------------------------------------*/
+			virtual void allocate_output(int num_channels, int num_frames);
+			virtual std::function<void()> prepare_output(int num_channels, int num_frames);
+
+			/*------------------------------------------------------------------------
+			 * Replace the stream with one of a new FFT and hop size. While the
+			 * graph is running, it is built here and swapped in at the next
+			 * block.
+			 *-----------------------------------------------------------------------*/
+			virtual void set_fft_size(int fft_size, int hop_size);
 
-			FFTNode(int fft_size) : Node()
-			{
-				this->fft_size = fft_size;
-				this->num_bins = fft_size / 2;
-				this->num_hops = 0;
-
-				this->magnitudes = (sample **) malloc(SIGNAL_MAX_CHANNELS * sizeof(float *));
-				for (int i = 0; i < SIGNAL_MAX_CHANNELS; i++)
-					this->magnitudes[i] = this->out[i];
-
-				this->phases = (sample **) malloc(SIGNAL_MAX_CHANNELS * sizeof(float *));
-				for (int i = 0; i < SIGNAL_MAX_CHANNELS; i++)
-					this->phases[i] = this->out[i] + this->num_bins;
-			}
-
-			~FFTNode()
-			{
-				free(this->magnitudes);
-				free(this->phases);
-			}
-
-			sample **magnitudes;
-			sample **phases;
+			std::shared_ptr<SpectralStream> stream;
 			int fft_size;
 			int num_bins;
-			int num_hops;
+			int hop_size;
+
+			/*------------------------------------------------------------------------
+			 * The size of the last stream built, which may not yet have been
+			 * swapped in. Only used on the control side, to size later edits.
+			 *-----------------------------------------------------------------------*/
+			int staged_fft_size;
+			int staged_hop_size;
+			int staged_channels;
+			int staged_block_size;
+
+		protected:
+			/*------------------------------------------------------------------------
+			 * Build a stream of the given size on the calling thread, and return
+			 * a function that swaps it in. The swap may be made on the audio
+			 * thread, so must not allocate. Subclasses with per-channel or
+			 * per-bin state extend this to build it alongside the stream.
+			 *-----------------------------------------------------------------------*/
+			virtual std::function<void()> create_stream(int fft_size, int hop_size, int num_channels, int max_block_size);
+
+			/*------------------------------------------------------------------------
+			 * As create_stream, recording the size as the one that later edits
+			 * are built for.
+			 *-----------------------------------------------------------------------*/
+			std::function<void()> resize_stream(int fft_size, int hop_size, int num_channels, int max_block_size);
 	};
 
+	/**------------------------------------------------------------------------
+	 * A node which transforms the spectral stream of another FFTNode,
+	 * adopting its FFT and hop size, and its number of channels.
+	 *------------------------------------------------------------------------*/
 	class FFTOpNode : public FFTNode
 	{
 		public:
+			FFTOpNode(NodeRef input = nullptr);
 
-			FFTOpNode(NodeRef input = nullptr) : FFTNode(input ? ((FFTNode *) input.get())->fft_size : SIGNAL_DEFAULT_FFT_SIZE), input(input)
-			{
-				this->add_input("input", this->input);
-			}
-
-			virtual void set_input(std::string name, const NodeRef &node)
-			{
-				FFTNode::set_input(name, node);
-				if (name == "input")
-				{
-					// TODO: Update FFT size and buffers
-				}
-			}
+			virtual void update_channels();
+			virtual void set_input(std::string name, const NodeRef &node);
 
 			NodeRef input;
+
+		protected:
+			/*------------------------------------------------------------------------
+			 * Start a block of our stream in step with that of our input, and
+			 * return the input's stream. If the input has no stream of our
+			 * size (as until a change in its size reaches us), the block has
+			 * no frames, and NULL is returned.
+			 *-----------------------------------------------------------------------*/
+			SpectralStream *begin_block(int num_frames);
 	};
-}
 
+	/*------------------------------------------------------------------------
+	 * Allocate a zeroed buffer of `size` samples for the state of a
+	 * spectral node.
+	 *-----------------------------------------------------------------------*/
+	std::shared_ptr<sample> fft_allocate(int size);
+
+	/*------------------------------------------------------------------------
+	 * Replace a buffer of a spectral node with one built by fft_allocate,
+	 * having the graph free the old one in case we are on the audio thread.
+	 *-----------------------------------------------------------------------*/
+	void fft_swap(AudioGraph *graph, std::shared_ptr<sample> &buffer, const std::shared_ptr<sample> &replacement);
+}
@@ -0,0 +1,298 @@
+#include "ifft.h"
+
+#include "../graph.h"
+#include "../kernels/kernels.h"
+
+#include <algorithm>
+
+namespace libsignal
+{
+
+IFFTState::IFFTState(int fft_size, int hop_size, int num_channels, int max_block_size)
+{
+	this->fft_size = fft_size;
+	this->hop_size = hop_size;
+	this->num_channels = num_channels;
+	this->max_block_size = max_block_size;
+	this->backend = FFTBackend_Abstract::create(fft_size);
+
+	/*------------------------------------------------------------------------
+	 * Generate a Hann window for overlap-add.
+	 *-----------------------------------------------------------------------*/
+	this->window = (sample *) calloc(fft_size, sizeof(sample));
+	fft_hann_window(this->window, fft_size);
+
+	/*------------------------------------------------------------------------
+	 * Scale down (the forward and inverse transforms together scale
+	 * by 2 * fft_size). The squared window has a mean of 1/4, so
+	 * overlapping windows sum to fft_size / (4 * hop_size).
+	 *-----------------------------------------------------------------------*/
+	this->synthesis_window = (sample *) calloc(fft_size, sizeof(sample));
+	float scale = 4.0 * hop_size / (2.0 * fft_size * fft_size);
+	vector_multiply_scalar(this->window, scale, this->synthesis_window, fft_size);
+
+	/*------------------------------------------------------------------------
+	 * Buffers used in intermediate FFT calculations, for as many frames as
+	 * a block can produce, up to the maximum batch.
+	 *-----------------------------------------------------------------------*/
+	int max_frames_per_block = (max_block_size + hop_size - 1) / hop_size;
+	this->batch_size = std::min(SIGNAL_FFT_MAX_BATCH, num_channels * max_frames_per_block);
+	this->buffer = (sample *) calloc(this->batch_size * fft_size, sizeof(sample));
+	this->buffer2 = (sample *) calloc(this->batch_size * fft_size, sizeof(sample));
+
+	/*------------------------------------------------------------------------
+	 * Samples are read out up to fft_size + max_block_size after the
+	 * earliest window that can still overlap them begins.
+	 *-----------------------------------------------------------------------*/
+	int size = 1;
+	while (size < fft_size + max_block_size)
+		size *= 2;
+
+	this->accumulator = (sample *) calloc(num_channels * size, sizeof(sample));
+	this->accumulator_size = size;
+}
+
+IFFTState::~IFFTState()
+{
+	delete this->backend;
+	free(this->buffer);
+	free(this->buffer2);
+	free(this->window);
+	free(this->synthesis_window);
+	free(this->accumulator);
+}
+
+IFFT::IFFT(NodeRef input) : Node(), input(input)
+{
+	this->name = "ifft";
+
+	/*------------------------------------------------------------------------
+	 * Our state is sized along with our output, which is only done for
+	 * nodes that aren't pooled, so that it is built on the control side.
+	 *-----------------------------------------------------------------------*/
+	this->no_output_pooling = true;
+
+	this->add_input("input", this->input);
+
+	FFTNode *fftnode = dynamic_cast<FFTNode *>(input.get());
+	this->resize_state(fftnode ? fftnode->staged_fft_size : SIGNAL_DEFAULT_FFT_SIZE,
+	                   fftnode ? fftnode->staged_hop_size : SIGNAL_DEFAULT_FFT_HOP_SIZE,
+	                   fftnode ? fftnode->staged_channels : 1,
+	                   this->graph ? this->graph->max_block_size : SIGNAL_DEFAULT_BLOCK_SIZE)();
+}
+
+void IFFT::set_input(std::string name, const NodeRef &node)
+{
+	FFTNode *fftnode = dynamic_cast<FFTNode *>(node.get());
+	if (name != "input" || !fftnode ||
+	    (fftnode->staged_fft_size == this->staged_fft_size && fftnode->staged_hop_size == this->staged_hop_size))
+	{
+		Node::set_input(name, node);
+		return;
+	}
+
+	/*------------------------------------------------------------------------
+	 * Follow the size of the new input, building our state for it here
+	 * and swapping it in with the edit.
+	 *-----------------------------------------------------------------------*/
+	std::function<void()> swap = this->resize_state(fftnode->staged_fft_size, fftnode->staged_hop_size,
+	                                                this->staged_channels, this->staged_block_size);
+
+	AudioGraphTransactionScope transaction(this->is_deferring() ? this->graph : NULL);
+	Node::set_input(name, node);
+	this->defer_edit(swap);
+	transaction.commit();
+}
+
+void IFFT::allocate_output(int num_channels, int num_frames)
+{
+	Node::allocate_output(num_channels, num_frames);
+
+	if (num_channels != this->staged_channels || num_frames > this->staged_block_size)
+		this->resize_state(this->staged_fft_size, this->staged_hop_size,
+		                   num_channels, std::max(num_frames, this->staged_block_size))();
+}
+
+std::function<void()> IFFT::prepare_output(int num_channels, int num_frames)
+{
+	std::function<void()> install = Node::prepare_output(num_channels, num_frames);
+	if (num_channels == this->staged_channels && num_frames <= this->staged_block_size)
+		return install;
+
+	std::function<void()> swap = this->resize_state(this->staged_fft_size, this->staged_hop_size,
+	                                                num_channels, std::max(num_frames, this->staged_block_size));
+	return [install, swap]
+	{
+		install();
+		swap();
+	};
+}
+
+std::function<void()> IFFT::resize_state(int fft_size, int hop_size, int num_channels, int max_block_size)
+{
+	this->staged_fft_size = fft_size;
+	this->staged_hop_size = hop_size;
+	this->staged_channels = num_channels;
+	this->staged_block_size = max_block_size;
+
+	std::shared_ptr<IFFTState> state = std::make_shared<IFFTState>(fft_size, hop_size, num_channels, max_block_size);
+
+	return [this, state]
+	{
+		this->fft_size = state->fft_size;
+		this->hop_size = state->hop_size;
+
+		std::shared_ptr<IFFTState> previous = this->state;
+		this->state = state;
+		if (!previous)
+			return;
+
+		/*------------------------------------------------------------------------
+		 * Carry over the overlap that is yet to be output, which is the
+		 * fft_size samples before the stream position.
+		 *-----------------------------------------------------------------------*/
+		FFTNode *fftnode = dynamic_cast<FFTNode *>(this->input.get());
+		if (fftnode && previous->fft_size == state->fft_size && previous->hop_size == state->hop_size)
+		{
+			int64_t position = fftnode->stream->position;
+			int mask = state->accumulator_size - 1;
+			int previous_mask = previous->accumulator_size - 1;
+			for (int channel = 0; channel < std::min(state->num_channels, previous->num_channels); channel++)
+			{
+				sample *accumulator = state->accumulator + channel * state->accumulator_size;
+				sample *previous_accumulator = previous->accumulator + channel * previous->accumulator_size;
+				for (int64_t index = position - state->fft_size; index < position; index++)
+					accumulator[index & mask] = previous_accumulator[index & previous_mask];
+			}
+		}
+
+		if (this->graph)
+			this->graph->retire(std::move(previous));
+	};
+}
+
+void IFFT::ifft(sample *in, sample *out, bool polar, bool do_window)
+{
+	IFFTState *state = this->state.get();
+
+	/*------------------------------------------------------------------------
+	 * 1. Expecting polar values
+	 *-----------------------------------------------------------------------*/
+	if (polar)
+	{
+		fft_from_polar(in, in + fft_size / 2, state->buffer, fft_size / 2);
+	}
+
+	/*------------------------------------------------------------------------
+	 * 2. Expecting Cartesian values, as sequential (real, imaginary) pairs
+	 *-----------------------------------------------------------------------*/
+	else
+	{
+		sample *split[2] = { state->buffer, state->buffer + fft_size / 2 };
+		vector_deinterleave(in, 2, split, fft_size / 2);
+	}
+
+	/*------------------------------------------------------------------------
+	 * Perform inverse FFT
+	 *-----------------------------------------------------------------------*/
+	state->backend->inverse(state->buffer, out);
+
+	/*------------------------------------------------------------------------
+	 * Scale, and apply Hann window (for overlap-add)
+	 *-----------------------------------------------------------------------*/
+	if (do_window)
+		vector_multiply(out, state->synthesis_window, out, fft_size);
+	else
+		vector_multiply_scalar(out, 1.0 / (fft_size * 2.0), out, fft_size);
+}
+
+/*------------------------------------------------------------------------
+ * Inverse transform the spectra in buffer, and overlap-add each at its
+ * window's position in its channel's ring, in up to two runs where it
+ * wraps around.
+ *-----------------------------------------------------------------------*/
+void IFFT::overlap_add(const SpectralStream *stream, const int *frames, const int *channels, int count)
+{
+	IFFTState *state = this->state.get();
+	state->backend->inverse_batch(state->buffer, state->buffer2, count);
+
+	int mask = state->accumulator_size - 1;
+	for (int index = 0; index < count; index++)
+	{
+		sample *frame = state->buffer2 + index * this->fft_size;
+		sample *accumulator = state->accumulator + channels[index] * state->accumulator_size;
+		int start = (int) (stream->timestamp(frames[index]) & mask);
+		int run = std::min(this->fft_size, state->accumulator_size - start);
+		vector_mac(frame, state->synthesis_window, accumulator + start, run);
+		vector_mac(frame + run, state->synthesis_window + run, accumulator, this->fft_size - run);
+	}
+}
+
+void IFFT::process(sample **out, int num_frames)
+{
+	/*------------------------------------------------------------------------
+	 * Our state is resized on the control side, so until an input of a
+	 * new size reaches us (or a new number of channels reaches our
+	 * state), output silence, or only the channels that we have.
+	 *-----------------------------------------------------------------------*/
+	FFTNode *fftnode = dynamic_cast<FFTNode *>(this->input.get());
+	IFFTState *state = this->state.get();
+	SpectralStream *stream = fftnode ? fftnode->stream.get() : NULL;
+	if (!stream || stream->fft_size != state->fft_size || stream->hop_size != state->hop_size ||
+	    num_frames > state->max_block_size)
+	{
+		for (int channel = 0; channel < this->num_output_channels; channel++)
+			memset(out[channel], 0, num_frames * sizeof(sample));
+		return;
+	}
+
+	int num_channels = std::min(stream->num_channels, state->num_channels);
+
+	/*------------------------------------------------------------------------
+	 * Convert the frames of every channel to packed spectra, in batches.
+	 *-----------------------------------------------------------------------*/
+	int frames[SIGNAL_FFT_MAX_BATCH];
+	int channels[SIGNAL_FFT_MAX_BATCH];
+	int batch = 0;
+	for (int index = 0; index < stream->num_frames; index++)
+	{
+		for (int channel = 0; channel < num_channels; channel++)
+		{
+			fft_from_polar(stream->magnitudes(index, channel), stream->phases(index, channel),
+			               state->buffer + batch * this->fft_size, stream->num_bins);
+			frames[batch] = index;
+			channels[batch] = channel;
+			if (++batch == state->batch_size)
+			{
+				this->overlap_add(stream, frames, channels, batch);
+				batch = 0;
+			}
+		}
+	}
+	if (batch > 0)
+		this->overlap_add(stream, frames, channels, batch);
+
+	/*------------------------------------------------------------------------
+	 * Output the block ending fft_size samples before the stream position,
+	 * which no later window can overlap, and clear it for reuse.
+	 *-----------------------------------------------------------------------*/
+	int mask = state->accumulator_size - 1;
+	int start = (int) ((stream->position - num_frames - this->fft_size) & mask);
+	int run = std::min(num_frames, state->accumulator_size - start);
+	for (int channel = 0; channel < this->num_output_channels; channel++)
+	{
+		if (channel >= num_channels)
+		{
+			memset(out[channel], 0, num_frames * sizeof(sample));
+			continue;
+		}
+
+		sample *accumulator = state->accumulator + channel * state->accumulator_size;
+		memcpy(out[channel], accumulator + start, run * sizeof(sample));
+		memcpy(out[channel] + run, accumulator, (num_frames - run) * sizeof(sample));
+		memset(accumulator + start, 0, run * sizeof(sample));
+		memset(accumulator, 0, (num_frames - run) * sizeof(sample));
+	}
+}
+
+}
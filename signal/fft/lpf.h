@@ -1,6 +1,7 @@
 #pragma once
 
 #include "fftnode.h"
+#include "spectral_kernels.h"
 
 namespace libsignal
 {
@@ -18,8 +19,9 @@ namespace libsignal
 
 			virtual void process(sample **out, int num_frames)
 			{
-				FFTNode *fftnode = (FFTNode *) this->input.get();
-				this->num_hops = fftnode->num_hops; 
+				SpectralStream *in = this->begin_block(num_frames);
+				if (!in)
+					return;
 
 				/*------------------------------------------------------------------------
 				 * Calculate a normalised cutoff value [0, 1]
@@ -32,27 +34,23 @@ namespace libsignal
 				 *-----------------------------------------------------------------------*/
 				int cutoff_bin = this->num_bins * cutoff_norm;
 
-				for (int hop = 0; hop < this->num_hops; hop++)
+				/*------------------------------------------------------------------------
+				 * IMPORTANT: FFT nodes must process each frame of the stream and
+				 * ignore num_frames (num_frames indicates how many audio frames have
+				 * been passed this block, but the stream holds one frame of
+				 * `fft_size` values per hop).
+				 *-----------------------------------------------------------------------*/
+				int num_channels = std::min(this->stream->num_channels, in->num_channels);
+				for (int index = 0; index < in->num_frames; index++)
 				{
-					/*------------------------------------------------------------------------
-					 * IMPORTANT: FFT nodes must process fft_size frames and ignore
-					 * num_frames (num_frames indicates how many audio frames have been 
-					 * passed this block, but the FFT node buffers windows of `fft_size`
-					 * frames.
-					 *-----------------------------------------------------------------------*/
-					for (int frame = 0; frame < this->fft_size; frame++)
+					if (!this->stream->append(in->timestamp(index)))
+						break;
+
+					for (int channel = 0; channel < num_channels; channel++)
 					{
-						if (frame < fft_size / 2)
-						{
-							if (frame > cutoff_bin)
-								out[hop][frame] = 0.0;
-							else
-								out[hop][frame] = input->out[hop][frame];
-						}
-						else
-						{
-							out[hop][frame] = input->out[hop][frame];
-						}
+						spectral_band(in->magnitudes(index, channel), 0, cutoff_bin + 1,
+						              this->stream->magnitudes(index, channel), this->num_bins);
+						vector_copy(in->phases(index, channel), this->stream->phases(index, channel), this->num_bins);
 					}
 				}
 			}
@@ -1,40 +1,101 @@
 #pragma once
 
-#include "../node.h"
+#include "fftnode.h"
+#include "spectral_kernels.h"
 #include "../constants.h"
 
+#include <math.h>
+
 namespace libsignal
 {
-	class FFTNoiseGate : public UnaryOpNode
+	/**------------------------------------------------------------------------
+	 * Spectral noise gate. Silences each bin whose magnitude is below
+	 * `threshold`, where 1.0 is the peak of a full-scale sinusoid.
+	 *
+	 * Each bin's gain opens and closes with time constants of `attack` and
+	 * `release` seconds, rather than switching from one frame to the
+	 * next, which would leave isolated bins chirping ("musical noise").
+	 *------------------------------------------------------------------------*/
+	class FFTNoiseGate : public FFTOpNode
 	{
 		public:
-			FFTNoiseGate(NodeRef input = 0, NodeRef threshold = 0.5) :
-				UnaryOpNode(input)
+			FFTNoiseGate(NodeRef input = nullptr, NodeRef threshold = 0.01, NodeRef attack = 0.005, NodeRef release = 0.05) :
+				FFTOpNode(input), threshold(threshold), attack(attack), release(release)
 			{
 				this->name = "fft_noise_gate";
+
+				this->add_input("threshold", this->threshold);
+				this->add_input("attack", this->attack);
+				this->add_input("release", this->release);
+
+				this->gain = fft_allocate(this->num_bins);
 			}
 
+			NodeRef threshold;
+			NodeRef attack;
+			NodeRef release;
+
+			/*------------------------------------------------------------------------
+			 * Gain of each bin, num_bins per channel.
+			 *-----------------------------------------------------------------------*/
+			std::shared_ptr<sample> gain;
+
 			virtual void process(sample **out, int num_frames)
 			{
-				for (int channel = 0; channel < 4; channel++)
+				SpectralStream *in = this->begin_block(num_frames);
+				if (!in)
+					return;
+
+				int num_channels = std::min(this->stream->num_channels, in->num_channels);
+
+				/*------------------------------------------------------------------------
+				 * A sinusoid centred on a bin, windowed by the FFT's Hann window,
+				 * has a magnitude of amplitude * fft_size * sqrt(2/3) / 2.
+				 *-----------------------------------------------------------------------*/
+				sample threshold = this->threshold->out[0][0] * this->fft_size * sqrt(2.0 / 3.0) / 2.0;
+				sample attack = this->smoothing(this->attack->out[0][0]);
+				sample release = this->smoothing(this->release->out[0][0]);
+
+				for (int index = 0; index < in->num_frames; index++)
 				{
-					for (int i = 0; i < num_frames; i++)
+					if (!this->stream->append(in->timestamp(index)))
+						break;
+
+					for (int channel = 0; channel < num_channels; channel++)
 					{
-						// Magnitudes
-						if (i < num_frames / 2)
-						{
-							float rv = input->out[channel][i];
-							printf("%f\n", rv);
-							out[channel][i] = (rv < 20) ? rv : 0;
-						}
-						// Phases
-						else
-						{
-							out[channel][i] = input->out[channel][i];
-						}
+						spectral_gate(in->magnitudes(index, channel), threshold, attack, release,
+						              this->gain.get() + channel * this->num_bins,
+						              this->stream->magnitudes(index, channel), this->num_bins);
+						vector_copy(in->phases(index, channel), this->stream->phases(index, channel), this->num_bins);
 					}
 				}
 			}
+
+		protected:
+			virtual std::function<void()> create_stream(int fft_size, int hop_size, int num_channels, int max_block_size)
+			{
+				std::function<void()> swap = FFTOpNode::create_stream(fft_size, hop_size, num_channels, max_block_size);
+				std::shared_ptr<sample> gain = fft_allocate(num_channels * (fft_size / 2));
+
+				return [this, swap, gain]
+				{
+					swap();
+					fft_swap(this->graph, this->gain, gain);
+				};
+			}
+
+		private:
+
+			/*------------------------------------------------------------------------
+			 * The fraction of the remaining change in gain made each hop, for a
+			 * time constant in seconds.
+			 *-----------------------------------------------------------------------*/
+			sample smoothing(sample time)
+			{
+				if (time <= 0)
+					return 1.0;
+				return 1.0 - exp(-this->hop_size / (time * this->graph->sample_rate));
+			}
 	};
 
 	REGISTER(FFTNoiseGate, "fft_noise_gate");
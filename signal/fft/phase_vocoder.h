@@ -1,6 +1,7 @@
 #pragma once
 
-#include "../node.h"
+#include "fftnode.h"
+#include "spectral_kernels.h"
 #include "../constants.h"
 
 namespace libsignal
@@ -15,16 +16,19 @@ namespace libsignal
 
 				this->add_input("clock", this->clock);
 
-				this->phase_buffer     = (sample *) calloc(this->num_bins, sizeof(sample));
-				this->phase_deriv      = (sample *) calloc(this->num_bins, sizeof(sample));
-				this->magnitude_buffer = (sample *) calloc(this->num_bins, sizeof(sample));
+				this->magnitude_buffer = fft_allocate(this->num_bins);
+				this->phase_buffer = fft_allocate(this->num_bins);
+				this->phase_deriv = fft_allocate(this->num_bins);
 
 				this->frozen = false;
 			}
 
-			sample *magnitude_buffer;
-			sample *phase_buffer;
-			sample *phase_deriv;
+			/*------------------------------------------------------------------------
+			 * Held magnitudes and phases, num_bins per channel.
+			 *-----------------------------------------------------------------------*/
+			std::shared_ptr<sample> magnitude_buffer;
+			std::shared_ptr<sample> phase_buffer;
+			std::shared_ptr<sample> phase_deriv;
 			bool frozen;
 
 			NodeRef clock = nullptr;
@@ -41,57 +45,75 @@ namespace libsignal
 					SIGNAL_PROCESS_TRIGGER_BLOCK(this->clock, num_frames, SIGNAL_DEFAULT_TRIGGER);
 				}
 
-				FFTNode *fftnode = (FFTNode *) this->input.get();
-				this->num_hops = fftnode->num_hops; 
+				SpectralStream *in = this->begin_block(num_frames);
+				if (!in)
+					return;
 
-				for (int hop = 0; hop < this->num_hops; hop++)
+				int num_channels = std::min(this->stream->num_channels, in->num_channels);
+
+				for (int index = 0; index < in->num_frames; index++)
 				{
-					/*------------------------------------------------------------------------
-					 * Rather than num_frames here, we need to iterate over fft_size frames
-					 *  - as each block contains a whole fft of samples.
-					 *-----------------------------------------------------------------------*/
-					for (int frame = 0; frame < this->fft_size; frame++)
+					if (!this->stream->append(in->timestamp(index)))
+						break;
+
+					for (int channel = 0; channel < num_channels; channel++)
 					{
+						sample *magnitudes = this->magnitude_buffer.get() + channel * this->num_bins;
+						sample *phases = this->phase_buffer.get() + channel * this->num_bins;
+						sample *phase_deriv = this->phase_deriv.get() + channel * this->num_bins;
+
+						/*------------------------------------------------------------------------
+						 * When frozen, repeat the held magnitudes, and advance each phase
+						 * by its held rate of change per hop.
+						 *-----------------------------------------------------------------------*/
 						if (frozen)
 						{
-							if (frame < this->num_bins)
-							{
-								out[hop][frame] = magnitude_buffer[frame];
-								// if (frame == 0)
-								// 	out[hop][frame] = 0.0;
-							}
-							else
-							{
-								// copy magnitudes in to out;
-								// for phases, increase by phase_deriv per hop
-								int phase_index = frame - num_bins;
-								phase_buffer[phase_index] = phase_buffer[phase_index] + phase_deriv[phase_index];
-								if (phase_buffer[phase_index] >= M_PI)
-									phase_buffer[phase_index] -= 2.0 * M_PI;
-								out[hop][frame] = phase_buffer[phase_index];
-							}
+							spectral_freeze(phases, phase_deriv, this->num_bins);
+							vector_copy(magnitudes, this->stream->magnitudes(index, channel), this->num_bins);
+							vector_copy(phases, this->stream->phases(index, channel), this->num_bins);
 						}
 						else
 						{
-							// copy in to out
-							out[hop][frame] = input->out[hop][frame];
+							vector_copy(in->frame(index, channel), this->stream->frame(index, channel), this->fft_size);
 						}
 					}
 				}
 
-				int last_hop = this->num_hops - 1;
-				// if ((last_hop >= 1) && (!frozen || triggered))
-				if ((last_hop >= 1) && !frozen)
+				/*------------------------------------------------------------------------
+				 * Hold the latest frame and its phase change since the frame
+				 * before, which may have been in the previous block.
+				 *-----------------------------------------------------------------------*/
+				int last_frame = in->num_frames - 1;
+				if (last_frame >= 0 && !frozen)
 				{
-					FFTNode *fftin = (FFTNode *) input.get();
-					for (int frame = 0; frame < this->num_bins; frame++)
+					for (int channel = 0; channel < num_channels; channel++)
 					{
-						this->phase_deriv[frame]      = fftin->phases[last_hop][frame] - fftin->phases[last_hop - 1][frame];
-						this->phase_buffer[frame]     = fftin->phases[last_hop][frame];
-						this->magnitude_buffer[frame] = fftin->magnitudes[last_hop][frame];
+						int offset = channel * this->num_bins;
+						spectral_phase_difference(in->phases(last_frame, channel), in->phases(last_frame - 1, channel),
+						                          this->phase_deriv.get() + offset, this->num_bins);
+						vector_copy(in->phases(last_frame, channel), this->phase_buffer.get() + offset, this->num_bins);
+						vector_copy(in->magnitudes(last_frame, channel), this->magnitude_buffer.get() + offset, this->num_bins);
 					}
 				}
 			}
+
+		protected:
+			virtual std::function<void()> create_stream(int fft_size, int hop_size, int num_channels, int max_block_size)
+			{
+				std::function<void()> swap = FFTOpNode::create_stream(fft_size, hop_size, num_channels, max_block_size);
+				int size = num_channels * (fft_size / 2);
+				std::shared_ptr<sample> magnitude_buffer = fft_allocate(size);
+				std::shared_ptr<sample> phase_buffer = fft_allocate(size);
+				std::shared_ptr<sample> phase_deriv = fft_allocate(size);
+
+				return [this, swap, magnitude_buffer, phase_buffer, phase_deriv]
+				{
+					swap();
+					fft_swap(this->graph, this->magnitude_buffer, magnitude_buffer);
+					fft_swap(this->graph, this->phase_buffer, phase_buffer);
+					fft_swap(this->graph, this->phase_deriv, phase_deriv);
+				};
+			}
 	};
 
 	REGISTER(FFTPhaseVocoder, "fft_phase_vocoder");
@@ -0,0 +1,96 @@
+#pragma once
+
+/**-------------------------------------------------------------------------
+ * @file spectral_kernels.h
+ * @brief Operations on spectral frames, for spectral nodes.
+ *
+ * Each operates on one channel of one frame, as a contiguous run of
+ * num_bins magnitudes or phases (see SpectralStream), using the vector
+ * kernels. As with those, `out` may be the same buffer as an input.
+ * Bin 0 holds DC and Nyquist together (see fft_to_polar()).
+ *-----------------------------------------------------------------------*/
+
+#include "../kernels/kernels.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace libsignal
+{
+	/*------------------------------------------------------------------------
+	 * Keep the magnitudes of bins low_bin to high_bin - 1, and silence the
+	 * rest.
+	 *-----------------------------------------------------------------------*/
+	inline void spectral_band(const sample *magnitudes, int low_bin, int high_bin, sample *out, int num_bins)
+	{
+		low_bin = std::max(0, std::min(low_bin, num_bins));
+		high_bin = std::max(low_bin, std::min(high_bin, num_bins));
+
+		vector_fill(out, 0.0, low_bin);
+		vector_copy(magnitudes + low_bin, out + low_bin, high_bin - low_bin);
+		vector_fill(out + high_bin, 0.0, num_bins - high_bin);
+	}
+
+	/*------------------------------------------------------------------------
+	 * Gate each bin whose magnitude is below `threshold`, smoothing each
+	 * bin's gain (held in `gain`) by the fraction `attack` or `release`
+	 * of its change per frame. See vector_spectral_gate().
+	 *-----------------------------------------------------------------------*/
+	inline void spectral_gate(const sample *magnitudes, sample threshold, sample attack, sample release,
+	                          sample *gain, sample *out, int num_bins)
+	{
+		vector_spectral_gate(magnitudes, threshold, attack, release, gain, out, num_bins);
+	}
+
+	/*------------------------------------------------------------------------
+	 * Advance held phases by their change per frame, to resynthesise a
+	 * frozen spectrum. Changes are as given by spectral_phase_difference().
+	 *-----------------------------------------------------------------------*/
+	inline void spectral_freeze(sample *phases, const sample *increments, int num_bins)
+	{
+		vector_phase_advance(phases, increments, phases, num_bins);
+	}
+
+	inline void spectral_phase_difference(const sample *phases, const sample *previous_phases, sample *out, int num_bins)
+	{
+		vector_subtract(phases, previous_phases, out, num_bins);
+	}
+
+	/*------------------------------------------------------------------------
+	 * Cross-synthesis: crossfade from the magnitudes of `carrier` (at an
+	 * amount of 0) to those of `modulator` (at 1). Used with the carrier's
+	 * phases, this imposes the modulator's spectral envelope on it.
+	 *-----------------------------------------------------------------------*/
+	inline void spectral_cross(const sample *carrier, const sample *modulator, sample amount, sample *out, int num_bins)
+	{
+		vector_mix(carrier, modulator, amount, out, num_bins);
+	}
+
+	/*------------------------------------------------------------------------
+	 * Move each value up by `shift` bins (or down, if negative), filling
+	 * the bins left empty with zero. Bin 0 pairs DC and Nyquist, so stays
+	 * where it is, and bins 1 to num_bins - 1 are moved among themselves.
+	 *-----------------------------------------------------------------------*/
+	inline void spectral_shift(const sample *in, int shift, sample *out, int num_bins)
+	{
+		if (num_bins < 1)
+			return;
+
+		out[0] = in[0];
+		in++;
+		out++;
+		num_bins--;
+		shift = std::max(-num_bins, std::min(shift, num_bins));
+
+		if (shift >= 0)
+		{
+			memmove(out + shift, in, (num_bins - shift) * sizeof(sample));
+			vector_fill(out, 0.0, shift);
+		}
+		else
+		{
+			memmove(out, in - shift, (num_bins + shift) * sizeof(sample));
+			vector_fill(out + num_bins + shift, 0.0, -shift);
+		}
+	}
+}
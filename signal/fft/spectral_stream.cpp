@@ -0,0 +1,75 @@
+#include "spectral_stream.h"
+
+#include <stdexcept>
+#include <stdlib.h>
+
+namespace libsignal
+{
+
+SpectralStream::SpectralStream(int fft_size, int hop_size, int num_channels, int max_block_size)
+{
+	if (hop_size <= 0 || hop_size > fft_size)
+		throw std::runtime_error("FFT hop size must be between 1 and the FFT size");
+
+	this->fft_size = fft_size;
+	this->num_bins = fft_size / 2;
+	this->hop_size = hop_size;
+	this->num_channels = num_channels;
+	this->max_block_size = max_block_size;
+	this->num_frames = 0;
+	this->position = 0;
+	this->frames_written = 0;
+
+	/*------------------------------------------------------------------------
+	 * A block of n samples completes at most ceil(n / hop_size) windows.
+	 *-----------------------------------------------------------------------*/
+	int max_frames_per_block = (max_block_size + hop_size - 1) / hop_size;
+	this->capacity = max_frames_per_block + SIGNAL_SPECTRAL_STREAM_HISTORY;
+	this->storage = (sample *) calloc((size_t) this->capacity * num_channels * fft_size, sizeof(sample));
+	this->timestamps = (int64_t *) calloc(this->capacity, sizeof(int64_t));
+}
+
+SpectralStream::~SpectralStream()
+{
+	free(this->storage);
+	free(this->timestamps);
+}
+
+void SpectralStream::begin_block(int64_t position)
+{
+	this->frames_written += this->num_frames;
+	this->num_frames = 0;
+	this->position = position;
+}
+
+sample *SpectralStream::append(int64_t timestamp)
+{
+	if (this->num_frames >= this->capacity - SIGNAL_SPECTRAL_STREAM_HISTORY)
+		return NULL;
+
+	int slot = this->slot(this->num_frames);
+	this->timestamps[slot] = timestamp;
+	this->num_frames++;
+
+	return this->storage + (size_t) slot * this->num_channels * this->fft_size;
+}
+
+int SpectralStream::slot(int index) const
+{
+	int64_t frame = this->frames_written + index;
+	if (frame < 0)
+		frame = 0;
+	return (int) (frame % this->capacity);
+}
+
+sample *SpectralStream::frame(int index, int channel) const
+{
+	return this->storage + ((size_t) this->slot(index) * this->num_channels + channel) * this->fft_size;
+}
+
+int64_t SpectralStream::timestamp(int index) const
+{
+	return this->timestamps[this->slot(index)];
+}
+
+}
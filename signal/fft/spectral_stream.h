@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../constants.h"
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------
+ * Number of frames from earlier blocks that remain readable in a
+ * spectral stream, for ops that compare successive frames.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_SPECTRAL_STREAM_HISTORY 4
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * A ring of spectral frames, as produced by an FFT node.
+	 *
+	 * Each frame holds num_channels spectra of fft_size samples (num_bins
+	 * magnitudes followed by num_bins phases, or interleaved real and
+	 * imaginary parts), one after another, taken from a window of the
+	 * input starting at timestamp(), in samples since the stream began. Successive windows start hop_size samples apart,
+	 * so a block can hold any number of frames, or none.
+	 *
+	 * The producing node calls begin_block() then append() for each frame
+	 * it writes. Consumers read frames 0 to num_frames - 1 in place, and
+	 * may look back up to SIGNAL_SPECTRAL_STREAM_HISTORY frames before
+	 * the block with a negative index.
+	 *------------------------------------------------------------------------*/
+	class SpectralStream
+	{
+		public:
+			/*------------------------------------------------------------------------
+			 * The ring holds as many frames as a block of up to max_block_size
+			 * samples can complete, plus the history.
+			 *-----------------------------------------------------------------------*/
+			SpectralStream(int fft_size, int hop_size, int num_channels = 1,
+			               int max_block_size = SIGNAL_DEFAULT_BLOCK_SIZE);
+			~SpectralStream();
+
+			/*------------------------------------------------------------------------
+			 * Start a block ending at `position` samples into the stream.
+			 *-----------------------------------------------------------------------*/
+			void begin_block(int64_t position);
+
+			/*------------------------------------------------------------------------
+			 * Return the storage of the next frame, whose window starts at
+			 * `timestamp`, with each channel's spectrum fft_size samples after
+			 * the last. Returns NULL if the block already holds as many frames
+			 * as the stream was sized for, as we may be on the audio thread.
+			 *-----------------------------------------------------------------------*/
+			sample *append(int64_t timestamp);
+
+			sample *frame(int index, int channel = 0) const;
+			int64_t timestamp(int index) const;
+			sample *magnitudes(int index, int channel = 0) const { return this->frame(index, channel); }
+			sample *phases(int index, int channel = 0) const { return this->frame(index, channel) + this->num_bins; }
+
+			int fft_size;
+			int num_bins;
+			int hop_size;
+			int num_channels;
+			int max_block_size;
+
+			/*------------------------------------------------------------------------
+			 * Frames appended in the current block, and the stream position at
+			 * the end of it.
+			 *-----------------------------------------------------------------------*/
+			int num_frames;
+			int64_t position;
+
+		private:
+			int slot(int index) const;
+
+			sample *storage;
+			int64_t *timestamps;
+			int capacity;
+			int64_t frames_written;
+	};
+}
@@ -1,32 +1,43 @@
 #pragma once
 
-#include "../node.h"
+#include "fftnode.h"
+#include "spectral_kernels.h"
 #include "../constants.h"
 
 namespace libsignal
 {
-	class FFTZeroPhase : public UnaryOpNode
+	/**------------------------------------------------------------------------
+	 * Discards the phase of every bin, keeping only the magnitudes. Each
+	 * frame resynthesises as a symmetric pulse, which gives a buzzy,
+	 * time-smeared version of the input.
+	 *------------------------------------------------------------------------*/
+	class FFTZeroPhase : public FFTOpNode
 	{
 		public:
-			FFTZeroPhase(NodeRef input = 0) :
-				UnaryOpNode(input)
+			FFTZeroPhase(NodeRef input = nullptr) :
+				FFTOpNode(input)
 			{
 				this->name = "zero_phase";
 			}
 
 			virtual void process(sample **out, int num_frames)
 			{
-				for (int i = 0; i < num_frames; i++)
+				SpectralStream *in = this->begin_block(num_frames);
+				if (!in)
+					return;
+
+				int num_channels = std::min(this->stream->num_channels, in->num_channels);
+
+				for (int index = 0; index < in->num_frames; index++)
 				{
-					if (i > 0 && i < num_frames / 2)
+					if (!this->stream->append(in->timestamp(index)))
+						break;
+
+					for (int channel = 0; channel < num_channels; channel++)
 					{
-						if (i < num_frames / 4)
-							out[0][i] = input->out[0][i];
-						else
-							out[0][i] = input->out[0][i];
+						vector_copy(in->magnitudes(index, channel), this->stream->magnitudes(index, channel), this->num_bins);
+						vector_fill(this->stream->phases(index, channel), 0.0, this->num_bins);
 					}
-					else
-						out[0][i] = input->out[0][i] * 0.1;
 				}
 			}
 	};
@@ -0,0 +1,104 @@
+#include "biquad.h"
+
+#include "../fastmath.h"
+#include "../kernels/kernels.h"
+
+#include <math.h>
+#include <stdexcept>
+
+namespace libsignal
+{
+
+Biquad::Biquad(NodeRef input, NodeRef cutoff, NodeRef q, NodeRef gain, signal_filter_type_t type,
+               int stages, bool per_sample) :
+	ResonantFilter(input, cutoff, q, gain, type, per_sample, 5), stages(stages)
+{
+	this->name = "biquad";
+
+	if (stages < 1 || stages > SIGNAL_BIQUAD_MAX_STAGES)
+		throw std::runtime_error("Biquad: invalid number of stages");
+
+	memset(this->state, 0, sizeof(this->state));
+}
+
+/*------------------------------------------------------------------------
+ * Each response as an analog prototype,
+ *
+ *   H(s) = (n2 s^2 + n1 s / q + n0) / (d2 s^2 + d1 s / q + d0),
+ *
+ * in which each term is its weight times r^power, with A = 10^(gain / 40)
+ * and r = sqrt(A). The bilinear transform of these gives the Cookbook's
+ * coefficients, with one branch-free, vectorisable loop for every type.
+ * Terms are ordered n2, n1, n0, d2, d1, d0.
+ *-----------------------------------------------------------------------*/
+typedef struct
+{
+	sample weight[6];
+	sample power[6];
+} biquad_response_t;
+
+static const biquad_response_t biquad_responses[] =
+{
+	{ { 0, 0, 1, 1, 1, 1 }, { 0, 0, 0, 0,  0, 0 } },	/* low pass */
+	{ { 1, 0, 0, 1, 1, 1 }, { 0, 0, 0, 0,  0, 0 } },	/* high pass */
+	{ { 0, 1, 0, 1, 1, 1 }, { 0, 0, 0, 0,  0, 0 } },	/* band pass */
+	{ { 1, 0, 1, 1, 1, 1 }, { 0, 0, 0, 0,  0, 0 } },	/* notch */
+	{ { 1, 1, 1, 1, 1, 1 }, { 0, 2, 0, 0, -2, 0 } },	/* peak */
+	{ { 1, 1, 1, 1, 1, 1 }, { 2, 3, 4, 2,  1, 0 } },	/* low shelf */
+	{ { 1, 1, 1, 1, 1, 1 }, { 4, 3, 2, 0,  1, 2 } }	/* high shelf */
+};
+
+void Biquad::calculate_response(const sample *frequency, const sample *q, const sample *gain,
+                                int count, sample *coefficients, int coefficient_stride, int set_stride)
+{
+	const biquad_response_t response = biquad_responses[this->type];
+
+	/*------------------------------------------------------------------------
+	 * Coefficients are calculated into a local buffer, then copied out,
+	 * so that the calculation can be vectorised without alias checks.
+	 *-----------------------------------------------------------------------*/
+	sample values[5][SIGNAL_LANES_BLOCK_SIZE];
+	for (int index = 0; index < count; index++)
+	{
+		/*------------------------------------------------------------------------
+		 * log2(r) = gain * log2(10) / 80.
+		 *-----------------------------------------------------------------------*/
+		sample log_r = gain[index] * 0.0415241012f;
+		sample n2 = response.weight[0] * fast_exp2(response.power[0] * log_r);
+		sample n1 = response.weight[1] * fast_exp2(response.power[1] * log_r);
+		sample n0 = response.weight[2] * fast_exp2(response.power[2] * log_r);
+		sample d2 = response.weight[3] * fast_exp2(response.power[3] * log_r);
+		sample d1 = response.weight[4] * fast_exp2(response.power[4] * log_r);
+		sample d0 = response.weight[5] * fast_exp2(response.power[5] * log_r);
+
+		sample angle = (sample) M_PI * frequency[index];
+		sample k = fast_sin(angle) / fast_cos(angle);
+		sample k2 = k * k;
+		sample k_q = k / q[index];
+
+		sample scale = 1.0f / (d2 + d1 * k_q + d0 * k2);
+		values[0][index] = (n2 + n1 * k_q + n0 * k2) * scale;
+		values[1][index] = 2.0f * (n0 * k2 - n2) * scale;
+		values[2][index] = (n2 - n1 * k_q + n0 * k2) * scale;
+		values[3][index] = 2.0f * (d0 * k2 - d2) * scale;
+		values[4][index] = (d2 - d1 * k_q + d0 * k2) * scale;
+	}
+
+	for (int index = 0; index < count; index++)
+		for (int coefficient = 0; coefficient < 5; coefficient++)
+			coefficients[index * set_stride + coefficient * coefficient_stride] = values[coefficient][index];
+}
+
+void Biquad::filter(const sample *in, const sample *coefficients, int coefficient_stride,
+                    int num_lanes, sample *out, int num_frames)
+{
+	/*------------------------------------------------------------------------
+	 * The first stage reads the input, and each later stage filters
+	 * the previous stage's output in place.
+	 *-----------------------------------------------------------------------*/
+	for (int stage = 0; stage < this->stages; stage++)
+		vector_biquad(stage ? out : in, coefficients, coefficient_stride,
+		              &this->state[2 * stage][0], num_lanes, out, num_frames);
+}
+
+}
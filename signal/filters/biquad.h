@@ -0,0 +1,41 @@
+#pragma once
+
+#include "lane_filter.h"
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * Cascade of 1 to SIGNAL_BIQUAD_MAX_STAGES identical biquad sections,
+	 * with coefficients from Robert Bristow-Johnson's "Audio EQ Cookbook".
+	 * Each stage adds 12dB/octave to the slope of the pass and shelf
+	 * types; two stages with a `q` of 0.707 give a Linkwitz-Riley
+	 * crossover response.
+	 *
+	 * `cutoff` is in Hz, `q` is the resonance and `gain` (in dB) applies
+	 * to the peak and shelf types only. See LaneFilter for how
+	 * coefficients follow modulation.
+	 *------------------------------------------------------------------------*/
+	class Biquad : public ResonantFilter
+	{
+		public:
+			Biquad(NodeRef input = 0.0, NodeRef cutoff = 440, NodeRef q = 0.707, NodeRef gain = 0.0,
+			       signal_filter_type_t type = SIGNAL_FILTER_LOW_PASS, int stages = 1, bool per_sample = false);
+
+			int stages;
+
+			/*------------------------------------------------------------------------
+			 * Filter state, two rows per stage (s1, s2), one column per
+			 * channel.
+			 *-----------------------------------------------------------------------*/
+			sample state[2 * SIGNAL_BIQUAD_MAX_STAGES][SIGNAL_MAX_CHANNELS];
+
+		protected:
+			virtual void calculate_response(const sample *frequency, const sample *q, const sample *gain,
+			                                int count, sample *coefficients,
+			                                int coefficient_stride, int set_stride);
+			virtual void filter(const sample *in, const sample *coefficients, int coefficient_stride,
+			                    int num_lanes, sample *out, int num_frames);
+	};
+
+	REGISTER(Biquad, "biquad");
+}
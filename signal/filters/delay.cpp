@@ -1,26 +1,157 @@
-#include "delay.h" 
+#include "delay.h"
 
 #include "../oscillators/constant.h"
+#include "../graph.h"
+#include "../kernels/kernels.h"
+#include "../util.h"
 
-#include <stdlib.h>
+#include <algorithm>
+#include <math.h>
 
 namespace libsignal
 {
 
+Delay::Delay(NodeRef input, NodeRef delaytime, NodeRef feedback, float maxdelaytime, signal_interpolate_t interpolate) :
+	UnaryOpNode(input), delaytime(delaytime), feedback(feedback), maxdelaytime(maxdelaytime), interpolate(interpolate)
+{
+	this->name = "delay";
+	this->max_delay = (int) ceilf(maxdelaytime * this->graph->sample_rate);
+	this->can_process_in_place = true;
+
+	this->add_input("delay_time", this->delaytime);
+	this->add_input("feedback", this->feedback);
+}
+
+void Delay::update_channels()
+{
+	UnaryOpNode::update_channels();
+
+	/*------------------------------------------------------------------------
+	 * We may be on the audio thread, so hand unused lines to the graph
+	 * to be freed. There, new lines are handed over by set_input().
+	 *-----------------------------------------------------------------------*/
+	for (int channel = 0; channel < SIGNAL_MAX_CHANNELS; channel++)
+	{
+		if (channel < this->num_output_channels && !this->lines[channel])
+		{
+			if (!this->graph || !this->graph->is_audio_thread())
+				this->lines[channel] = std::make_shared<DelayLine>(this->max_delay);
+		}
+		else if (channel >= this->num_output_channels && this->lines[channel])
+		{
+			if (this->graph)
+				this->graph->retire(this->lines[channel]);
+			this->lines[channel].reset();
+		}
+	}
+}
+
+void Delay::set_input(std::string name, const NodeRef &node)
+{
+	if (!this->is_deferring())
+	{
+		UnaryOpNode::set_input(name, node);
+		return;
+	}
+
+	/*------------------------------------------------------------------------
+	 * The edit is made on the audio thread, so allocate any lines that
+	 * our new number of channels needs here, and hand them over after it.
+	 *-----------------------------------------------------------------------*/
+	AudioGraphTransactionScope transaction(this->graph);
+	int num_channels = 1;
+	for (auto param : this->params)
+	{
+		NodeRef input = (param.first == name) ? node : this->graph->get_staged_input(this, param.first);
+		if (input)
+			num_channels = std::max(num_channels, input->num_output_channels);
+	}
+
+	std::vector<std::shared_ptr<DelayLine>> lines(num_channels);
+	for (int channel = 0; channel < num_channels; channel++)
+		if (!this->lines[channel])
+			lines[channel] = std::make_shared<DelayLine>(this->max_delay);
+
+	UnaryOpNode::set_input(name, node);
+
+	this->defer_edit([this, lines]
+	{
+		for (int channel = 0; channel < (int) lines.size() && channel < this->num_output_channels; channel++)
+			if (!this->lines[channel])
+				this->lines[channel] = lines[channel];
+	});
+	transaction.commit();
+}
+
 void Delay::process(sample **out, int num_frames)
 {
-	for (int frame = 0; frame < num_frames; frame++)
+	sample sample_rate = this->graph->sample_rate;
+	sample min_delay = DelayLine::min_delay(this->interpolate);
+	sample delays[SIGNAL_DELAY_RUN_LENGTH];
+	sample taps[SIGNAL_DELAY_RUN_LENGTH];
+
+	for (int channel = 0; channel < this->num_output_channels; channel++)
 	{
-		sample d = this->delaytime->out[0][frame];
-		sample f = this->feedback->out[0][frame];
-		int offset = d * this->graph->sample_rate;
+		DelayLine *line = this->lines[channel].get();
+		if (!line)
+		{
+			vector_fill(out[channel], 0.0, num_frames);
+			continue;
+		}
 
-		for (int channel = 0; channel < this->num_input_channels; channel++)
+		sample max_delay = line->max_delay;
+		const sample *input = this->input->out[channel];
+		const sample *delaytime = this->delaytime->out[channel];
+		const sample *feedback = this->feedback->out[channel];
+
+		for (int offset = 0; offset < num_frames; )
 		{
-			sample rv = input->out[channel][frame] + f * buffers[channel]->get(-offset);
-			out[channel][frame] = rv;
-			buffers[channel]->append(rv);
-			// TODO should copy bulk samples rather than appending single
+			int run = std::min(num_frames - offset, SIGNAL_DELAY_RUN_LENGTH);
+
+			/*------------------------------------------------------------------------
+			 * Runs are read before they are written, so must be no longer than
+			 * the delay. At a constant delay, the whole run is copied out of the
+			 * line at once.
+			 *-----------------------------------------------------------------------*/
+			if (this->delaytime->is_constant)
+			{
+				sample delay = clip(delaytime[0] * sample_rate, min_delay, max_delay);
+				run = std::min(run, DelayLine::max_run(delay, this->interpolate));
+				line->read(delay, this->interpolate, taps, run);
+			}
+			else
+			{
+				vector_multiply_scalar(delaytime + offset, sample_rate, delays, run);
+				vector_clip(delays, min_delay, max_delay, delays, run);
+				sample shortest = *std::min_element(delays, delays + run);
+
+				/*------------------------------------------------------------------------
+				 * If the delay falls below the run length, the run is processed
+				 * one frame at a time.
+				 *-----------------------------------------------------------------------*/
+				if (DelayLine::max_run(shortest, this->interpolate) < run)
+				{
+					for (int frame = offset; frame < offset + run; frame++)
+					{
+						sample value = input[frame] + feedback[frame] * line->read(delays[frame - offset], this->interpolate);
+						line->write(value);
+						out[channel][frame] = value;
+					}
+					offset += run;
+					continue;
+				}
+
+				line->read(delays, this->interpolate, taps, run);
+			}
+
+			if (this->feedback->is_constant)
+				vector_multiply_scalar(taps, feedback[0], taps, run);
+			else
+				vector_multiply(taps, feedback + offset, taps, run);
+			vector_add(input + offset, taps, out[channel] + offset, run);
+			line->write(out[channel] + offset, run);
+
+			offset += run;
 		}
 	}
 }
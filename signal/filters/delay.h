@@ -2,39 +2,42 @@
 
 #include "../node.h"
 #include "../constants.h"
-#include "../ringbuffer.h"
-#include "../graph.h"
+#include "delay_line.h"
 
-#include <vector>
+#include <memory>
 
 namespace libsignal
 {
+	/**------------------------------------------------------------------------
+	 * Feedback delay (echo).
+	 *
+	 * Each output frame is the input plus `feedback` times the output
+	 * `delaytime` seconds earlier, up to `maxdelaytime`. Fractional and
+	 * modulated delay times are interpolated with `interpolate`; delays
+	 * are at least DelayLine::min_delay() samples.
+	 *
+	 * History is only held for the channels in use, and is allocated
+	 * when the channel count changes: by set_input() on the control
+	 * thread, if the graph is running.
+	 *------------------------------------------------------------------------*/
 	class Delay : public UnaryOpNode
 	{
 		public:
-			Delay(NodeRef input = 0.0, NodeRef delaytime = 0.1, NodeRef feedback = 0.5, float maxdelaytime = 10.0) :
-				UnaryOpNode(input), delaytime(delaytime), feedback(feedback), maxdelaytime(maxdelaytime)
-			{
-				this->name = "delay";
-				this->add_input("delay_time", this->delaytime);
-				this->add_input("feedback", this->feedback);
-
-				for (int i = 0; i < SIGNAL_MAX_CHANNELS; i++)
-					buffers.push_back(new SampleRingBuffer(maxdelaytime * this->graph->sample_rate));
-			}
-
-			~Delay()
-			{
-				// free buffers
-			}
+			Delay(NodeRef input = 0.0, NodeRef delaytime = 0.1, NodeRef feedback = 0.5, float maxdelaytime = 10.0,
+			      signal_interpolate_t interpolate = SIGNAL_INTERPOLATE_LINEAR);
 
 			NodeRef delaytime;
 			NodeRef feedback;
 			float maxdelaytime;
-
-			std::vector <SampleRingBuffer *> buffers;
+			signal_interpolate_t interpolate;
 
 			virtual void process(sample **out, int num_frames);
+			virtual void update_channels();
+			virtual void set_input(std::string name, const NodeRef &node);
+
+		private:
+			int max_delay;
+			std::shared_ptr<DelayLine> lines[SIGNAL_MAX_CHANNELS];
 	};
 
 	REGISTER(Delay, "delay");
@@ -0,0 +1,225 @@
+#include "delay_line.h"
+
+#include "../kernels/kernels.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+namespace libsignal
+{
+
+DelayLine::DelayLine(int max_delay)
+{
+	/*------------------------------------------------------------------------
+	 * Room for the longest delay, the run written before reading it, and
+	 * the extra samples either side that cubic interpolation needs.
+	 *-----------------------------------------------------------------------*/
+	this->max_delay = std::max(max_delay, 2);
+	this->size = 1;
+	while (this->size < this->max_delay + SIGNAL_DELAY_RUN_LENGTH + 4)
+		this->size <<= 1;
+	this->mask = this->size - 1;
+	this->position = 0;
+	this->allpass_state = 0.0;
+	this->data = (sample *) calloc(this->size, sizeof(sample));
+}
+
+DelayLine::~DelayLine()
+{
+	free(this->data);
+}
+
+void DelayLine::write(const sample *in, int num_frames)
+{
+	while (num_frames > 0)
+	{
+		int count = std::min(num_frames, this->size - this->position);
+		memcpy(this->data + this->position, in, sizeof(sample) * count);
+		this->position = (this->position + count) & this->mask;
+		in += count;
+		num_frames -= count;
+	}
+}
+
+void DelayLine::copy(int delay, sample *out, int num_frames)
+{
+	int start = (this->position - delay) & this->mask;
+	int first = std::min(num_frames, this->size - start);
+	memcpy(out, this->data + start, sizeof(sample) * first);
+	memcpy(out + first, this->data, sizeof(sample) * (num_frames - first));
+}
+
+/*------------------------------------------------------------------------
+ * Interpolated reads at `delay` samples before `position`. Frames
+ * further in the past are at higher delays, so cubic interpolation
+ * reads from y0 (the newest) to y3 (the oldest).
+ *-----------------------------------------------------------------------*/
+static inline sample read_none(const sample *data, int mask, int position, sample delay)
+{
+	return data[(position - (int) delay) & mask];
+}
+
+static inline sample read_linear(const sample *data, int mask, int position, sample delay)
+{
+	int whole = (int) delay;
+	sample frac = delay - whole;
+	sample y1 = data[(position - whole) & mask];
+	sample y2 = data[(position - whole - 1) & mask];
+	return y1 + (y2 - y1) * frac;
+}
+
+/*------------------------------------------------------------------------
+ * 4-point, 3rd-order Hermite (Catmull-Rom) interpolation between
+ * y1 and y2.
+ *-----------------------------------------------------------------------*/
+static inline sample read_cubic(const sample *data, int mask, int position, sample delay)
+{
+	int whole = (int) delay;
+	sample frac = delay - whole;
+	sample y0 = data[(position - whole + 1) & mask];
+	sample y1 = data[(position - whole) & mask];
+	sample y2 = data[(position - whole - 1) & mask];
+	sample y3 = data[(position - whole - 2) & mask];
+	sample c1 = 0.5f * (y2 - y0);
+	sample c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+	sample c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+	return ((c3 * frac + c2) * frac + c1) * frac + y1;
+}
+
+/*------------------------------------------------------------------------
+ * First-order allpass interpolation, which has a flat magnitude
+ * response (unlike linear, which attenuates high frequencies), but
+ * depends on its previous output. The fractional part is kept within
+ * [0.618, 1.618), where the allpass's phase delay is most accurate.
+ *-----------------------------------------------------------------------*/
+static inline sample allpass_coefficient(sample delay, int &whole)
+{
+	whole = (int) (delay - 0.618f);
+	sample frac = delay - whole;
+	return (1.0f - frac) / (1.0f + frac);
+}
+
+static inline sample read_allpass(const sample *data, int mask, int position, sample delay, sample &state)
+{
+	int whole;
+	sample eta = allpass_coefficient(delay, whole);
+	state = eta * (data[(position - whole) & mask] - state) + data[(position - whole - 1) & mask];
+	return state;
+}
+
+void DelayLine::read(int delay, sample *out, int num_frames)
+{
+	this->copy(delay, out, num_frames);
+}
+
+void DelayLine::read(sample delay, signal_interpolate_t interpolate, sample *out, int num_frames)
+{
+	if (interpolate == SIGNAL_INTERPOLATE_NONE || delay == (int) delay)
+	{
+		/*------------------------------------------------------------------------
+		 * Allpass interpolation keeps its state up to date for whenever
+		 * the delay becomes fractional again.
+		 *-----------------------------------------------------------------------*/
+		this->copy((int) delay, out, num_frames);
+		if (interpolate == SIGNAL_INTERPOLATE_ALLPASS && num_frames > 0)
+			this->allpass_state = out[num_frames - 1];
+		return;
+	}
+
+	/*------------------------------------------------------------------------
+	 * At a constant delay, the interpolation weights are constant too.
+	 * Copy out the samples each run needs, newest last, and weight them.
+	 *-----------------------------------------------------------------------*/
+	sample history[SIGNAL_DELAY_RUN_LENGTH + 3];
+
+	for (int offset = 0; offset < num_frames; offset += SIGNAL_DELAY_RUN_LENGTH)
+	{
+		int run = std::min(num_frames - offset, SIGNAL_DELAY_RUN_LENGTH);
+		int whole = (int) delay;
+		sample frac = delay - whole;
+
+		if (interpolate == SIGNAL_INTERPOLATE_LINEAR)
+		{
+			this->copy(whole + 1 - offset, history, run + 1);
+			vector_mix(history + 1, history, frac, out + offset, run);
+		}
+		else if (interpolate == SIGNAL_INTERPOLATE_CUBIC)
+		{
+			sample frac2 = frac * frac;
+			sample frac3 = frac2 * frac;
+			sample w0 = -0.5f * frac + frac2 - 0.5f * frac3;
+			sample w1 = 1.0f - 2.5f * frac2 + 1.5f * frac3;
+			sample w2 = 0.5f * frac + 2.0f * frac2 - 1.5f * frac3;
+			sample w3 = -0.5f * frac2 + 0.5f * frac3;
+
+			this->copy(whole + 2 - offset, history, run + 3);
+			sample *y = out + offset;
+			for (int frame = 0; frame < run; frame++)
+				y[frame] = w0 * history[frame + 3] + w1 * history[frame + 2] +
+				           w2 * history[frame + 1] + w3 * history[frame];
+		}
+		else
+		{
+			sample eta = allpass_coefficient(delay, whole);
+			sample state = this->allpass_state;
+
+			this->copy(whole + 1 - offset, history, run + 1);
+			sample *y = out + offset;
+			for (int frame = 0; frame < run; frame++)
+			{
+				state = eta * (history[frame + 1] - state) + history[frame];
+				y[frame] = state;
+			}
+			this->allpass_state = state;
+		}
+	}
+}
+
+void DelayLine::read(const sample *delay, signal_interpolate_t interpolate, sample *out, int num_frames)
+{
+	const sample *data = this->data;
+	int mask = this->mask;
+	int position = this->position;
+
+	switch (interpolate)
+	{
+		case SIGNAL_INTERPOLATE_NONE:
+			for (int frame = 0; frame < num_frames; frame++)
+				out[frame] = read_none(data, mask, position + frame, delay[frame]);
+			break;
+		case SIGNAL_INTERPOLATE_LINEAR:
+			for (int frame = 0; frame < num_frames; frame++)
+				out[frame] = read_linear(data, mask, position + frame, delay[frame]);
+			break;
+		case SIGNAL_INTERPOLATE_CUBIC:
+			for (int frame = 0; frame < num_frames; frame++)
+				out[frame] = read_cubic(data, mask, position + frame, delay[frame]);
+			break;
+		default:
+		{
+			sample state = this->allpass_state;
+			for (int frame = 0; frame < num_frames; frame++)
+				out[frame] = read_allpass(data, mask, position + frame, delay[frame], state);
+			this->allpass_state = state;
+			break;
+		}
+	}
+}
+
+sample DelayLine::read(sample delay, signal_interpolate_t interpolate)
+{
+	switch (interpolate)
+	{
+		case SIGNAL_INTERPOLATE_NONE:
+			return read_none(this->data, this->mask, this->position, delay);
+		case SIGNAL_INTERPOLATE_LINEAR:
+			return read_linear(this->data, this->mask, this->position, delay);
+		case SIGNAL_INTERPOLATE_CUBIC:
+			return read_cubic(this->data, this->mask, this->position, delay);
+		default:
+			return read_allpass(this->data, this->mask, this->position, delay, this->allpass_state);
+	}
+}
+
+}
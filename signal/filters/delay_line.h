@@ -0,0 +1,99 @@
+#pragma once
+
+#include "../constants.h"
+#include "../buffer.h"
+
+/*------------------------------------------------------------------------
+ * Number of frames that delay lines read and write at once.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_DELAY_RUN_LENGTH 64
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * A single channel of delayed samples, for delay, echo and chorus
+	 * nodes.
+	 *
+	 * History is held in a power-of-two buffer, so that positions wrap
+	 * with a mask rather than a modulo, and blocks of samples are
+	 * written and read with at most two copies. Reads may be at a
+	 * fractional delay, with no, linear, cubic or allpass interpolation.
+	 *
+	 * Delays are measured in samples from the next frame to be written:
+	 * a delay of 1 reads the frame written most recently. A run of
+	 * frames can be read before it is written (as a feedback delay must)
+	 * so long as each read lies entirely in the past; see min_delay().
+	 *------------------------------------------------------------------------*/
+	class DelayLine
+	{
+		public:
+			/*------------------------------------------------------------------------
+			 * Holds enough history to read a delay of up to `max_delay`
+			 * samples, after writing a run of up to SIGNAL_DELAY_RUN_LENGTH
+			 * frames.
+			 *-----------------------------------------------------------------------*/
+			DelayLine(int max_delay);
+			~DelayLine();
+
+			void write(const sample *in, int num_frames);
+			void write(sample value)
+			{
+				this->data[this->position] = value;
+				this->position = (this->position + 1) & this->mask;
+			}
+
+			/*------------------------------------------------------------------------
+			 * Read `num_frames` frames, each at the same delay. Frame i is read
+			 * `delay` samples before the (i)th frame to be written.
+			 *-----------------------------------------------------------------------*/
+			void read(int delay, sample *out, int num_frames);
+			void read(sample delay, signal_interpolate_t interpolate, sample *out, int num_frames);
+
+			/*------------------------------------------------------------------------
+			 * Read `num_frames` frames, each at its own delay.
+			 *-----------------------------------------------------------------------*/
+			void read(const sample *delay, signal_interpolate_t interpolate, sample *out, int num_frames);
+
+			/*------------------------------------------------------------------------
+			 * Read one frame, `delay` samples before the next to be written.
+			 *-----------------------------------------------------------------------*/
+			sample read(sample delay, signal_interpolate_t interpolate);
+
+			/*------------------------------------------------------------------------
+			 * The shortest delay that reads only frames already written, and
+			 * so the shortest that a feedback delay can use.
+			 *-----------------------------------------------------------------------*/
+			static int min_delay(signal_interpolate_t interpolate)
+			{
+				return (interpolate == SIGNAL_INTERPOLATE_CUBIC || interpolate == SIGNAL_INTERPOLATE_ALLPASS) ? 2 : 1;
+			}
+
+			/*------------------------------------------------------------------------
+			 * The longest run of frames that can be read at `delay` before
+			 * any of them are written.
+			 *-----------------------------------------------------------------------*/
+			static int max_run(sample delay, signal_interpolate_t interpolate)
+			{
+				return (int) delay - min_delay(interpolate) + 1;
+			}
+
+			int max_delay;
+
+		private:
+			/*------------------------------------------------------------------------
+			 * Copy `num_frames` consecutive frames, starting `delay` samples
+			 * before the next frame to be written.
+			 *-----------------------------------------------------------------------*/
+			void copy(int delay, sample *out, int num_frames);
+
+			sample *data;
+			int size;
+			int mask;
+			int position;
+
+			/*------------------------------------------------------------------------
+			 * The last output of the allpass interpolator.
+			 *-----------------------------------------------------------------------*/
+			sample allpass_state;
+	};
+}
@@ -1,59 +1,54 @@
-#include "eq.h" 
+#include "eq.h"
 
-#include "../oscillators/constant.h"
-#include "../graph.h"
+#include "../kernels/kernels.h"
+#include "../fastmath.h"
 
+#include <math.h>
 #include <stdlib.h>
 
 namespace libsignal
 {
 
-void EQ::process(sample **out, int num_frames)
+EQ::EQ(NodeRef input, NodeRef low_gain, NodeRef mid_gain, NodeRef high_gain,
+       NodeRef low_freq, NodeRef high_freq, bool per_sample) :
+	LaneFilter(input, per_sample, 5), low_gain(low_gain), mid_gain(mid_gain), high_gain(high_gain),
+	low_freq(low_freq), high_freq(high_freq)
 {
-	float low, mid, high;
+	this->name = "eq";
 
-	for (int channel = 0; channel < this->num_output_channels; channel++)
+	this->add_control("low_gain", this->low_gain);
+	this->add_control("mid_gain", this->mid_gain);
+	this->add_control("high_gain", this->high_gain);
+	this->add_control("low_freq", this->low_freq);
+	this->add_control("high_freq", this->high_freq);
+
+	memset(this->state, 0, sizeof(this->state));
+}
+
+/*------------------------------------------------------------------------
+ * Coefficients are the low and high crossovers, as the f of a
+ * Chamberlin state-variable filter, then the three gains.
+ *-----------------------------------------------------------------------*/
+void EQ::calculate_coefficients(const sample * const *controls, int count, sample *coefficients,
+                                int coefficient_stride, int set_stride)
+{
+	float radians_per_hz = M_PI / this->coefficient_sample_rate;
+
+	for (int index = 0; index < count; index++)
 	{
-		for (int frame = 0; frame < num_frames; frame++)
-		{
-			float lf = 2 * sin(M_PI * ((double) this->low_freq->out[channel][frame] / this->graph->sample_rate));
-			float hf = 2 * sin(M_PI * ((double) this->high_freq->out[channel][frame] / this->graph->sample_rate));
-
-			/*------------------------------------------------------------------------
-			 * Low-pass filter
-			 *-----------------------------------------------------------------------*/
-			float sample = this->input->out[channel][frame];
-			this->f1p0[channel]  += (lf * (sample   - this->f1p0[channel]));
-			this->f1p1[channel]  += (lf * (this->f1p0[channel] - this->f1p1[channel]));
-			this->f1p2[channel]  += (lf * (this->f1p1[channel] - this->f1p2[channel]));
-			this->f1p3[channel]  += (lf * (this->f1p2[channel] - this->f1p3[channel]));
-			low = this->f1p3[channel];
-
-			/*------------------------------------------------------------------------
-			 * High-pass filter
-			 *-----------------------------------------------------------------------*/
-			this->f2p0[channel]  += (hf * (sample   - this->f2p0[channel]));
-			this->f2p1[channel]  += (hf * (this->f2p0[channel] - this->f2p1[channel]));
-			this->f2p2[channel]  += (hf * (this->f2p1[channel] - this->f2p2[channel]));
-			this->f2p3[channel]  += (hf * (this->f2p2[channel] - this->f2p3[channel]));
-			high = this->sdm3[channel] - this->f2p3[channel];
-
-			/*------------------------------------------------------------------------
-			 * Midrange (signal - (low + high))
-			 *-----------------------------------------------------------------------*/
-			mid = this->sdm3[channel] - (high + low);
-
-			low *= this->low_gain->out[channel][frame];
-			mid *= this->mid_gain->out[channel][frame];
-			high *= this->high_gain->out[channel][frame];
-
-			this->sdm3[channel] = this->sdm2[channel];
-			this->sdm2[channel] = this->sdm1[channel];
-			this->sdm1[channel] = sample;                
-
-			this->out[channel][frame] = low + mid + high;
-		}
+		sample *set = coefficients + index * set_stride;
+		set[0] = 2.0f * fast_sin(controls[3][index] * radians_per_hz);
+		set[coefficient_stride] = 2.0f * fast_sin(controls[4][index] * radians_per_hz);
+		set[2 * coefficient_stride] = controls[0][index];
+		set[3 * coefficient_stride] = controls[1][index];
+		set[4 * coefficient_stride] = controls[2][index];
 	}
 }
 
+void EQ::filter(const sample *in, const sample *coefficients, int coefficient_stride,
+                int num_lanes, sample *out, int num_frames)
+{
+	vector_eq(in, coefficients, coefficient_stride, &this->state[0][0], num_lanes, out, num_frames);
+}
+
 }
@@ -1,38 +1,22 @@
 #pragma once
 
-#include "../node.h"
-#include "../constants.h"
+#include "lane_filter.h"
 
 namespace libsignal
 {
-	class EQ : public UnaryOpNode
+	/**------------------------------------------------------------------------
+	 * Three-band EQ. Splits its input into bands below `low_freq`, above
+	 * `high_freq` and between the two, each in Hz, and mixes them with
+	 * linear gains `low_gain`, `mid_gain` and `high_gain`.
+	 *
+	 * By default, coefficients are calculated from every frame; see
+	 * LaneFilter.
+	 *------------------------------------------------------------------------*/
+	class EQ : public LaneFilter
 	{
 		public:
 			EQ(NodeRef input = 0.0, NodeRef low_gain = 1.0, NodeRef mid_gain = 1.0, NodeRef high_gain = 1.0,
-					NodeRef low_freq = 500, NodeRef high_freq = 5000) :
-				UnaryOpNode(input), low_gain(low_gain), mid_gain(mid_gain), high_gain(high_gain),
-					low_freq(low_freq), high_freq(high_freq)
-			{
-				this->name = "eq";
-				this->add_input("low_gain", this->low_gain);
-				this->add_input("mid_gain", this->mid_gain);
-				this->add_input("high_gain", this->high_gain);
-				this->add_input("low_freq", this->low_freq);
-				this->add_input("high_freq", this->high_freq);
-
-				int int_buf_size = SIGNAL_MAX_CHANNELS * sizeof(int);
-				memset(f1p0, 0, int_buf_size);
-				memset(f1p1, 0, int_buf_size);
-				memset(f1p2, 0, int_buf_size);
-				memset(f1p3, 0, int_buf_size);
-				memset(f2p0, 0, int_buf_size);
-				memset(f2p1, 0, int_buf_size);
-				memset(f2p2, 0, int_buf_size);
-				memset(f2p3, 0, int_buf_size);
-				memset(sdm1, 0, int_buf_size);
-				memset(sdm2, 0, int_buf_size);
-				memset(sdm3, 0, int_buf_size);
-			}
+					NodeRef low_freq = 500, NodeRef high_freq = 5000, bool per_sample = true);
 
 			NodeRef low_gain;
 			NodeRef mid_gain;
@@ -40,11 +24,18 @@ namespace libsignal
 			NodeRef low_freq;
 			NodeRef high_freq;
 
-			float f1p0[SIGNAL_MAX_CHANNELS], f1p1[SIGNAL_MAX_CHANNELS], f1p2[SIGNAL_MAX_CHANNELS], f1p3[SIGNAL_MAX_CHANNELS];
-			float f2p0[SIGNAL_MAX_CHANNELS], f2p1[SIGNAL_MAX_CHANNELS], f2p2[SIGNAL_MAX_CHANNELS], f2p3[SIGNAL_MAX_CHANNELS];
-			float sdm1[SIGNAL_MAX_CHANNELS], sdm2[SIGNAL_MAX_CHANNELS], sdm3[SIGNAL_MAX_CHANNELS];
+			/*------------------------------------------------------------------------
+			 * Filter state, one row per variable (low-pass poles f1p0-3,
+			 * high-pass poles f2p0-3, delayed input sdm1-3), one column per
+			 * channel, so that channels can be processed in parallel.
+			 *-----------------------------------------------------------------------*/
+			sample state[11][SIGNAL_MAX_CHANNELS];
 
-			virtual void process(sample **out, int num_frames);
+		protected:
+			virtual void calculate_coefficients(const sample * const *controls, int count, sample *coefficients,
+			                                    int coefficient_stride, int set_stride);
+			virtual void filter(const sample *in, const sample *coefficients, int coefficient_stride,
+			                    int num_lanes, sample *out, int num_frames);
 	};
 
 	REGISTER(EQ, "eq");
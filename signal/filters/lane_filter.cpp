@@ -0,0 +1,195 @@
+#include "lane_filter.h"
+
+#include "../oscillators/constant.h"
+#include "../graph.h"
+#include "../kernels/kernels.h"
+#include "../fastmath.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace libsignal
+{
+
+LaneFilter::LaneFilter(NodeRef input, bool per_sample, int num_coefficients) :
+	UnaryOpNode(input), per_sample(per_sample)
+{
+	if (num_coefficients < 1 || num_coefficients > SIGNAL_FILTER_MAX_COEFFICIENTS)
+		throw std::runtime_error("LaneFilter: invalid number of coefficients");
+
+	this->num_coefficients = num_coefficients;
+	this->num_controls = 0;
+	this->coefficient_sample_rate = 0.0;
+
+	memset(this->input_lanes, 0, sizeof(this->input_lanes));
+	memset(this->coefficient_lanes, 0, sizeof(this->coefficient_lanes));
+	memset(this->last_controls, 0, sizeof(this->last_controls));
+	memset(this->target, 0, sizeof(this->target));
+	memset(this->current, 0, sizeof(this->current));
+}
+
+void LaneFilter::add_control(std::string name, NodeRef &control)
+{
+	if (this->num_controls == SIGNAL_FILTER_MAX_CONTROLS)
+		throw std::runtime_error("LaneFilter: too many controls");
+
+	this->add_input(name, control);
+	this->controls[this->num_controls++] = &control;
+}
+
+/*------------------------------------------------------------------------
+ * Recalculate every channel's target coefficients from the controls at
+ * `frame`, if any have changed. Returns whether they have.
+ *-----------------------------------------------------------------------*/
+bool LaneFilter::update_targets(int num_channels, int frame)
+{
+	bool changed = false;
+	for (int control = 0; control < this->num_controls; control++)
+		for (int channel = 0; channel < num_channels; channel++)
+			changed |= ((*this->controls[control])->out[channel][frame] != this->last_controls[control][channel]);
+
+	if (!changed)
+		return false;
+
+	for (int control = 0; control < this->num_controls; control++)
+		for (int channel = 0; channel < num_channels; channel++)
+			this->last_controls[control][channel] = (*this->controls[control])->out[channel][frame];
+
+	const sample *values[SIGNAL_FILTER_MAX_CONTROLS];
+	for (int channel = 0; channel < num_channels; channel += SIGNAL_LANES_BLOCK_SIZE)
+	{
+		for (int control = 0; control < this->num_controls; control++)
+			values[control] = this->last_controls[control] + channel;
+		this->calculate_coefficients(values, std::min(num_channels - channel, SIGNAL_LANES_BLOCK_SIZE),
+		                             &this->target[0][channel], SIGNAL_MAX_CHANNELS, 1);
+	}
+	return true;
+}
+
+/*------------------------------------------------------------------------
+ * Calculate a channel's coefficients for each of `num_frames` frames
+ * from `offset`, unless its controls are unchanged from the last frame
+ * calculated, in which case its target coefficients are copied.
+ * Returns whether any controls have changed.
+ *-----------------------------------------------------------------------*/
+bool LaneFilter::update_frames(int channel, int offset, int num_frames, sample *coefficients,
+                               int coefficient_stride, int frame_stride)
+{
+	const sample *values[SIGNAL_FILTER_MAX_CONTROLS];
+	bool unchanged = true;
+	for (int control = 0; control < this->num_controls; control++)
+	{
+		values[control] = (*this->controls[control])->out[channel] + offset;
+		for (int frame = 0; frame < num_frames; frame++)
+			unchanged &= (values[control][frame] == this->last_controls[control][channel]);
+	}
+
+	if (unchanged)
+	{
+		for (int frame = 0; frame < num_frames; frame++)
+			for (int index = 0; index < this->num_coefficients; index++)
+				coefficients[frame * frame_stride + index * coefficient_stride] = this->target[index][channel];
+		return false;
+	}
+
+	this->calculate_coefficients(values, num_frames, coefficients, coefficient_stride, frame_stride);
+
+	int last = num_frames - 1;
+	for (int control = 0; control < this->num_controls; control++)
+		this->last_controls[control][channel] = values[control][last];
+	for (int index = 0; index < this->num_coefficients; index++)
+		this->target[index][channel] = coefficients[last * frame_stride + index * coefficient_stride];
+	return true;
+}
+
+void LaneFilter::process(sample **out, int num_frames)
+{
+	int num_channels = this->num_output_channels;
+	int num_lanes = vector_lanes(num_channels);
+	int row_size = this->num_coefficients * num_lanes;
+
+	/*------------------------------------------------------------------------
+	 * On the first block, or after a change of sample rate, start from
+	 * the new coefficients rather than ramping to them.
+	 *-----------------------------------------------------------------------*/
+	bool ramp = (this->graph->sample_rate == this->coefficient_sample_rate);
+	if (!ramp)
+	{
+		this->coefficient_sample_rate = this->graph->sample_rate;
+		std::fill_n(&this->last_controls[0][0], SIGNAL_FILTER_MAX_CONTROLS * SIGNAL_MAX_CHANNELS,
+		            std::numeric_limits<float>::max());
+	}
+
+	sample *input = this->input_lanes;
+	sample *coefficients = this->coefficient_lanes;
+	sample output[SIGNAL_LANES_BLOCK_SIZE * SIGNAL_MAX_CHANNELS];
+
+	for (int offset = 0; offset < num_frames; offset += SIGNAL_LANES_BLOCK_SIZE)
+	{
+		int run = std::min(num_frames - offset, SIGNAL_LANES_BLOCK_SIZE);
+		bool changed = false;
+
+		if (this->per_sample)
+		{
+			for (int channel = 0; channel < num_channels; channel++)
+				changed |= this->update_frames(channel, offset, run, coefficients + channel, num_lanes, row_size);
+		}
+		else
+		{
+			changed = this->update_targets(num_channels, offset + run - 1);
+
+			if (changed && ramp)
+			{
+				for (int frame = 0; frame < run; frame++)
+				{
+					sample *row = coefficients + frame * row_size;
+					sample position = (sample) (frame + 1) / run;
+					for (int index = 0; index < this->num_coefficients; index++)
+						for (int channel = 0; channel < num_channels; channel++)
+							row[index * num_lanes + channel] = this->current[index][channel] +
+								(this->target[index][channel] - this->current[index][channel]) * position;
+				}
+			}
+			else
+			{
+				for (int index = 0; index < this->num_coefficients; index++)
+					for (int channel = 0; channel < num_channels; channel++)
+						coefficients[index * num_lanes + channel] = this->target[index][channel];
+				changed = false;
+			}
+
+			memcpy(this->current, this->target, sizeof(this->current));
+		}
+
+		ramp = true;
+
+		vector_interleave_lanes(this->input->out, num_channels, num_lanes, offset, input, run);
+		this->filter(input, coefficients, changed ? row_size : 0, num_lanes, output, run);
+		vector_deinterleave_lanes(output, num_channels, num_lanes, out, offset, run);
+	}
+}
+
+ResonantFilter::ResonantFilter(NodeRef input, NodeRef cutoff, NodeRef q, NodeRef gain,
+                               signal_filter_type_t type, bool per_sample, int num_coefficients) :
+	LaneFilter(input, per_sample, num_coefficients), cutoff(cutoff), q(q), gain(gain), type(type)
+{
+	this->add_control("cutoff", this->cutoff);
+	this->add_control("q", this->q);
+	this->add_control("gain", this->gain);
+}
+
+void ResonantFilter::calculate_coefficients(const sample * const *controls, int count, sample *coefficients,
+                                            int coefficient_stride, int set_stride)
+{
+	sample frequency[SIGNAL_LANES_BLOCK_SIZE];
+	sample q[SIGNAL_LANES_BLOCK_SIZE];
+	sample inverse_sample_rate = 1.0f / this->coefficient_sample_rate;
+	for (int index = 0; index < count; index++)
+	{
+		frequency[index] = fast_clamp(controls[0][index] * inverse_sample_rate, 1e-5f, 0.49f);
+		q[index] = std::max(controls[1][index], 0.05f);
+	}
+	this->calculate_response(frequency, q, controls[2], count, coefficients, coefficient_stride, set_stride);
+}
+
+}
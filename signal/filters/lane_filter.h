@@ -0,0 +1,119 @@
+#pragma once
+
+#include "../node.h"
+#include "../constants.h"
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * Shared core of the channel-parallel filters (SVF, Biquad, MoogVCF,
+	 * EQ).
+	 *
+	 * Channels are interleaved and filtered one per vector lane, in runs
+	 * of SIGNAL_LANES_BLOCK_SIZE frames. Coefficients are calculated from
+	 * the filter's control inputs, registered with add_control(). By
+	 * default, they are calculated once per run, from the last frame of
+	 * each control, and ramped linearly across the run from their
+	 * previous values, so that modulation doesn't cause zipper noise.
+	 * With `per_sample` set, they are calculated from every frame
+	 * instead, for audio-rate modulation.
+	 *
+	 * Either way, coefficients are only recalculated for a channel when
+	 * one of its controls changes, and a run with no changes is filtered
+	 * with a single set of coefficients.
+	 *------------------------------------------------------------------------*/
+	class LaneFilter : public UnaryOpNode
+	{
+		public:
+			LaneFilter(NodeRef input, bool per_sample, int num_coefficients);
+
+			virtual void process(sample **out, int num_frames);
+
+			bool per_sample;
+
+		protected:
+			/*------------------------------------------------------------------------
+			 * Add `control` as an input named `name`, from which coefficients
+			 * are calculated. Controls are passed to calculate_coefficients()
+			 * in the order they are added.
+			 *-----------------------------------------------------------------------*/
+			void add_control(std::string name, NodeRef &control);
+
+			/*------------------------------------------------------------------------
+			 * Calculate coefficients for each of `count` (at most
+			 * SIGNAL_LANES_BLOCK_SIZE) sets of controls: successive frames of
+			 * one channel, or one frame of successive channels. controls[n]
+			 * holds the `count` values of the nth control. A set's
+			 * coefficients are written `coefficient_stride` values apart, and
+			 * each set `set_stride` after the last.
+			 *-----------------------------------------------------------------------*/
+			virtual void calculate_coefficients(const sample * const *controls, int count, sample *coefficients,
+			                                    int coefficient_stride, int set_stride) = 0;
+
+			/*------------------------------------------------------------------------
+			 * Filter interleaved lanes, as the channel-parallel kernels.
+			 *-----------------------------------------------------------------------*/
+			virtual void filter(const sample *in, const sample *coefficients, int coefficient_stride,
+			                    int num_lanes, sample *out, int num_frames) = 0;
+
+			/*------------------------------------------------------------------------
+			 * The sample rate that coefficients are being calculated for.
+			 * Until the first block, 0, and nothing is ramped.
+			 *-----------------------------------------------------------------------*/
+			sample coefficient_sample_rate;
+
+		private:
+			bool update_targets(int num_channels, int frame);
+			bool update_frames(int channel, int offset, int num_frames, sample *coefficients,
+			                   int coefficient_stride, int frame_stride);
+
+			int num_coefficients;
+			NodeRef *controls[SIGNAL_FILTER_MAX_CONTROLS];
+			int num_controls;
+
+			/*------------------------------------------------------------------------
+			 * Interleaved inputs and coefficients. Lanes beyond the last
+			 * channel are zeroed on construction, and never written.
+			 *-----------------------------------------------------------------------*/
+			sample input_lanes[SIGNAL_LANES_BLOCK_SIZE * SIGNAL_MAX_CHANNELS];
+			sample coefficient_lanes[SIGNAL_LANES_BLOCK_SIZE * SIGNAL_FILTER_MAX_COEFFICIENTS * SIGNAL_MAX_CHANNELS];
+
+			/*------------------------------------------------------------------------
+			 * The last controls seen on each channel, the coefficients
+			 * calculated from them, and the coefficients that the previous
+			 * run ended with.
+			 *-----------------------------------------------------------------------*/
+			sample last_controls[SIGNAL_FILTER_MAX_CONTROLS][SIGNAL_MAX_CHANNELS];
+			sample target[SIGNAL_FILTER_MAX_COEFFICIENTS][SIGNAL_MAX_CHANNELS];
+			sample current[SIGNAL_FILTER_MAX_COEFFICIENTS][SIGNAL_MAX_CHANNELS];
+	};
+
+	/**------------------------------------------------------------------------
+	 * A LaneFilter with a `cutoff` in Hz, a resonance `q` and a `gain` in
+	 * dB, for filters with one response of each signal_filter_type_t.
+	 *------------------------------------------------------------------------*/
+	class ResonantFilter : public LaneFilter
+	{
+		public:
+			ResonantFilter(NodeRef input, NodeRef cutoff, NodeRef q, NodeRef gain,
+			               signal_filter_type_t type, bool per_sample, int num_coefficients);
+
+			NodeRef cutoff;
+			NodeRef q;
+			NodeRef gain;
+			signal_filter_type_t type;
+
+		protected:
+			virtual void calculate_coefficients(const sample * const *controls, int count, sample *coefficients,
+			                                    int coefficient_stride, int set_stride);
+
+			/*------------------------------------------------------------------------
+			 * As calculate_coefficients(), given each set's `frequency` as the
+			 * cutoff in cycles per sample, within (0, 0.49]; `q`, at least
+			 * 0.05; and `gain`.
+			 *-----------------------------------------------------------------------*/
+			virtual void calculate_response(const sample *frequency, const sample *q, const sample *gain,
+			                                int count, sample *coefficients,
+			                                int coefficient_stride, int set_stride) = 0;
+	};
+}
@@ -1,59 +1,48 @@
-#include "moog.h" 
+#include "moog.h"
 
-#include "../oscillators/constant.h"
-#include "../graph.h"
+#include "../kernels/kernels.h"
 
 #include <stdlib.h>
 
 namespace libsignal
 {
 
-void MoogVCF::process(sample **out, int num_frames)
+MoogVCF::MoogVCF(NodeRef input, NodeRef cutoff, NodeRef resonance, bool per_sample) :
+	LaneFilter(input, per_sample, 2), cutoff(cutoff), resonance(resonance)
 {
-	for (int channel = 0; channel < num_output_channels; channel++)
+	this->name = "moog";
+
+	this->add_control("cutoff", this->cutoff);
+	this->add_control("resonance", this->resonance);
+
+	memset(this->state, 0, sizeof(this->state));
+}
+
+/*------------------------------------------------------------------------
+ * Cutoff is mapped from [0, nyquist] to [0.005, 1], then scaled by
+ * 1.16 to give f. The feedback is the resonance, tempered as f rises.
+ * Coefficients are f and the feedback.
+ *-----------------------------------------------------------------------*/
+void MoogVCF::calculate_coefficients(const sample * const *controls, int count, sample *coefficients,
+                                     int coefficient_stride, int set_stride)
+{
+	const sample *cutoff = controls[0];
+	const sample *resonance = controls[1];
+	float f_scale = 1.16f * 0.995f * 2.0f / this->coefficient_sample_rate;
+	float f_offset = 1.16f * 0.005f;
+
+	for (int index = 0; index < count; index++)
 	{
-		for (int frame = 0; frame < num_frames; frame++)
-		{
-			float cutoff = map(this->cutoff->out[channel][frame], 0, this->graph->sample_rate / 2, 0.005, 1);
-			float resonance = this->resonance->out[channel][frame];
-			float f = cutoff * 1.16; 
-			float fb = resonance * (1.0 - 0.15 * f * f);
-
-			/*------------------------------------------------------------------------
-			 * Calculate filter
-			 *-----------------------------------------------------------------------*/
-			float input = this->input->out[channel][frame];
-
-			input -= out4[channel] * fb;
-			input *= 0.35013 * f*f*f*f;
-
-			/*------------------------------------------------------------------------
-			 * Pole 1
-			 *-----------------------------------------------------------------------*/
-			out1[channel] = input + 0.3 * in1[channel] + (1 - f) * out1[channel];
-			in1[channel]  = input;
-
-			/*------------------------------------------------------------------------
-			 * Pole 2
-			 *-----------------------------------------------------------------------*/
-			out2[channel] = out1[channel] + 0.3 * in2[channel] + (1 - f) * out2[channel];
-			in2[channel]  = out1[channel];
-
-			/*------------------------------------------------------------------------
-			 * Pole 3
-			 *-----------------------------------------------------------------------*/
-			out3[channel] = out2[channel] + 0.3 * in3[channel] + (1 - f) * out3[channel];
-			in3[channel]  = out2[channel];
-
-			/*------------------------------------------------------------------------
-			 * Pole 4
-			 *-----------------------------------------------------------------------*/
-			out4[channel] = out3[channel] + 0.3 * in4[channel] + (1 - f) * out4[channel];
-			in4[channel]  = out3[channel];
-
-			this->out[channel][frame] = out4[channel];
-		}
+		float f = f_offset + cutoff[index] * f_scale;
+		coefficients[index * set_stride] = f;
+		coefficients[index * set_stride + coefficient_stride] = resonance[index] * (1.0f - 0.15f * f * f);
 	}
 }
 
+void MoogVCF::filter(const sample *in, const sample *coefficients, int coefficient_stride,
+                     int num_lanes, sample *out, int num_frames)
+{
+	vector_moog(in, coefficients, coefficient_stride, &this->state[0][0], num_lanes, out, num_frames);
+}
+
 }
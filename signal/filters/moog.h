@@ -1,44 +1,36 @@
 #pragma once
 
-#include "../node.h"
-#include "../constants.h"
+#include "lane_filter.h"
 
 namespace libsignal
 {
-	class MoogVCF : public UnaryOpNode
+	/**------------------------------------------------------------------------
+	 * Four-pole (24dB/octave) resonant low-pass filter, after the Moog
+	 * ladder. `cutoff` is in Hz and `resonance` is the feedback, which
+	 * self-oscillates at around 4.
+	 *
+	 * By default, coefficients are calculated from every frame; see
+	 * LaneFilter.
+	 *------------------------------------------------------------------------*/
+	class MoogVCF : public LaneFilter
 	{
 		public:
-			MoogVCF(NodeRef input = 0.0, NodeRef cutoff = 200.0, NodeRef resonance = 0.0) :
-				UnaryOpNode(input), cutoff(cutoff), resonance(resonance)
-			{
-				this->name = "moog";
-				this->add_input("cutoff", this->cutoff);
-				this->add_input("resonance", this->resonance);
-
-				int int_buf_size = SIGNAL_MAX_CHANNELS * sizeof(int);
-				memset(out1, 0, int_buf_size);
-				memset(out2, 0, int_buf_size);
-				memset(out3, 0, int_buf_size);
-				memset(out4, 0, int_buf_size);
-				memset(in1, 0, int_buf_size);
-				memset(in2, 0, int_buf_size);
-				memset(in3, 0, int_buf_size);
-				memset(in4, 0, int_buf_size);
-			}
+			MoogVCF(NodeRef input = 0.0, NodeRef cutoff = 200.0, NodeRef resonance = 0.0, bool per_sample = true);
 
 			NodeRef cutoff;
 			NodeRef resonance;
 
-			float out1[SIGNAL_MAX_CHANNELS],
-				  out2[SIGNAL_MAX_CHANNELS],
-				  out3[SIGNAL_MAX_CHANNELS],
-				  out4[SIGNAL_MAX_CHANNELS];
-			float in1[SIGNAL_MAX_CHANNELS],
-				  in2[SIGNAL_MAX_CHANNELS],
-				  in3[SIGNAL_MAX_CHANNELS],
-				  in4[SIGNAL_MAX_CHANNELS];
+			/*------------------------------------------------------------------------
+			 * Filter state, one row per variable (out1-4, in1-4), one column
+			 * per channel, so that channels can be processed in parallel.
+			 *-----------------------------------------------------------------------*/
+			sample state[8][SIGNAL_MAX_CHANNELS];
 
-			virtual void process(sample **out, int num_frames);
+		protected:
+			virtual void calculate_coefficients(const sample * const *controls, int count, sample *coefficients,
+			                                    int coefficient_stride, int set_stride);
+			virtual void filter(const sample *in, const sample *coefficients, int coefficient_stride,
+			                    int num_lanes, sample *out, int num_frames);
 	};
 
 	REGISTER(MoogVCF, "moog");
@@ -0,0 +1,159 @@
+#include "multi_tap_delay.h"
+
+#include "../oscillators/constant.h"
+#include "../graph.h"
+#include "../kernels/kernels.h"
+#include "../util.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string>
+
+namespace libsignal
+{
+
+MultiTapDelay::MultiTapDelay(NodeRef input, std::vector<NodeRef> times, std::vector<NodeRef> gains,
+                             float maxdelaytime, signal_interpolate_t interpolate) :
+	UnaryOpNode(input), maxdelaytime(maxdelaytime), interpolate(interpolate)
+{
+	if (times.size() > SIGNAL_DELAY_MAX_TAPS)
+		throw std::runtime_error("MultiTapDelay: too many taps");
+	if (interpolate == SIGNAL_INTERPOLATE_ALLPASS)
+		throw std::runtime_error("MultiTapDelay: allpass interpolation is not supported");
+
+	this->name = "multi_tap_delay";
+	this->num_taps = times.size();
+	this->max_delay = (int) ceilf(maxdelaytime * this->graph->sample_rate);
+	this->can_process_in_place = true;
+
+	for (int tap = 0; tap < this->num_taps; tap++)
+	{
+		this->times[tap] = times[tap];
+		this->gains[tap] = (tap < (int) gains.size()) ? gains[tap] : NodeRef(1.0);
+		this->add_input("time" + std::to_string(tap), this->times[tap]);
+		this->add_input("gain" + std::to_string(tap), this->gains[tap]);
+	}
+
+	this->update_channels();
+}
+
+void MultiTapDelay::update_channels()
+{
+	UnaryOpNode::update_channels();
+
+	/*------------------------------------------------------------------------
+	 * As Delay, allocating lines for the channels in use only, and not
+	 * on the audio thread.
+	 *-----------------------------------------------------------------------*/
+	for (int channel = 0; channel < SIGNAL_MAX_CHANNELS; channel++)
+	{
+		if (channel < this->num_output_channels && !this->lines[channel])
+		{
+			if (!this->graph || !this->graph->is_audio_thread())
+				this->lines[channel] = std::make_shared<DelayLine>(this->max_delay);
+		}
+		else if (channel >= this->num_output_channels && this->lines[channel])
+		{
+			if (this->graph)
+				this->graph->retire(this->lines[channel]);
+			this->lines[channel].reset();
+		}
+	}
+}
+
+void MultiTapDelay::set_input(std::string name, const NodeRef &node)
+{
+	if (!this->is_deferring())
+	{
+		UnaryOpNode::set_input(name, node);
+		return;
+	}
+
+	/*------------------------------------------------------------------------
+	 * As Delay, allocating lines for our new number of channels here,
+	 * to be handed over after the edit is made.
+	 *-----------------------------------------------------------------------*/
+	AudioGraphTransactionScope transaction(this->graph);
+	int num_channels = 1;
+	for (auto param : this->params)
+	{
+		NodeRef input = (param.first == name) ? node : this->graph->get_staged_input(this, param.first);
+		if (input)
+			num_channels = std::max(num_channels, input->num_output_channels);
+	}
+
+	std::vector<std::shared_ptr<DelayLine>> lines(num_channels);
+	for (int channel = 0; channel < num_channels; channel++)
+		if (!this->lines[channel])
+			lines[channel] = std::make_shared<DelayLine>(this->max_delay);
+
+	UnaryOpNode::set_input(name, node);
+
+	this->defer_edit([this, lines]
+	{
+		for (int channel = 0; channel < (int) lines.size() && channel < this->num_output_channels; channel++)
+			if (!this->lines[channel])
+				this->lines[channel] = lines[channel];
+	});
+	transaction.commit();
+}
+
+void MultiTapDelay::process(sample **out, int num_frames)
+{
+	sample sample_rate = this->graph->sample_rate;
+	sample delays[SIGNAL_DELAY_RUN_LENGTH];
+	sample taps[SIGNAL_DELAY_RUN_LENGTH];
+
+	for (int channel = 0; channel < this->num_output_channels; channel++)
+	{
+		DelayLine *line = this->lines[channel].get();
+		if (!line)
+		{
+			vector_fill(out[channel], 0.0, num_frames);
+			continue;
+		}
+
+		/*------------------------------------------------------------------------
+		 * Each run is written before it is read, so a tap can read the
+		 * current input. Delays are then offset by the run length. Cubic
+		 * interpolation needs one newer frame than it outputs.
+		 *-----------------------------------------------------------------------*/
+		sample min_delay = DelayLine::min_delay(this->interpolate) - 1;
+		sample max_delay = line->max_delay;
+
+		for (int offset = 0; offset < num_frames; offset += SIGNAL_DELAY_RUN_LENGTH)
+		{
+			int run = std::min(num_frames - offset, SIGNAL_DELAY_RUN_LENGTH);
+			sample *output = out[channel] + offset;
+
+			line->write(this->input->out[channel] + offset, run);
+			vector_fill(output, 0.0, run);
+
+			for (int tap = 0; tap < this->num_taps; tap++)
+			{
+				const sample *time = this->times[tap]->out[channel];
+				const sample *gain = this->gains[tap]->out[channel];
+
+				if (this->times[tap]->is_constant)
+				{
+					sample delay = clip(time[0] * sample_rate, min_delay, max_delay);
+					line->read(delay + run, this->interpolate, taps, run);
+				}
+				else
+				{
+					vector_multiply_scalar(time + offset, sample_rate, delays, run);
+					vector_clip(delays, min_delay, max_delay, delays, run);
+					vector_add_scalar(delays, run, delays, run);
+					line->read(delays, this->interpolate, taps, run);
+				}
+
+				if (this->gains[tap]->is_constant)
+					vector_mac_scalar(taps, gain[0], output, run);
+				else
+					vector_mac(taps, gain + offset, output, run);
+			}
+		}
+	}
+}
+
+}
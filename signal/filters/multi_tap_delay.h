@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../node.h"
+#include "../constants.h"
+#include "delay_line.h"
+
+#include <memory>
+#include <vector>
+
+/*------------------------------------------------------------------------
+ * Max supported number of taps in a MultiTapDelay.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_DELAY_MAX_TAPS 16
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * Several reads from one delay line, without feedback.
+	 *
+	 * The output is the sum of the input at each of `times` seconds ago,
+	 * up to `maxdelaytime`, scaled by the corresponding `gains` (1.0
+	 * where no gain is given). Times may be modulated, and are
+	 * interpolated with `interpolate`, which may not be allpass, as each
+	 * line has a single allpass state.
+	 *------------------------------------------------------------------------*/
+	class MultiTapDelay : public UnaryOpNode
+	{
+		public:
+			MultiTapDelay(NodeRef input = 0.0, std::vector<NodeRef> times = {}, std::vector<NodeRef> gains = {},
+			              float maxdelaytime = 10.0, signal_interpolate_t interpolate = SIGNAL_INTERPOLATE_LINEAR);
+
+			NodeRef times[SIGNAL_DELAY_MAX_TAPS];
+			NodeRef gains[SIGNAL_DELAY_MAX_TAPS];
+			int num_taps;
+			float maxdelaytime;
+			signal_interpolate_t interpolate;
+
+			virtual void process(sample **out, int num_frames);
+			virtual void update_channels();
+			virtual void set_input(std::string name, const NodeRef &node);
+
+		private:
+			int max_delay;
+			std::shared_ptr<DelayLine> lines[SIGNAL_MAX_CHANNELS];
+	};
+
+	REGISTER(MultiTapDelay, "multi_tap_delay");
+}
@@ -0,0 +1,93 @@
+#include "svf.h"
+
+#include "../fastmath.h"
+#include "../kernels/kernels.h"
+
+#include <math.h>
+
+namespace libsignal
+{
+
+SVF::SVF(NodeRef input, NodeRef cutoff, NodeRef q, NodeRef gain, signal_filter_type_t type, bool per_sample) :
+	ResonantFilter(input, cutoff, q, gain, type, per_sample, 6)
+{
+	this->name = "svf";
+
+	memset(this->state, 0, sizeof(this->state));
+}
+
+/*------------------------------------------------------------------------
+ * Each response as weights on the terms of its coefficients, so that
+ * every type shares one branch-free, vectorisable loop. With
+ * A = 10^(gain / 40) and r = sqrt(A):
+ *
+ *   g  = tan(pi * frequency) * (g_1 + g_r * r + g_inverse_r / r)
+ *   k  = (k_1 + k_inverse_a / A) / q
+ *   m0 = m0_1 + m0_a2 * A^2
+ *   m1 = k * (m1_1 + m1_a * A + m1_a2 * A^2)
+ *   m2 = m2_1 + m2_a2 * A^2
+ *
+ * g is the prewarped integrator gain and k the damping; the output
+ * mixes the input (m0), band-pass (m1) and low-pass (m2) responses.
+ *-----------------------------------------------------------------------*/
+typedef struct
+{
+	sample g_1, g_r, g_inverse_r;
+	sample k_1, k_inverse_a;
+	sample m0_1, m0_a2;
+	sample m1_1, m1_a, m1_a2;
+	sample m2_1, m2_a2;
+} svf_response_t;
+
+static const svf_response_t svf_responses[] =
+{
+	{ 1, 0, 0,  1, 0,  0, 0,   0, 0,  0,   1,  0 },	/* low pass */
+	{ 1, 0, 0,  1, 0,  1, 0,  -1, 0,  0,  -1,  0 },	/* high pass */
+	{ 1, 0, 0,  1, 0,  0, 0,   1, 0,  0,   0,  0 },	/* band pass */
+	{ 1, 0, 0,  1, 0,  1, 0,  -1, 0,  0,   0,  0 },	/* notch */
+	{ 1, 0, 0,  0, 1,  1, 0,  -1, 0,  1,   0,  0 },	/* peak */
+	{ 0, 0, 1,  1, 0,  1, 0,  -1, 1,  0,  -1,  1 },	/* low shelf */
+	{ 0, 1, 0,  1, 0,  0, 1,   0, 1, -1,   1, -1 }	/* high shelf */
+};
+
+void SVF::calculate_response(const sample *frequency, const sample *q, const sample *gain,
+                             int count, sample *coefficients, int coefficient_stride, int set_stride)
+{
+	const svf_response_t response = svf_responses[this->type];
+
+	/*------------------------------------------------------------------------
+	 * Coefficients are calculated into a local buffer, then copied out,
+	 * so that the calculation can be vectorised without alias checks.
+	 *-----------------------------------------------------------------------*/
+	sample values[6][SIGNAL_LANES_BLOCK_SIZE];
+	for (int index = 0; index < count; index++)
+	{
+		sample angle = (sample) M_PI * frequency[index];
+		sample r = fast_exp2(gain[index] * 0.0415241012f);
+		sample a = r * r;
+		sample a2 = a * a;
+
+		sample g = fast_sin(angle) / fast_cos(angle) * (response.g_1 + response.g_r * r + response.g_inverse_r / r);
+		sample k = (response.k_1 + response.k_inverse_a / a) / q[index];
+		sample a1 = 1.0f / (1.0f + g * (g + k));
+
+		values[0][index] = a1;
+		values[1][index] = g * a1;
+		values[2][index] = g * g * a1;
+		values[3][index] = response.m0_1 + response.m0_a2 * a2;
+		values[4][index] = k * (response.m1_1 + response.m1_a * a + response.m1_a2 * a2);
+		values[5][index] = response.m2_1 + response.m2_a2 * a2;
+	}
+
+	for (int index = 0; index < count; index++)
+		for (int coefficient = 0; coefficient < 6; coefficient++)
+			coefficients[index * set_stride + coefficient * coefficient_stride] = values[coefficient][index];
+}
+
+void SVF::filter(const sample *in, const sample *coefficients, int coefficient_stride,
+                 int num_lanes, sample *out, int num_frames)
+{
+	vector_svf(in, coefficients, coefficient_stride, &this->state[0][0], num_lanes, out, num_frames);
+}
+
+}
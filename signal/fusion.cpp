@@ -0,0 +1,306 @@
+#include "fusion.h"
+
+#include "operators/add.h"
+#include "operators/subtract.h"
+#include "operators/multiply.h"
+#include "operators/divide.h"
+#include "operators/scale.h"
+#include "kernels/kernels.h"
+#include "fastmath.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace libsignal
+{
+
+FusedExpression::FusedExpression(Node *root, std::function<bool(Node *)> can_inline)
+{
+	this->root = root;
+	this->add_instruction(root, -1, can_inline);
+
+	/*------------------------------------------------------------------------
+	 * The root is added first, but must be evaluated last. Reverse the
+	 * list so that operands precede their users, and renumber accordingly.
+	 *-----------------------------------------------------------------------*/
+	int num_instructions = this->instructions.size();
+	std::reverse(this->instructions.begin(), this->instructions.end());
+	for (FusedInstruction &instruction : this->instructions)
+	{
+		if (instruction.parent >= 0)
+			instruction.parent = num_instructions - 1 - instruction.parent;
+		for (int index = 0; index < instruction.num_operands; index++)
+		{
+			if (instruction.operands[index].instruction >= 0)
+				instruction.operands[index].instruction = num_instructions - 1 - instruction.operands[index].instruction;
+		}
+	}
+
+	this->channels.resize(num_instructions);
+	this->registers.resize(num_instructions * SIGNAL_FUSION_CHUNK_SIZE);
+}
+
+/*------------------------------------------------------------------------
+ * Apply a binary operator over n frames, treating constant operands as
+ * scalars (as the operator nodes themselves do).
+ *-----------------------------------------------------------------------*/
+static void process_binary(signal_fused_op_t op, sample **in, bool *scalar, sample *out, int n)
+{
+	if (scalar[0] && scalar[1])
+	{
+		sample value;
+		switch (op)
+		{
+			case SIGNAL_FUSED_ADD: value = in[0][0] + in[1][0]; break;
+			case SIGNAL_FUSED_SUBTRACT: value = in[0][0] - in[1][0]; break;
+			case SIGNAL_FUSED_MULTIPLY: value = in[0][0] * in[1][0]; break;
+			default: value = in[0][0] / in[1][0]; break;
+		}
+		vector_fill(out, value, n);
+	}
+	else if (scalar[1])
+	{
+		switch (op)
+		{
+			case SIGNAL_FUSED_ADD: vector_add_scalar(in[0], in[1][0], out, n); break;
+			case SIGNAL_FUSED_SUBTRACT: vector_add_scalar(in[0], -in[1][0], out, n); break;
+			case SIGNAL_FUSED_MULTIPLY: vector_multiply_scalar(in[0], in[1][0], out, n); break;
+			default: vector_divide_scalar(in[0], in[1][0], out, n); break;
+		}
+	}
+	else if (scalar[0])
+	{
+		switch (op)
+		{
+			case SIGNAL_FUSED_ADD: vector_add_scalar(in[1], in[0][0], out, n); break;
+			case SIGNAL_FUSED_SUBTRACT: vector_scale_offset(in[1], -1.0, in[0][0], out, n); break;
+			case SIGNAL_FUSED_MULTIPLY: vector_multiply_scalar(in[1], in[0][0], out, n); break;
+			default:
+				for (int frame = 0; frame < n; frame++)
+					out[frame] = in[0][0] / in[1][frame];
+				break;
+		}
+	}
+	else
+	{
+		switch (op)
+		{
+			case SIGNAL_FUSED_ADD: vector_add(in[0], in[1], out, n); break;
+			case SIGNAL_FUSED_SUBTRACT: vector_subtract(in[0], in[1], out, n); break;
+			case SIGNAL_FUSED_MULTIPLY: vector_multiply(in[0], in[1], out, n); break;
+			default: vector_divide(in[0], in[1], out, n); break;
+		}
+	}
+}
+
+bool FusedExpression::can_fuse(Node *node)
+{
+	return dynamic_cast<Add *>(node) || dynamic_cast<Subtract *>(node) ||
+	       dynamic_cast<Multiply *>(node) || dynamic_cast<Divide *>(node) ||
+	       dynamic_cast<Scale *>(node) || dynamic_cast<LinExp *>(node);
+}
+
+int FusedExpression::add_instruction(Node *node, int parent, std::function<bool(Node *)> &can_inline)
+{
+	int index = this->instructions.size();
+	this->instructions.push_back(FusedInstruction());
+
+	FusedInstruction instruction;
+	instruction.node = node;
+	instruction.parent = parent;
+
+	std::vector<Node *> operands;
+	if (BinaryOpNode *binary = dynamic_cast<BinaryOpNode *>(node))
+	{
+		if (dynamic_cast<Add *>(node))
+			instruction.op = SIGNAL_FUSED_ADD;
+		else if (dynamic_cast<Subtract *>(node))
+			instruction.op = SIGNAL_FUSED_SUBTRACT;
+		else if (dynamic_cast<Multiply *>(node))
+			instruction.op = SIGNAL_FUSED_MULTIPLY;
+		else
+			instruction.op = SIGNAL_FUSED_DIVIDE;
+		operands = { binary->input0.get(), binary->input1.get() };
+	}
+	else if (Scale *scale = dynamic_cast<Scale *>(node))
+	{
+		instruction.op = SIGNAL_FUSED_SCALE;
+		operands = { scale->input.get(), scale->a.get(), scale->b.get(), scale->c.get(), scale->d.get() };
+	}
+	else
+	{
+		LinExp *linexp = dynamic_cast<LinExp *>(node);
+		instruction.op = SIGNAL_FUSED_LINEXP;
+		operands = { linexp->input.get(), linexp->a.get(), linexp->b.get(), linexp->c.get(), linexp->d.get() };
+	}
+
+	instruction.num_operands = operands.size();
+	for (int operand_index = 0; operand_index < (int) operands.size(); operand_index++)
+	{
+		Node *operand = operands[operand_index];
+		instruction.operands[operand_index].node = operand;
+		instruction.operands[operand_index].instruction = -1;
+
+		if (can_inline(operand))
+		{
+			this->inlined_nodes.push_back(operand);
+			instruction.operands[operand_index].instruction = this->add_instruction(operand, index, can_inline);
+		}
+		else if (std::find(this->inputs.begin(), this->inputs.end(), operand) == this->inputs.end())
+		{
+			this->inputs.push_back(operand);
+		}
+	}
+
+	this->instructions[index] = instruction;
+	return index;
+}
+
+void FusedExpression::process(int num_frames)
+{
+	int num_instructions = this->instructions.size();
+
+	/*------------------------------------------------------------------------
+	 * If every input is constant, so is the result: evaluate a single
+	 * frame and repeat it.
+	 *-----------------------------------------------------------------------*/
+	bool constant = true;
+	for (Node *input : this->inputs)
+		constant = constant && input->is_constant;
+	int length = constant ? 1 : num_frames;
+
+	for (int channel = 0; channel < this->root->num_output_channels; channel++)
+	{
+		/*------------------------------------------------------------------------
+		 * Each operator reads its inputs at the channel it is producing.
+		 * An inlined operator with fewer channels than its user is read
+		 * as if up-mixed, by repeating its channels.
+		 *-----------------------------------------------------------------------*/
+		for (int index = num_instructions - 1; index >= 0; index--)
+		{
+			FusedInstruction &instruction = this->instructions[index];
+			if (instruction.parent < 0)
+				this->channels[index] = channel;
+			else
+				this->channels[index] = this->channels[instruction.parent] % std::max(instruction.node->num_output_channels, 1);
+		}
+
+		for (int offset = 0; offset < length; offset += SIGNAL_FUSION_CHUNK_SIZE)
+		{
+			int n = std::min(SIGNAL_FUSION_CHUNK_SIZE, length - offset);
+
+			for (int index = 0; index < num_instructions; index++)
+			{
+				FusedInstruction &instruction = this->instructions[index];
+				sample *out = (index == num_instructions - 1) ?
+				              this->root->out[channel] + offset :
+				              &this->registers[index * SIGNAL_FUSION_CHUNK_SIZE];
+
+				sample *in[SIGNAL_FUSION_MAX_OPERANDS];
+				bool scalar[SIGNAL_FUSION_MAX_OPERANDS];
+				for (int operand_index = 0; operand_index < instruction.num_operands; operand_index++)
+				{
+					FusedOperand &operand = instruction.operands[operand_index];
+					if (operand.instruction >= 0)
+					{
+						in[operand_index] = &this->registers[operand.instruction * SIGNAL_FUSION_CHUNK_SIZE];
+						scalar[operand_index] = false;
+					}
+					else if (operand.node->is_constant)
+					{
+						in[operand_index] = operand.node->out[this->channels[index]];
+						scalar[operand_index] = true;
+					}
+					else
+					{
+						in[operand_index] = operand.node->out[this->channels[index]] + offset;
+						scalar[operand_index] = false;
+					}
+				}
+
+				switch (instruction.op)
+				{
+					case SIGNAL_FUSED_ADD:
+					case SIGNAL_FUSED_SUBTRACT:
+					case SIGNAL_FUSED_MULTIPLY:
+					case SIGNAL_FUSED_DIVIDE:
+						process_binary(instruction.op, in, scalar, out, n);
+						break;
+
+					case SIGNAL_FUSED_SCALE:
+					case SIGNAL_FUSED_LINEXP:
+					{
+						int stride = scalar[0] ? 0 : 1;
+						bool constant_range = scalar[1] && scalar[2] && scalar[3] && scalar[4];
+
+						if (constant_range && instruction.op == SIGNAL_FUSED_SCALE)
+						{
+							float a = in[1][0];
+							float range = in[2][0] - a;
+							float c = in[3][0];
+							float scale = in[4][0] - c;
+							for (int frame = 0; frame < n; frame++)
+							{
+								float norm = (in[0][frame * stride] - a) / range;
+								out[frame] = c + scale * norm;
+							}
+						}
+						else if (constant_range)
+						{
+							float a = in[1][0];
+							float range = in[2][0] - a;
+							float c = in[3][0];
+							float log_ratio = fast_log2(in[4][0] / c);
+							for (int frame = 0; frame < n; frame++)
+							{
+								float norm = (in[0][frame * stride] - a) / range;
+								out[frame] = fast_exp2(norm * log_ratio) * c;
+							}
+						}
+						else
+						{
+							int strides[SIGNAL_FUSION_MAX_OPERANDS];
+							for (int operand_index = 0; operand_index < SIGNAL_FUSION_MAX_OPERANDS; operand_index++)
+								strides[operand_index] = scalar[operand_index] ? 0 : 1;
+
+							/*------------------------------------------------------------------------
+							 * One loop per op, so that neither has a branch and both can be
+							 * vectorised.
+							 *-----------------------------------------------------------------------*/
+							const sample *x = in[0], *a = in[1], *b = in[2], *c = in[3], *d = in[4];
+							if (instruction.op == SIGNAL_FUSED_SCALE)
+							{
+								for (int frame = 0; frame < n; frame++)
+								{
+									float norm = (x[frame * strides[0]] - a[frame * strides[1]]) /
+									             (b[frame * strides[2]] - a[frame * strides[1]]);
+									out[frame] = c[frame * strides[3]] + (d[frame * strides[4]] - c[frame * strides[3]]) * norm;
+								}
+							}
+							else
+							{
+								for (int frame = 0; frame < n; frame++)
+								{
+									float norm = (x[frame * strides[0]] - a[frame * strides[1]]) /
+									             (b[frame * strides[2]] - a[frame * strides[1]]);
+									out[frame] = fast_pow(d[frame * strides[4]] / c[frame * strides[3]], norm) * c[frame * strides[3]];
+								}
+							}
+						}
+						break;
+					}
+				}
+			}
+		}
+
+		if (constant)
+		{
+			for (int frame = 1; frame < num_frames; frame++)
+				this->root->out[channel][frame] = this->root->out[channel][0];
+		}
+	}
+
+	this->root->is_constant = constant;
+}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+/**-------------------------------------------------------------------------
+ * @file fusion.h
+ * @brief FusedExpression evaluates a tree of elementwise operator nodes
+ *        in a single pass, without intermediate output buffers.
+ *-----------------------------------------------------------------------*/
+
+#include "node.h"
+
+#include <functional>
+#include <vector>
+
+/*------------------------------------------------------------------------
+ * Number of frames evaluated per pass through a fused expression.
+ * Intermediate values are held in registers of this many frames, which
+ * remain in cache throughout.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_FUSION_CHUNK_SIZE 64
+
+/*------------------------------------------------------------------------
+ * Maximum number of operands taken by a fused operator (Scale: input,
+ * a, b, c, d).
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_FUSION_MAX_OPERANDS 5
+
+namespace libsignal
+{
+	typedef enum
+	{
+		SIGNAL_FUSED_ADD,
+		SIGNAL_FUSED_SUBTRACT,
+		SIGNAL_FUSED_MULTIPLY,
+		SIGNAL_FUSED_DIVIDE,
+		SIGNAL_FUSED_SCALE,
+		SIGNAL_FUSED_LINEXP
+	} signal_fused_op_t;
+
+	/*------------------------------------------------------------------------
+	 * An operand is either the result of an earlier instruction, or
+	 * (when instruction is -1) the output buffer of an input node.
+	 *-----------------------------------------------------------------------*/
+	class FusedOperand
+	{
+		public:
+			Node *node;
+			int instruction;
+	};
+
+	class FusedInstruction
+	{
+		public:
+			signal_fused_op_t op;
+			Node *node;
+			int parent;
+			int num_operands;
+			FusedOperand operands[SIGNAL_FUSION_MAX_OPERANDS];
+	};
+
+	class FusedExpression
+	{
+		public:
+			/**------------------------------------------------------------------------
+			 * Build an expression that computes the output of `root`. Operands
+			 * for which `can_inline` returns true are evaluated as part of the
+			 * expression; all others are read from their output buffers.
+			 *------------------------------------------------------------------------*/
+			FusedExpression(Node *root, std::function<bool(Node *)> can_inline);
+
+			/**------------------------------------------------------------------------
+			 * Returns true if `node` is an elementwise operator that can be
+			 * evaluated within a fused expression.
+			 *------------------------------------------------------------------------*/
+			static bool can_fuse(Node *node);
+
+			/**------------------------------------------------------------------------
+			 * Write num_frames frames of the root node's output.
+			 *------------------------------------------------------------------------*/
+			void process(int num_frames);
+
+			Node *root;
+
+			/*------------------------------------------------------------------------
+			 * Nodes evaluated within the expression (excluding the root), which
+			 * need no schedule step of their own; and the nodes whose output
+			 * buffers the expression reads.
+			 *-----------------------------------------------------------------------*/
+			std::vector<Node *> inlined_nodes;
+			std::vector<Node *> inputs;
+
+		private:
+			int add_instruction(Node *node, int parent, std::function<bool(Node *)> &can_inline);
+
+			/*------------------------------------------------------------------------
+			 * Instructions are in evaluation order: operands always precede the
+			 * instructions that use them, and the root is last.
+			 *-----------------------------------------------------------------------*/
+			std::vector<FusedInstruction> instructions;
+			std::vector<int> channels;
+			std::vector<sample> registers;
+	};
+}
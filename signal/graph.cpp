@@ -7,11 +7,21 @@
 #include "io/output/soundio.h"
 #include "io/output/ios.h"
 
+#include "executor.h"
+#include "collector.h"
+#include "fusion.h"
+
 #include <unistd.h>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
 
 namespace libsignal
 {
-	AudioGraph::AudioGraph()
+	AudioGraph::AudioGraph() :
+		transactions(SIGNAL_MAX_PENDING_TRANSACTIONS),
+		completed_transactions(SIGNAL_MAX_PENDING_TRANSACTIONS)
 	{
 		signal_init();
         
@@ -19,11 +29,37 @@ namespace libsignal
 		this->output = audioout;
 		this->sample_rate = audioout->sample_rate;
 		this->node_count = 0;
+
+		this->schedule = NULL;
+		this->schedule_valid = false;
+		this->schedule_edited = false;
+		this->schedule_stale = false;
+
+		this->max_block_size = SIGNAL_DEFAULT_MAX_BLOCK_SIZE;
+		this->max_channels = SIGNAL_MAX_CHANNELS;
+		this->allocated_bytes = 0;
+
+		this->executor = NULL;
+
+		this->pending_transaction = NULL;
+		this->transaction_depth = 0;
+
+		this->running = false;
+		this->collector = NULL;
 	}
 
 	void AudioGraph::start()
 	{
 		AudioOut *audioout = (AudioOut *) this->output.get();
+		if (!this->collector)
+			this->collector = new GarbageCollector();
+
+		/*------------------------------------------------------------------------
+		 * Build the first schedule before the audio thread starts. From then
+		 * on, schedules are built by commit_transaction().
+		 *-----------------------------------------------------------------------*/
+		this->compile(this->output);
+		this->running = true;
 		audioout->start();
 	}
 
@@ -35,75 +71,838 @@ namespace libsignal
 		}
 	}
 
-	void AudioGraph::pull_input(const NodeRef &node, int num_frames)
+	void AudioGraphStep::process(int num_frames)
 	{
+		Node *node = this->node.get();
+		if (this->fused)
+			this->fused->process(num_frames);
+		else
+			node->process(node->out, num_frames);
+
 		/*------------------------------------------------------------------------
-		 * If this node has already been processed this timestep, return.
+		 * If we generate 2 channels but have 6 channels demanded, repeat
+		 * them: [ 0, 1, 0, 1, 0, 1 ]
 		 *-----------------------------------------------------------------------*/
-		if (this->processed_nodes.find(node.get()) != processed_nodes.end())
+		int upmix_channels = std::min(this->upmix_channels, node->output_buffer_channels);
+		for (int out_channel_index = node->num_output_channels;
+		         out_channel_index < upmix_channels && node->num_output_channels > 0;
+		         out_channel_index ++)
 		{
-			signal_debug("Already processed node %s, skipping", node->name.c_str());
+			int in_channel_index = out_channel_index % node->num_output_channels;
+			memcpy(node->out[out_channel_index],
+			       node->out[in_channel_index],
+			       num_frames * sizeof(sample));
+		}
+	}
+
+	/**------------------------------------------------------------------------
+	 * The topology that a schedule is built for: the graph as it stands,
+	 * with the edits staged by a transaction made.
+	 *
+	 * The number of channels of a node with staged edits isn't known
+	 * until its update_channels() is called on the audio thread, so is
+	 * taken as the most it could be: the total of its inputs' channels,
+	 * unless the edit gives it.
+	 *------------------------------------------------------------------------*/
+	class AudioGraphTopology
+	{
+		public:
+			AudioGraphTopology(AudioGraphTransaction *transaction, int max_channels) : max_channels(max_channels)
+			{
+				if (!transaction)
+					return;
+
+				for (AudioGraphEdit &edit : transaction->edits)
+				{
+					if (edit.num_channels)
+						this->staged_channels[edit.node] = edit.num_channels;
+					if (edit.name.empty() && !edit.input)
+						continue;
+
+					if (this->staged_inputs.find(edit.node) == this->staged_inputs.end())
+					{
+						std::vector<std::pair<std::string, NodeRef>> &inputs = this->staged_inputs[edit.node];
+						for (auto param : edit.node->params)
+							inputs.push_back(std::make_pair(param.first, *(param.second)));
+					}
+
+					std::vector<std::pair<std::string, NodeRef>> &inputs = this->staged_inputs[edit.node];
+					auto input = std::find_if(inputs.begin(), inputs.end(),
+					                          [&](const std::pair<std::string, NodeRef> &input) { return input.first == edit.name; });
+					if (!edit.name.empty() && input != inputs.end())
+						input->second = edit.input;
+					else
+						inputs.push_back(std::make_pair(edit.name, edit.input));
+				}
+			}
+
+			bool is_staged(Node *node)
+			{
+				return this->staged_inputs.count(node) || this->staged_channels.count(node);
+			}
+
+			void get_inputs(Node *node, std::vector<NodeRef> &inputs)
+			{
+				inputs.clear();
+
+				auto staged = this->staged_inputs.find(node);
+				if (staged != this->staged_inputs.end())
+				{
+					for (auto input : staged->second)
+						if (input.second)
+							inputs.push_back(input.second);
+				}
+				else
+				{
+					for (auto param : node->params)
+						if (*(param.second))
+							inputs.push_back(*(param.second));
+				}
+			}
+
+			int get_num_output_channels(Node *node)
+			{
+				if (!this->is_staged(node))
+					return node->num_output_channels;
+
+				auto cached = this->num_channels.find(node);
+				if (cached != this->num_channels.end())
+					return cached->second;
+
+				auto staged = this->staged_channels.find(node);
+				if (staged != this->staged_channels.end())
+					return this->num_channels[node] = staged->second;
+
+				/*------------------------------------------------------------------------
+				 * Cache the current count first, so that a cycle terminates.
+				 *-----------------------------------------------------------------------*/
+				int num_channels = this->num_channels[node] = node->num_output_channels;
+				int total = 0;
+				std::vector<NodeRef> inputs;
+				this->get_inputs(node, inputs);
+				for (NodeRef &input : inputs)
+					total += this->get_num_output_channels(input.get());
+
+				return this->num_channels[node] = std::max(num_channels, std::min(total, this->max_channels));
+			}
+
+			int get_num_input_channels(Node *node)
+			{
+				if (!this->is_staged(node))
+					return node->num_input_channels;
+
+				return std::max(node->num_input_channels, this->get_num_output_channels(node));
+			}
+
+		private:
+			int max_channels;
+			std::unordered_map<Node *, std::vector<std::pair<std::string, NodeRef>>> staged_inputs;
+			std::unordered_map<Node *, int> staged_channels;
+			std::unordered_map<Node *, int> num_channels;
+	};
+
+	AudioGraphSchedule::AudioGraphSchedule()
+	{
+		this->root = NULL;
+		this->buffer_pool_size = 0;
+		this->silent_buffer = NULL;
+		this->max_channels = SIGNAL_MAX_CHANNELS;
+		this->tasks = NULL;
+		this->allocated_bytes = 0;
+	}
+
+	AudioGraphSchedule::~AudioGraphSchedule()
+	{
+		for (sample *buffer : this->buffer_pool)
+			free(buffer);
+		free(this->silent_buffer);
+		delete this->tasks;
+	}
+
+	bool AudioGraphSchedule::install()
+	{
+		for (AudioGraphStep &step : this->steps)
+		{
+			Node *node = step.node.get();
+			if (step.buffers.empty())
+			{
+				if (step.install_output)
+					step.install_output();
+
+				for (int channel = node->output_buffer_channels; channel < SIGNAL_MAX_CHANNELS; channel++)
+					node->out[channel] = this->silent_buffer;
+			}
+			else
+			{
+				for (int channel = 0; channel < SIGNAL_MAX_CHANNELS; channel++)
+					node->out[channel] = (channel < step.num_channels) ? step.buffers[channel] : this->silent_buffer;
+				node->output_buffer_channels = step.num_channels;
+				node->output_buffer_size = this->buffer_pool_size;
+			}
+		}
+
+		for (Node *node : this->detached_nodes)
+		{
+			for (int channel = 0; channel < SIGNAL_MAX_CHANNELS; channel++)
+				node->out[channel] = this->silent_buffer;
+			node->output_buffer_channels = 0;
+		}
+
+		/*------------------------------------------------------------------------
+		 * Channel counts are only final once the edits have been made, so
+		 * the up-mix of each step is found now, and checked against the
+		 * storage that was allocated for it.
+		 *-----------------------------------------------------------------------*/
+		bool fits = true;
+		for (AudioGraphStep &step : this->steps)
+		{
+			Node *node = step.node.get();
+			step.upmix_channels = 0;
+			for (Node *consumer : step.consumers)
+				step.upmix_channels = std::max(step.upmix_channels, consumer->num_input_channels);
+
+			int num_channels = std::min(std::max(node->num_output_channels, step.upmix_channels), this->max_channels);
+			if (num_channels > node->output_buffer_channels)
+				fits = false;
+		}
+
+		return fits;
+	}
+
+	void AudioGraph::compile_node(const NodeRef &node, AudioGraphTopology &topology,
+	                              std::set<Node *> &visited, AudioGraphSchedule *schedule)
+	{
+		/*------------------------------------------------------------------------
+		 * Mark the node as visited before descending, so that a cyclic graph
+		 * terminates rather than recursing indefinitely.
+		 *-----------------------------------------------------------------------*/
+		if (visited.find(node.get()) != visited.end())
 			return;
+		visited.insert(node.get());
+
+		/*------------------------------------------------------------------------
+		 * Schedule our inputs before we schedule ourselves.
+		 *-----------------------------------------------------------------------*/
+		std::vector<NodeRef> inputs;
+		topology.get_inputs(node.get(), inputs);
+		for (NodeRef &input : inputs)
+			this->compile_node(input, topology, visited, schedule);
+
+		schedule->steps.push_back(AudioGraphStep(node));
+	}
+
+	void AudioGraph::compile(const NodeRef &root)
+	{
+		AudioGraphTopology topology(NULL, this->max_channels);
+		delete this->install_schedule(this->build_schedule(root, topology));
+	}
+
+	AudioGraphSchedule *AudioGraph::build_schedule(const NodeRef &root, AudioGraphTopology &topology)
+	{
+		AudioGraphSchedule *schedule = new AudioGraphSchedule();
+		std::set<Node *> visited;
+
+		schedule->root = root.get();
+		schedule->max_channels = this->max_channels;
+		this->compile_node(root, topology, visited, schedule);
+
+		/*------------------------------------------------------------------------
+		 * Automatic upmix.
+		 *
+		 * If an input node produces less channels than demanded, automatically
+		 * up-mix its output by replicating the existing channels. This allows
+		 * operations between multi-channel and mono-channel inputs to work
+		 * seamlessly without any additional implementation within the node
+		 * itself (for example, Multiply(new Sine(440), new Pan(2, ...)))
+		 *
+		 * Up-mixing is performed once, immediately after the input is
+		 * processed, to the widest channel count demanded by any consumer.
+		 * Record the consumers of each step, whose demands are read when the
+		 * schedule is installed.
+		 *
+		 * A few nodes must prevent automatic up-mixing from happening.
+		 * These include Multiplex and AudioOut.
+		 *-----------------------------------------------------------------------*/
+		std::unordered_map<Node *, int> step_index;
+		for (int index = 0; index < (int) schedule->steps.size(); index++)
+			step_index[schedule->steps[index].node.get()] = index;
+
+		std::vector<NodeRef> inputs;
+		for (AudioGraphStep &step : schedule->steps)
+		{
+			Node *node = step.node.get();
+			if (node->no_input_automix)
+				continue;
+
+			topology.get_inputs(node, inputs);
+			for (NodeRef &input : inputs)
+				schedule->steps[step_index[input.get()]].consumers.push_back(node);
+		}
+
+		this->fuse_operators(schedule, topology);
+		this->allocate_buffers(schedule, topology);
+
+		if (this->executor)
+			schedule->tasks = this->executor->compile(schedule->steps);
+
+		signal_debug("AudioGraph: compiled schedule of %d nodes", (int) schedule->steps.size());
+
+		return schedule;
+	}
+
+	AudioGraphSchedule *AudioGraph::install_schedule(AudioGraphSchedule *schedule)
+	{
+		AudioGraphSchedule *previous = this->schedule;
+
+		this->schedule = schedule;
+		this->schedule_stale = !schedule->install();
+		if (this->executor)
+			this->executor->install(schedule->tasks);
+
+		this->schedule_valid = true;
+		this->schedule_edited = false;
+		this->allocated_bytes = schedule->allocated_bytes;
+		this->node_count = schedule->steps.size();
+
+		return previous;
+	}
+
+	void AudioGraph::fuse_operators(AudioGraphSchedule *schedule, AudioGraphTopology &topology)
+	{
+		/*------------------------------------------------------------------------
+		 * Operator expressions such as `(sine * env + noise) * 0.1` produce a
+		 * chain of elementwise operator nodes. Where an operator's output is
+		 * read only once, by another operator, it is evaluated as part of its
+		 * consumer's fused expression, and its step is removed.
+		 *
+		 * Operators that must keep their own output (monitored nodes, the
+		 * schedule root, and control-rate nodes) are not inlined. Nor are
+		 * those with staged edits, whose params are yet to change.
+		 *-----------------------------------------------------------------------*/
+		std::unordered_map<Node *, int> reference_count;
+		std::vector<NodeRef> inputs;
+		for (AudioGraphStep &step : schedule->steps)
+		{
+			topology.get_inputs(step.node.get(), inputs);
+			for (NodeRef &input : inputs)
+				reference_count[input.get()]++;
+		}
+
+		auto can_inline = [&](Node *node)
+		{
+			return node && FusedExpression::can_fuse(node) && reference_count[node] == 1 &&
+			       !node->monitor && !node->no_output_pooling && node != schedule->root &&
+			       node->rate == SIGNAL_RATE_AUDIO && !topology.is_staged(node);
+		};
+
+		std::set<Node *> inlined;
+		for (int index = (int) schedule->steps.size() - 1; index >= 0; index--)
+		{
+			AudioGraphStep &step = schedule->steps[index];
+			Node *node = step.node.get();
+			if (inlined.count(node) || !FusedExpression::can_fuse(node) || node->rate != SIGNAL_RATE_AUDIO ||
+			    topology.is_staged(node))
+				continue;
+
+			std::shared_ptr<FusedExpression> fused(new FusedExpression(node, can_inline));
+			if (fused->inlined_nodes.empty())
+				continue;
+
+			inlined.insert(fused->inlined_nodes.begin(), fused->inlined_nodes.end());
+			step.fused = fused;
 		}
 
-		if (!(node->params.size() > 0 || node->name == "constant" || node->name == "audioout" || node->name == "audioin"))
+		if (!inlined.empty())
+		{
+			schedule->steps.erase(std::remove_if(schedule->steps.begin(), schedule->steps.end(),
+			                                     [&](const AudioGraphStep &step) { return inlined.count(step.node.get()) > 0; }),
+			                      schedule->steps.end());
+		}
+
+		/*------------------------------------------------------------------------
+		 * Record the steps that each step reads from.
+		 *-----------------------------------------------------------------------*/
+		std::unordered_map<Node *, int> step_index;
+		for (int index = 0; index < (int) schedule->steps.size(); index++)
+			step_index[schedule->steps[index].node.get()] = index;
+
+		for (AudioGraphStep &step : schedule->steps)
 		{
-			// signal_warn("Node %s has no registered params", node->name.c_str());
+			std::vector<Node *> step_inputs;
+			if (step.fused)
+			{
+				step_inputs = step.fused->inputs;
+			}
+			else
+			{
+				topology.get_inputs(step.node.get(), inputs);
+				for (NodeRef &input : inputs)
+					step_inputs.push_back(input.get());
+			}
+
+			step.inputs.clear();
+			for (Node *input : step_inputs)
+			{
+				int producer = step_index[input];
+				if (std::find(step.inputs.begin(), step.inputs.end(), producer) == step.inputs.end())
+					step.inputs.push_back(producer);
+			}
 		}
 
+		if (!inlined.empty())
+			signal_debug("AudioGraph: fused %d operator nodes", (int) inlined.size());
+	}
+
+	void AudioGraph::allocate_buffers(AudioGraphSchedule *schedule, AudioGraphTopology &topology)
+	{
+		int num_steps = schedule->steps.size();
+
 		/*------------------------------------------------------------------------
-		 * Pull our inputs before we generate our own outputs.
+		 * Each schedule has a pool of its own, as the audio thread may still
+		 * be processing with the pool of the current one.
 		 *-----------------------------------------------------------------------*/
+		schedule->buffer_pool_size = this->max_block_size;
+		schedule->silent_buffer = (sample *) calloc(schedule->buffer_pool_size, sizeof(sample));
 
-		for (auto param : node->params)
+		/*------------------------------------------------------------------------
+		 * Nodes processed by the current schedule may be mid-block, so their
+		 * private storage is swapped when the new schedule is installed.
+		 *-----------------------------------------------------------------------*/
+		std::unordered_set<Node *> live_nodes;
+		if (this->schedule)
 		{
-			NodeRef param_node = *(param.second);
-			if (param_node)
+			for (AudioGraphStep &step : this->schedule->steps)
+			{
+				live_nodes.insert(step.node.get());
+				if (step.fused)
+					live_nodes.insert(step.fused->inlined_nodes.begin(), step.fused->inlined_nodes.end());
+			}
+		}
+
+		/*------------------------------------------------------------------------
+		 * For each step, find the distinct steps that consume its output,
+		 * and the distinct steps that it consumes.
+		 *-----------------------------------------------------------------------*/
+		std::vector<std::vector<int>> consumers(num_steps);
+		std::vector<std::vector<int>> producers(num_steps);
+		for (int index = 0; index < num_steps; index++)
+		{
+			producers[index] = schedule->steps[index].inputs;
+			for (int producer : producers[index])
+				consumers[producer].push_back(index);
+		}
+
+		/*------------------------------------------------------------------------
+		 * Walk the schedule in order, assigning each step's output from the
+		 * pool and returning its inputs' buffers once their last consumer
+		 * has been assigned. Each free buffer remembers the steps that last
+		 * read it, which must complete before it is written again.
+		 *-----------------------------------------------------------------------*/
+		std::vector<int> free_buffers;
+		std::vector<std::vector<int>> buffer_readers;
+
+		std::vector<std::vector<int>> step_buffers(num_steps);
+		std::vector<int> remaining_consumers(num_steps);
+		for (int index = 0; index < num_steps; index++)
+			remaining_consumers[index] = consumers[index].size();
+
+		for (int index = 0; index < num_steps; index++)
+		{
+			AudioGraphStep &step = schedule->steps[index];
+			Node *node = step.node.get();
+			step.buffer_dependencies.clear();
+
+			int upmix_channels = 0;
+			for (Node *consumer : step.consumers)
+				upmix_channels = std::max(upmix_channels, topology.get_num_input_channels(consumer));
+
+			int num_channels = std::max(std::max(topology.get_num_output_channels(node), upmix_channels), 1);
+			if (num_channels > this->max_channels)
+			{
+				signal_warn("AudioGraph: Node %s requires %d channels, exceeding max_channels (%d)",
+				            node->name.c_str(), num_channels, this->max_channels);
+				num_channels = this->max_channels;
+			}
+			step.num_channels = num_channels;
+
+			if (node->no_output_pooling || node->monitor || node == schedule->root)
 			{
-				this->pull_input(param_node, num_frames);
+				if (live_nodes.count(node))
+				{
+					step.install_output = node->prepare_output(num_channels, this->max_block_size);
+					schedule->allocated_bytes += num_channels * this->max_block_size * sizeof(sample);
+				}
+				else
+				{
+					node->allocate_output(num_channels, this->max_block_size);
+					schedule->allocated_bytes += node->allocated_bytes;
+				}
+			}
+			else
+			{
+				std::vector<int> &buffers = step_buffers[index];
+
+				/*------------------------------------------------------------------------
+				 * Process in place if we are the sole consumer of a pooled input
+				 * that has enough channels. Fused expressions may read an input
+				 * at a different channel to the one they are writing, so are
+				 * never processed in place.
+				 *-----------------------------------------------------------------------*/
+				if (node->can_process_in_place && !step.fused)
+				{
+					for (int producer : producers[index])
+					{
+						if (consumers[producer].size() == 1 && (int) step_buffers[producer].size() >= num_channels)
+						{
+							buffers.swap(step_buffers[producer]);
+							break;
+						}
+					}
+				}
+
+				while ((int) buffers.size() < num_channels)
+				{
+					if (free_buffers.empty())
+					{
+						free_buffers.push_back(schedule->buffer_pool.size());
+						schedule->buffer_pool.push_back((sample *) calloc(schedule->buffer_pool_size, sizeof(sample)));
+						buffer_readers.push_back(std::vector<int>());
+					}
+
+					int buffer = free_buffers.back();
+					free_buffers.pop_back();
+					buffers.push_back(buffer);
+					for (int reader : buffer_readers[buffer])
+						step.buffer_dependencies.push_back(reader);
+				}
 
 				/*------------------------------------------------------------------------
-				 * Automatic upmix.
-				 *
-				 * If the input node produces less channels than demanded, automatically
-				 * up-mix its output by replicating the existing channels. This allows
-				 * operations between multi-channel and mono-channel inputs to work
-				 * seamlessly without any additional implementation within the node
-				 * itself (for example, Multiply(new Sine(440), new Pan(2, ...)))
-				 *
-				 * A few nodes must prevent automatic up-mixing from happening.
-				 * These include Multiplex and AudioOut.
+				 * An in-place input may have had more channels than we need.
 				 *-----------------------------------------------------------------------*/
-				if (param_node->num_output_channels < node->num_input_channels && !node->no_input_automix)
+				while ((int) buffers.size() > num_channels)
+				{
+					buffer_readers[buffers.back()] = { index };
+					free_buffers.push_back(buffers.back());
+					buffers.pop_back();
+				}
+
+				for (int buffer : buffers)
+					step.buffers.push_back(schedule->buffer_pool[buffer]);
+			}
+
+			for (int producer : producers[index])
+			{
+				if (--remaining_consumers[producer] == 0)
 				{
-					signal_debug("Upmixing %s (%s wants %d channels, %s only produces %d)", param_node->name.c_str(),
-						node->name.c_str(), node->num_input_channels, param_node->name.c_str(), param_node->num_output_channels);
-
-					/*------------------------------------------------------------------------
-					 * If we generate 2 channels but have 6 channels demanded, repeat
-					 * them: [ 0, 1, 0, 1, 0, 1 ]
-					 *-----------------------------------------------------------------------*/
-					for (int out_channel_index = param_node->num_output_channels;
-					         out_channel_index < node->num_input_channels;
-					         out_channel_index ++)
+					for (int buffer : step_buffers[producer])
 					{
-						int in_channel_index = out_channel_index % param_node->num_output_channels;
-						memcpy(param_node->out[out_channel_index],
-						       param_node->out[in_channel_index],
-						       num_frames * sizeof(sample));
+						buffer_readers[buffer] = consumers[producer];
+						free_buffers.push_back(buffer);
 					}
+					step_buffers[producer].clear();
 				}
 			}
 		}
-		node->process(node->out, num_frames);
-		this->processed_nodes.insert(node.get());
+
+		/*------------------------------------------------------------------------
+		 * Nodes that lose their pooled output would otherwise be left
+		 * pointing into the current schedule's pool once it is freed.
+		 *-----------------------------------------------------------------------*/
+		if (this->schedule)
+		{
+			std::unordered_set<Node *> scheduled_nodes;
+			for (AudioGraphStep &step : schedule->steps)
+				scheduled_nodes.insert(step.node.get());
+
+			for (AudioGraphStep &step : this->schedule->steps)
+			{
+				if (!step.buffers.empty() && !scheduled_nodes.count(step.node.get()))
+					schedule->detached_nodes.push_back(step.node.get());
+			}
+		}
+
+		schedule->allocated_bytes += (schedule->buffer_pool.size() + 1) * schedule->buffer_pool_size * sizeof(sample);
+
+		signal_debug("AudioGraph: %d nodes share %d pooled buffers, %d bytes allocated in total",
+		             num_steps, (int) schedule->buffer_pool.size(), (int) schedule->allocated_bytes);
+	}
+
+	void AudioGraph::invalidate_schedule()
+	{
+		this->schedule_valid = false;
+		if (this->is_audio_thread())
+			this->schedule_edited = true;
+	}
+
+	void AudioGraph::set_num_threads(int num_threads, bool deterministic)
+	{
+		if (this->executor)
+		{
+			delete this->executor;
+			this->executor = NULL;
+		}
+
+		if (num_threads == 0)
+			num_threads = std::thread::hardware_concurrency();
+
+		if (num_threads > 1)
+			this->executor = new ParallelExecutor(num_threads, deterministic);
+
+		this->invalidate_schedule();
+	}
+
+	void AudioGraph::pull_input(const NodeRef &root, int num_frames)
+	{
+		if (num_frames > this->max_block_size)
+			throw std::runtime_error("AudioGraph: Block of " + std::to_string(num_frames) + " frames exceeds max_block_size");
+
+		/*------------------------------------------------------------------------
+		 * While running, schedules are built on the control side (see
+		 * commit_transaction), and we are silent while the schedule doesn't
+		 * fit the graph. Otherwise, only re-traverse the graph when its
+		 * topology has changed.
+		 *-----------------------------------------------------------------------*/
+		if (this->running)
+		{
+			if (this->schedule_stale)
+			{
+				root->zero_output();
+				return;
+			}
+		}
+		else if (!this->schedule_valid || !this->schedule || this->schedule->root != root.get())
+		{
+			this->compile(root);
+		}
+
+		if (this->executor && this->schedule->tasks)
+		{
+			this->executor->process(num_frames);
+		}
+		else
+		{
+			for (AudioGraphStep &step : this->schedule->steps)
+				step.process(num_frames);
+		}
+	}
+
+	bool AudioGraph::is_deferring()
+	{
+		return this->running && std::this_thread::get_id() != this->audio_thread_id.load(std::memory_order_relaxed);
+	}
+
+	bool AudioGraph::is_audio_thread()
+	{
+		return this->running && std::this_thread::get_id() == this->audio_thread_id.load(std::memory_order_relaxed);
+	}
+
+	void AudioGraph::begin_transaction()
+	{
+		this->control_mutex.lock();
+		if (this->transaction_depth++ == 0)
+			this->pending_transaction = new AudioGraphTransaction();
+	}
+
+	void AudioGraph::commit_transaction()
+	{
+		if (--this->transaction_depth == 0)
+		{
+			AudioGraphTransaction *transaction = this->pending_transaction;
+			this->pending_transaction = NULL;
+
+			if (!this->running)
+			{
+				/*------------------------------------------------------------------------
+				 * Edits are only deferred while running, so any operations queued
+				 * otherwise can be made now.
+				 *-----------------------------------------------------------------------*/
+				for (auto &operation : transaction->operations)
+					operation();
+				delete transaction;
+			}
+			else
+			{
+				/*------------------------------------------------------------------------
+				 * Build the schedule for the graph as it will be once the edits are
+				 * made, so that the audio thread only needs to install it.
+				 *-----------------------------------------------------------------------*/
+				if (!transaction->edits.empty() || !this->schedule_valid)
+				{
+					this->schedule_valid = true;
+					AudioGraphTopology topology(transaction, this->max_channels);
+					transaction->schedule = this->build_schedule(this->output, topology);
+				}
+
+				this->submit_transaction(transaction);
+			}
+		}
+		this->control_mutex.unlock();
+	}
+
+	void AudioGraph::submit_transaction(AudioGraphTransaction *transaction)
+	{
+		while (transaction)
+		{
+			if (transaction->operations.empty() && !transaction->schedule)
+			{
+				delete transaction;
+				return;
+			}
+
+			/*------------------------------------------------------------------------
+			 * Wait for the audio thread to hand the transaction back, so that the
+			 * next schedule is built from the graph with these edits made, and
+			 * the schedule that was replaced is freed here.
+			 *-----------------------------------------------------------------------*/
+			this->transactions.push(transaction);
+
+			AudioGraphTransaction *completed;
+			while (!this->completed_transactions.pop(completed))
+				std::this_thread::yield();
+
+			bool stale = completed->stale;
+			delete completed->schedule;
+			delete completed;
+			transaction = NULL;
+
+			/*------------------------------------------------------------------------
+			 * If the edits didn't fit the schedule built for them, rebuild it
+			 * from the graph as it now stands.
+			 *-----------------------------------------------------------------------*/
+			if (stale)
+			{
+				signal_debug("AudioGraph: rebuilding stale schedule");
+				AudioGraphTopology topology(NULL, this->max_channels);
+				transaction = new AudioGraphTransaction();
+				transaction->schedule = this->build_schedule(this->output, topology);
+			}
+		}
+	}
+
+	void AudioGraph::abort_transaction()
+	{
+		if (--this->transaction_depth == 0)
+		{
+			delete this->pending_transaction;
+			this->pending_transaction = NULL;
+		}
+		this->control_mutex.unlock();
+	}
+
+	void AudioGraph::defer(std::function<void()> operation)
+	{
+		this->begin_transaction();
+		this->pending_transaction->operations.push_back(operation);
+		this->commit_transaction();
+	}
+
+	void AudioGraph::stage_input(Node *node, std::string name, const NodeRef &input)
+	{
+		this->begin_transaction();
+		this->pending_transaction->edits.push_back(AudioGraphEdit(node, name, input));
+		this->commit_transaction();
+	}
+
+	void AudioGraph::stage_channels(Node *node, int num_channels)
+	{
+		this->begin_transaction();
+		this->pending_transaction->edits.push_back(AudioGraphEdit(node, "", nullptr, num_channels));
+		this->commit_transaction();
+	}
+
+	NodeRef AudioGraph::get_staged_input(Node *node, std::string name)
+	{
+		std::lock_guard<std::recursive_mutex> lock(this->control_mutex);
+
+		NodeRef input = nullptr;
+		if (node->params.find(name) != node->params.end())
+			input = *(node->params[name]);
+
+		if (this->pending_transaction)
+		{
+			for (AudioGraphEdit &edit : this->pending_transaction->edits)
+			{
+				if (edit.node == node && edit.name == name)
+					input = edit.input;
+			}
+		}
+
+		return input;
+	}
+
+	std::set<std::pair<Node *, std::string>> AudioGraph::get_staged_outputs(Node *node)
+	{
+		std::lock_guard<std::recursive_mutex> lock(this->control_mutex);
+
+		std::set<std::pair<Node *, std::string>> outputs;
+		for (auto output : node->outputs)
+		{
+			if (this->get_staged_input(output.first, output.second).get() == node)
+				outputs.insert(output);
+		}
+
+		if (this->pending_transaction)
+		{
+			for (AudioGraphEdit &edit : this->pending_transaction->edits)
+			{
+				if (!edit.name.empty() && edit.input.get() == node &&
+				    this->get_staged_input(edit.node, edit.name).get() == node)
+					outputs.insert(std::make_pair(edit.node, edit.name));
+			}
+		}
+
+		return outputs;
+	}
+
+	void AudioGraph::retire(std::shared_ptr<void> object)
+	{
+		if (this->collector && this->is_audio_thread())
+			this->collector->retire(std::move(object));
+	}
+
+	long AudioGraph::get_pending_reclaim_count()
+	{
+		return this->collector ? this->collector->get_pending_count() : 0;
+	}
+
+	long AudioGraph::get_reclaimed_count()
+	{
+		return this->collector ? this->collector->get_reclaimed_count() : 0;
+	}
+
+	void AudioGraph::apply_transactions()
+	{
+		AudioGraphTransaction *transaction;
+		while (this->transactions.pop(transaction))
+		{
+			for (auto &operation : transaction->operations)
+				operation();
+
+			/*------------------------------------------------------------------------
+			 * Install the schedule built for the edits, handing back the one it
+			 * replaces. Edits that change the topology without one leave us
+			 * with no valid schedule until the control side builds it.
+			 *-----------------------------------------------------------------------*/
+			if (transaction->schedule)
+				transaction->schedule = this->install_schedule(transaction->schedule);
+			else if (this->schedule_edited)
+				this->schedule_stale = true;
+
+			transaction->stale = this->schedule_stale;
+			this->completed_transactions.push(transaction);
+		}
 	}
 
 	void AudioGraph::pull_input(int num_frames)
 	{
-		this->processed_nodes.clear();
+		/*------------------------------------------------------------------------
+		 * Apply any topology edits queued by the control thread(s), so that
+		 * the graph only ever changes at block boundaries.
+		 *-----------------------------------------------------------------------*/
+		this->audio_thread_id.store(std::this_thread::get_id(), std::memory_order_relaxed);
+		this->apply_transactions();
+
 		this->pull_input(this->output, num_frames);
-		this->node_count = this->processed_nodes.size();
 		signal_debug("AudioGraph: pull %d frames, %d nodes", num_frames, this->node_count);
 	}
 
@@ -115,13 +914,13 @@ namespace libsignal
 		 * audio out. Can this be improved?
 		 *-----------------------------------------------------------------------*/
 		root->update_channels();
+		block_size = std::min(block_size, this->max_block_size);
 
 		int index = 0;
 		signal_debug("AudioGraph: Performing offline process of %d frames", num_frames);
 		while (index < (num_frames - block_size))
 		{
 			signal_debug("AudioGraph: Processing frame %d...", index);
-			this->processed_nodes.clear();
 			this->pull_input(root, block_size);
 			index += block_size;
 		}
@@ -133,7 +932,6 @@ namespace libsignal
 		if (index < num_frames)
 		{
 			signal_debug("AudioGraph: Processing remaining %d samples", num_frames - index);
-			this->processed_nodes.clear();
 			this->pull_input(root, num_frames - index);
 		}
 
@@ -152,7 +950,7 @@ namespace libsignal
 
 	void AudioGraph::add_output(SynthRef synth)
 	{
-		this->output->add_input(synth->output);
+		this->add_output(synth->output);
 	}
 
 	void AudioGraph::add_output(NodeRef node)
@@ -3,9 +3,167 @@
 #include "node.h"
 #include "synth.h"
 
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
 namespace libsignal
 {
 	class AudioOut_Abstract;
+	class ParallelExecutor;
+	class ParallelTaskGraph;
+	class GarbageCollector;
+	class FusedExpression;
+	class AudioGraphTopology;
+
+	/**------------------------------------------------------------------------
+	 * A single step of a compiled execution schedule.
+	 *
+	 * After `node` has been processed, its output is up-mixed to
+	 * `upmix_channels` channels, which is the widest input demanded by any
+	 * of its consumers (see AudioGraph::compile).
+	 *
+	 * Unless the node opts out, its output buffers are drawn from the
+	 * schedule's buffer pool, and are returned to the pool once its last
+	 * consumer has been processed.
+	 *
+	 * If `fused` is set, the node is the root of a chain of operators
+	 * that are evaluated together, and whose intermediate nodes have no
+	 * step of their own.
+	 *------------------------------------------------------------------------*/
+	class AudioGraphStep
+	{
+		public:
+			AudioGraphStep(const NodeRef &node) : node(node), upmix_channels(0), num_channels(0) {}
+
+			/**------------------------------------------------------------------------
+			 * Process the node, then perform any up-mixing that is required.
+			 *------------------------------------------------------------------------*/
+			void process(int num_frames);
+
+			NodeRef node;
+			int upmix_channels;
+			std::shared_ptr<FusedExpression> fused;
+
+			/*------------------------------------------------------------------------
+			 * Indices of the earlier steps whose output this step reads.
+			 *-----------------------------------------------------------------------*/
+			std::vector<int> inputs;
+
+			/*------------------------------------------------------------------------
+			 * Indices of earlier steps that must complete before this step may
+			 * write its output, as its output reuses their inputs' buffers.
+			 *-----------------------------------------------------------------------*/
+			std::vector<int> buffer_dependencies;
+
+			/*------------------------------------------------------------------------
+			 * Number of channels of output storage, and the pooled buffer of
+			 * each. A node with private storage has no pooled buffers, and may
+			 * have a function to swap in storage of the new size when the
+			 * schedule is installed.
+			 *-----------------------------------------------------------------------*/
+			int num_channels;
+			std::vector<sample *> buffers;
+			std::function<void()> install_output;
+
+			/*------------------------------------------------------------------------
+			 * Nodes that read this step's output, and whose input channel
+			 * counts decide `upmix_channels`.
+			 *-----------------------------------------------------------------------*/
+			std::vector<Node *> consumers;
+	};
+
+	/**------------------------------------------------------------------------
+	 * A compiled execution schedule, and the output storage of its steps.
+	 *
+	 * Schedules are built off the audio thread, from the graph as it will
+	 * be once a transaction's edits are made (see AudioGraph::compile),
+	 * and installed by the audio thread in the same block as the edits.
+	 * Installing only points each node at its storage, and doesn't
+	 * allocate; the schedule it replaces is handed back to be freed.
+	 *------------------------------------------------------------------------*/
+	class AudioGraphSchedule
+	{
+		public:
+			AudioGraphSchedule();
+			~AudioGraphSchedule();
+
+			/**------------------------------------------------------------------------
+			 * Point each node at its storage, and up-mix to the channels that
+			 * its consumers now demand. Returns false if any node has more
+			 * channels than were allocated for it, in which case the schedule
+			 * must be rebuilt before it is processed.
+			 *------------------------------------------------------------------------*/
+			bool install();
+
+			std::vector<AudioGraphStep> steps;
+			Node *root;
+
+			/*------------------------------------------------------------------------
+			 * Mono buffers of `buffer_pool_size` frames, shared between the
+			 * outputs of nodes whose lifetimes within the schedule don't overlap.
+			 * Channels beyond those a node needs point to `silent_buffer`,
+			 * which is only ever read, so that it stays zeroed: nodes must not
+			 * write beyond their output_buffer_channels.
+			 *-----------------------------------------------------------------------*/
+			std::vector<sample *> buffer_pool;
+			int buffer_pool_size;
+			sample *silent_buffer;
+			int max_channels;
+
+			/*------------------------------------------------------------------------
+			 * Nodes whose output was pooled by the previous schedule, but isn't
+			 * by this one. These are pointed at the silent buffer on install,
+			 * as the previous schedule's pool is freed.
+			 *-----------------------------------------------------------------------*/
+			std::vector<Node *> detached_nodes;
+
+			ParallelTaskGraph *tasks;
+			size_t allocated_bytes;
+	};
+
+	/**------------------------------------------------------------------------
+	 * An input edit that is staged by a transaction, so that its schedule
+	 * can be built before the edit is made. An empty `name` appends the
+	 * input (as AudioOut::add_input does).
+	 *------------------------------------------------------------------------*/
+	class AudioGraphEdit
+	{
+		public:
+			AudioGraphEdit(Node *node, std::string name, NodeRef input, int num_channels = 0) :
+				node(node), name(name), input(input), num_channels(num_channels) {}
+
+			Node *node;
+			std::string name;
+			NodeRef input;
+
+			/*------------------------------------------------------------------------
+			 * If non-zero, the node's number of output channels once the edit
+			 * is made, for nodes whose count isn't derived from their inputs.
+			 *-----------------------------------------------------------------------*/
+			int num_channels;
+	};
+
+	/**------------------------------------------------------------------------
+	 * A batch of topology edits, queued by a control thread and applied
+	 * atomically by the audio thread at the start of a block.
+	 *
+	 * If the edits change the topology, the transaction carries the
+	 * schedule that is built for them, and returns with the schedule that
+	 * it replaced, to be freed on the control side. `stale` is set on
+	 * return if the schedule couldn't be used as it stands.
+	 *------------------------------------------------------------------------*/
+	class AudioGraphTransaction
+	{
+		public:
+			AudioGraphTransaction() : schedule(NULL), stale(false) {}
+
+			std::vector<std::function<void()>> operations;
+			std::vector<AudioGraphEdit> edits;
+			AudioGraphSchedule *schedule;
+			bool stale;
+	};
 
 	class AudioGraph
 	{
@@ -31,9 +189,123 @@ namespace libsignal
 			 *------------------------------------------------------------------------*/
 			void process(const NodeRef &root, int num_frames, int block_size = SIGNAL_DEFAULT_BLOCK_SIZE);
 
-			void pull_input(const NodeRef &node, int num_frames);
+			void pull_input(const NodeRef &root, int num_frames);
 			void pull_input(int num_frames);
 
+			/**------------------------------------------------------------------------
+			 * Flatten the graph beneath `root` into a topologically-sorted
+			 * schedule, and process with it from now on. Called automatically
+			 * when the topology has changed: while the graph is running, by
+			 * commit_transaction(), which builds the schedule on the control
+			 * thread for the audio thread to install. Must not be called
+			 * directly while the graph is running.
+			 *
+			 *------------------------------------------------------------------------*/
+			void compile(const NodeRef &root);
+
+			/**------------------------------------------------------------------------
+			 * Mark the compiled schedule as stale. Called by Node whenever
+			 * an input or output connection is made or broken. While running,
+			 * the schedule is rebuilt when the next transaction is committed.
+			 *
+			 *------------------------------------------------------------------------*/
+			void invalidate_schedule();
+
+			/**------------------------------------------------------------------------
+			 * Process independent branches of the graph concurrently, across
+			 * `num_threads` threads (including the audio thread). A value of 0
+			 * uses one thread per hardware core; 1 reverts to serial processing.
+			 *
+			 * In deterministic mode, nodes with shared state (for example, those
+			 * that draw from the global random number generator) are processed in
+			 * the same order as the serial schedule, so that output is
+			 * bit-identical to serial processing.
+			 *
+			 * Should be called before start().
+			 *
+			 *------------------------------------------------------------------------*/
+			void set_num_threads(int num_threads, bool deterministic = false);
+
+			/**------------------------------------------------------------------------
+			 * Group subsequent topology edits (set_input, add_output, etc)
+			 * so that the audio thread applies them together, within a single
+			 * block boundary. Calls may be nested; edits are queued when the
+			 * outermost commit_transaction() is reached.
+			 *
+			 * abort_transaction() ends a transaction without queueing the edits
+			 * made within it, discarding them unless an enclosing transaction is
+			 * still open (which decides their fate in turn).
+			 *
+			 * While the graph is running, the outermost commit builds the new
+			 * schedule (if the topology changes), then waits for the audio
+			 * thread to take the edits, which is at most a block.
+			 *
+			 *------------------------------------------------------------------------*/
+			void begin_transaction();
+			void commit_transaction();
+			void abort_transaction();
+
+			/**------------------------------------------------------------------------
+			 * Returns true if the calling thread must not modify the topology
+			 * directly: that is, the graph is running and we are not on the
+			 * audio thread. Topology edits should then be passed to defer().
+			 *
+			 *------------------------------------------------------------------------*/
+			bool is_deferring();
+
+			/**------------------------------------------------------------------------
+			 * Returns true if the graph is running and the calling thread is
+			 * its audio thread, on which nothing may be allocated or freed.
+			 *
+			 *------------------------------------------------------------------------*/
+			bool is_audio_thread();
+
+			/**------------------------------------------------------------------------
+			 * Queue an operation to be performed by the audio thread at the
+			 * start of the next block. Never blocks the audio thread.
+			 *
+			 *------------------------------------------------------------------------*/
+			void defer(std::function<void()> operation);
+
+			/**------------------------------------------------------------------------
+			 * Stage the edit of input `name` of `node` to `input` (or, with an
+			 * empty name, the addition of `input`), which the operations of
+			 * the current transaction make on the audio thread. The transaction's
+			 * schedule is built with the edit in place.
+			 *
+			 * stage_channels() stages a change of a node's number of output
+			 * channels that isn't derived from its inputs.
+			 *
+			 *------------------------------------------------------------------------*/
+			void stage_input(Node *node, std::string name, const NodeRef &input);
+			void stage_channels(Node *node, int num_channels);
+
+			/**------------------------------------------------------------------------
+			 * Returns the input `name` of `node`, and the (node, name) pairs of
+			 * the inputs that `node` is connected to, as they will be once the
+			 * edits staged in the current transaction are made.
+			 *
+			 *------------------------------------------------------------------------*/
+			NodeRef get_staged_input(Node *node, std::string name);
+			std::set<std::pair<Node *, std::string>> get_staged_outputs(Node *node);
+
+			/**------------------------------------------------------------------------
+			 * Release a reference that is being dropped by the graph. On the
+			 * audio thread, the reference is passed to a background collector,
+			 * so that any resulting destructor and free() runs off the audio
+			 * thread. Elsewhere, it is simply released.
+			 *
+			 *------------------------------------------------------------------------*/
+			void retire(std::shared_ptr<void> object);
+
+			/**------------------------------------------------------------------------
+			 * Number of retired references awaiting collection, and the total
+			 * number collected since start().
+			 *
+			 *------------------------------------------------------------------------*/
+			long get_pending_reclaim_count();
+			long get_reclaimed_count();
+
 			NodeRef get_output();
 
 			/**------------------------------------------------------------------------
@@ -51,9 +323,100 @@ namespace libsignal
 			float sample_rate;
 			int node_count;
 
+			/*------------------------------------------------------------------------
+			 * Output buffer allocation policy. Node outputs are allocated with
+			 * max_block_size frames, and up to max_channels channels (which
+			 * cannot exceed SIGNAL_MAX_CHANNELS). Should be set before start().
+			 *-----------------------------------------------------------------------*/
+			int max_block_size;
+			int max_channels;
+
+			/*------------------------------------------------------------------------
+			 * Bytes of output storage used by the current schedule: the buffer
+			 * pool, plus any private node outputs. Updated on each compile.
+			 *-----------------------------------------------------------------------*/
+			size_t allocated_bytes;
+
 		private: 
 
-			std::set<Node *> processed_nodes;
+			AudioGraphSchedule *build_schedule(const NodeRef &root, AudioGraphTopology &topology);
+			void compile_node(const NodeRef &node, AudioGraphTopology &topology,
+			                  std::set<Node *> &visited, AudioGraphSchedule *schedule);
+			void fuse_operators(AudioGraphSchedule *schedule, AudioGraphTopology &topology);
+			void allocate_buffers(AudioGraphSchedule *schedule, AudioGraphTopology &topology);
+
+			/*------------------------------------------------------------------------
+			 * Install `schedule` on the processing thread, returning the schedule
+			 * that it replaces.
+			 *-----------------------------------------------------------------------*/
+			AudioGraphSchedule *install_schedule(AudioGraphSchedule *schedule);
+			void submit_transaction(AudioGraphTransaction *transaction);
+			void apply_transactions();
+
+			AudioGraphSchedule *schedule;
+			std::atomic<bool> schedule_valid;
+
+			/*------------------------------------------------------------------------
+			 * Set on the audio thread by edits made without a new schedule, or
+			 * when a schedule doesn't fit the edits made with it. Output is
+			 * silent until the control side replaces the schedule.
+			 *-----------------------------------------------------------------------*/
+			bool schedule_edited;
+			bool schedule_stale;
+
+			/*------------------------------------------------------------------------
+			 * Transactions travel to the audio thread via `transactions`, and
+			 * are handed back via `completed_transactions` so that they are
+			 * freed on the control side. The control mutex serialises multiple
+			 * control threads; it is never taken by the audio thread.
+			 *-----------------------------------------------------------------------*/
+			LockFreeRingBuffer<AudioGraphTransaction *> transactions;
+			LockFreeRingBuffer<AudioGraphTransaction *> completed_transactions;
+			AudioGraphTransaction *pending_transaction;
+			int transaction_depth;
+			std::recursive_mutex control_mutex;
+
+			std::atomic<bool> running;
+			std::atomic<std::thread::id> audio_thread_id;
+
+			GarbageCollector *collector;
+
+			ParallelExecutor *executor;
+	};
+
+	/**------------------------------------------------------------------------
+	 * Holds a transaction open on `graph` (if any) for its lifetime.
+	 * Unless commit() is called first, the transaction is aborted when
+	 * the scope is left, so that an exception thrown part-way through a
+	 * set of edits doesn't leave the graph locked, or half-connected.
+	 *------------------------------------------------------------------------*/
+	class AudioGraphTransactionScope
+	{
+		public:
+			AudioGraphTransactionScope(AudioGraph *graph) : graph(graph)
+			{
+				if (this->graph)
+					this->graph->begin_transaction();
+			}
+
+			~AudioGraphTransactionScope()
+			{
+				if (this->graph)
+					this->graph->abort_transaction();
+			}
+
+			void commit()
+			{
+				if (this->graph)
+					this->graph->commit_transaction();
+				this->graph = NULL;
+			}
+
+		private:
+			AudioGraphTransactionScope(const AudioGraphTransactionScope &);
+			AudioGraphTransactionScope &operator=(const AudioGraphTransactionScope &);
+
+			AudioGraph *graph;
 	};
 
 	class AudioGraphRef : public std::shared_ptr<AudioGraph>
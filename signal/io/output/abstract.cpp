@@ -1,4 +1,7 @@
 #include "abstract.h"
+#include "../../kernels/kernels.h"
+
+#include <algorithm>
 
 namespace libsignal
 {
@@ -13,31 +16,62 @@ namespace libsignal
         // this->num_input_channels = 2;
         this->num_output_channels = 2;
         this->no_input_automix = true;
+        this->no_output_pooling = true;
     }
     
     
-    void AudioOut_Abstract::process(sample **out, int num_frames)
+    void AudioOut_Abstract::add_input(NodeRef node)
     {
-        for (int channel = 0; channel < this->num_output_channels; channel++)
-            memset(out[channel], 0, num_frames * sizeof(sample));
-        
-        for (NodeRef input : this->inputs)
+        std::shared_ptr<std::list<NodeRef>> slot = std::make_shared<std::list<NodeRef>>(1, node);
+        std::string name = "input" + std::to_string(this->params.size() + 1);
+
+        if (!this->is_deferring())
+        {
+            this->inputs.splice(this->inputs.end(), *slot);
+            this->Node::add_input(name, this->inputs.back());
+            return;
+        }
+
+        /*------------------------------------------------------------------------
+         * Edits are made on the audio thread while the control side waits for
+         * them, so our params can be registered here. The slot keeps its
+         * address when it is moved into our inputs.
+         *-----------------------------------------------------------------------*/
+        AudioGraphTransactionScope transaction(this->graph);
+        this->params[name] = &slot->front();
+        this->graph->stage_input(this, name, node);
+        if (node)
+            node->reserve_output(this, name);
+
+        this->defer_edit([this, slot, name, node]
         {
-            for (int channel = 0; channel < input->num_output_channels; channel++)
+            this->inputs.splice(this->inputs.end(), *slot);
+            if (node)
             {
-                #ifdef __APPLE__
-                
-                vDSP_vadd(input->out[channel], 1, out[channel], 1, out[channel], 1, num_frames);
-                
-                #else
-                
-                for (int frame = 0; frame < num_frames; frame++)
-                {
-                    out[channel][frame] += input->out[channel][frame];
-                }
-                
-                #endif
+                node->update_channels();
+                node->add_output(this, name);
             }
+            this->update_channels();
+            this->graph->invalidate_schedule();
+        });
+        transaction.commit();
+    }
+
+    void AudioOut_Abstract::process(sample **out, int num_frames)
+    {
+        /*------------------------------------------------------------------------
+         * Channels beyond our output buffer point at the schedule's silent
+         * buffer, so inputs with more channels than we have are truncated.
+         *-----------------------------------------------------------------------*/
+        int num_channels = std::min(this->num_output_channels, this->output_buffer_channels);
+        for (int channel = 0; channel < num_channels; channel++)
+            vector_fill(out[channel], 0, num_frames);
+        
+        for (const NodeRef &input : this->inputs)
+        {
+            int input_channels = std::min(input->num_output_channels, num_channels);
+            for (int channel = 0; channel < input_channels; channel++)
+                vector_add(out[channel], input->out[channel], out[channel], num_frames);
         }
     }
     
@@ -22,15 +22,14 @@ namespace libsignal
         virtual int start() = 0;
         virtual int close() = 0;
 
-        virtual void add_input(NodeRef node)
-		{
-			inputs.push_back(node);
-			std::string input_name = "input" + std::to_string(this->inputs.size());;
-
-			this->Node::add_input(input_name, inputs.back());
-		}
-
-		std::list <NodeRef> inputs;
+        /*------------------------------------------------------------------------
+         * Add an input to be mixed to the output. While the graph is running,
+         * its param and list entry are made on the calling thread, and only
+         * linked into our inputs on the audio thread.
+         *-----------------------------------------------------------------------*/
+        virtual void add_input(NodeRef node);
+
+        std::list <NodeRef> inputs;
     };
 
 } // namespace libsignal
@@ -13,6 +13,7 @@
 #include <string.h>
 #include <math.h>
 #include <iostream>
+#include <algorithm>
 
 
 namespace libsignal
@@ -22,13 +23,24 @@ extern AudioGraph *shared_graph;
     
 void audio_callback(float **data, int num_channels, int num_frames)
 {
-    shared_graph->pull_input(num_frames);
-    
-    for (int frame = 0; frame < num_frames; frame++)
+    /*-----------------------------------------------------------------------*
+     * Process in blocks of no more than max_block_size frames.
+     *-----------------------------------------------------------------------*/
+    for (int offset = 0; offset < num_frames; offset += shared_graph->max_block_size)
     {
-        for (int channel = 0; channel < num_channels; channel++)
+        int block_size = std::min(num_frames - offset, shared_graph->max_block_size);
+        shared_graph->pull_input(block_size);
+
+        /*-----------------------------------------------------------------------*
+         * Device channels beyond those of our output are written as silence.
+         *-----------------------------------------------------------------------*/
+        int output_channels = std::min(num_channels, shared_graph->output->output_buffer_channels);
+        for (int frame = 0; frame < block_size; frame++)
         {
-            data[channel][frame] = shared_graph->output->out[channel][frame];
+            for (int channel = 0; channel < num_channels; channel++)
+            {
+                data[channel][offset + frame] = (channel < output_channels) ? shared_graph->output->out[channel][frame] : 0.0;
+            }
         }
     }
 }
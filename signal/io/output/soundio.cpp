@@ -3,12 +3,14 @@
 #ifdef HAVE_SOUNDIO
 
 #include "../../graph.h"
+#include "../../kernels/kernels.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <iostream>
+#include <algorithm>
 
 namespace libsignal
 {
@@ -44,20 +46,52 @@ void write_callback(struct SoundIoOutStream *outstream,
 		if ((err = soundio_outstream_begin_write(outstream, &areas, &frame_count)))
 			throw std::runtime_error("libsoundio error on begin write: " + std::string(soundio_strerror(err)));
 
-		shared_graph->pull_input(frame_count);
-
-		for (int frame = 0; frame < frame_count; frame++)
+		/*-----------------------------------------------------------------------*
+		 * Process in blocks of no more than max_block_size frames.
+		 *-----------------------------------------------------------------------*/
+		for (int offset = 0; offset < frame_count; offset += shared_graph->max_block_size)
 		{
-			for (int channel = 0; channel < layout->channel_count; channel += 1)
+			int block_size = std::min(frame_count - offset, shared_graph->max_block_size);
+			shared_graph->pull_input(block_size);
+
+			/*-----------------------------------------------------------------------*
+			 * Device channels beyond those of our output are written as silence.
+			 *-----------------------------------------------------------------------*/
+			int num_channels = std::min(layout->channel_count, shared_graph->output->output_buffer_channels);
+
+			/*-----------------------------------------------------------------------*
+			 * If the device buffer is packed, interleaved float32 (as is usual),
+			 * write it with vector kernels, applying the hard limiter in place.
+			 *-----------------------------------------------------------------------*/
+			bool interleaved = num_channels == layout->channel_count;
+			for (int channel = 0; channel < layout->channel_count; channel++)
+			{
+				if (areas[channel].step != (int) (layout->channel_count * sizeof(float)) ||
+				    areas[channel].ptr != areas[0].ptr + channel * sizeof(float))
+					interleaved = false;
+			}
+
+			if (interleaved)
+			{
+				float *ptr = (float *) (areas[0].ptr + areas[0].step * offset);
+				vector_interleave(shared_graph->output->out, layout->channel_count, ptr, block_size);
+				vector_clip(ptr, -1.0, 1.0, ptr, block_size * layout->channel_count);
+				continue;
+			}
+
+			for (int frame = 0; frame < block_size; frame++)
 			{
-				float *ptr = (float *)(areas[channel].ptr + areas[channel].step * frame);
-				*ptr = shared_graph->output->out[channel][frame];
-
-				/*-----------------------------------------------------------------------*
-				 * Hard limiter.
-				 *-----------------------------------------------------------------------*/
-				if (*ptr > 1.0) *ptr = 1.0;
-				if (*ptr < -1.0) *ptr = -1.0;
+				for (int channel = 0; channel < layout->channel_count; channel += 1)
+				{
+					float *ptr = (float *)(areas[channel].ptr + areas[channel].step * (offset + frame));
+					*ptr = (channel < num_channels) ? shared_graph->output->out[channel][frame] : 0.0;
+
+					/*-----------------------------------------------------------------------*
+					 * Hard limiter.
+					 *-----------------------------------------------------------------------*/
+					if (*ptr > 1.0) *ptr = 1.0;
+					if (*ptr < -1.0) *ptr = -1.0;
+				}
 			}
 		}
 
@@ -0,0 +1,56 @@
+#include "kernels.h"
+#include "../fastmath.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*------------------------------------------------------------------------
+ * Compiled for AVX2 regardless of the compiler's target, and only
+ * selected at runtime if the CPU supports it. Headers with inline
+ * functions are included above, so that they aren't (see vector_impl.h).
+ *-----------------------------------------------------------------------*/
+#if defined(__clang__)
+	#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+	#pragma GCC target ("avx2")
+#endif
+
+#include <immintrin.h>
+
+#define SIGNAL_VECTOR_NAME "avx2"
+#define SIGNAL_VECTOR_NAMESPACE avx2
+#define SIGNAL_VECTOR_TABLE vector_kernels_avx2
+#define SIGNAL_VECTOR_WIDTH 8
+
+typedef __m256 vector_t;
+#define VECTOR_LOAD(ptr) _mm256_loadu_ps(ptr)
+#define VECTOR_STORE(ptr, v) _mm256_storeu_ps(ptr, v)
+#define VECTOR_SET1(value) _mm256_set1_ps(value)
+#define VECTOR_ADD(a, b) _mm256_add_ps(a, b)
+#define VECTOR_SUB(a, b) _mm256_sub_ps(a, b)
+#define VECTOR_MUL(a, b) _mm256_mul_ps(a, b)
+#define VECTOR_DIV(a, b) _mm256_div_ps(a, b)
+#define VECTOR_SQRT(v) _mm256_sqrt_ps(v)
+#define VECTOR_MAX(a, b) _mm256_max_ps(a, b)
+#define VECTOR_MIN(a, b) _mm256_min_ps(a, b)
+
+typedef __m256i vector_int_t;
+#define VECTOR_TRUNCATE(v) _mm256_cvttps_epi32(v)
+#define VECTOR_TO_FLOAT(i) _mm256_cvtepi32_ps(i)
+#define VECTOR_GATHER(table, i) _mm256_i32gather_ps(table, i, 4)
+
+#include "vector_impl.h"
+
+#if defined(__clang__)
+	#pragma clang attribute pop
+#endif
+
+#else
+
+namespace libsignal
+{
+	const VectorKernels *vector_kernels_avx2 = NULL;
+}
+
+#endif
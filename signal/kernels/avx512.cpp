@@ -0,0 +1,61 @@
+#include "kernels.h"
+#include "../fastmath.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*------------------------------------------------------------------------
+ * Compiled for AVX-512 regardless of the compiler's target, and only
+ * selected at runtime if the CPU supports it. Headers with inline
+ * functions are included above, so that they aren't (see vector_impl.h).
+ *-----------------------------------------------------------------------*/
+#if defined(__clang__)
+	#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#else
+	#pragma GCC target ("avx512f")
+
+	/*------------------------------------------------------------------------
+	 * Some GCC releases warn spuriously within their own AVX-512 headers.
+	 *-----------------------------------------------------------------------*/
+	#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include <immintrin.h>
+
+#define SIGNAL_VECTOR_NAME "avx512"
+#define SIGNAL_VECTOR_NAMESPACE avx512
+#define SIGNAL_VECTOR_TABLE vector_kernels_avx512
+#define SIGNAL_VECTOR_WIDTH 16
+
+typedef __m512 vector_t;
+#define VECTOR_LOAD(ptr) _mm512_loadu_ps(ptr)
+#define VECTOR_STORE(ptr, v) _mm512_storeu_ps(ptr, v)
+#define VECTOR_SET1(value) _mm512_set1_ps(value)
+#define VECTOR_ADD(a, b) _mm512_add_ps(a, b)
+#define VECTOR_SUB(a, b) _mm512_sub_ps(a, b)
+#define VECTOR_MUL(a, b) _mm512_mul_ps(a, b)
+#define VECTOR_DIV(a, b) _mm512_div_ps(a, b)
+#define VECTOR_SQRT(v) _mm512_sqrt_ps(v)
+#define VECTOR_MAX(a, b) _mm512_max_ps(a, b)
+#define VECTOR_MIN(a, b) _mm512_min_ps(a, b)
+
+typedef __m512i vector_int_t;
+#define VECTOR_TRUNCATE(v) _mm512_cvttps_epi32(v)
+#define VECTOR_TO_FLOAT(i) _mm512_cvtepi32_ps(i)
+#define VECTOR_GATHER(table, i) _mm512_i32gather_ps(i, table, 4)
+
+#include "vector_impl.h"
+
+#if defined(__clang__)
+	#pragma clang attribute pop
+#endif
+
+#else
+
+namespace libsignal
+{
+	const VectorKernels *vector_kernels_avx512 = NULL;
+}
+
+#endif
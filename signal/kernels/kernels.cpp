@@ -0,0 +1,117 @@
+#include "kernels.h"
+#include "../core.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*------------------------------------------------------------------------
+ * The scalar reference implementation: the generic kernels, with a
+ * vector width of one sample.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_VECTOR_NAME "scalar"
+#define SIGNAL_VECTOR_NAMESPACE scalar
+#define SIGNAL_VECTOR_TABLE vector_kernels_scalar
+#define SIGNAL_VECTOR_WIDTH 1
+
+typedef sample vector_t;
+#define VECTOR_LOAD(ptr) (*(ptr))
+#define VECTOR_STORE(ptr, v) (*(ptr) = (v))
+#define VECTOR_SET1(value) ((sample) (value))
+#define VECTOR_ADD(a, b) ((a) + (b))
+#define VECTOR_SUB(a, b) ((a) - (b))
+#define VECTOR_MUL(a, b) ((a) * (b))
+#define VECTOR_DIV(a, b) ((a) / (b))
+#define VECTOR_SQRT(v) sqrtf(v)
+#define VECTOR_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define VECTOR_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+typedef int vector_int_t;
+#define VECTOR_TRUNCATE(v) ((int) (v))
+#define VECTOR_TO_FLOAT(i) ((sample) (i))
+#define VECTOR_GATHER(table, i) ((table)[i])
+
+#include "vector_impl.h"
+
+namespace libsignal
+{
+
+const VectorKernels *vector_kernels = &scalar::table;
+
+/*------------------------------------------------------------------------
+ * Returns true if the host CPU (and OS) can run the given kernels.
+ *-----------------------------------------------------------------------*/
+static bool vector_kernels_supported(const VectorKernels *kernels)
+{
+	if (!kernels)
+		return false;
+
+	#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+		__builtin_cpu_init();
+		if (kernels == vector_kernels_avx512)
+			return __builtin_cpu_supports("avx512f");
+		if (kernels == vector_kernels_avx2)
+			return __builtin_cpu_supports("avx2");
+		if (kernels == vector_kernels_sse2)
+			return __builtin_cpu_supports("sse2");
+
+	#endif
+
+	/*------------------------------------------------------------------------
+	 * NEON is part of the AArch64 baseline, and the scalar reference
+	 * runs anywhere.
+	 *-----------------------------------------------------------------------*/
+	return true;
+}
+
+void vector_kernels_init()
+{
+	const VectorKernels *candidates[] =
+	{
+		vector_kernels_avx512,
+		vector_kernels_avx2,
+		vector_kernels_sse2,
+		vector_kernels_neon,
+		vector_kernels_scalar
+	};
+
+	/*------------------------------------------------------------------------
+	 * The SIGNAL_SIMD environment variable forces a given implementation
+	 * (for example, SIGNAL_SIMD=sse2), for benchmarking and testing.
+	 *-----------------------------------------------------------------------*/
+	const char *forced = getenv("SIGNAL_SIMD");
+	if (forced && *forced)
+	{
+		for (const VectorKernels *candidate : candidates)
+		{
+			if (candidate && strcmp(candidate->name, forced) == 0)
+			{
+				if (vector_kernels_supported(candidate))
+				{
+					vector_kernels = candidate;
+					signal_debug("Vector kernels: %s (forced by SIGNAL_SIMD)", vector_kernels->name);
+					return;
+				}
+				break;
+			}
+		}
+
+		signal_warn("SIGNAL_SIMD: %s is not available on this host, ignoring", forced);
+	}
+
+	/*------------------------------------------------------------------------
+	 * Otherwise, use the widest implementation that the CPU supports.
+	 *-----------------------------------------------------------------------*/
+	for (const VectorKernels *candidate : candidates)
+	{
+		if (vector_kernels_supported(candidate))
+		{
+			vector_kernels = candidate;
+			break;
+		}
+	}
+
+	signal_debug("Vector kernels: %s", vector_kernels->name);
+}
+
+}
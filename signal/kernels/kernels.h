@@ -0,0 +1,409 @@
+#pragma once
+
+/**-------------------------------------------------------------------------
+ * @file kernels.h
+ * @brief Vectorised buffer arithmetic, with implementations for each
+ *        supported instruction set and a portable scalar reference.
+ *
+ * Every kernel accepts an output buffer that is identical to one of its
+ * input buffers (in-place operation), but not a partial overlap.
+ * Element-wise kernels produce results that are bit-identical to the
+ * scalar reference; only the order of summation in dot(),
+ * sine_bank() and unison() may differ.
+ *-----------------------------------------------------------------------*/
+
+#include "../constants.h"
+
+namespace libsignal
+{
+	/*------------------------------------------------------------------------
+	 * A full set of kernels for one instruction set.
+	 *-----------------------------------------------------------------------*/
+	class VectorKernels
+	{
+		public:
+			const char *name;
+
+			/*------------------------------------------------------------------------
+			 * Number of samples per vector.
+			 *-----------------------------------------------------------------------*/
+			int width;
+
+			void (*fill)(sample *out, sample value, int num_frames);
+			void (*copy)(const sample *in, sample *out, int num_frames);
+
+			void (*add)(const sample *a, const sample *b, sample *out, int num_frames);
+			void (*subtract)(const sample *a, const sample *b, sample *out, int num_frames);
+			void (*multiply)(const sample *a, const sample *b, sample *out, int num_frames);
+			void (*divide)(const sample *a, const sample *b, sample *out, int num_frames);
+
+			void (*add_scalar)(const sample *a, sample b, sample *out, int num_frames);
+			void (*multiply_scalar)(const sample *a, sample b, sample *out, int num_frames);
+			void (*divide_scalar)(const sample *a, sample b, sample *out, int num_frames);
+
+			void (*mac)(const sample *a, const sample *b, sample *out, int num_frames);
+			void (*mac_scalar)(const sample *a, sample b, sample *out, int num_frames);
+			void (*scale_offset)(const sample *in, sample scale, sample offset, sample *out, int num_frames);
+			void (*clip)(const sample *in, sample min, sample max, sample *out, int num_frames);
+			void (*mix)(const sample *a, const sample *b, sample position, sample *out, int num_frames);
+
+			void (*interleave)(sample * const *in, int num_channels, sample *out, int num_frames);
+			void (*deinterleave)(const sample *in, int num_channels, sample **out, int num_frames);
+
+			sample (*dot)(const sample *a, const sample *b, int num_frames);
+
+			void (*sine)(const sample *phase, sample *out, int num_frames);
+
+			void (*table_read)(const sample *table, sample length, const sample *phase, sample *out, int num_frames);
+			void (*table_read_linear)(const sample *table, sample length, const sample *phase, sample *out, int num_frames);
+			void (*table_read_cubic)(const sample *table, sample length, const sample *phase, sample *out, int num_frames);
+
+			void (*sine_bank)(sample *real, sample *imag, const sample *rotation_real, const sample *rotation_imag,
+			                  const sample *amplitude, int num_partials, sample *out, int num_frames);
+
+			void (*unison)(sample *phase, const sample *increment, const sample *gain, int num_voices, int num_channels,
+			               signal_shape_t shape, const sample *frequency, sample **out, int num_frames);
+
+			void (*moog)(const sample *in, const sample *coefficients, int coefficient_stride,
+			             sample *state, int num_lanes, sample *out, int num_frames);
+			void (*eq)(const sample *in, const sample *coefficients, int coefficient_stride,
+			           sample *state, int num_lanes, sample *out, int num_frames);
+			void (*svf)(const sample *in, const sample *coefficients, int coefficient_stride,
+			            sample *state, int num_lanes, sample *out, int num_frames);
+			void (*biquad)(const sample *in, const sample *coefficients, int coefficient_stride,
+			               sample *state, int num_lanes, sample *out, int num_frames);
+
+			void (*fft_radix4)(const sample *in_real, const sample *in_imag, const sample *twiddles,
+			                   int num_groups, int stride, sample *out_real, sample *out_imag);
+			void (*fft_radix2)(const sample *in_real, const sample *in_imag, int stride,
+			                   sample *out_real, sample *out_imag);
+			void (*fft_real_split)(const sample *in_real, const sample *in_imag,
+			                       const sample *rotation_real, const sample *rotation_imag,
+			                       int num_points, sample *out_real, sample *out_imag);
+			void (*fft_polar)(const sample *real, const sample *imag,
+			                  sample *magnitudes, sample *phases, int num_bins);
+			void (*fft_cartesian)(const sample *magnitudes, const sample *phases,
+			                      sample *real, sample *imag, int num_bins);
+			void (*complex_mac)(const sample *a_real, const sample *a_imag,
+			                    const sample *b_real, const sample *b_imag,
+			                    sample *out_real, sample *out_imag, int num_frames);
+			void (*phase_advance)(const sample *phases, const sample *increments, sample *out, int num_bins);
+			void (*spectral_gate)(const sample *magnitudes, sample threshold, sample attack, sample release,
+			                      sample *gain, sample *out, int num_bins);
+	};
+
+	/*------------------------------------------------------------------------
+	 * Implementations compiled into this build. Each x86 implementation is
+	 * built on any x86 target, and NEON on any AArch64 target; those that
+	 * don't apply to this architecture are NULL.
+	 *-----------------------------------------------------------------------*/
+	extern const VectorKernels *vector_kernels_scalar;
+	extern const VectorKernels *vector_kernels_sse2;
+	extern const VectorKernels *vector_kernels_avx2;
+	extern const VectorKernels *vector_kernels_avx512;
+	extern const VectorKernels *vector_kernels_neon;
+
+	/*------------------------------------------------------------------------
+	 * The kernels used by all nodes. Defaults to the scalar reference until
+	 * vector_kernels_init() (called by signal_init()) selects the widest
+	 * implementation that the host CPU supports, or the one named by the
+	 * SIGNAL_SIMD environment variable (scalar, sse2, avx2, avx512, neon).
+	 *-----------------------------------------------------------------------*/
+	extern const VectorKernels *vector_kernels;
+
+	void vector_kernels_init();
+
+	/*------------------------------------------------------------------------
+	 * out[i] = value
+	 *-----------------------------------------------------------------------*/
+	inline void vector_fill(sample *out, sample value, int num_frames)
+	{ vector_kernels->fill(out, value, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * out[i] = in[i]
+	 *-----------------------------------------------------------------------*/
+	inline void vector_copy(const sample *in, sample *out, int num_frames)
+	{ vector_kernels->copy(in, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * out[i] = a[i] (+, -, *, /) b[i]
+	 *-----------------------------------------------------------------------*/
+	inline void vector_add(const sample *a, const sample *b, sample *out, int num_frames)
+	{ vector_kernels->add(a, b, out, num_frames); }
+
+	inline void vector_subtract(const sample *a, const sample *b, sample *out, int num_frames)
+	{ vector_kernels->subtract(a, b, out, num_frames); }
+
+	inline void vector_multiply(const sample *a, const sample *b, sample *out, int num_frames)
+	{ vector_kernels->multiply(a, b, out, num_frames); }
+
+	inline void vector_divide(const sample *a, const sample *b, sample *out, int num_frames)
+	{ vector_kernels->divide(a, b, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * out[i] = a[i] (+, *, /) b
+	 *-----------------------------------------------------------------------*/
+	inline void vector_add_scalar(const sample *a, sample b, sample *out, int num_frames)
+	{ vector_kernels->add_scalar(a, b, out, num_frames); }
+
+	inline void vector_multiply_scalar(const sample *a, sample b, sample *out, int num_frames)
+	{ vector_kernels->multiply_scalar(a, b, out, num_frames); }
+
+	inline void vector_divide_scalar(const sample *a, sample b, sample *out, int num_frames)
+	{ vector_kernels->divide_scalar(a, b, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * Multiply-accumulate: out[i] += a[i] * b[i], or out[i] += a[i] * b
+	 *-----------------------------------------------------------------------*/
+	inline void vector_mac(const sample *a, const sample *b, sample *out, int num_frames)
+	{ vector_kernels->mac(a, b, out, num_frames); }
+
+	inline void vector_mac_scalar(const sample *a, sample b, sample *out, int num_frames)
+	{ vector_kernels->mac_scalar(a, b, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * out[i] = in[i] * scale + offset
+	 *-----------------------------------------------------------------------*/
+	inline void vector_scale_offset(const sample *in, sample scale, sample offset, sample *out, int num_frames)
+	{ vector_kernels->scale_offset(in, scale, offset, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * out[i] = in[i], limited to [min, max]
+	 *-----------------------------------------------------------------------*/
+	inline void vector_clip(const sample *in, sample min, sample max, sample *out, int num_frames)
+	{ vector_kernels->clip(in, min, max, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * Linear crossfade: out[i] = a[i] + (b[i] - a[i]) * position
+	 *-----------------------------------------------------------------------*/
+	inline void vector_mix(const sample *a, const sample *b, sample position, sample *out, int num_frames)
+	{ vector_kernels->mix(a, b, position, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * Convert between per-channel buffers and a single buffer of
+	 * interleaved frames.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_interleave(sample * const *in, int num_channels, sample *out, int num_frames)
+	{ vector_kernels->interleave(in, num_channels, out, num_frames); }
+
+	inline void vector_deinterleave(const sample *in, int num_channels, sample **out, int num_frames)
+	{ vector_kernels->deinterleave(in, num_channels, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * Returns the sum of a[i] * b[i]
+	 *-----------------------------------------------------------------------*/
+	inline sample vector_dot(const sample *a, const sample *b, int num_frames)
+	{ return vector_kernels->dot(a, b, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * out[i] = sin(2 * pi * phase[i]), for phase in [0, 1).
+	 * Accurate to within 1e-7 of the true value.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_sine(const sample *phase, sample *out, int num_frames)
+	{ vector_kernels->sine(phase, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * out[i] = table[phase[i] * length], for phase in [0, 1), without
+	 * interpolation, or with linear or cubic (Catmull-Rom) interpolation.
+	 * The table must be readable from index -1 to length + 1, with the
+	 * samples outside [0, length) wrapping around.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_table_read(const sample *table, sample length, const sample *phase, sample *out, int num_frames)
+	{ vector_kernels->table_read(table, length, phase, out, num_frames); }
+
+	inline void vector_table_read_linear(const sample *table, sample length, const sample *phase, sample *out, int num_frames)
+	{ vector_kernels->table_read_linear(table, length, phase, out, num_frames); }
+
+	inline void vector_table_read_cubic(const sample *table, sample length, const sample *phase, sample *out, int num_frames)
+	{ vector_kernels->table_read_cubic(table, length, phase, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * Oscillator bank: for each frame, adds the sum of amplitude[i] *
+	 * imag[i] to out, then rotates each phasor (real[i], imag[i]) by
+	 * (rotation_real[i], rotation_imag[i]). As with dot(), the order of
+	 * summation may differ between implementations.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_sine_bank(sample *real, sample *imag, const sample *rotation_real, const sample *rotation_imag,
+	                             const sample *amplitude, int num_partials, sample *out, int num_frames)
+	{ vector_kernels->sine_bank(real, imag, rotation_real, rotation_imag, amplitude, num_partials, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * Unison oscillator: a band-limited waveform per voice, at
+	 * (frequency[frame] * increment[voice]) cycles per frame, starting
+	 * from and updating phase[voice]. For each frame, adds the sum of
+	 * gain[channel * num_voices + voice] times each voice to
+	 * out[channel]. At most SIGNAL_UNISON_MAX_VOICES voices.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_unison(sample *phase, const sample *increment, const sample *gain, int num_voices, int num_channels,
+	                          signal_shape_t shape, const sample *frequency, sample **out, int num_frames)
+	{ vector_kernels->unison(phase, increment, gain, num_voices, num_channels, shape, frequency, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * Channel-parallel filters.
+	 *
+	 * Recursive filters can't be vectorised across frames, so these
+	 * process one channel per lane instead. `in` and `out` hold frames of
+	 * `num_lanes` interleaved channels (see vector_interleave_lanes()),
+	 * where num_lanes is a multiple of the vector width.
+	 *
+	 * Each frame's coefficients are rows of num_lanes values, starting
+	 * at coefficients + (frame * coefficient_stride); with a stride of
+	 * 0, one set of coefficients is used for the whole block. Filter
+	 * state is held in rows of SIGNAL_MAX_CHANNELS values, one per lane,
+	 * so that it is unaffected by changes in the number of lanes.
+	 *-----------------------------------------------------------------------*/
+
+	/*------------------------------------------------------------------------
+	 * Moog ladder filter, as MoogVCF.
+	 * Coefficients: f, feedback. State: out1-4, in1-4.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_moog(const sample *in, const sample *coefficients, int coefficient_stride,
+	                        sample *state, int num_lanes, sample *out, int num_frames)
+	{ vector_kernels->moog(in, coefficients, coefficient_stride, state, num_lanes, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * Three-band EQ, as EQ.
+	 * Coefficients: low f, high f, low gain, mid gain, high gain.
+	 * State: low-pass poles 0-3, high-pass poles 0-3, delayed input 1-3.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_eq(const sample *in, const sample *coefficients, int coefficient_stride,
+	                      sample *state, int num_lanes, sample *out, int num_frames)
+	{ vector_kernels->eq(in, coefficients, coefficient_stride, state, num_lanes, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * Linear trapezoidal state-variable filter, as SVF.
+	 * Coefficients: a1, a2, a3, m0, m1, m2. State: ic1eq, ic2eq.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_svf(const sample *in, const sample *coefficients, int coefficient_stride,
+	                       sample *state, int num_lanes, sample *out, int num_frames)
+	{ vector_kernels->svf(in, coefficients, coefficient_stride, state, num_lanes, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * One biquad section (transposed direct form II), as Biquad.
+	 * Coefficients: b0, b1, b2, a1, a2, normalised by a0. State: s1, s2.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_biquad(const sample *in, const sample *coefficients, int coefficient_stride,
+	                          sample *state, int num_lanes, sample *out, int num_frames)
+	{ vector_kernels->biquad(in, coefficients, coefficient_stride, state, num_lanes, out, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * Passes of a Stockham autosort FFT, on complex values held as
+	 * separate real and imaginary arrays. `in` and `out` must not overlap.
+	 *
+	 * fft_radix4: each of `num_groups` groups p reads four runs of
+	 * `stride` values, at in + (p + j * num_groups) * stride for j = 0-3,
+	 * and writes their 4-point DFTs, multiplied by the group's twiddle
+	 * factors, to four adjacent runs at out + (4 * p + j) * stride.
+	 * Twiddles are held as six arrays of `num_groups` values: the real
+	 * and imaginary parts of w1, w2 and w3, where
+	 * wj[p] = exp(-2 pi i j p / (4 * num_groups)).
+	 *
+	 * fft_radix2: the final pass when the size is not a power of four.
+	 * out[q] = in[q] + in[q + stride], out[q + stride] = in[q] - in[q + stride].
+	 *-----------------------------------------------------------------------*/
+	inline void vector_fft_radix4(const sample *in_real, const sample *in_imag, const sample *twiddles,
+	                              int num_groups, int stride, sample *out_real, sample *out_imag)
+	{ vector_kernels->fft_radix4(in_real, in_imag, twiddles, num_groups, stride, out_real, out_imag); }
+
+	inline void vector_fft_radix2(const sample *in_real, const sample *in_imag, int stride,
+	                              sample *out_real, sample *out_imag)
+	{ vector_kernels->fft_radix2(in_real, in_imag, stride, out_real, out_imag); }
+
+	/*------------------------------------------------------------------------
+	 * Converts between the spectrum of a real signal of 2 * num_points
+	 * samples and the transform of the complex signal of num_points
+	 * formed from its even and odd samples, for bins 1 to num_points - 1
+	 * (bin 0 holding DC and Nyquist, which the caller computes).
+	 *
+	 * With Z = in, A = Z[k] + Z*[M-k] and D = Z[k] - Z*[M-k],
+	 * out[k] = A + (c[k] * D.imag - s[k] * D.real, -c[k] * D.real - s[k] * D.imag),
+	 * where c and s are the rotation tables. The tables must satisfy
+	 * c[M-k] = -c[k] and s[M-k] = s[k], and only their first half is read.
+	 * c = cos(pi k / M), s = sin(pi k / M) gives twice the real spectrum
+	 * from Z; negating c gives 4Z back from twice the spectrum. `in` and
+	 * `out` must not overlap.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_fft_real_split(const sample *in_real, const sample *in_imag,
+	                                  const sample *rotation_real, const sample *rotation_imag,
+	                                  int num_points, sample *out_real, sample *out_imag)
+	{ vector_kernels->fft_real_split(in_real, in_imag, rotation_real, rotation_imag, num_points, out_real, out_imag); }
+
+	/*------------------------------------------------------------------------
+	 * Convert between real and imaginary parts and magnitudes and phases,
+	 * with fast_atan2(), fast_sin() and fast_cos(). Buffers may not overlap.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_fft_polar(const sample *real, const sample *imag,
+	                             sample *magnitudes, sample *phases, int num_bins)
+	{ vector_kernels->fft_polar(real, imag, magnitudes, phases, num_bins); }
+
+	inline void vector_fft_cartesian(const sample *magnitudes, const sample *phases,
+	                                 sample *real, sample *imag, int num_bins)
+	{ vector_kernels->fft_cartesian(magnitudes, phases, real, imag, num_bins); }
+
+	/*------------------------------------------------------------------------
+	 * Complex multiply-accumulate, on separate real and imaginary arrays:
+	 * out[i] += a[i] * b[i]. `out` may not overlap `a` or `b`.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_complex_mac(const sample *a_real, const sample *a_imag,
+	                               const sample *b_real, const sample *b_imag,
+	                               sample *out_real, sample *out_imag, int num_frames)
+	{ vector_kernels->complex_mac(a_real, a_imag, b_real, b_imag, out_real, out_imag, num_frames); }
+
+	/*------------------------------------------------------------------------
+	 * out[i] = phases[i] + increments[i], wrapped to [-pi, pi). The sum
+	 * must be within 7 pi of zero.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_phase_advance(const sample *phases, const sample *increments, sample *out, int num_bins)
+	{ vector_kernels->phase_advance(phases, increments, out, num_bins); }
+
+	/*------------------------------------------------------------------------
+	 * Spectral gate with per-bin smoothing. Each bin's gain moves towards
+	 * 1 if its magnitude is at or above `threshold`, or 0 if not, by the
+	 * fraction `attack` of the difference when rising and `release` when
+	 * falling, and out[i] = magnitudes[i] * gain[i]. `gain` may not
+	 * overlap `magnitudes` or `out`.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_spectral_gate(const sample *magnitudes, sample threshold, sample attack, sample release,
+	                                 sample *gain, sample *out, int num_bins)
+	{ vector_kernels->spectral_gate(magnitudes, threshold, attack, release, gain, out, num_bins); }
+
+	/*------------------------------------------------------------------------
+	 * Returns the number of lanes needed to process `num_channels`
+	 * channels in parallel with the current kernels.
+	 *-----------------------------------------------------------------------*/
+	inline int vector_lanes(int num_channels)
+	{
+		int width = vector_kernels->width;
+		return (num_channels + width - 1) / width * width;
+	}
+
+	/*------------------------------------------------------------------------
+	 * Interleave frames [offset, offset + num_frames) of each channel into
+	 * `out`, num_lanes samples per frame. Unused lanes are not written,
+	 * so that callers can zero them once rather than every block.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_interleave_lanes(sample * const *in, int num_channels, int num_lanes, int offset,
+	                                    sample *out, int num_frames)
+	{
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			sample *lanes = out + frame * num_lanes;
+			for (int channel = 0; channel < num_channels; channel++)
+				lanes[channel] = in[channel][offset + frame];
+		}
+	}
+
+	/*------------------------------------------------------------------------
+	 * The reverse of vector_interleave_lanes(). Unused lanes are ignored.
+	 *-----------------------------------------------------------------------*/
+	inline void vector_deinterleave_lanes(const sample *in, int num_channels, int num_lanes,
+	                                      sample **out, int offset, int num_frames)
+	{
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			const sample *lanes = in + frame * num_lanes;
+			for (int channel = 0; channel < num_channels; channel++)
+				out[channel][offset + frame] = lanes[channel];
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#include "kernels.h"
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+
+#include <arm_neon.h>
+
+#define SIGNAL_VECTOR_NAME "neon"
+#define SIGNAL_VECTOR_NAMESPACE neon
+#define SIGNAL_VECTOR_TABLE vector_kernels_neon
+#define SIGNAL_VECTOR_WIDTH 4
+
+/*------------------------------------------------------------------------
+ * Division requires AArch64; 32-bit ARM only has a reciprocal estimate.
+ * NEON min/max propagate NaNs, unlike the scalar reference, but agree
+ * on all other inputs.
+ *-----------------------------------------------------------------------*/
+typedef float32x4_t vector_t;
+#define VECTOR_LOAD(ptr) vld1q_f32(ptr)
+#define VECTOR_STORE(ptr, v) vst1q_f32(ptr, v)
+#define VECTOR_SET1(value) vdupq_n_f32(value)
+#define VECTOR_ADD(a, b) vaddq_f32(a, b)
+#define VECTOR_SUB(a, b) vsubq_f32(a, b)
+#define VECTOR_MUL(a, b) vmulq_f32(a, b)
+#define VECTOR_DIV(a, b) vdivq_f32(a, b)
+#define VECTOR_SQRT(v) vsqrtq_f32(v)
+#define VECTOR_MAX(a, b) vmaxq_f32(a, b)
+#define VECTOR_MIN(a, b) vminq_f32(a, b)
+
+/*------------------------------------------------------------------------
+ * NEON has no gather instruction, so gathers are made lane by lane.
+ *-----------------------------------------------------------------------*/
+static inline float32x4_t neon_gather(const float *table, int32x4_t indices)
+{
+	int lanes[4];
+	vst1q_s32(lanes, indices);
+	float values[4] = { table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]] };
+	return vld1q_f32(values);
+}
+
+typedef int32x4_t vector_int_t;
+#define VECTOR_TRUNCATE(v) vcvtq_s32_f32(v)
+#define VECTOR_TO_FLOAT(i) vcvtq_f32_s32(i)
+#define VECTOR_GATHER(table, i) neon_gather(table, i)
+
+#include "vector_impl.h"
+
+#else
+
+namespace libsignal
+{
+	const VectorKernels *vector_kernels_neon = NULL;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include "kernels.h"
+#include "../fastmath.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*------------------------------------------------------------------------
+ * Compiled for SSE2 regardless of the compiler's target, and only
+ * selected at runtime if the CPU supports it. Headers with inline
+ * functions are included above, so that they aren't (see vector_impl.h).
+ *-----------------------------------------------------------------------*/
+#if defined(__clang__)
+	#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#else
+	#pragma GCC target ("sse2")
+#endif
+
+#include <emmintrin.h>
+
+#define SIGNAL_VECTOR_NAME "sse2"
+#define SIGNAL_VECTOR_NAMESPACE sse2
+#define SIGNAL_VECTOR_TABLE vector_kernels_sse2
+#define SIGNAL_VECTOR_WIDTH 4
+
+typedef __m128 vector_t;
+#define VECTOR_LOAD(ptr) _mm_loadu_ps(ptr)
+#define VECTOR_STORE(ptr, v) _mm_storeu_ps(ptr, v)
+#define VECTOR_SET1(value) _mm_set1_ps(value)
+#define VECTOR_ADD(a, b) _mm_add_ps(a, b)
+#define VECTOR_SUB(a, b) _mm_sub_ps(a, b)
+#define VECTOR_MUL(a, b) _mm_mul_ps(a, b)
+#define VECTOR_DIV(a, b) _mm_div_ps(a, b)
+#define VECTOR_SQRT(v) _mm_sqrt_ps(v)
+#define VECTOR_MAX(a, b) _mm_max_ps(a, b)
+#define VECTOR_MIN(a, b) _mm_min_ps(a, b)
+
+/*------------------------------------------------------------------------
+ * SSE2 has no gather instruction, so gathers are made lane by lane.
+ *-----------------------------------------------------------------------*/
+static inline __m128 sse2_gather(const float *table, __m128i indices)
+{
+	int lanes[4];
+	_mm_storeu_si128((__m128i *) lanes, indices);
+	return _mm_setr_ps(table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]]);
+}
+
+typedef __m128i vector_int_t;
+#define VECTOR_TRUNCATE(v) _mm_cvttps_epi32(v)
+#define VECTOR_TO_FLOAT(i) _mm_cvtepi32_ps(i)
+#define VECTOR_GATHER(table, i) sse2_gather(table, i)
+
+#include "vector_impl.h"
+
+#if defined(__clang__)
+	#pragma clang attribute pop
+#endif
+
+#else
+
+namespace libsignal
+{
+	const VectorKernels *vector_kernels_sse2 = NULL;
+}
+
+#endif
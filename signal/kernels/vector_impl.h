@@ -0,0 +1,1067 @@
+/**-------------------------------------------------------------------------
+ * @file vector_impl.h
+ * @brief Generic kernel bodies, shared by each instruction set.
+ *
+ * Not a public header: included once by each per-ISA source file, after
+ * defining the vector type and primitive operations below. The file
+ * then defines a VectorKernels table named SIGNAL_VECTOR_TABLE.
+ *
+ *   SIGNAL_VECTOR_NAME          name of the instruction set
+ *   SIGNAL_VECTOR_NAMESPACE     namespace to hold this implementation
+ *   SIGNAL_VECTOR_TABLE         identifier of the table to define
+ *   SIGNAL_VECTOR_WIDTH         number of samples per vector
+ *   vector_t                    the vector type
+ *   VECTOR_LOAD(ptr)            unaligned load
+ *   VECTOR_STORE(ptr, v)        unaligned store
+ *   VECTOR_SET1(value)          broadcast a scalar
+ *   VECTOR_ADD, VECTOR_SUB,
+ *   VECTOR_MUL, VECTOR_DIV      element-wise arithmetic
+ *   VECTOR_SQRT(v)              square root
+ *   VECTOR_MAX(a, b)            a > b ? a : b
+ *   VECTOR_MIN(a, b)            a < b ? a : b
+ *   vector_int_t                a vector of 32-bit integers
+ *   VECTOR_TRUNCATE(v)          convert to integers, rounding to zero
+ *   VECTOR_TO_FLOAT(i)          convert integers to samples
+ *   VECTOR_GATHER(table, i)     table[i] for each lane
+ *
+ * Tails shorter than one vector are processed with the same operations
+ * in scalar form, so that results match the scalar reference exactly.
+ *
+ * Headers with inline functions, such as fastmath.h, must be included
+ * before the instruction set is enabled. An inline function is compiled
+ * in every file that uses it, and the linker keeps any one copy, so a
+ * copy compiled for AVX2 could be called on a CPU without it.
+ *-----------------------------------------------------------------------*/
+
+#include "../fastmath.h"
+
+#include <math.h>
+
+/*------------------------------------------------------------------------
+ * Instruction sets that include FMA (AVX-512, NEON) would otherwise let
+ * the compiler contract multiplies and adds, changing their rounding.
+ *-----------------------------------------------------------------------*/
+#if defined(__clang__)
+	#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+	#pragma GCC optimize ("fp-contract=off")
+#endif
+
+namespace libsignal
+{
+namespace SIGNAL_VECTOR_NAMESPACE
+{
+
+static void fill(sample *out, sample value, int num_frames)
+{
+	vector_t v = VECTOR_SET1(value);
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+		VECTOR_STORE(out + frame, v);
+	for (; frame < num_frames; frame++)
+		out[frame] = value;
+}
+
+static void copy(const sample *in, sample *out, int num_frames)
+{
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+		VECTOR_STORE(out + frame, VECTOR_LOAD(in + frame));
+	for (; frame < num_frames; frame++)
+		out[frame] = in[frame];
+}
+
+/*------------------------------------------------------------------------
+ * Element-wise binary operators, vector (op) vector and vector (op) scalar.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_VECTOR_BINARY(NAME, VECTOR_OP, OPERATOR) \
+	static void NAME(const sample *a, const sample *b, sample *out, int num_frames) \
+	{ \
+		int frame = 0; \
+		for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH) \
+			VECTOR_STORE(out + frame, VECTOR_OP(VECTOR_LOAD(a + frame), VECTOR_LOAD(b + frame))); \
+		for (; frame < num_frames; frame++) \
+			out[frame] = a[frame] OPERATOR b[frame]; \
+	}
+
+#define SIGNAL_VECTOR_BINARY_SCALAR(NAME, VECTOR_OP, OPERATOR) \
+	static void NAME(const sample *a, sample b, sample *out, int num_frames) \
+	{ \
+		vector_t vb = VECTOR_SET1(b); \
+		int frame = 0; \
+		for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH) \
+			VECTOR_STORE(out + frame, VECTOR_OP(VECTOR_LOAD(a + frame), vb)); \
+		for (; frame < num_frames; frame++) \
+			out[frame] = a[frame] OPERATOR b; \
+	}
+
+SIGNAL_VECTOR_BINARY(add, VECTOR_ADD, +)
+SIGNAL_VECTOR_BINARY(subtract, VECTOR_SUB, -)
+SIGNAL_VECTOR_BINARY(multiply, VECTOR_MUL, *)
+SIGNAL_VECTOR_BINARY(divide, VECTOR_DIV, /)
+
+SIGNAL_VECTOR_BINARY_SCALAR(add_scalar, VECTOR_ADD, +)
+SIGNAL_VECTOR_BINARY_SCALAR(multiply_scalar, VECTOR_MUL, *)
+SIGNAL_VECTOR_BINARY_SCALAR(divide_scalar, VECTOR_DIV, /)
+
+#undef SIGNAL_VECTOR_BINARY
+#undef SIGNAL_VECTOR_BINARY_SCALAR
+
+/*------------------------------------------------------------------------
+ * Multiplies and adds are kept as separate operations (rather than
+ * fused) so that rounding matches the scalar reference.
+ *-----------------------------------------------------------------------*/
+static void mac(const sample *a, const sample *b, sample *out, int num_frames)
+{
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t product = VECTOR_MUL(VECTOR_LOAD(a + frame), VECTOR_LOAD(b + frame));
+		VECTOR_STORE(out + frame, VECTOR_ADD(VECTOR_LOAD(out + frame), product));
+	}
+	for (; frame < num_frames; frame++)
+		out[frame] += a[frame] * b[frame];
+}
+
+static void mac_scalar(const sample *a, sample b, sample *out, int num_frames)
+{
+	vector_t vb = VECTOR_SET1(b);
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t product = VECTOR_MUL(VECTOR_LOAD(a + frame), vb);
+		VECTOR_STORE(out + frame, VECTOR_ADD(VECTOR_LOAD(out + frame), product));
+	}
+	for (; frame < num_frames; frame++)
+		out[frame] += a[frame] * b;
+}
+
+static void scale_offset(const sample *in, sample scale, sample offset, sample *out, int num_frames)
+{
+	vector_t vscale = VECTOR_SET1(scale);
+	vector_t voffset = VECTOR_SET1(offset);
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+		VECTOR_STORE(out + frame, VECTOR_ADD(VECTOR_MUL(VECTOR_LOAD(in + frame), vscale), voffset));
+	for (; frame < num_frames; frame++)
+		out[frame] = in[frame] * scale + offset;
+}
+
+static void clip(const sample *in, sample min, sample max, sample *out, int num_frames)
+{
+	vector_t vmin = VECTOR_SET1(min);
+	vector_t vmax = VECTOR_SET1(max);
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+		VECTOR_STORE(out + frame, VECTOR_MIN(VECTOR_MAX(VECTOR_LOAD(in + frame), vmin), vmax));
+	for (; frame < num_frames; frame++)
+	{
+		sample value = in[frame] > min ? in[frame] : min;
+		out[frame] = value < max ? value : max;
+	}
+}
+
+static void mix(const sample *a, const sample *b, sample position, sample *out, int num_frames)
+{
+	vector_t vposition = VECTOR_SET1(position);
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t va = VECTOR_LOAD(a + frame);
+		vector_t difference = VECTOR_SUB(VECTOR_LOAD(b + frame), va);
+		VECTOR_STORE(out + frame, VECTOR_ADD(va, VECTOR_MUL(difference, vposition)));
+	}
+	for (; frame < num_frames; frame++)
+		out[frame] = a[frame] + (b[frame] - a[frame]) * position;
+}
+
+/*------------------------------------------------------------------------
+ * Interleaving is bound by memory bandwidth rather than arithmetic, so
+ * is left to the compiler to vectorise, with the common mono and
+ * stereo cases unrolled.
+ *-----------------------------------------------------------------------*/
+static void interleave(sample * const *in, int num_channels, sample *out, int num_frames)
+{
+	if (num_channels == 1)
+	{
+		copy(in[0], out, num_frames);
+	}
+	else if (num_channels == 2)
+	{
+		const sample *left = in[0];
+		const sample *right = in[1];
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			out[frame * 2] = left[frame];
+			out[frame * 2 + 1] = right[frame];
+		}
+	}
+	else
+	{
+		for (int frame = 0; frame < num_frames; frame++)
+			for (int channel = 0; channel < num_channels; channel++)
+				out[frame * num_channels + channel] = in[channel][frame];
+	}
+}
+
+static void deinterleave(const sample *in, int num_channels, sample **out, int num_frames)
+{
+	if (num_channels == 1)
+	{
+		copy(in, out[0], num_frames);
+	}
+	else if (num_channels == 2)
+	{
+		sample *left = out[0];
+		sample *right = out[1];
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			left[frame] = in[frame * 2];
+			right[frame] = in[frame * 2 + 1];
+		}
+	}
+	else
+	{
+		for (int frame = 0; frame < num_frames; frame++)
+			for (int channel = 0; channel < num_channels; channel++)
+				out[channel][frame] = in[frame * num_channels + channel];
+	}
+}
+
+static sample dot(const sample *a, const sample *b, int num_frames)
+{
+	vector_t sum = VECTOR_SET1(0.0);
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+		sum = VECTOR_ADD(sum, VECTOR_MUL(VECTOR_LOAD(a + frame), VECTOR_LOAD(b + frame)));
+
+	sample lanes[SIGNAL_VECTOR_WIDTH];
+	VECTOR_STORE(lanes, sum);
+
+	sample rv = 0.0;
+	for (int lane = 0; lane < SIGNAL_VECTOR_WIDTH; lane++)
+		rv += lanes[lane];
+	for (; frame < num_frames; frame++)
+		rv += a[frame] * b[frame];
+	return rv;
+}
+
+/*------------------------------------------------------------------------
+ * Sine of a phase in [0, 1). The phase is offset by half a cycle, to
+ * [-0.5, 0.5), and folded into the quarter-cycle [-0.25, 0.25] using
+ * min/max. sin(2 pi z) is then evaluated with its Taylor series to
+ * degree 11, whose error over the quarter-cycle is below 6e-8.
+ * Coefficients are negated to undo the half-cycle offset.
+ *
+ * A partial vector at the end of the buffer is padded and processed
+ * with the same operations.
+ *-----------------------------------------------------------------------*/
+static inline vector_t sine_vector(vector_t phase)
+{
+	vector_t half = VECTOR_SET1(0.5);
+	vector_t y = VECTOR_SUB(phase, half);
+	vector_t z = VECTOR_MIN(y, VECTOR_SUB(half, y));
+	z = VECTOR_MAX(z, VECTOR_SUB(VECTOR_SET1(-0.5), z));
+
+	vector_t z2 = VECTOR_MUL(z, z);
+	vector_t p = VECTOR_SET1(1.509464258e+01);
+	p = VECTOR_ADD(VECTOR_MUL(p, z2), VECTOR_SET1(-4.205869394e+01));
+	p = VECTOR_ADD(VECTOR_MUL(p, z2), VECTOR_SET1(7.670585975e+01));
+	p = VECTOR_ADD(VECTOR_MUL(p, z2), VECTOR_SET1(-8.160524928e+01));
+	p = VECTOR_ADD(VECTOR_MUL(p, z2), VECTOR_SET1(4.134170224e+01));
+	p = VECTOR_ADD(VECTOR_MUL(p, z2), VECTOR_SET1(-6.283185307e+00));
+	return VECTOR_MUL(p, z);
+}
+
+/*------------------------------------------------------------------------
+ * Load fewer than SIGNAL_VECTOR_WIDTH samples, padded with zeros, and
+ * store the corresponding lanes of a vector.
+ *-----------------------------------------------------------------------*/
+static inline vector_t load_partial(const sample *in, int count)
+{
+	if (count == SIGNAL_VECTOR_WIDTH)
+		return VECTOR_LOAD(in);
+
+	sample lanes[SIGNAL_VECTOR_WIDTH] = { 0 };
+	for (int lane = 0; lane < count; lane++)
+		lanes[lane] = in[lane];
+	return VECTOR_LOAD(lanes);
+}
+
+static inline void store_partial(sample *out, vector_t v, int count)
+{
+	if (count == SIGNAL_VECTOR_WIDTH)
+	{
+		VECTOR_STORE(out, v);
+		return;
+	}
+
+	sample lanes[SIGNAL_VECTOR_WIDTH];
+	VECTOR_STORE(lanes, v);
+	for (int lane = 0; lane < count; lane++)
+		out[lane] = lanes[lane];
+}
+
+static void sine(const sample *phase, sample *out, int num_frames)
+{
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+		VECTOR_STORE(out + frame, sine_vector(VECTOR_LOAD(phase + frame)));
+
+	if (frame < num_frames)
+		store_partial(out + frame, sine_vector(load_partial(phase + frame, num_frames - frame)), num_frames - frame);
+}
+
+/*------------------------------------------------------------------------
+ * Read a periodic table at (phase * length), with no, linear or
+ * cubic (Catmull-Rom) interpolation. A phase of zero is always a
+ * valid index, so partial vectors are padded with zeros.
+ *-----------------------------------------------------------------------*/
+static inline vector_t table_read_vector(const sample *table, vector_t index)
+{
+	return VECTOR_GATHER(table, VECTOR_TRUNCATE(index));
+}
+
+static inline vector_t table_read_linear_vector(const sample *table, vector_t index)
+{
+	vector_int_t whole = VECTOR_TRUNCATE(index);
+	vector_t frac = VECTOR_SUB(index, VECTOR_TO_FLOAT(whole));
+	vector_t y0 = VECTOR_GATHER(table, whole);
+	vector_t y1 = VECTOR_GATHER(table + 1, whole);
+	return VECTOR_ADD(y0, VECTOR_MUL(VECTOR_SUB(y1, y0), frac));
+}
+
+static inline vector_t table_read_cubic_vector(const sample *table, vector_t index)
+{
+	vector_int_t whole = VECTOR_TRUNCATE(index);
+	vector_t frac = VECTOR_SUB(index, VECTOR_TO_FLOAT(whole));
+	vector_t y0 = VECTOR_GATHER(table - 1, whole);
+	vector_t y1 = VECTOR_GATHER(table, whole);
+	vector_t y2 = VECTOR_GATHER(table + 1, whole);
+	vector_t y3 = VECTOR_GATHER(table + 2, whole);
+
+	vector_t half = VECTOR_SET1(0.5);
+	vector_t c1 = VECTOR_MUL(half, VECTOR_SUB(y2, y0));
+	vector_t c2 = VECTOR_SUB(VECTOR_ADD(VECTOR_SUB(y0, VECTOR_MUL(VECTOR_SET1(2.5), y1)),
+	                                    VECTOR_MUL(VECTOR_SET1(2.0), y2)),
+	                         VECTOR_MUL(half, y3));
+	vector_t c3 = VECTOR_ADD(VECTOR_MUL(half, VECTOR_SUB(y3, y0)),
+	                         VECTOR_MUL(VECTOR_SET1(1.5), VECTOR_SUB(y1, y2)));
+
+	vector_t rv = VECTOR_ADD(VECTOR_MUL(c3, frac), c2);
+	rv = VECTOR_ADD(VECTOR_MUL(rv, frac), c1);
+	return VECTOR_ADD(VECTOR_MUL(rv, frac), y1);
+}
+
+static void table_read(const sample *table, sample length, const sample *phase, sample *out, int num_frames)
+{
+	vector_t scale = VECTOR_SET1(length);
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+		VECTOR_STORE(out + frame, table_read_vector(table, VECTOR_MUL(VECTOR_LOAD(phase + frame), scale)));
+
+	if (frame < num_frames)
+	{
+		vector_t index = VECTOR_MUL(load_partial(phase + frame, num_frames - frame), scale);
+		store_partial(out + frame, table_read_vector(table, index), num_frames - frame);
+	}
+}
+
+static void table_read_linear(const sample *table, sample length, const sample *phase, sample *out, int num_frames)
+{
+	vector_t scale = VECTOR_SET1(length);
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+		VECTOR_STORE(out + frame, table_read_linear_vector(table, VECTOR_MUL(VECTOR_LOAD(phase + frame), scale)));
+
+	if (frame < num_frames)
+	{
+		vector_t index = VECTOR_MUL(load_partial(phase + frame, num_frames - frame), scale);
+		store_partial(out + frame, table_read_linear_vector(table, index), num_frames - frame);
+	}
+}
+
+static void table_read_cubic(const sample *table, sample length, const sample *phase, sample *out, int num_frames)
+{
+	vector_t scale = VECTOR_SET1(length);
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+		VECTOR_STORE(out + frame, table_read_cubic_vector(table, VECTOR_MUL(VECTOR_LOAD(phase + frame), scale)));
+
+	if (frame < num_frames)
+	{
+		vector_t index = VECTOR_MUL(load_partial(phase + frame, num_frames - frame), scale);
+		store_partial(out + frame, table_read_cubic_vector(table, index), num_frames - frame);
+	}
+}
+
+/*------------------------------------------------------------------------
+ * A bank of sinusoidal oscillators, each a complex phasor that is
+ * rotated once per frame. Partials are processed a vector at a time,
+ * holding their state in registers over a chunk of frames, and their
+ * contributions to each frame are summed across lanes at the end of
+ * each chunk.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_SINE_BANK_CHUNK 64
+
+static void sine_bank(sample *real, sample *imag, const sample *rotation_real, const sample *rotation_imag,
+                      const sample *amplitude, int num_partials, sample *out, int num_frames)
+{
+	vector_t sums[SIGNAL_SINE_BANK_CHUNK];
+
+	for (int offset = 0; offset < num_frames; offset += SIGNAL_SINE_BANK_CHUNK)
+	{
+		int chunk = (num_frames - offset < SIGNAL_SINE_BANK_CHUNK) ? num_frames - offset : SIGNAL_SINE_BANK_CHUNK;
+		for (int frame = 0; frame < chunk; frame++)
+			sums[frame] = VECTOR_SET1(0.0);
+
+		for (int partial = 0; partial < num_partials; partial += SIGNAL_VECTOR_WIDTH)
+		{
+			int count = (num_partials - partial < SIGNAL_VECTOR_WIDTH) ? num_partials - partial : SIGNAL_VECTOR_WIDTH;
+			vector_t re = load_partial(real + partial, count);
+			vector_t im = load_partial(imag + partial, count);
+			vector_t step_re = load_partial(rotation_real + partial, count);
+			vector_t step_im = load_partial(rotation_imag + partial, count);
+			vector_t gain = load_partial(amplitude + partial, count);
+
+			for (int frame = 0; frame < chunk; frame++)
+			{
+				sums[frame] = VECTOR_ADD(sums[frame], VECTOR_MUL(gain, im));
+				vector_t next_re = VECTOR_SUB(VECTOR_MUL(re, step_re), VECTOR_MUL(im, step_im));
+				im = VECTOR_ADD(VECTOR_MUL(re, step_im), VECTOR_MUL(im, step_re));
+				re = next_re;
+			}
+
+			store_partial(real + partial, re, count);
+			store_partial(imag + partial, im, count);
+		}
+
+		for (int frame = 0; frame < chunk; frame++)
+		{
+			sample lanes[SIGNAL_VECTOR_WIDTH];
+			VECTOR_STORE(lanes, sums[frame]);
+			sample total = 0.0;
+			for (int lane = 0; lane < SIGNAL_VECTOR_WIDTH; lane++)
+				total += lanes[lane];
+			out[offset + frame] += total;
+		}
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Unison: each lane is one voice. PolyBLEP and PolyBLAMP residuals
+ * (see oscillators/polyblep.h) are written in terms of the distance
+ * into the correction region either side of the discontinuity,
+ * clamped at zero, so that they need no compares.
+ *-----------------------------------------------------------------------*/
+static inline vector_t abs_vector(vector_t v)
+{
+	return VECTOR_MAX(v, VECTOR_SUB(VECTOR_SET1(0.0), v));
+}
+
+static inline vector_t floor_vector(vector_t v)
+{
+	return VECTOR_TO_FLOAT(VECTOR_TRUNCATE(v));
+}
+
+/*------------------------------------------------------------------------
+ * Wrap a phase in (-1, 2) into [0, 1).
+ *-----------------------------------------------------------------------*/
+static inline vector_t wrap_vector(vector_t phase)
+{
+	vector_t shifted = VECTOR_ADD(phase, VECTOR_SET1(1.0));
+	return VECTOR_SUB(shifted, floor_vector(shifted));
+}
+
+static inline vector_t poly_blep_vector(vector_t t, vector_t inverse_dt)
+{
+	vector_t one = VECTOR_SET1(1.0);
+	vector_t zero = VECTOR_SET1(0.0);
+	vector_t after = VECTOR_MAX(zero, VECTOR_SUB(one, VECTOR_MUL(t, inverse_dt)));
+	vector_t before = VECTOR_MAX(zero, VECTOR_SUB(one, VECTOR_MUL(VECTOR_SUB(one, t), inverse_dt)));
+	return VECTOR_SUB(VECTOR_MUL(before, before), VECTOR_MUL(after, after));
+}
+
+static inline vector_t poly_blamp_vector(vector_t t, vector_t inverse_dt)
+{
+	vector_t one = VECTOR_SET1(1.0);
+	vector_t zero = VECTOR_SET1(0.0);
+	vector_t after = VECTOR_MAX(zero, VECTOR_SUB(one, VECTOR_MUL(t, inverse_dt)));
+	vector_t before = VECTOR_MAX(zero, VECTOR_SUB(one, VECTOR_MUL(VECTOR_SUB(one, t), inverse_dt)));
+	vector_t cubes = VECTOR_ADD(VECTOR_MUL(VECTOR_MUL(after, after), after),
+	                            VECTOR_MUL(VECTOR_MUL(before, before), before));
+	return VECTOR_MUL(cubes, VECTOR_SET1(1.0 / 3.0));
+}
+
+static inline vector_t unison_vector(signal_shape_t shape, vector_t t, vector_t dt)
+{
+	vector_t one = VECTOR_SET1(1.0);
+	vector_t inverse_dt = VECTOR_DIV(one, dt);
+
+	if (shape == SIGNAL_SHAPE_SAW)
+	{
+		vector_t naive = VECTOR_SUB(VECTOR_ADD(t, t), one);
+		return VECTOR_SUB(naive, poly_blep_vector(t, inverse_dt));
+	}
+
+	vector_t opposite = wrap_vector(VECTOR_ADD(t, VECTOR_SET1(0.5)));
+	if (shape == SIGNAL_SHAPE_SQUARE)
+	{
+		vector_t naive = VECTOR_SUB(one, VECTOR_MUL(VECTOR_SET1(2.0), floor_vector(VECTOR_ADD(t, t))));
+		vector_t correction = VECTOR_SUB(poly_blep_vector(t, inverse_dt), poly_blep_vector(opposite, inverse_dt));
+		return VECTOR_ADD(naive, correction);
+	}
+
+	vector_t naive = VECTOR_SUB(one, VECTOR_MUL(VECTOR_SET1(4.0), abs_vector(VECTOR_SUB(t, VECTOR_SET1(0.5)))));
+	vector_t correction = VECTOR_SUB(poly_blamp_vector(t, inverse_dt), poly_blamp_vector(opposite, inverse_dt));
+	return VECTOR_ADD(naive, VECTOR_MUL(VECTOR_MUL(VECTOR_SET1(4.0), dt), correction));
+}
+
+#define SIGNAL_UNISON_GROUPS ((SIGNAL_UNISON_MAX_VOICES + SIGNAL_VECTOR_WIDTH - 1) / SIGNAL_VECTOR_WIDTH)
+
+static void unison(sample *phase, const sample *increment, const sample *gain, int num_voices, int num_channels,
+                   signal_shape_t shape, const sample *frequency, sample **out, int num_frames)
+{
+	/*------------------------------------------------------------------------
+	 * Voice state and gains are held in vectors for the whole block.
+	 * Unused lanes have zero gain. The smallest phase increment is
+	 * clamped, so that silent lanes do not divide by zero.
+	 *-----------------------------------------------------------------------*/
+	vector_t phases[SIGNAL_UNISON_GROUPS];
+	vector_t increments[SIGNAL_UNISON_GROUPS];
+	vector_t gains[SIGNAL_MAX_CHANNELS][SIGNAL_UNISON_GROUPS];
+	vector_t values[SIGNAL_UNISON_GROUPS];
+
+	num_voices = (num_voices < SIGNAL_UNISON_MAX_VOICES) ? num_voices : SIGNAL_UNISON_MAX_VOICES;
+	num_channels = (num_channels < SIGNAL_MAX_CHANNELS) ? num_channels : SIGNAL_MAX_CHANNELS;
+	int num_groups = (num_voices + SIGNAL_VECTOR_WIDTH - 1) / SIGNAL_VECTOR_WIDTH;
+	for (int group = 0; group < num_groups; group++)
+	{
+		int voice = group * SIGNAL_VECTOR_WIDTH;
+		int count = (num_voices - voice < SIGNAL_VECTOR_WIDTH) ? num_voices - voice : SIGNAL_VECTOR_WIDTH;
+		phases[group] = load_partial(phase + voice, count);
+		increments[group] = load_partial(increment + voice, count);
+		for (int channel = 0; channel < num_channels; channel++)
+			gains[channel][group] = load_partial(gain + channel * num_voices + voice, count);
+	}
+
+	vector_t min_dt = VECTOR_SET1(1e-9);
+	for (int frame = 0; frame < num_frames; frame++)
+	{
+		vector_t f = VECTOR_SET1(frequency[frame]);
+		for (int group = 0; group < num_groups; group++)
+		{
+			vector_t step = VECTOR_MUL(f, increments[group]);
+			vector_t dt = VECTOR_MAX(abs_vector(step), min_dt);
+			values[group] = unison_vector(shape, phases[group], dt);
+			phases[group] = wrap_vector(VECTOR_ADD(phases[group], step));
+		}
+
+		for (int channel = 0; channel < num_channels; channel++)
+		{
+			vector_t sum = VECTOR_MUL(gains[channel][0], values[0]);
+			for (int group = 1; group < num_groups; group++)
+				sum = VECTOR_ADD(sum, VECTOR_MUL(gains[channel][group], values[group]));
+
+			sample lanes[SIGNAL_VECTOR_WIDTH];
+			VECTOR_STORE(lanes, sum);
+			sample total = 0.0;
+			for (int lane = 0; lane < SIGNAL_VECTOR_WIDTH; lane++)
+				total += lanes[lane];
+			out[channel][frame] += total;
+		}
+	}
+
+	for (int group = 0; group < num_groups; group++)
+	{
+		int voice = group * SIGNAL_VECTOR_WIDTH;
+		int count = (num_voices - voice < SIGNAL_VECTOR_WIDTH) ? num_voices - voice : SIGNAL_VECTOR_WIDTH;
+		store_partial(phase + voice, phases[group], count);
+	}
+}
+
+#undef SIGNAL_UNISON_GROUPS
+
+/*------------------------------------------------------------------------
+ * Channel-parallel filters. Each group of lanes keeps its state in
+ * registers for the whole block.
+ *-----------------------------------------------------------------------*/
+static void moog(const sample *in, const sample *coefficients, int coefficient_stride,
+                 sample *state, int num_lanes, sample *out, int num_frames)
+{
+	vector_t one = VECTOR_SET1(1.0);
+	vector_t feedforward = VECTOR_SET1(0.3);
+
+	for (int lane = 0; lane < num_lanes; lane += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t out1 = VECTOR_LOAD(state + 0 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t out2 = VECTOR_LOAD(state + 1 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t out3 = VECTOR_LOAD(state + 2 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t out4 = VECTOR_LOAD(state + 3 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t in1 = VECTOR_LOAD(state + 4 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t in2 = VECTOR_LOAD(state + 5 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t in3 = VECTOR_LOAD(state + 6 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t in4 = VECTOR_LOAD(state + 7 * SIGNAL_MAX_CHANNELS + lane);
+
+		vector_t feedback = one, gain = one, damping = one;
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			if (frame == 0 || coefficient_stride)
+			{
+				const sample *row = coefficients + frame * coefficient_stride + lane;
+				vector_t f = VECTOR_LOAD(row);
+				vector_t f2 = VECTOR_MUL(f, f);
+				feedback = VECTOR_LOAD(row + num_lanes);
+				gain = VECTOR_MUL(VECTOR_MUL(VECTOR_SET1(0.35013), f2), f2);
+				damping = VECTOR_SUB(one, f);
+			}
+
+			vector_t input = VECTOR_LOAD(in + frame * num_lanes + lane);
+			input = VECTOR_MUL(VECTOR_SUB(input, VECTOR_MUL(out4, feedback)), gain);
+
+			out1 = VECTOR_ADD(VECTOR_ADD(input, VECTOR_MUL(feedforward, in1)), VECTOR_MUL(damping, out1));
+			in1 = input;
+			out2 = VECTOR_ADD(VECTOR_ADD(out1, VECTOR_MUL(feedforward, in2)), VECTOR_MUL(damping, out2));
+			in2 = out1;
+			out3 = VECTOR_ADD(VECTOR_ADD(out2, VECTOR_MUL(feedforward, in3)), VECTOR_MUL(damping, out3));
+			in3 = out2;
+			out4 = VECTOR_ADD(VECTOR_ADD(out3, VECTOR_MUL(feedforward, in4)), VECTOR_MUL(damping, out4));
+			in4 = out3;
+
+			VECTOR_STORE(out + frame * num_lanes + lane, out4);
+		}
+
+		VECTOR_STORE(state + 0 * SIGNAL_MAX_CHANNELS + lane, out1);
+		VECTOR_STORE(state + 1 * SIGNAL_MAX_CHANNELS + lane, out2);
+		VECTOR_STORE(state + 2 * SIGNAL_MAX_CHANNELS + lane, out3);
+		VECTOR_STORE(state + 3 * SIGNAL_MAX_CHANNELS + lane, out4);
+		VECTOR_STORE(state + 4 * SIGNAL_MAX_CHANNELS + lane, in1);
+		VECTOR_STORE(state + 5 * SIGNAL_MAX_CHANNELS + lane, in2);
+		VECTOR_STORE(state + 6 * SIGNAL_MAX_CHANNELS + lane, in3);
+		VECTOR_STORE(state + 7 * SIGNAL_MAX_CHANNELS + lane, in4);
+	}
+}
+
+static void eq(const sample *in, const sample *coefficients, int coefficient_stride,
+               sample *state, int num_lanes, sample *out, int num_frames)
+{
+	for (int lane = 0; lane < num_lanes; lane += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t poles[8];
+		for (int pole = 0; pole < 8; pole++)
+			poles[pole] = VECTOR_LOAD(state + pole * SIGNAL_MAX_CHANNELS + lane);
+		vector_t sdm1 = VECTOR_LOAD(state + 8 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t sdm2 = VECTOR_LOAD(state + 9 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t sdm3 = VECTOR_LOAD(state + 10 * SIGNAL_MAX_CHANNELS + lane);
+
+		vector_t lf = sdm1, hf = sdm1, low_gain = sdm1, mid_gain = sdm1, high_gain = sdm1;
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			if (frame == 0 || coefficient_stride)
+			{
+				const sample *row = coefficients + frame * coefficient_stride + lane;
+				lf = VECTOR_LOAD(row);
+				hf = VECTOR_LOAD(row + num_lanes);
+				low_gain = VECTOR_LOAD(row + 2 * num_lanes);
+				mid_gain = VECTOR_LOAD(row + 3 * num_lanes);
+				high_gain = VECTOR_LOAD(row + 4 * num_lanes);
+			}
+
+			vector_t input = VECTOR_LOAD(in + frame * num_lanes + lane);
+
+			poles[0] = VECTOR_ADD(poles[0], VECTOR_MUL(lf, VECTOR_SUB(input, poles[0])));
+			poles[1] = VECTOR_ADD(poles[1], VECTOR_MUL(lf, VECTOR_SUB(poles[0], poles[1])));
+			poles[2] = VECTOR_ADD(poles[2], VECTOR_MUL(lf, VECTOR_SUB(poles[1], poles[2])));
+			poles[3] = VECTOR_ADD(poles[3], VECTOR_MUL(lf, VECTOR_SUB(poles[2], poles[3])));
+			vector_t low = poles[3];
+
+			poles[4] = VECTOR_ADD(poles[4], VECTOR_MUL(hf, VECTOR_SUB(input, poles[4])));
+			poles[5] = VECTOR_ADD(poles[5], VECTOR_MUL(hf, VECTOR_SUB(poles[4], poles[5])));
+			poles[6] = VECTOR_ADD(poles[6], VECTOR_MUL(hf, VECTOR_SUB(poles[5], poles[6])));
+			poles[7] = VECTOR_ADD(poles[7], VECTOR_MUL(hf, VECTOR_SUB(poles[6], poles[7])));
+			vector_t high = VECTOR_SUB(sdm3, poles[7]);
+
+			vector_t mid = VECTOR_SUB(sdm3, VECTOR_ADD(high, low));
+
+			sdm3 = sdm2;
+			sdm2 = sdm1;
+			sdm1 = input;
+
+			vector_t sum = VECTOR_ADD(VECTOR_ADD(VECTOR_MUL(low, low_gain), VECTOR_MUL(mid, mid_gain)),
+			                          VECTOR_MUL(high, high_gain));
+			VECTOR_STORE(out + frame * num_lanes + lane, sum);
+		}
+
+		for (int pole = 0; pole < 8; pole++)
+			VECTOR_STORE(state + pole * SIGNAL_MAX_CHANNELS + lane, poles[pole]);
+		VECTOR_STORE(state + 8 * SIGNAL_MAX_CHANNELS + lane, sdm1);
+		VECTOR_STORE(state + 9 * SIGNAL_MAX_CHANNELS + lane, sdm2);
+		VECTOR_STORE(state + 10 * SIGNAL_MAX_CHANNELS + lane, sdm3);
+	}
+}
+
+static void svf(const sample *in, const sample *coefficients, int coefficient_stride,
+                sample *state, int num_lanes, sample *out, int num_frames)
+{
+	vector_t two = VECTOR_SET1(2.0);
+
+	for (int lane = 0; lane < num_lanes; lane += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t ic1eq = VECTOR_LOAD(state + 0 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t ic2eq = VECTOR_LOAD(state + 1 * SIGNAL_MAX_CHANNELS + lane);
+
+		vector_t a1 = ic1eq, a2 = ic1eq, a3 = ic1eq, m0 = ic1eq, m1 = ic1eq, m2 = ic1eq;
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			if (frame == 0 || coefficient_stride)
+			{
+				const sample *row = coefficients + frame * coefficient_stride + lane;
+				a1 = VECTOR_LOAD(row);
+				a2 = VECTOR_LOAD(row + num_lanes);
+				a3 = VECTOR_LOAD(row + 2 * num_lanes);
+				m0 = VECTOR_LOAD(row + 3 * num_lanes);
+				m1 = VECTOR_LOAD(row + 4 * num_lanes);
+				m2 = VECTOR_LOAD(row + 5 * num_lanes);
+			}
+
+			vector_t v0 = VECTOR_LOAD(in + frame * num_lanes + lane);
+			vector_t v3 = VECTOR_SUB(v0, ic2eq);
+			vector_t v1 = VECTOR_ADD(VECTOR_MUL(a1, ic1eq), VECTOR_MUL(a2, v3));
+			vector_t v2 = VECTOR_ADD(VECTOR_ADD(ic2eq, VECTOR_MUL(a2, ic1eq)), VECTOR_MUL(a3, v3));
+			ic1eq = VECTOR_SUB(VECTOR_MUL(two, v1), ic1eq);
+			ic2eq = VECTOR_SUB(VECTOR_MUL(two, v2), ic2eq);
+
+			vector_t sum = VECTOR_ADD(VECTOR_ADD(VECTOR_MUL(m0, v0), VECTOR_MUL(m1, v1)), VECTOR_MUL(m2, v2));
+			VECTOR_STORE(out + frame * num_lanes + lane, sum);
+		}
+
+		VECTOR_STORE(state + 0 * SIGNAL_MAX_CHANNELS + lane, ic1eq);
+		VECTOR_STORE(state + 1 * SIGNAL_MAX_CHANNELS + lane, ic2eq);
+	}
+}
+
+static void biquad(const sample *in, const sample *coefficients, int coefficient_stride,
+                   sample *state, int num_lanes, sample *out, int num_frames)
+{
+	for (int lane = 0; lane < num_lanes; lane += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t s1 = VECTOR_LOAD(state + 0 * SIGNAL_MAX_CHANNELS + lane);
+		vector_t s2 = VECTOR_LOAD(state + 1 * SIGNAL_MAX_CHANNELS + lane);
+
+		vector_t b0 = s1, b1 = s1, b2 = s1, a1 = s1, a2 = s1;
+		for (int frame = 0; frame < num_frames; frame++)
+		{
+			if (frame == 0 || coefficient_stride)
+			{
+				const sample *row = coefficients + frame * coefficient_stride + lane;
+				b0 = VECTOR_LOAD(row);
+				b1 = VECTOR_LOAD(row + num_lanes);
+				b2 = VECTOR_LOAD(row + 2 * num_lanes);
+				a1 = VECTOR_LOAD(row + 3 * num_lanes);
+				a2 = VECTOR_LOAD(row + 4 * num_lanes);
+			}
+
+			vector_t x = VECTOR_LOAD(in + frame * num_lanes + lane);
+			vector_t y = VECTOR_ADD(VECTOR_MUL(b0, x), s1);
+			s1 = VECTOR_SUB(VECTOR_ADD(VECTOR_MUL(b1, x), s2), VECTOR_MUL(a1, y));
+			s2 = VECTOR_SUB(VECTOR_MUL(b2, x), VECTOR_MUL(a2, y));
+			VECTOR_STORE(out + frame * num_lanes + lane, y);
+		}
+
+		VECTOR_STORE(state + 0 * SIGNAL_MAX_CHANNELS + lane, s1);
+		VECTOR_STORE(state + 1 * SIGNAL_MAX_CHANNELS + lane, s2);
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Stockham FFT passes. Within a group, the `stride` butterflies are
+ * independent and contiguous, so are processed a vector at a time,
+ * sharing the group's twiddle factors.
+ *-----------------------------------------------------------------------*/
+#define SIGNAL_FFT_RADIX4_BUTTERFLY(TYPE, LOAD, STORE, ADD, SUB, MUL, IN, OUT) \
+	{ \
+		TYPE ar = LOAD(a_real + IN), ai = LOAD(a_imag + IN); \
+		TYPE br = LOAD(b_real + IN), bi = LOAD(b_imag + IN); \
+		TYPE cr = LOAD(c_real + IN), ci = LOAD(c_imag + IN); \
+		TYPE dr = LOAD(d_real + IN), di = LOAD(d_imag + IN); \
+		TYPE apc_r = ADD(ar, cr), apc_i = ADD(ai, ci); \
+		TYPE amc_r = SUB(ar, cr), amc_i = SUB(ai, ci); \
+		TYPE bpd_r = ADD(br, dr), bpd_i = ADD(bi, di); \
+		TYPE bmd_r = SUB(br, dr), bmd_i = SUB(bi, di); \
+		TYPE u1r = ADD(amc_r, bmd_i), u1i = SUB(amc_i, bmd_r); \
+		TYPE u2r = SUB(apc_r, bpd_r), u2i = SUB(apc_i, bpd_i); \
+		TYPE u3r = SUB(amc_r, bmd_i), u3i = ADD(amc_i, bmd_r); \
+		STORE(y0_real + OUT, ADD(apc_r, bpd_r)); \
+		STORE(y0_imag + OUT, ADD(apc_i, bpd_i)); \
+		STORE(y1_real + OUT, SUB(MUL(u1r, w1r), MUL(u1i, w1i))); \
+		STORE(y1_imag + OUT, ADD(MUL(u1r, w1i), MUL(u1i, w1r))); \
+		STORE(y2_real + OUT, SUB(MUL(u2r, w2r), MUL(u2i, w2i))); \
+		STORE(y2_imag + OUT, ADD(MUL(u2r, w2i), MUL(u2i, w2r))); \
+		STORE(y3_real + OUT, SUB(MUL(u3r, w3r), MUL(u3i, w3i))); \
+		STORE(y3_imag + OUT, ADD(MUL(u3r, w3i), MUL(u3i, w3r))); \
+	}
+
+#define SIGNAL_SCALAR_LOAD(ptr) (*(ptr))
+#define SIGNAL_SCALAR_STORE(ptr, v) (*(ptr) = (v))
+#define SIGNAL_SCALAR_ADD(a, b) ((a) + (b))
+#define SIGNAL_SCALAR_SUB(a, b) ((a) - (b))
+#define SIGNAL_SCALAR_MUL(a, b) ((a) * (b))
+
+/*------------------------------------------------------------------------
+ * Passes whose runs are not a whole number of vectors (in practice,
+ * shorter than a vector) are written as a plain loop over groups, with
+ * short strides known at compile time, for the compiler to vectorise
+ * across groups. The pointers are declared non-aliasing, as otherwise
+ * GCC needs more runtime overlap checks than it allows.
+ *-----------------------------------------------------------------------*/
+static inline void fft_radix4_short(const sample *__restrict in_real, const sample *__restrict in_imag,
+                                    const sample *__restrict twiddles, int num_groups, const int stride,
+                                    sample *__restrict out_real, sample *__restrict out_imag)
+{
+	int quarter = num_groups * stride;
+	const sample *a_real = in_real, *a_imag = in_imag;
+	const sample *b_real = a_real + quarter, *b_imag = a_imag + quarter;
+	const sample *c_real = b_real + quarter, *c_imag = b_imag + quarter;
+	const sample *d_real = c_real + quarter, *d_imag = c_imag + quarter;
+	sample *y0_real = out_real, *y0_imag = out_imag;
+	sample *y1_real = y0_real + stride, *y1_imag = y0_imag + stride;
+	sample *y2_real = y1_real + stride, *y2_imag = y1_imag + stride;
+	sample *y3_real = y2_real + stride, *y3_imag = y2_imag + stride;
+
+	for (int group = 0; group < num_groups; group++)
+	{
+		sample w1r = twiddles[group], w1i = twiddles[num_groups + group];
+		sample w2r = twiddles[2 * num_groups + group], w2i = twiddles[3 * num_groups + group];
+		sample w3r = twiddles[4 * num_groups + group], w3i = twiddles[5 * num_groups + group];
+
+		for (int q = 0; q < stride; q++)
+			SIGNAL_FFT_RADIX4_BUTTERFLY(sample, SIGNAL_SCALAR_LOAD, SIGNAL_SCALAR_STORE,
+			                            SIGNAL_SCALAR_ADD, SIGNAL_SCALAR_SUB, SIGNAL_SCALAR_MUL,
+			                            group * stride + q, 4 * group * stride + q)
+	}
+}
+
+static void fft_radix4(const sample *in_real, const sample *in_imag, const sample *twiddles,
+                       int num_groups, int stride, sample *out_real, sample *out_imag)
+{
+	if (stride % SIGNAL_VECTOR_WIDTH)
+	{
+		if (stride == 1)
+			fft_radix4_short(in_real, in_imag, twiddles, num_groups, 1, out_real, out_imag);
+		else if (stride == 4)
+			fft_radix4_short(in_real, in_imag, twiddles, num_groups, 4, out_real, out_imag);
+		else
+			fft_radix4_short(in_real, in_imag, twiddles, num_groups, stride, out_real, out_imag);
+		return;
+	}
+
+	int quarter = num_groups * stride;
+
+	for (int group = 0; group < num_groups; group++)
+	{
+		const sample *a_real = in_real + group * stride, *a_imag = in_imag + group * stride;
+		const sample *b_real = a_real + quarter, *b_imag = a_imag + quarter;
+		const sample *c_real = b_real + quarter, *c_imag = b_imag + quarter;
+		const sample *d_real = c_real + quarter, *d_imag = c_imag + quarter;
+		sample *y0_real = out_real + 4 * group * stride, *y0_imag = out_imag + 4 * group * stride;
+		sample *y1_real = y0_real + stride, *y1_imag = y0_imag + stride;
+		sample *y2_real = y1_real + stride, *y2_imag = y1_imag + stride;
+		sample *y3_real = y2_real + stride, *y3_imag = y2_imag + stride;
+
+		vector_t w1r = VECTOR_SET1(twiddles[group]), w1i = VECTOR_SET1(twiddles[num_groups + group]);
+		vector_t w2r = VECTOR_SET1(twiddles[2 * num_groups + group]), w2i = VECTOR_SET1(twiddles[3 * num_groups + group]);
+		vector_t w3r = VECTOR_SET1(twiddles[4 * num_groups + group]), w3i = VECTOR_SET1(twiddles[5 * num_groups + group]);
+
+		for (int q = 0; q < stride; q += SIGNAL_VECTOR_WIDTH)
+			SIGNAL_FFT_RADIX4_BUTTERFLY(vector_t, VECTOR_LOAD, VECTOR_STORE, VECTOR_ADD, VECTOR_SUB, VECTOR_MUL, q, q)
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Phases are plain loops for the compiler to vectorise, as fast_atan2(),
+ * fast_sin() and fast_cos() are branch-free. sqrtf() is not vectorised
+ * while it may set errno, so magnitudes are explicit.
+ *-----------------------------------------------------------------------*/
+static void fft_polar(const sample *__restrict real, const sample *__restrict imag,
+                      sample *__restrict magnitudes, sample *__restrict phases, int num_bins)
+{
+	int bin = 0;
+	for (; bin + SIGNAL_VECTOR_WIDTH <= num_bins; bin += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t re = VECTOR_LOAD(real + bin), im = VECTOR_LOAD(imag + bin);
+		VECTOR_STORE(magnitudes + bin, VECTOR_SQRT(VECTOR_ADD(VECTOR_MUL(re, re), VECTOR_MUL(im, im))));
+	}
+	for (; bin < num_bins; bin++)
+		magnitudes[bin] = sqrtf(real[bin] * real[bin] + imag[bin] * imag[bin]);
+
+	for (bin = 0; bin < num_bins; bin++)
+		phases[bin] = fast_atan2(imag[bin], real[bin]);
+}
+
+static void fft_cartesian(const sample *__restrict magnitudes, const sample *__restrict phases,
+                          sample *__restrict real, sample *__restrict imag, int num_bins)
+{
+	for (int bin = 0; bin < num_bins; bin++)
+	{
+		real[bin] = magnitudes[bin] * fast_cos(phases[bin]);
+		imag[bin] = magnitudes[bin] * fast_sin(phases[bin]);
+	}
+}
+
+static void complex_mac(const sample *__restrict a_real, const sample *__restrict a_imag,
+                        const sample *__restrict b_real, const sample *__restrict b_imag,
+                        sample *__restrict out_real, sample *__restrict out_imag, int num_frames)
+{
+	int frame = 0;
+	for (; frame + SIGNAL_VECTOR_WIDTH <= num_frames; frame += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t ar = VECTOR_LOAD(a_real + frame), ai = VECTOR_LOAD(a_imag + frame);
+		vector_t br = VECTOR_LOAD(b_real + frame), bi = VECTOR_LOAD(b_imag + frame);
+		vector_t real = VECTOR_SUB(VECTOR_MUL(ar, br), VECTOR_MUL(ai, bi));
+		vector_t imag = VECTOR_ADD(VECTOR_MUL(ar, bi), VECTOR_MUL(ai, br));
+		VECTOR_STORE(out_real + frame, VECTOR_ADD(VECTOR_LOAD(out_real + frame), real));
+		VECTOR_STORE(out_imag + frame, VECTOR_ADD(VECTOR_LOAD(out_imag + frame), imag));
+	}
+	for (; frame < num_frames; frame++)
+	{
+		out_real[frame] += a_real[frame] * b_real[frame] - a_imag[frame] * b_imag[frame];
+		out_imag[frame] += a_real[frame] * b_imag[frame] + a_imag[frame] * b_real[frame];
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Wraps by whole turns, as floor((phase + pi) / 2pi), offset to be
+ * positive so that truncation rounds down.
+ *-----------------------------------------------------------------------*/
+static void phase_advance(const sample *phases, const sample *increments, sample *out, int num_bins)
+{
+	vector_t vpi = VECTOR_SET1(M_PI);
+	vector_t vturn = VECTOR_SET1(2.0 * M_PI);
+	vector_t vinverse = VECTOR_SET1(1.0 / (2.0 * M_PI));
+	vector_t voffset = VECTOR_SET1(4.0);
+	int bin = 0;
+	for (; bin + SIGNAL_VECTOR_WIDTH <= num_bins; bin += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t phase = VECTOR_ADD(VECTOR_LOAD(phases + bin), VECTOR_LOAD(increments + bin));
+		vector_t turns = VECTOR_ADD(VECTOR_MUL(VECTOR_ADD(phase, vpi), vinverse), voffset);
+		turns = VECTOR_SUB(VECTOR_TO_FLOAT(VECTOR_TRUNCATE(turns)), voffset);
+		VECTOR_STORE(out + bin, VECTOR_SUB(phase, VECTOR_MUL(turns, vturn)));
+	}
+	for (; bin < num_bins; bin++)
+	{
+		sample phase = phases[bin] + increments[bin];
+		sample turns = (phase + (sample) M_PI) * (sample) (1.0 / (2.0 * M_PI)) + 4.0f;
+		turns = (sample) (int) turns - 4.0f;
+		out[bin] = phase - turns * (sample) (2.0 * M_PI);
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Written as a plain loop for the compiler to vectorise, as it needs
+ * comparisons.
+ *-----------------------------------------------------------------------*/
+static void spectral_gate(const sample *magnitudes, sample threshold, sample attack, sample release,
+                          sample *__restrict gain, sample *out, int num_bins)
+{
+	for (int bin = 0; bin < num_bins; bin++)
+	{
+		sample target = magnitudes[bin] >= threshold ? 1.0f : 0.0f;
+		sample rate = target > gain[bin] ? attack : release;
+		gain[bin] += (target - gain[bin]) * rate;
+		out[bin] = magnitudes[bin] * gain[bin];
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Bins k and num_points - k are computed together, from the same
+ * inputs. Written as a plain loop for the compiler to vectorise, as it
+ * needs its reversed loads and stores.
+ *-----------------------------------------------------------------------*/
+static void fft_real_split(const sample *__restrict in_real, const sample *__restrict in_imag,
+                           const sample *__restrict rotation_real, const sample *__restrict rotation_imag,
+                           int num_points, sample *__restrict out_real, sample *__restrict out_imag)
+{
+	int half = num_points / 2;
+
+	for (int k = 1; k < half; k++)
+	{
+		int j = num_points - k;
+		sample sum_real = in_real[k] + in_real[j];
+		sample sum_imag = in_imag[k] - in_imag[j];
+		sample diff_real = in_real[k] - in_real[j];
+		sample diff_imag = in_imag[k] + in_imag[j];
+		sample c = rotation_real[k];
+		sample s = rotation_imag[k];
+		sample rotated_real = c * diff_imag - s * diff_real;
+		sample rotated_imag = -c * diff_real - s * diff_imag;
+		out_real[k] = sum_real + rotated_real;
+		out_imag[k] = sum_imag + rotated_imag;
+		out_real[j] = sum_real - rotated_real;
+		out_imag[j] = rotated_imag - sum_imag;
+	}
+
+	if (half > 0)
+	{
+		out_real[half] = 2.0f * in_real[half] + rotation_real[half] * 2.0f * in_imag[half];
+		out_imag[half] = -rotation_imag[half] * 2.0f * in_imag[half];
+	}
+}
+
+#undef SIGNAL_FFT_RADIX4_BUTTERFLY
+#undef SIGNAL_SCALAR_LOAD
+#undef SIGNAL_SCALAR_STORE
+#undef SIGNAL_SCALAR_ADD
+#undef SIGNAL_SCALAR_SUB
+#undef SIGNAL_SCALAR_MUL
+
+static void fft_radix2(const sample *in_real, const sample *in_imag, int stride,
+                       sample *out_real, sample *out_imag)
+{
+	int q = 0;
+	for (; q + SIGNAL_VECTOR_WIDTH <= stride; q += SIGNAL_VECTOR_WIDTH)
+	{
+		vector_t ar = VECTOR_LOAD(in_real + q), ai = VECTOR_LOAD(in_imag + q);
+		vector_t br = VECTOR_LOAD(in_real + q + stride), bi = VECTOR_LOAD(in_imag + q + stride);
+		VECTOR_STORE(out_real + q, VECTOR_ADD(ar, br));
+		VECTOR_STORE(out_imag + q, VECTOR_ADD(ai, bi));
+		VECTOR_STORE(out_real + q + stride, VECTOR_SUB(ar, br));
+		VECTOR_STORE(out_imag + q + stride, VECTOR_SUB(ai, bi));
+	}
+	for (; q < stride; q++)
+	{
+		sample ar = in_real[q], ai = in_imag[q];
+		sample br = in_real[q + stride], bi = in_imag[q + stride];
+		out_real[q] = ar + br;
+		out_imag[q] = ai + bi;
+		out_real[q + stride] = ar - br;
+		out_imag[q + stride] = ai - bi;
+	}
+}
+
+static const VectorKernels table =
+{
+	SIGNAL_VECTOR_NAME,
+	SIGNAL_VECTOR_WIDTH,
+	fill, copy,
+	add, subtract, multiply, divide,
+	add_scalar, multiply_scalar, divide_scalar,
+	mac, mac_scalar, scale_offset, clip, mix,
+	interleave, deinterleave,
+	dot,
+	sine,
+	table_read, table_read_linear, table_read_cubic,
+	sine_bank,
+	unison,
+	moog, eq,
+	svf, biquad,
+	fft_radix4, fft_radix2, fft_real_split,
+	fft_polar, fft_cartesian,
+	complex_mac,
+	phase_advance, spectral_gate
+};
+
+}
+
+const VectorKernels *SIGNAL_VECTOR_TABLE = &SIGNAL_VECTOR_NAMESPACE::table;
+
+}
@@ -17,6 +17,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <cassert>
+#include <algorithm>
 
 
 namespace libsignal
@@ -27,9 +28,13 @@ extern AudioGraph *shared_graph;
 Node::Node()
 {
 	this->graph = shared_graph;
-	this->out = (sample **) malloc(SIGNAL_MAX_CHANNELS * sizeof(sample *));
-	for (int i = 0; i < SIGNAL_MAX_CHANNELS; i++)
-		this->out[i] = (sample *) malloc(SIGNAL_NODE_BUFFER_SIZE * sizeof(sample));
+	this->out = (sample **) calloc(SIGNAL_MAX_CHANNELS, sizeof(sample *));
+	this->output_storage = NULL;
+	this->output_storage_channels = 0;
+	this->output_storage_frames = 0;
+	this->output_buffer_channels = 0;
+	this->output_buffer_size = 0;
+	this->allocated_bytes = 0;
 
 	this->min_input_channels = N_CHANNELS;
 	this->max_input_channels = N_CHANNELS;
@@ -40,11 +45,95 @@ Node::Node()
 	this->num_output_channels = 1;
 
 	this->no_input_automix = false;
+	this->shared_state = false;
+	this->is_constant = false;
+	this->rate = SIGNAL_RATE_AUDIO;
+	this->interpolate_control_rate = false;
+	this->can_process_at_control_rate = false;
+	memset(this->control_rate_value, 0, sizeof(this->control_rate_value));
+	this->no_output_pooling = false;
+	this->can_process_in_place = false;
 
 	this->ref = NULL;
 	this->monitor = NULL;
 }
 
+Node::~Node()
+{
+	if (this->monitor)
+	{
+		this->monitor->stop();
+		this->monitor->thread->join();
+		delete this->monitor;
+	}
+
+	free(this->output_storage);
+	free(this->out);
+}
+
+void Node::allocate_output(int num_channels, int num_frames)
+{
+	sample *storage = this->output_storage;
+	if (!storage || num_channels != this->output_storage_channels || num_frames != this->output_storage_frames)
+		storage = (sample *) calloc(num_channels * num_frames, sizeof(sample));
+
+	this->set_output_storage(storage, num_channels, num_frames);
+}
+
+std::function<void()> Node::prepare_output(int num_channels, int num_frames)
+{
+	sample *storage = this->output_storage;
+	if (!storage || num_channels != this->output_storage_channels || num_frames != this->output_storage_frames)
+		storage = (sample *) calloc(num_channels * num_frames, sizeof(sample));
+
+	/*------------------------------------------------------------------------
+	 * The reference that retires the storage we replace is made here, so
+	 * that the swap itself allocates nothing. It is only given the storage
+	 * once the swap is made, and so frees nothing if it never is.
+	 *-----------------------------------------------------------------------*/
+	std::shared_ptr<sample *> previous;
+	if (storage != this->output_storage)
+		previous = std::shared_ptr<sample *>(new sample *(NULL), [](sample **pointer) { free(*pointer); delete pointer; });
+
+	return [this, storage, num_channels, num_frames, previous]
+	{
+		if (previous)
+		{
+			*previous = this->output_storage;
+			this->output_storage = NULL;
+			if (this->graph)
+				this->graph->retire(previous);
+		}
+		this->set_output_storage(storage, num_channels, num_frames);
+	};
+}
+
+void Node::set_output_storage(sample *storage, int num_channels, int num_frames)
+{
+	/*------------------------------------------------------------------------
+	 * We may be on the audio thread, so hand any existing storage to the
+	 * graph to be freed. New storage is allocated before the old is
+	 * released, so that the two never share an address.
+	 *-----------------------------------------------------------------------*/
+	if (this->output_storage && this->output_storage != storage)
+	{
+		if (this->graph)
+			this->graph->retire(std::shared_ptr<void>(this->output_storage, free));
+		else
+			free(this->output_storage);
+	}
+
+	this->output_storage = storage;
+	this->output_storage_channels = num_channels;
+	this->output_storage_frames = num_frames;
+	for (int i = 0; i < SIGNAL_MAX_CHANNELS; i++)
+		this->out[i] = (i < num_channels) ? this->output_storage + i * num_frames : NULL;
+
+	this->output_buffer_channels = num_channels;
+	this->output_buffer_size = num_frames;
+	this->allocated_bytes = num_channels * num_frames * sizeof(sample);
+}
+
 void Node::process(sample **out, int num_frames)
 {
 	// Basic process() loop assumes we are N-in, N-out.
@@ -93,6 +182,8 @@ void Node::add_input(std::string name, NodeRef &node)
 	this->params[name] = &node;
 	this->update_channels();
 
+	if (this->graph)
+		this->graph->invalidate_schedule();
 }
 
 void Node::set_input(std::string name, const NodeRef &node)
@@ -100,6 +191,23 @@ void Node::set_input(std::string name, const NodeRef &node)
 	if (this->params.find(name) == this->params.end())
 		throw std::runtime_error("Node " + this->name + " has no such param: " + name);
 
+	/*------------------------------------------------------------------------
+	 * If the graph is running, hand the edit to the audio thread rather
+	 * than modifying our params mid-block, staging it so that the new
+	 * schedule is built here.
+	 *-----------------------------------------------------------------------*/
+	if (this->is_deferring())
+	{
+		NodeRef input = node;
+		AudioGraphTransactionScope transaction(this->graph);
+		this->graph->stage_input(this, name, input);
+		if (input)
+			input->reserve_output(this, name);
+		this->defer_edit([this, name, input] { this->set_input(name, input); });
+		transaction.commit();
+		return;
+	}
+
 	NodeRef current_input = *(this->params[name]);
 	if (current_input)
 	{
@@ -111,20 +219,62 @@ void Node::set_input(std::string name, const NodeRef &node)
 	node->update_channels();
 
 	node->add_output(this, name);
+
+	if (this->graph)
+	{
+		this->graph->invalidate_schedule();
+		this->graph->retire(current_input);
+	}
 }
 
 void Node::add_output(Node *target, std::string name)
 {
-	this->outputs.insert(std::make_pair(target, name));
+	std::pair<Node *, std::string> output = std::make_pair(target, name);
+	auto reserved = std::find(this->reserved_outputs.begin(), this->reserved_outputs.end(), output);
+	if (reserved != this->reserved_outputs.end())
+		this->outputs.splice(this->outputs.end(), this->reserved_outputs, reserved);
+	else if (std::find(this->outputs.begin(), this->outputs.end(), output) == this->outputs.end())
+		this->outputs.push_back(output);
+
+	if (this->graph)
+		this->graph->invalidate_schedule();
 }
 
 void Node::remove_output(Node *target, std::string name)
 {
-	this->outputs.erase(std::make_pair(target, name));
+	auto output = std::find(this->outputs.begin(), this->outputs.end(), std::make_pair(target, name));
+	if (output != this->outputs.end())
+		this->retired_outputs.splice(this->retired_outputs.end(), this->outputs, output);
+
+	if (this->graph)
+		this->graph->invalidate_schedule();
+}
+
+void Node::reserve_output(Node *target, std::string name)
+{
+	/*------------------------------------------------------------------------
+	 * Edits are made on the audio thread while the control side waits for
+	 * them, so entries retired by earlier edits are no longer in use.
+	 *-----------------------------------------------------------------------*/
+	this->retired_outputs.clear();
+	this->reserved_outputs.push_back(std::make_pair(target, name));
 }
 
 void Node::disconnect_outputs()
 {
+	/*------------------------------------------------------------------------
+	 * If the graph is running, disconnect each of the outputs that we
+	 * will have once any staged edits are made, as one edit.
+	 *-----------------------------------------------------------------------*/
+	if (this->graph && this->graph->is_deferring())
+	{
+		AudioGraphTransactionScope transaction(this->graph);
+		for (auto output : this->graph->get_staged_outputs(this))
+			output.first->set_input(output.second, 0);
+		transaction.commit();
+		return;
+	}
+
 	/*------------------------------------------------------------------------
 	 * Don't iterate over outputs as the output set will change during
 	 * iteration (as calling set_input on each output of the node will 
@@ -142,10 +292,15 @@ void Node::disconnect_outputs()
 
 void Node::disconnect_inputs()
 {
+	/*------------------------------------------------------------------------
+	 * Each set_input is deferred if need be; make them as one edit.
+	 *-----------------------------------------------------------------------*/
+	AudioGraphTransactionScope transaction(this->graph && this->graph->is_deferring() ? this->graph : NULL);
 	for (auto param : this->params)
 	{
 		this->set_input(param.first, 0);
 	}
+	transaction.commit();
 }
 
 
@@ -177,7 +332,38 @@ void Node::set_buffer(std::string name, BufferRef buffer)
 	if (this->buffers.find(name) == this->buffers.end())
 		throw std::runtime_error("Node " + this->name + " has no such buffer: " + name);
 
+	if (this->is_deferring())
+	{
+		this->defer_edit([this, name, buffer] { this->set_buffer(name, buffer); });
+		return;
+	}
+
+	BufferRef current_buffer = *(this->buffers[name]);
 	*(this->buffers[name]) = buffer;
+
+	if (this->graph)
+		this->graph->retire(current_buffer);
+}
+
+bool Node::is_deferring()
+{
+	return this->graph && this->graph->is_deferring() && !this->weak_ref.expired();
+}
+
+void Node::defer_edit(std::function<void()> edit)
+{
+	/*------------------------------------------------------------------------
+	 * A node that is no longer referenced can't be being processed, so
+	 * if we lose our last reference in the meantime, edit in place.
+	 *-----------------------------------------------------------------------*/
+	NodeRef self = this->is_deferring() ? NodeRef(this->weak_ref.lock()) : NodeRef();
+	if (!self)
+	{
+		edit();
+		return;
+	}
+
+	this->graph->defer([self, edit] { edit(); });
 }
 
 
@@ -197,8 +383,8 @@ NodeRef NodeRef::operator= (const NodeRef &other)
 
 void Node::zero_output()
 {
-	for (int i = 0; i < this->num_output_channels; i++)
-		memset(this->out[i], 0, SIGNAL_NODE_BUFFER_SIZE * sizeof(sample));
+	for (int i = 0; i < this->num_output_channels && i < this->output_buffer_channels; i++)
+		memset(this->out[i], 0, this->output_buffer_size * sizeof(sample));
 }
 
 void Node::trigger(std::string name, float value)
@@ -206,10 +392,50 @@ void Node::trigger(std::string name, float value)
 }
 
 
+void Node::set_rate(signal_rate_t rate, bool interpolate)
+{
+	if (rate == SIGNAL_RATE_CONTROL && !this->can_process_at_control_rate)
+		throw std::runtime_error("Node " + this->name + " does not support control rate");
+
+	this->rate = rate;
+	this->interpolate_control_rate = interpolate;
+}
+
+void Node::write_control_value(sample **out, int num_frames, int channel, sample value)
+{
+	if (this->interpolate_control_rate)
+	{
+		sample previous = this->control_rate_value[channel];
+		sample step = (value - previous) / num_frames;
+		for (int frame = 0; frame < num_frames; frame++)
+			out[channel][frame] = previous + step * (frame + 1);
+		this->is_constant = false;
+	}
+	else
+	{
+		for (int frame = 0; frame < num_frames; frame++)
+			out[channel][frame] = value;
+		this->is_constant = true;
+	}
+
+	this->control_rate_value[channel] = value;
+}
+
 void Node::poll(float frequency, std::string label)
 {
 	this->monitor = new NodeMonitor(this, label, frequency); 
 	this->monitor->start();
+
+	/*------------------------------------------------------------------------
+	 * The monitor reads our output between blocks, so we need a private
+	 * output buffer. Committing rebuilds the schedule of a running graph.
+	 *-----------------------------------------------------------------------*/
+	if (this->graph)
+	{
+		AudioGraphTransactionScope transaction(this->graph);
+		this->graph->invalidate_schedule();
+		transaction.commit();
+	}
 }
 
 /*------------------------------------------------------------------------
@@ -219,16 +445,19 @@ void Node::poll(float frequency, std::string label)
 NodeRef::NodeRef() : std::shared_ptr<Node>(nullptr) { }
 
 NodeRef::NodeRef(Node *ptr) : std::shared_ptr<Node>(ptr)
-	{ if (ptr) ptr->ref = this; }
+	{ if (ptr) { ptr->ref = this; ptr->weak_ref = *this; } }
+
+NodeRef::NodeRef(const std::shared_ptr<Node> &ptr) : std::shared_ptr<Node>(ptr)
+	{ if (ptr) { ptr->ref = this; ptr->weak_ref = *this; } }
 
 NodeRef::NodeRef(double x) : std::shared_ptr<Node>(new Constant(x))
-	{ (*this)->ref = this; }
+	{ (*this)->ref = this; (*this)->weak_ref = *this; }
 
 NodeRef::NodeRef(int x) : std::shared_ptr<Node>(new Constant((float) x))
-	{ (*this)->ref = this; }
+	{ (*this)->ref = this; (*this)->weak_ref = *this; }
 
 NodeRef::NodeRef(std::initializer_list<NodeRef> x) : std::shared_ptr<Node>(new Multiplex(x))
-	{ (*this)->ref = this; }
+	{ (*this)->ref = this; (*this)->weak_ref = *this; }
 
 
 /*------------------------------------------------------------------------
@@ -291,12 +520,19 @@ UnaryOpNode::UnaryOpNode(NodeRef a) : Node(), input(a)
 
 NodeRef Node::scale(float from, float to, signal_scale_t scale)
 {
+	/*------------------------------------------------------------------------
+	 * Share ownership with the NodeRef that already holds us, rather than
+	 * creating a second owner from the raw pointer. If nothing owns us yet
+	 * (as in `(new Sine(1))->scale(0, 1)`), the new Scale node takes ownership.
+	 *-----------------------------------------------------------------------*/
+	NodeRef input = this->weak_ref.expired() ? NodeRef(this) : NodeRef(this->weak_ref.lock());
+
 	switch (scale)
 	{
 		case SIGNAL_SCALE_LIN_LIN:
-			return new Scale(this, -1, 1, from, to);
+			return new Scale(input, -1, 1, from, to);
 		case SIGNAL_SCALE_LIN_EXP:
-			return new LinExp(this, -1, 1, from, to);
+			return new LinExp(input, -1, 1, from, to);
 		default:
 			return nullptr;
 	}
@@ -11,7 +11,9 @@
 #include <vector>
 #include <unordered_map>
 #include <set>
+#include <list>
 #include <memory>
+#include <functional>
 
 
 namespace libsignal
@@ -38,6 +40,7 @@ namespace libsignal
 		public:
 			NodeRef();
 			NodeRef(Node *ptr);
+			NodeRef(const std::shared_ptr<Node> &ptr);
 			NodeRef(double x);
 			NodeRef(int x);
 			NodeRef(std::initializer_list<NodeRef> x);
@@ -69,6 +72,7 @@ namespace libsignal
 
 			Node();
 			Node(double x);
+			virtual ~Node();
 
 			virtual void process(sample **out, int num_frames);
 
@@ -85,6 +89,8 @@ namespace libsignal
 
 			/*------------------------------------------------------------------------
 			 * Register parameters.
+			 * When called from a control thread while the graph is running,
+			 * set_input is queued and takes effect at the next block boundary.
 			 *-----------------------------------------------------------------------*/
 			virtual void add_input(std::string name, NodeRef &param);
 			virtual void set_input(std::string name, const NodeRef &param);
@@ -97,6 +103,13 @@ namespace libsignal
 			virtual void add_output(Node *target, std::string name);
 			virtual void remove_output(Node *target, std::string name);
 
+			/*------------------------------------------------------------------------
+			 * Make the entry that add_output(target, name) will take, for an edit
+			 * that is to be made on the audio thread. Called on the control side,
+			 * while the edit is staged.
+			 *-----------------------------------------------------------------------*/
+			void reserve_output(Node *target, std::string name);
+
 			/*------------------------------------------------------------------------
 			 * Disconnect inputs and outputs.
 			 *-----------------------------------------------------------------------*/
@@ -116,6 +129,20 @@ namespace libsignal
 			virtual void add_buffer(std::string name, BufferRef &buffer);
 			virtual void set_buffer(std::string name, BufferRef buffer);
 
+			/*------------------------------------------------------------------------
+			 * True if edits to this node must be handed to the audio thread:
+			 * the graph is running, we are on a control thread, and we are
+			 * referenced, so may be being processed.
+			 *-----------------------------------------------------------------------*/
+			bool is_deferring();
+
+			/*------------------------------------------------------------------------
+			 * Make an edit to this node. If is_deferring(), it is queued to be
+			 * made on the audio thread at the next block, holding a reference
+			 * to us so that we outlive it. Otherwise, it is made now.
+			 *-----------------------------------------------------------------------*/
+			void defer_edit(std::function<void()> edit);
+
 			/*------------------------------------------------------------------------
 			 * Generic trigger method. 
 			 *-----------------------------------------------------------------------*/
@@ -132,6 +159,22 @@ namespace libsignal
 			virtual void poll(float frequency = 1.0, std::string label = "");
 			NodeMonitor *monitor;
 
+			/*------------------------------------------------------------------------
+			 * Set the rate at which this node computes its output. At control
+			 * rate, a node computes a single value per channel per block. The
+			 * block is then populated either as a constant, which consumers can
+			 * treat as a scalar, or if `interpolate` is set, as a linear ramp
+			 * from the previous block's value.
+			 * Throws if the node does not support control rate.
+			 *-----------------------------------------------------------------------*/
+			virtual void set_rate(signal_rate_t rate, bool interpolate = false);
+
+			/*------------------------------------------------------------------------
+			 * Used by control-rate nodes within process() to populate one
+			 * channel of output from a single value.
+			 *-----------------------------------------------------------------------*/
+			void write_control_value(sample **out, int num_frames, int channel, sample value);
+
 			/*------------------------------------------------------------------------
 			 * Returns a new Node that scales the output of this node from
 			 * `from` to `to`.
@@ -151,15 +194,22 @@ namespace libsignal
 			std::unordered_map <std::string, NodeRef *> params;
 
 			/*------------------------------------------------------------------------
-			 * Set of outputs.
+			 * List of outputs.
 			 * Each output is a std::pair containing 
 			 *  - a reference to the Node connected outwards to
 			 *  - a string containing the name of the parameter that this node
 			 *    modulates.
 			 * Note that a node may modulate two different parameters of the same
 			 * node.
+			 *
+			 * Connections made on the audio thread move entries between lists
+			 * rather than allocating them: add_output takes the entry made by
+			 * reserve_output, and remove_output moves its entry to
+			 * retired_outputs, to be freed by the next reserve_output.
 			 *-----------------------------------------------------------------------*/
-			std::set <std::pair <Node *, std::string>> outputs;
+			std::list <std::pair <Node *, std::string>> outputs;
+			std::list <std::pair <Node *, std::string>> reserved_outputs;
+			std::list <std::pair <Node *, std::string>> retired_outputs;
 
 			/*------------------------------------------------------------------------
 			 * Hash table of properties: (name, PropertyRef)
@@ -202,12 +252,80 @@ namespace libsignal
 			bool no_input_automix;
 
 			/*------------------------------------------------------------------------
-			 * Buffer containing this node's output.
+			 * Set by nodes whose process() touches state shared with other
+			 * nodes (such as the global random number generator). These are
+			 * never processed concurrently with one another.
+			 *-----------------------------------------------------------------------*/
+			bool shared_state;
+
+			/*------------------------------------------------------------------------
+			 * Control-rate settings and state (see set_rate).
+			 * Nodes that implement a control-rate mode set can_process_at_control_rate.
+			 *-----------------------------------------------------------------------*/
+			signal_rate_t rate;
+			bool interpolate_control_rate;
+			bool can_process_at_control_rate;
+			sample control_rate_value[SIGNAL_MAX_CHANNELS];
+
+			/*------------------------------------------------------------------------
+			 * Set by process() when every frame of each output channel in the
+			 * current block equals out[channel][0], so that consumers may treat
+			 * the input as a scalar. The output buffer is still fully populated.
+			 *-----------------------------------------------------------------------*/
+			bool is_constant;
+
+			/*------------------------------------------------------------------------
+			 * Set by nodes whose output must persist beyond the block in which
+			 * it is generated, or may be larger than a block (such as FFT
+			 * frames). These get a private output buffer, rather than one
+			 * shared from the graph's buffer pool.
+			 *-----------------------------------------------------------------------*/
+			bool no_output_pooling;
+
+			/*------------------------------------------------------------------------
+			 * Set by nodes that read each input sample before writing the output
+			 * sample at the same channel and frame, and so may write over the
+			 * buffer of an input that has no other consumer.
+			 *-----------------------------------------------------------------------*/
+			bool can_process_in_place;
+
+			/*------------------------------------------------------------------------
+			 * Allocate a private output buffer of `num_channels` channels of
+			 * `num_frames` frames, growing or shrinking any existing buffer.
+			 * Called by AudioGraph::compile for nodes that are not pooled, and
+			 * so re-run whenever our channel count changes.
+			 *-----------------------------------------------------------------------*/
+			virtual void allocate_output(int num_channels, int num_frames);
+
+			/*------------------------------------------------------------------------
+			 * As allocate_output, for a node that the audio thread may be
+			 * processing: the storage is allocated by the caller, and the
+			 * returned function swaps it in, to be called on the audio thread
+			 * between blocks.
+			 *-----------------------------------------------------------------------*/
+			virtual std::function<void()> prepare_output(int num_channels, int num_frames);
+
+			/*------------------------------------------------------------------------
+			 * Buffer containing this node's output, one pointer per channel.
+			 * Channel storage is assigned when the graph is compiled: either
+			 * from the graph's buffer pool, or from private storage.
 			 * TODO: Point this partway through a bigger frame buffer so that
 			 * its history can be read for delay lines etc.
 			 *-----------------------------------------------------------------------*/
 			sample **out;
 
+			/*------------------------------------------------------------------------
+			 * Number of channels of `out` that are backed by storage, and the
+			 * number of frames in each.
+			 *-----------------------------------------------------------------------*/
+			int output_buffer_channels;
+			int output_buffer_size;
+
+			/*------------------------------------------------------------------------
+			 * Bytes of private output storage held by this node.
+			 *-----------------------------------------------------------------------*/
+			size_t allocated_bytes;
+
 			/*------------------------------------------------------------------------
 			 * A reference to the NodeRef shared_ptr pointing to this Node.
 			 * Necessary so that a node can make outgoing/incoming connections to
@@ -215,7 +333,29 @@ namespace libsignal
 			 *-----------------------------------------------------------------------*/
 			NodeRef *ref;
 
+			/*------------------------------------------------------------------------
+			 * The shared_ptr that owns this Node, if any. Set by each NodeRef
+			 * that takes or shares ownership, so that the node can hand out
+			 * further references to itself (to deferred edits, for instance).
+			 *-----------------------------------------------------------------------*/
+			std::weak_ptr<Node> weak_ref;
+
 			Node operator+ (Node &other);
+
+		private:
+
+			/*------------------------------------------------------------------------
+			 * Point our output at `storage`, of `num_channels` channels of
+			 * `num_frames` frames, releasing any storage that it replaces.
+			 *-----------------------------------------------------------------------*/
+			void set_output_storage(sample *storage, int num_channels, int num_frames);
+
+			/*------------------------------------------------------------------------
+			 * Private output storage, if allocated, and its size.
+			 *-----------------------------------------------------------------------*/
+			sample *output_storage;
+			int output_storage_channels;
+			int output_storage_frames;
 	};
 
 	class GeneratorNode : public Node
@@ -1,5 +1,6 @@
 #include "../constants.h"
 #include "../node.h"
+#include "../kernels/kernels.h"
 
 namespace libsignal
 {
@@ -12,15 +13,37 @@ namespace libsignal
 		Add(NodeRef a = 0, NodeRef b = 0) : BinaryOpNode(a, b)
 		{
 			this->name = "add";
+			this->can_process_in_place = true;
 		}
 
 		virtual void process(sample **out, int num_frames)
 		{
-			for (int frame = 0; frame < num_frames; frame++)
+			/*------------------------------------------------------------------------
+			 * Where an input is constant for this block, use its value as a
+			 * scalar rather than reading its buffer.
+			 *-----------------------------------------------------------------------*/
+			this->is_constant = input0->is_constant && input1->is_constant;
+
+			for (int channel = 0; channel < this->num_output_channels; channel++)
 			{
-				for (int channel = 0; channel < this->num_output_channels; channel++)
+				sample *in0 = input0->out[channel];
+				sample *in1 = input1->out[channel];
+
+				if (this->is_constant)
+				{
+					vector_fill(out[channel], in0[0] + in1[0], num_frames);
+				}
+				else if (input1->is_constant)
+				{
+					vector_add_scalar(in0, in1[0], out[channel], num_frames);
+				}
+				else if (input0->is_constant)
+				{
+					vector_add_scalar(in1, in0[0], out[channel], num_frames);
+				}
+				else
 				{
-					out[channel][frame] = input0->out[channel][frame] + input1->out[channel][frame];
+					vector_add(in0, in1, out[channel], num_frames);
 				}
 			}
 		}
@@ -4,6 +4,7 @@
 #include "../node.h"
 #include "../registry.h"
 #include "../util.h"
+#include "../kernels/kernels.h"
 
 #include <list>
 
@@ -58,10 +59,7 @@ namespace libsignal
 						channel_amp = channel_amp * this->amp_compensation;
 					}
 					
-					for (int frame = 0; frame < num_frames; frame++)
-					{
-						out[out_channel][frame] += channel_amp * this->input->out[in_channel][frame];
-					}
+					vector_mac_scalar(this->input->out[in_channel], channel_amp, out[out_channel], num_frames);
 				}
 			}
 		}
@@ -2,6 +2,7 @@
 
 #include "../constants.h"
 #include "../node.h"
+#include "../graph.h"
 #include "../core.h"
 #include "../registry.h"
 
@@ -64,6 +65,18 @@ namespace libsignal
 
 		virtual void set_input(std::string name, const NodeRef &node)
 		{
+			if (this->is_deferring())
+			{
+				NodeRef input = node;
+				AudioGraphTransactionScope transaction(this->graph);
+				this->graph->stage_input(this, name, input);
+				if (input)
+					input->reserve_output(this, name);
+				this->defer_edit([this, name, input] { this->set_input(name, input); });
+				transaction.commit();
+				return;
+			}
+
 			if (this->params.find(name) == this->params.end())
 			{
 				this->inputs.push_back(node);
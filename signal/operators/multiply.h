@@ -2,6 +2,7 @@
 
 #include "../constants.h"
 #include "../node.h"
+#include "../kernels/kernels.h"
 #include "../registry.h"
 
 namespace libsignal
@@ -15,22 +16,38 @@ namespace libsignal
 		Multiply(NodeRef a = 1.0, NodeRef b = 1.0) : BinaryOpNode(a, b)
 		{
 			this->name = "multiply";
+			this->can_process_in_place = true;
 		}
 
 		virtual void process(sample **out, int num_frames)
 		{
+			/*------------------------------------------------------------------------
+			 * Where an input is constant for this block, use its value as a
+			 * scalar rather than reading its buffer.
+			 *-----------------------------------------------------------------------*/
+			this->is_constant = input0->is_constant && input1->is_constant;
+
 			for (int channel = 0; channel < this->num_output_channels; channel++)
 			{
-				#ifdef __APPLE__
-
-					vDSP_vmul(input0->out[channel], 1, input1->out[channel], 1, out[channel], 1, num_frames);
-
-				#else
-
-					for (int frame = 0; frame < num_frames; frame++)
-						out[channel][frame] = input0->out[channel][frame] * input1->out[channel][frame];
-
-				#endif
+				sample *in0 = input0->out[channel];
+				sample *in1 = input1->out[channel];
+
+				if (this->is_constant)
+				{
+					vector_fill(out[channel], in0[0] * in1[0], num_frames);
+				}
+				else if (input1->is_constant)
+				{
+					vector_multiply_scalar(in0, in1[0], out[channel], num_frames);
+				}
+				else if (input0->is_constant)
+				{
+					vector_multiply_scalar(in1, in0[0], out[channel], num_frames);
+				}
+				else
+				{
+					vector_multiply(in0, in1, out[channel], num_frames);
+				}
 			}
 		}
 	};
@@ -1,9 +1,13 @@
 #include "../constants.h"
 
 #include "../node.h"
-#include "../util.h"
+#include "../fastmath.h"
+#include "../kernels/kernels.h"
 #include "../oscillators/constant.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace libsignal
 {
 
@@ -15,22 +19,56 @@ public:
 	RoundToScale(NodeRef a) : UnaryOpNode(a)
 	{
 		this->name = "round-to-scale";
+
+		for (int channel = 0; channel < SIGNAL_MAX_CHANNELS; channel++)
+		{
+			this->last_input[channel] = std::numeric_limits<float>::max();
+			this->last_output[channel] = 0.0;
+		}
 	}
 
 	virtual void process(sample **out, int num_frames)
 	{
-		for (int frame = 0; frame < num_frames; frame++)
+		for (int channel = 0; channel < this->num_output_channels; channel++)
 		{
-			for (int channel = 0; channel < this->num_output_channels; channel++)
+			sample *in = this->input->out[channel];
+
+			/*------------------------------------------------------------------------
+			 * The input is typically a held pitch, in which case the previous
+			 * block's output can be reused.
+			 *-----------------------------------------------------------------------*/
+			bool unchanged = true;
+			for (int frame = 0; frame < num_frames; frame++)
+				unchanged &= (in[frame] == this->last_input[channel]);
+
+			if (unchanged)
 			{
-				float value = this->input->out[channel][frame];
-				float midi = freq_to_midi(value);
-				float midi_rounded = roundf(midi);
-				float freq = midi_to_freq(midi_rounded);
-				out[channel][frame] = freq;
+				vector_fill(out[channel], this->last_output[channel], num_frames);
+				continue;
 			}
+
+			/*------------------------------------------------------------------------
+			 * Notes are calculated in one pass, and looked up in a second,
+			 * so that the first can be vectorised.
+			 *-----------------------------------------------------------------------*/
+			int notes[SIGNAL_DEFAULT_BLOCK_SIZE];
+			for (int offset = 0; offset < num_frames; offset += SIGNAL_DEFAULT_BLOCK_SIZE)
+			{
+				int run = std::min(num_frames - offset, SIGNAL_DEFAULT_BLOCK_SIZE);
+				for (int frame = 0; frame < run; frame++)
+					notes[frame] = fast_floor_int(fast_freq_to_midi(in[offset + frame]) + 0.5f);
+				for (int frame = 0; frame < run; frame++)
+					out[channel][offset + frame] = midi_note_to_freq(notes[frame]);
+			}
+
+			this->last_input[channel] = in[num_frames - 1];
+			this->last_output[channel] = out[channel][num_frames - 1];
 		}
 	}
+
+private:
+	sample last_input[SIGNAL_MAX_CHANNELS];
+	sample last_output[SIGNAL_MAX_CHANNELS];
 };
 
 }
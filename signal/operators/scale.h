@@ -1,6 +1,7 @@
 #include "../constants.h"
 
 #include "../node.h"
+#include "../fastmath.h"
 #include "../oscillators/constant.h"
 
 namespace libsignal
@@ -14,6 +15,8 @@ namespace libsignal
 		LinExp(NodeRef input = 0, NodeRef a = 0, NodeRef b = 1, NodeRef c = 1, NodeRef d = 10) : UnaryOpNode(input), a(a), b(b), c(c), d(d)
 		{
 			this->name = "linexp";
+			this->can_process_in_place = true;
+			this->can_process_at_control_rate = true;
 
 			this->add_input("a", this->a);
 			this->add_input("b", this->b);
@@ -23,12 +26,52 @@ namespace libsignal
 
 		virtual void process(sample **out, int num_frames)
 		{
-			for (int frame = 0; frame < num_frames; frame++)
+			/*------------------------------------------------------------------------
+			 * Usually, the range parameters are all constant, so hoist them
+			 * out of the loop.
+			 *-----------------------------------------------------------------------*/
+			bool constant_range = a->is_constant && b->is_constant && c->is_constant && d->is_constant;
+			this->is_constant = constant_range && input->is_constant;
+
+			/*------------------------------------------------------------------------
+			 * If every input is constant, or we are running at control rate,
+			 * only a single value per channel needs to be computed.
+			 *-----------------------------------------------------------------------*/
+			if (this->is_constant || this->rate == SIGNAL_RATE_CONTROL)
 			{
 				for (int channel = 0; channel < this->num_output_channels; channel++)
 				{
-					float norm = (input->out[channel][frame] - a->out[channel][frame]) / (b->out[channel][frame] - a->out[channel][frame]);
-					out[channel][frame] = powf(d->out[channel][frame] / c->out[channel][frame], norm) * c->out[channel][frame];
+					float a = this->a->out[channel][0];
+					float c = this->c->out[channel][0];
+					float norm = (input->out[channel][0] - a) / (this->b->out[channel][0] - a);
+					this->write_control_value(out, num_frames, channel, fast_pow(this->d->out[channel][0] / c, norm) * c);
+				}
+				return;
+			}
+
+			for (int channel = 0; channel < this->num_output_channels; channel++)
+			{
+				if (constant_range)
+				{
+					float a = this->a->out[channel][0];
+					float range = this->b->out[channel][0] - a;
+					float c = this->c->out[channel][0];
+					float log_ratio = fast_log2(this->d->out[channel][0] / c);
+					sample *in = input->out[channel];
+
+					for (int frame = 0; frame < num_frames; frame++)
+					{
+						float norm = (in[frame] - a) / range;
+						out[channel][frame] = fast_exp2(norm * log_ratio) * c;
+					}
+				}
+				else
+				{
+					for (int frame = 0; frame < num_frames; frame++)
+					{
+						float norm = (input->out[channel][frame] - a->out[channel][frame]) / (b->out[channel][frame] - a->out[channel][frame]);
+						out[channel][frame] = fast_pow(d->out[channel][frame] / c->out[channel][frame], norm) * c->out[channel][frame];
+					}
 				}
 			}
 		}
@@ -44,6 +87,8 @@ namespace libsignal
 		Scale(NodeRef input = 0, NodeRef a = 0, NodeRef b = 1, NodeRef c = 1, NodeRef d = 10) : UnaryOpNode(input), a(a), b(b), c(c), d(d)
 		{
 			this->name = "scale";
+			this->can_process_in_place = true;
+			this->can_process_at_control_rate = true;
 
 			this->add_input("a", this->a);
 			this->add_input("b", this->b);
@@ -53,12 +98,48 @@ namespace libsignal
 
 		virtual void process(sample **out, int num_frames)
 		{
-			for (int frame = 0; frame < num_frames; frame++)
+			/*------------------------------------------------------------------------
+			 * Usually, the range parameters are all constant, so hoist them
+			 * out of the loop.
+			 *-----------------------------------------------------------------------*/
+			bool constant_range = a->is_constant && b->is_constant && c->is_constant && d->is_constant;
+			this->is_constant = constant_range && input->is_constant;
+
+			if (this->is_constant || this->rate == SIGNAL_RATE_CONTROL)
 			{
 				for (int channel = 0; channel < this->num_output_channels; channel++)
 				{
-					float norm = (input->out[channel][frame] - a->out[channel][frame]) / (b->out[channel][frame] - a->out[channel][frame]);
-					out[channel][frame] = (c->out[channel][frame]) + (d->out[channel][frame] - c->out[channel][frame]) * norm;
+					float a = this->a->out[channel][0];
+					float c = this->c->out[channel][0];
+					float norm = (input->out[channel][0] - a) / (this->b->out[channel][0] - a);
+					this->write_control_value(out, num_frames, channel, c + (this->d->out[channel][0] - c) * norm);
+				}
+				return;
+			}
+
+			for (int channel = 0; channel < this->num_output_channels; channel++)
+			{
+				if (constant_range)
+				{
+					float a = this->a->out[channel][0];
+					float range = this->b->out[channel][0] - a;
+					float c = this->c->out[channel][0];
+					float scale = this->d->out[channel][0] - c;
+					sample *in = input->out[channel];
+
+					for (int frame = 0; frame < num_frames; frame++)
+					{
+						float norm = (in[frame] - a) / range;
+						out[channel][frame] = c + scale * norm;
+					}
+				}
+				else
+				{
+					for (int frame = 0; frame < num_frames; frame++)
+					{
+						float norm = (input->out[channel][frame] - a->out[channel][frame]) / (b->out[channel][frame] - a->out[channel][frame]);
+						out[channel][frame] = (c->out[channel][frame]) + (d->out[channel][frame] - c->out[channel][frame]) * norm;
+					}
 				}
 			}
 		}
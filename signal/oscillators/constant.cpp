@@ -1,4 +1,5 @@
 #include "constant.h"
+#include "../kernels/kernels.h"
 
 namespace libsignal
 {
@@ -10,16 +11,26 @@ Constant::Constant(sample value) : Node()
 
 	this->min_input_channels = 0;
 	this->max_input_channels = 0;
+
+	/*------------------------------------------------------------------------
+	 * Keep a private buffer so that its contents persist between blocks.
+	 *-----------------------------------------------------------------------*/
+	this->no_output_pooling = true;
+	this->is_constant = true;
+
+	this->filled_buffer = NULL;
+	this->filled_value = 0;
 }
 
 void Constant::process(sample **out, int num_frames)
 {
-	#if __APPLE__
-		vDSP_vfill(&(this->value), out[0], 1, num_frames);
-	#else
-		for (int frame = 0; frame < num_frames; frame++)
-			out[0][frame] = this->value;
-	#endif
+	if (out[0] == this->filled_buffer && this->value == this->filled_value)
+		return;
+
+	vector_fill(out[0], this->value, this->output_buffer_size);
+
+	this->filled_buffer = out[0];
+	this->filled_value = this->value;
 }
 
 }
@@ -12,6 +12,14 @@ namespace libsignal
 		float value;
 
 		virtual void process(sample **out, int num_frames);
+
+	private:
+		/*------------------------------------------------------------------------
+		 * The buffer and value that we last filled, so that we only refill
+		 * when the value changes or our buffer is reallocated.
+		 *-----------------------------------------------------------------------*/
+		sample *filled_buffer;
+		sample filled_value;
 	};
 
 	REGISTER(Constant, "constant");
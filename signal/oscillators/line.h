@@ -2,6 +2,8 @@
 
 #include "../node.h"
 
+#include <algorithm>
+
 namespace libsignal
 {
 	class Line : public Node
@@ -11,6 +13,7 @@ namespace libsignal
 			time(time), from(from), to(to)
 		{
 			this->name = "line";
+			this->can_process_at_control_rate = true;
 
 			this->add_input("time", this->time);
 			this->add_input("from", this->from);
@@ -24,20 +27,32 @@ namespace libsignal
 
 		virtual void process(sample **out, int num_frames)
 		{
+			if (this->rate == SIGNAL_RATE_CONTROL)
+			{
+				/*------------------------------------------------------------------------
+				 * At control rate, the line advances a block at a time, and its
+				 * value at the end of the block is written (or ramped to).
+				 *-----------------------------------------------------------------------*/
+				for (int channel = 0; channel < this->num_output_channels; channel++)
+				{
+					if (!step_target)
+						this->start(channel, 0);
+
+					int steps = std::max(0, std::min(num_frames, this->step_target - this->step));
+					this->value += this->value_change_per_step * steps;
+					this->step += steps;
+
+					this->write_control_value(out, num_frames, channel, this->value);
+				}
+				return;
+			}
+
 			for (int channel = 0; channel < this->num_output_channels; channel++)
 			{
 				for (int frame = 0; frame < num_frames; frame++)
 				{
 					if (!step_target)
-					{
-						float from = this->from->out[channel][frame];
-						float to = this->to->out[channel][frame];
-						float time = this->time->out[channel][frame];
-
-						this->step_target = this->graph->sample_rate * time;
-						this->value = from;
-						this->value_change_per_step = (to - from) / this->step_target;
-					}
+						this->start(channel, frame);
 
 					if (this->step < this->step_target)
 					{
@@ -59,6 +74,20 @@ namespace libsignal
 		int step;
 		int step_target;
 
+	private:
+		/*------------------------------------------------------------------------
+		 * Begin the line from the values of our inputs at `frame`.
+		 *-----------------------------------------------------------------------*/
+		void start(int channel, int frame)
+		{
+			float from = this->from->out[channel][frame];
+			float to = this->to->out[channel][frame];
+			float time = this->time->out[channel][frame];
+
+			this->step_target = this->graph->sample_rate * time;
+			this->value = from;
+			this->value_change_per_step = (to - from) / this->step_target;
+		}
 	};
 
 	REGISTER(Line, "line");
@@ -0,0 +1,87 @@
+#include "oscillator.h"
+#include "../graph.h"
+
+#include <algorithm>
+
+namespace libsignal
+{
+
+/*------------------------------------------------------------------------
+ * Wrap a phase into [0, 1), without branches or calls to floor(),
+ * so that loops containing it can be vectorised.
+ *-----------------------------------------------------------------------*/
+template <typename T>
+static inline T wrap_phase(T phase)
+{
+	T whole = (T) (int) phase;
+	return phase - whole + (phase < whole ? (T) 1 : (T) 0);
+}
+
+/*------------------------------------------------------------------------
+ * Rounding to float can carry a phase just below 1 up to 1.
+ *-----------------------------------------------------------------------*/
+static inline sample phase_to_sample(double phase)
+{
+	return std::min((sample) phase, (sample) 0.99999994);
+}
+
+Oscillator::Oscillator(NodeRef frequency) : frequency(frequency)
+{
+	this->add_input("frequency", this->frequency);
+	this->can_process_at_control_rate = true;
+
+	for (int channel = 0; channel < SIGNAL_MAX_CHANNELS; channel++)
+		this->phase[channel] = 0.0;
+}
+
+void Oscillator::process(sample **out, int num_frames)
+{
+	double inverse_sample_rate = 1.0 / this->graph->sample_rate;
+
+	for (int channel = 0; channel < this->num_output_channels; channel++)
+	{
+		sample *buffer = out[channel];
+		sample *frequency = this->frequency->out[channel];
+		double phase = this->phase[channel];
+
+		if (this->rate == SIGNAL_RATE_CONTROL)
+		{
+			/*------------------------------------------------------------------------
+			 * At control rate, render the phase at the start of the block,
+			 * then advance by the full block.
+			 *-----------------------------------------------------------------------*/
+			sample value = phase_to_sample(phase);
+			this->render(channel, &value, 1);
+			this->write_control_value(out, num_frames, channel, value);
+			phase += num_frames * frequency[0] * inverse_sample_rate;
+		}
+		else if (this->frequency->is_constant)
+		{
+			/*------------------------------------------------------------------------
+			 * Within a block, single precision relative to the block's
+			 * starting phase is enough, and twice as wide. The running
+			 * phase is still accumulated in double, so does not drift.
+			 *-----------------------------------------------------------------------*/
+			double phase_increment = frequency[0] * inverse_sample_rate;
+			sample start = (sample) phase;
+			sample increment = (sample) phase_increment;
+			for (int frame = 0; frame < num_frames; frame++)
+				buffer[frame] = std::min(wrap_phase(start + frame * increment), (sample) 0.99999994);
+			phase += num_frames * phase_increment;
+			this->render(channel, buffer, num_frames);
+		}
+		else
+		{
+			for (int frame = 0; frame < num_frames; frame++)
+			{
+				buffer[frame] = phase_to_sample(phase);
+				phase = wrap_phase(phase + frequency[frame] * inverse_sample_rate);
+			}
+			this->render(channel, buffer, num_frames);
+		}
+
+		this->phase[channel] = wrap_phase(phase);
+	}
+}
+
+}
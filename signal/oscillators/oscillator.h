@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../node.h"
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * Shared core of the periodic oscillators.
+	 *
+	 * Each block, Oscillator writes the phase of every frame, in [0, 1),
+	 * into the output buffer, then calls render() to turn those phases
+	 * into output samples in place.
+	 *
+	 * Phase is accumulated in double precision, using the reciprocal of
+	 * the sample rate, with branch-free wrapping. When the frequency is
+	 * constant over the block, each frame's phase is calculated directly
+	 * from the phase at the start of the block. Frames then don't depend
+	 * on each other, so the loop vectorises.
+	 *
+	 * Oscillators may also be run at control rate (see Node::set_rate).
+	 *------------------------------------------------------------------------*/
+	class Oscillator : public Node
+	{
+		public:
+			Oscillator(NodeRef frequency = 440);
+
+			virtual void process(sample **out, int num_frames);
+
+			/*------------------------------------------------------------------------
+			 * Replace `num_frames` phases in `buffer` with output samples.
+			 *-----------------------------------------------------------------------*/
+			virtual void render(int channel, sample *buffer, int num_frames) = 0;
+
+			NodeRef frequency;
+			double phase[SIGNAL_MAX_CHANNELS];
+	};
+}
@@ -0,0 +1,176 @@
+#include "oscillator_bank.h"
+#include "../graph.h"
+#include "../kernels/kernels.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace libsignal
+{
+
+OscillatorBankPartials::OscillatorBankPartials(const std::vector<float> &frequencies, const std::vector<float> &amplitudes,
+                                               const std::vector<float> &phases, int num_channels, float sample_rate)
+{
+	this->num_partials = frequencies.size();
+	this->num_channels = num_channels;
+	this->channel_offsets.resize(num_channels + 1);
+
+	this->frequencies.reserve(this->num_partials);
+	this->amplitudes.reserve(this->num_partials);
+	this->real.reserve(this->num_partials);
+	this->imag.reserve(this->num_partials);
+
+	/*------------------------------------------------------------------------
+	 * Store each channel's partials contiguously, so that each channel can
+	 * be rendered with a single call to the kernel. Missing amplitudes
+	 * default to 1, and missing phases to 0.
+	 *-----------------------------------------------------------------------*/
+	for (int channel = 0; channel < num_channels; channel++)
+	{
+		this->channel_offsets[channel] = this->frequencies.size();
+		for (int partial = channel; partial < this->num_partials; partial += num_channels)
+		{
+			float phase = partial < (int) phases.size() ? phases[partial] : 0.0;
+			this->frequencies.push_back(frequencies[partial]);
+			this->amplitudes.push_back(partial < (int) amplitudes.size() ? amplitudes[partial] : 1.0);
+			this->real.push_back(cos(2.0 * M_PI * phase));
+			this->imag.push_back(sin(2.0 * M_PI * phase));
+		}
+	}
+	this->channel_offsets[num_channels] = this->num_partials;
+
+	this->levels.resize(this->num_partials);
+	this->rotation_real.resize(this->num_partials);
+	this->rotation_imag.resize(this->num_partials);
+	this->set_sample_rate(sample_rate);
+}
+
+void OscillatorBankPartials::set_sample_rate(float sample_rate)
+{
+	this->sample_rate = sample_rate;
+
+	for (int partial = 0; partial < this->num_partials; partial++)
+	{
+		double increment = 2.0 * M_PI * this->frequencies[partial] / sample_rate;
+		this->rotation_real[partial] = cos(increment);
+		this->rotation_imag[partial] = sin(increment);
+		bool audible = fabs(this->frequencies[partial]) < sample_rate / 2;
+		this->levels[partial] = audible ? this->amplitudes[partial] : 0.0;
+	}
+}
+
+OscillatorBank::OscillatorBank(PropertyRef frequencies, PropertyRef amplitudes, PropertyRef phases, int channels) :
+	frequencies(frequencies), amplitudes(amplitudes), phases(phases), channels(channels)
+{
+	this->name = "oscillator_bank";
+
+	if (channels < 1)
+		throw std::runtime_error("OscillatorBank: must have at least one output channel");
+
+	this->num_input_channels = 0;
+	this->num_output_channels = channels;
+
+	this->min_input_channels = this->max_input_channels = 0;
+	this->min_output_channels = this->max_output_channels = this->num_output_channels;
+
+	Node::set_property("frequencies", this->frequencies);
+	Node::set_property("amplitudes", this->amplitudes);
+	Node::set_property("phases", this->phases);
+
+	this->partials = this->create_partials();
+}
+
+void OscillatorBank::set_property(std::string name, PropertyRef value)
+{
+	Node::set_property(name, value);
+
+	if (name == "frequencies")
+		this->frequencies = value;
+	else if (name == "amplitudes")
+		this->amplitudes = value;
+	else if (name == "phases")
+		this->phases = value;
+	else
+		return;
+
+	this->update_partials(name == "phases");
+}
+
+std::shared_ptr<OscillatorBankPartials> OscillatorBank::create_partials()
+{
+	std::vector<float> frequencies = this->frequencies ? this->frequencies->float_array_value() : std::vector<float>();
+	std::vector<float> amplitudes = this->amplitudes ? this->amplitudes->float_array_value() : std::vector<float>();
+	std::vector<float> phases = this->phases ? this->phases->float_array_value() : std::vector<float>();
+	float sample_rate = this->graph ? this->graph->sample_rate : 44100.0;
+
+	return std::shared_ptr<OscillatorBankPartials>(new OscillatorBankPartials(frequencies, amplitudes, phases,
+	                                                                          this->channels, sample_rate));
+}
+
+void OscillatorBank::update_partials(bool reset_phases)
+{
+	/*------------------------------------------------------------------------
+	 * Build the new partials on the calling thread, and swap them in on
+	 * the audio thread. Unless phases have been given, each partial picks
+	 * up where the corresponding partial left off.
+	 *-----------------------------------------------------------------------*/
+	std::shared_ptr<OscillatorBankPartials> partials = this->create_partials();
+
+	this->defer_edit([this, partials, reset_phases]
+	{
+		std::shared_ptr<OscillatorBankPartials> previous = this->partials;
+		if (previous && !reset_phases)
+		{
+			for (int channel = 0; channel < this->channels; channel++)
+			{
+				int start = partials->channel_offsets[channel];
+				int previous_start = previous->channel_offsets[channel];
+				int count = std::min(partials->channel_offsets[channel + 1] - start,
+				                     previous->channel_offsets[channel + 1] - previous_start);
+				std::copy_n(previous->real.data() + previous_start, count, partials->real.data() + start);
+				std::copy_n(previous->imag.data() + previous_start, count, partials->imag.data() + start);
+			}
+		}
+
+		this->partials = partials;
+		if (this->graph)
+			this->graph->retire(std::move(previous));
+	});
+}
+
+void OscillatorBank::process(sample **out, int num_frames)
+{
+	for (int channel = 0; channel < this->num_output_channels; channel++)
+		vector_fill(out[channel], 0.0, num_frames);
+
+	OscillatorBankPartials *partials = this->partials.get();
+	if (!partials)
+		return;
+
+	if (partials->sample_rate != this->graph->sample_rate)
+		partials->set_sample_rate(this->graph->sample_rate);
+
+	for (int channel = 0; channel < this->num_output_channels; channel++)
+	{
+		int start = partials->channel_offsets[channel];
+		int count = partials->channel_offsets[channel + 1] - start;
+		vector_sine_bank(partials->real.data() + start, partials->imag.data() + start,
+		                 partials->rotation_real.data() + start, partials->rotation_imag.data() + start,
+		                 partials->levels.data() + start, count, out[channel], num_frames);
+	}
+
+	/*------------------------------------------------------------------------
+	 * Rounding slowly changes the magnitude of each phasor. Restore it to
+	 * 1 once per block, with a Newton step towards 1 / sqrt(magnitude^2).
+	 *-----------------------------------------------------------------------*/
+	sample *real = partials->real.data();
+	sample *imag = partials->imag.data();
+	for (int partial = 0; partial < partials->num_partials; partial++)
+	{
+		sample correction = 1.5f - 0.5f * (real[partial] * real[partial] + imag[partial] * imag[partial]);
+		real[partial] *= correction;
+		imag[partial] *= correction;
+	}
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../node.h"
+
+#include <memory>
+#include <vector>
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * The partials of an OscillatorBank, grouped by output channel. Each
+	 * partial is a unit phasor (real, imag), rotated every frame by its
+	 * frequency, and scaled by its level.
+	 *------------------------------------------------------------------------*/
+	class OscillatorBankPartials
+	{
+		public:
+			OscillatorBankPartials(const std::vector<float> &frequencies, const std::vector<float> &amplitudes,
+			                       const std::vector<float> &phases, int num_channels, float sample_rate);
+
+			/*------------------------------------------------------------------------
+			 * Recalculate each partial's rotation for a new sample rate.
+			 * Partials at or above the Nyquist frequency are silenced.
+			 *-----------------------------------------------------------------------*/
+			void set_sample_rate(float sample_rate);
+
+			int num_partials;
+			int num_channels;
+			float sample_rate;
+
+			/*------------------------------------------------------------------------
+			 * The partials of channel `c` are those from channel_offsets[c]
+			 * up to channel_offsets[c + 1].
+			 *-----------------------------------------------------------------------*/
+			std::vector<int> channel_offsets;
+
+			std::vector<sample> frequencies;
+			std::vector<sample> amplitudes;
+			std::vector<sample> levels;
+			std::vector<sample> real;
+			std::vector<sample> imag;
+			std::vector<sample> rotation_real;
+			std::vector<sample> rotation_imag;
+	};
+
+	/**------------------------------------------------------------------------
+	 * A bank of sine oscillators, rendered together.
+	 *
+	 * The frequency, amplitude and initial phase (from 0 to 1) of each
+	 * partial are given as float array properties. Partials are summed
+	 * into `channels` output channels in turn: partial i is heard on
+	 * channel (i % channels).
+	 *
+	 * Properties are read when they are set, and take effect at the start
+	 * of the next block. Changing frequencies or amplitudes preserves the
+	 * phase of each partial; setting phases resets them.
+	 *------------------------------------------------------------------------*/
+	class OscillatorBank : public Node
+	{
+		public:
+			OscillatorBank(PropertyRef frequencies = {}, PropertyRef amplitudes = {},
+			               PropertyRef phases = {}, int channels = 1);
+
+			virtual void process(sample **out, int num_frames);
+			virtual void set_property(std::string name, PropertyRef value);
+
+			PropertyRef frequencies;
+			PropertyRef amplitudes;
+			PropertyRef phases;
+			int channels;
+
+		private:
+			std::shared_ptr<OscillatorBankPartials> create_partials();
+			void update_partials(bool reset_phases);
+
+			std::shared_ptr<OscillatorBankPartials> partials;
+	};
+
+	REGISTER(OscillatorBank, "oscillator_bank");
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../constants.h"
+
+/**-------------------------------------------------------------------------
+ * @file polyblep.h
+ * @brief Polynomial band-limited step (PolyBLEP) and ramp (PolyBLAMP)
+ *        residuals, used to suppress aliasing in oscillators with
+ *        discontinuities in their value or slope.
+ *
+ * Each takes the oscillator's phase `t` in [0, 1), measured from the
+ * discontinuity, and its phase increment per sample `dt`. The result is
+ * non-zero only within one sample either side of the discontinuity.
+ * Both are written as selects rather than branches, so that they
+ * vectorise.
+ *-----------------------------------------------------------------------*/
+
+namespace libsignal
+{
+	/*------------------------------------------------------------------------
+	 * Residual for a downward step of height 2 at t = 0.
+	 * Subtract it from the waveform (scaled by half the step height).
+	 *-----------------------------------------------------------------------*/
+	inline sample poly_blep(sample t, sample dt)
+	{
+		sample before = (t - 1) / dt;
+		sample after = t / dt;
+		sample rv = 0;
+		rv = (t < dt) ? (after + after - after * after - 1) : rv;
+		rv = (t > 1 - dt) ? (before * before + before + before + 1) : rv;
+		return rv;
+	}
+
+	/*------------------------------------------------------------------------
+	 * Residual for an upward change of slope of 2 per sample at t = 0.
+	 * Add it to the waveform, scaled by half the change in slope.
+	 *-----------------------------------------------------------------------*/
+	inline sample poly_blamp(sample t, sample dt)
+	{
+		sample before = (t - 1) / dt + 1;
+		sample after = t / dt - 1;
+		sample rv = 0;
+		rv = (t < dt) ? (after * after * after * (sample) (-1.0 / 3.0)) : rv;
+		rv = (t > 1 - dt) ? (before * before * before * (sample) (1.0 / 3.0)) : rv;
+		return rv;
+	}
+}
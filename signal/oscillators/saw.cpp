@@ -1,23 +1,33 @@
 #include "saw.h"
+#include "polyblep.h"
 #include "../graph.h"
+#include "../kernels/kernels.h"
+
+#include <math.h>
 
 namespace libsignal
 {
 
-void Saw::process(sample **out, int num_frames)
+void Saw::render(int channel, sample *buffer, int num_frames)
 {
-	for (int channel = 0; channel < this->num_output_channels; channel++)
+	if (this->waveform == SIGNAL_WAVEFORM_NAIVE)
 	{
-		for (int frame = 0; frame < num_frames; frame++)
-		{
-			float rv = (this->phase[channel] * 2.0) - 1.0;
+		vector_scale_offset(buffer, 2.0, -1.0, buffer, num_frames);
+		return;
+	}
 
-			out[channel][frame] = rv;
+	bool constant_frequency = this->frequency->is_constant;
+	sample *frequency = this->frequency->out[channel];
+	sample inverse_sample_rate = 1.0 / this->graph->sample_rate;
+	sample dt = fabsf(frequency[0]) * inverse_sample_rate;
+
+	for (int frame = 0; frame < num_frames; frame++)
+	{
+		if (!constant_frequency)
+			dt = fabsf(frequency[frame]) * inverse_sample_rate;
 
-			this->phase[channel] += this->frequency->out[channel][frame] / this->graph->sample_rate;
-			while (this->phase[channel] >= 1.0)
-				this->phase[channel] -= 1.0;
-		}
+		sample t = buffer[frame];
+		buffer[frame] = t * 2 - 1 - poly_blep(t, dt);
 	}
 }
 
@@ -1,24 +1,25 @@
 #pragma once 
 
-#include "../node.h"
+#include "oscillator.h"
 
 namespace libsignal
 {
-	class Saw : public Node
+	class Saw : public Oscillator
 	{
 	public:
-		Saw(NodeRef frequency = 440) : frequency(frequency)
+		Saw(NodeRef frequency = 440, signal_waveform_t waveform = SIGNAL_WAVEFORM_NAIVE) : Oscillator(frequency), waveform(waveform)
 		{
 			this->name = "saw";
-			this->add_input("frequency", this->frequency);
-			memset(this->phase, 0, sizeof(this->phase));
 		};
 
-		NodeRef frequency;
+		/*------------------------------------------------------------------------
+		 * With SIGNAL_WAVEFORM_BAND_LIMITED, the discontinuity is smoothed
+		 * with a PolyBLEP correction, which greatly reduces aliasing at high
+		 * frequencies.
+		 *-----------------------------------------------------------------------*/
+		signal_waveform_t waveform;
 
-		float phase[SIGNAL_MAX_CHANNELS];
-
-		virtual void process(sample **out, int num_frames);
+		virtual void render(int channel, sample *buffer, int num_frames);
 	};
 
 	REGISTER(Saw, "saw");
@@ -1,25 +1,19 @@
 #pragma once 
 
-#include "../node.h"
+#include "oscillator.h"
 
 namespace libsignal
 {
-	class Sine : public Node
+	class Sine : public Oscillator
 	{
 	public:
-		Sine(NodeRef frequency = 440) : frequency(frequency)
+		Sine(NodeRef frequency = 440) : Oscillator(frequency)
 		{
 			this->name = "sine";
-			this->add_input("frequency", this->frequency);
-			memset(this->phase, 0, sizeof(this->phase));
 		}
 
-		NodeRef frequency;
-		float phase[SIGNAL_MAX_CHANNELS];
-
-		virtual void process(sample **out, int num_frames);
+		virtual void render(int channel, sample *buffer, int num_frames);
 	};
 
 	REGISTER(Sine, "sine");
 }
-
@@ -1,25 +1,57 @@
 #include "square.h"
+#include "polyblep.h"
 #include "../graph.h"
 
+#include <math.h>
+
 namespace libsignal
 {
 
-void Square::process(sample **out, int num_frames)
+void Square::render(int channel, sample *buffer, int num_frames)
 {
-	for (int channel = 0; channel < this->num_output_channels; channel++)
+	sample *width = this->width->out[channel];
+
+	if (this->waveform == SIGNAL_WAVEFORM_NAIVE)
 	{
-		for (int frame = 0; frame < num_frames; frame++)
+		/*------------------------------------------------------------------------
+		 * With a constant width, the width is only read once per block.
+		 *-----------------------------------------------------------------------*/
+		if (this->width->is_constant)
 		{
-			float frequency = this->frequency->out[channel][frame];
-			float width = this->width->out[channel][frame];
-			float rv = (this->phase[channel] < width) ? 1 : -1;
+			sample constant_width = width[0];
+			for (int frame = 0; frame < num_frames; frame++)
+				buffer[frame] = (buffer[frame] < constant_width) ? 1 : -1;
+		}
+		else
+		{
+			for (int frame = 0; frame < num_frames; frame++)
+				buffer[frame] = (buffer[frame] < width[frame]) ? 1 : -1;
+		}
+		return;
+	}
 
-			out[channel][frame] = rv;
+	bool constant_frequency = this->frequency->is_constant;
+	bool constant_width = this->width->is_constant;
+	sample *frequency = this->frequency->out[channel];
+	sample inverse_sample_rate = 1.0 / this->graph->sample_rate;
+	sample dt = fabsf(frequency[0]) * inverse_sample_rate;
+	sample w = width[0];
 
-			this->phase[channel] += 1.0 / (this->graph->sample_rate / frequency);
-			if (this->phase[channel] >= 1.0)
-				this->phase[channel] -= 1.0;
-		}
+	for (int frame = 0; frame < num_frames; frame++)
+	{
+		if (!constant_frequency)
+			dt = fabsf(frequency[frame]) * inverse_sample_rate;
+		if (!constant_width)
+			w = width[frame];
+
+		/*------------------------------------------------------------------------
+		 * A rising edge at phase 0, and a falling edge at phase `width`.
+		 *-----------------------------------------------------------------------*/
+		sample t = buffer[frame];
+		sample falling = t - w;
+		falling += (falling < 0) ? 1 : 0;
+		sample rv = (t < w) ? 1 : -1;
+		buffer[frame] = rv + poly_blep(t, dt) - poly_blep(falling, dt);
 	}
 }
 
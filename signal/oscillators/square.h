@@ -1,26 +1,29 @@
 #pragma once 
 
-#include "../node.h"
+#include "oscillator.h"
 
 namespace libsignal
 {
-	class Square : public Node
+	class Square : public Oscillator
 	{
 	public:
-		Square(NodeRef frequency = 440, NodeRef width = 0.5) : frequency(frequency), width(width)
+		Square(NodeRef frequency = 440, NodeRef width = 0.5, signal_waveform_t waveform = SIGNAL_WAVEFORM_NAIVE) :
+			Oscillator(frequency), width(width), waveform(waveform)
 		{
 			this->name = "square";
-			this->add_input("frequency", this->frequency);
 			this->add_input("width", this->width);
-			memset(this->phase, 0, sizeof(this->phase));
 		};
 
-		NodeRef frequency;
 		NodeRef width;
 
-		float phase[SIGNAL_MAX_CHANNELS];
+		/*------------------------------------------------------------------------
+		 * With SIGNAL_WAVEFORM_BAND_LIMITED, both edges are smoothed with
+		 * a PolyBLEP correction, which greatly reduces aliasing at high
+		 * frequencies.
+		 *-----------------------------------------------------------------------*/
+		signal_waveform_t waveform;
 
-		virtual void process(sample **out, int num_frames);
+		virtual void render(int channel, sample *buffer, int num_frames);
 	};
 
 	REGISTER(Square, "square");
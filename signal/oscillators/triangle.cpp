@@ -1,23 +1,44 @@
 #include "triangle.h"
+#include "polyblep.h"
 #include "../graph.h"
 
+#include <math.h>
+
 namespace libsignal
 {
 
-void Triangle::process(sample **out, int num_frames)
+void Triangle::render(int channel, sample *buffer, int num_frames)
 {
-	for (int channel = 0; channel < this->num_output_channels; channel++)
+	/*------------------------------------------------------------------------
+	 * Rises from -1 to 1 over the first half-cycle and falls back over
+	 * the second, written without a branch so that it vectorises.
+	 *-----------------------------------------------------------------------*/
+	if (this->waveform == SIGNAL_WAVEFORM_NAIVE)
 	{
 		for (int frame = 0; frame < num_frames; frame++)
-		{
-			float rv = (this->phase[channel] < 0.5) ? (this->phase[channel] * 4.0 - 1.0) : (1.0 - (this->phase[channel] - 0.5) * 4.0);
+			buffer[frame] = 1.0f - 4.0f * fabsf(buffer[frame] - 0.5f);
+		return;
+	}
 
-			out[channel][frame] = rv;
+	bool constant_frequency = this->frequency->is_constant;
+	sample *frequency = this->frequency->out[channel];
+	sample inverse_sample_rate = 1.0 / this->graph->sample_rate;
+	sample dt = fabsf(frequency[0]) * inverse_sample_rate;
+
+	for (int frame = 0; frame < num_frames; frame++)
+	{
+		if (!constant_frequency)
+			dt = fabsf(frequency[frame]) * inverse_sample_rate;
 
-			this->phase[channel] += this->frequency->out[channel][frame] / this->graph->sample_rate;
-			while (this->phase[channel] >= 1.0)
-				this->phase[channel] -= 1.0;
-		}
+		/*------------------------------------------------------------------------
+		 * At each corner, the slope changes by 8 per cycle (8 * dt per
+		 * sample): upward at phase 0, downward at phase 0.5.
+		 *-----------------------------------------------------------------------*/
+		sample t = buffer[frame];
+		sample opposite = t + 0.5f;
+		opposite -= (opposite >= 1) ? 1 : 0;
+		sample rv = 1.0f - 4.0f * fabsf(t - 0.5f);
+		buffer[frame] = rv + 4 * dt * (poly_blamp(t, dt) - poly_blamp(opposite, dt));
 	}
 }
 
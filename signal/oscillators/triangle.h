@@ -1,24 +1,25 @@
 #pragma once 
 
-#include "../node.h"
+#include "oscillator.h"
 
 namespace libsignal
 {
-	class Triangle : public Node
+	class Triangle : public Oscillator
 	{
 	public:
-		Triangle(NodeRef frequency = 440) : frequency(frequency)
+		Triangle(NodeRef frequency = 440, signal_waveform_t waveform = SIGNAL_WAVEFORM_NAIVE) : Oscillator(frequency), waveform(waveform)
 		{
 			this->name = "triangle";
-			this->add_input("frequency", this->frequency);
-			memset(this->phase, 0, sizeof(this->phase));
 		};
 
-		NodeRef frequency;
+		/*------------------------------------------------------------------------
+		 * With SIGNAL_WAVEFORM_BAND_LIMITED, both corners are smoothed with
+		 * a PolyBLAMP correction, which greatly reduces aliasing at high
+		 * frequencies.
+		 *-----------------------------------------------------------------------*/
+		signal_waveform_t waveform;
 
-		float phase[SIGNAL_MAX_CHANNELS];
-
-		virtual void process(sample **out, int num_frames);
+		virtual void render(int channel, sample *buffer, int num_frames);
 	};
 
 	REGISTER(Triangle, "triangle");
@@ -0,0 +1,96 @@
+#include "unison.h"
+#include "../graph.h"
+#include "../kernels/kernels.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace libsignal
+{
+
+Unison::Unison(NodeRef frequency, NodeRef voices, NodeRef detune, NodeRef spread, signal_shape_t shape, int channels) :
+	frequency(frequency), voices(voices), detune(detune), spread(spread), shape(shape)
+{
+	this->name = "unison";
+
+	if (channels < 1 || channels > SIGNAL_MAX_CHANNELS)
+		throw std::runtime_error("Unison: invalid number of output channels");
+
+	this->num_input_channels = 1;
+	this->num_output_channels = channels;
+
+	this->min_input_channels = this->max_input_channels = 1;
+	this->min_output_channels = this->max_output_channels = channels;
+
+	this->add_input("frequency", this->frequency);
+	this->add_input("voices", this->voices);
+	this->add_input("detune", this->detune);
+	this->add_input("spread", this->spread);
+
+	/*------------------------------------------------------------------------
+	 * Start each voice at a different phase, spaced by the golden ratio,
+	 * so that voices do not sum to a single sharp edge when triggered.
+	 *-----------------------------------------------------------------------*/
+	for (int voice = 0; voice < SIGNAL_UNISON_MAX_VOICES; voice++)
+		this->phase[voice] = fmod(voice * 0.6180339887, 1.0);
+
+	this->num_voices = 0;
+	this->current_detune = 0.0;
+	this->current_spread = 0.0;
+	this->current_sample_rate = 0.0;
+}
+
+void Unison::update_voices(int num_voices, sample detune, sample spread)
+{
+	this->num_voices = num_voices;
+	this->current_detune = detune;
+	this->current_spread = spread;
+	this->current_sample_rate = this->graph->sample_rate;
+
+	/*------------------------------------------------------------------------
+	 * Equal-power panning between the two output channels either side of
+	 * each voice's position, with the sum normalised by the voice count.
+	 *-----------------------------------------------------------------------*/
+	int num_channels = this->num_output_channels;
+	sample level = 1.0 / sqrtf(num_voices);
+	std::fill_n(this->gain, num_channels * num_voices, 0.0);
+
+	for (int voice = 0; voice < num_voices; voice++)
+	{
+		sample offset = (num_voices > 1) ? (2.0f * voice / (num_voices - 1) - 1.0f) : 0.0f;
+		this->increment[voice] = powf(2.0f, offset * detune / 12.0f) / this->current_sample_rate;
+
+		if (num_channels == 1)
+		{
+			this->gain[voice] = level;
+			continue;
+		}
+
+		sample pan = 0.5f + 0.5f * offset * std::min(std::max(spread, 0.0f), 1.0f);
+		sample position = pan * (num_channels - 1);
+		int left = std::min((int) position, num_channels - 2);
+		sample angle = (position - left) * M_PI_2;
+		this->gain[left * num_voices + voice] = level * cosf(angle);
+		this->gain[(left + 1) * num_voices + voice] = level * sinf(angle);
+	}
+}
+
+void Unison::process(sample **out, int num_frames)
+{
+	int num_voices = (int) roundf(this->voices->out[0][0]);
+	num_voices = std::max(1, std::min(num_voices, SIGNAL_UNISON_MAX_VOICES));
+	sample detune = this->detune->out[0][0];
+	sample spread = this->spread->out[0][0];
+
+	if (num_voices != this->num_voices || detune != this->current_detune ||
+	    spread != this->current_spread || this->graph->sample_rate != this->current_sample_rate)
+		this->update_voices(num_voices, detune, spread);
+
+	for (int channel = 0; channel < this->num_output_channels; channel++)
+		vector_fill(out[channel], 0.0, num_frames);
+
+	vector_unison(this->phase, this->increment, this->gain, this->num_voices, this->num_output_channels,
+	              this->shape, this->frequency->out[0], out, num_frames);
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../node.h"
+
+namespace libsignal
+{
+	/**------------------------------------------------------------------------
+	 * Unison oscillator: several detuned, band-limited copies of one
+	 * waveform, panned across the output channels (a "supersaw", with
+	 * the default shape).
+	 *
+	 * `voices` (1 to SIGNAL_UNISON_MAX_VOICES) sets the number of copies.
+	 * Their frequencies are spread evenly over `detune` semitones either
+	 * side of `frequency`, and their pan positions evenly over the output
+	 * channels, from the first to the last, scaled by `spread` (0 to 1).
+	 * Voice count, detune and spread are read once per block, and changes
+	 * take effect without allocating.
+	 *------------------------------------------------------------------------*/
+	class Unison : public Node
+	{
+		public:
+			Unison(NodeRef frequency = 440, NodeRef voices = 7, NodeRef detune = 0.25, NodeRef spread = 1.0,
+			       signal_shape_t shape = SIGNAL_SHAPE_SAW, int channels = 2);
+
+			virtual void process(sample **out, int num_frames);
+
+			NodeRef frequency;
+			NodeRef voices;
+			NodeRef detune;
+			NodeRef spread;
+			signal_shape_t shape;
+
+		private:
+			void update_voices(int num_voices, sample detune, sample spread);
+
+			/*------------------------------------------------------------------------
+			 * Per-voice state, sized for the most voices so that the voice
+			 * count can change on the audio thread. Gains are packed by
+			 * channel, num_voices apart.
+			 *-----------------------------------------------------------------------*/
+			sample phase[SIGNAL_UNISON_MAX_VOICES];
+			sample increment[SIGNAL_UNISON_MAX_VOICES];
+			sample gain[SIGNAL_MAX_CHANNELS * SIGNAL_UNISON_MAX_VOICES];
+
+			int num_voices;
+			sample current_detune;
+			sample current_spread;
+			sample current_sample_rate;
+	};
+
+	REGISTER(Unison, "unison");
+}
@@ -0,0 +1,271 @@
+#include "wavetable.h"
+#include "../graph.h"
+#include "../kernels/kernels.h"
+#include "../fft/backend/abstract.h"
+
+#include <algorithm>
+#include <math.h>
+#include <memory>
+
+namespace libsignal
+{
+
+/*------------------------------------------------------------------------
+ * 4-point, 3rd-order Hermite (Catmull-Rom) interpolation between
+ * y1 and y2.
+ *-----------------------------------------------------------------------*/
+static inline sample interpolate_cubic(sample y0, sample y1, sample y2, sample y3, sample frac)
+{
+	sample c1 = 0.5f * (y2 - y0);
+	sample c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+	sample c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+	return ((c3 * frac + c2) * frac + c1) * frac + y1;
+}
+
+WavetableMipmap::WavetableMipmap(BufferRef table, int frame_size)
+{
+	if (frame_size <= 0)
+		frame_size = table->num_frames;
+	if (frame_size > table->num_frames)
+		throw std::runtime_error("Wavetable: frame_size is longer than the table");
+
+	/*------------------------------------------------------------------------
+	 * Each frame is resampled to a power-of-two period, which determines
+	 * how many harmonics it can hold; the stored levels are then
+	 * oversampled to at least SIGNAL_WAVETABLE_MIN_LENGTH, so that
+	 * interpolation between samples stays accurate.
+	 *-----------------------------------------------------------------------*/
+	int period = 4;
+	while (period < frame_size)
+		period <<= 1;
+
+	this->num_channels = table->num_channels;
+	this->num_waveforms = table->num_frames / frame_size;
+	this->num_harmonics = period / 2;
+	this->num_levels = (int) log2(this->num_harmonics) + 1;
+	this->length = std::max(period, SIGNAL_WAVETABLE_MIN_LENGTH);
+	this->data.resize(this->num_channels * this->num_waveforms * this->num_levels * (this->length + 3));
+
+	/*------------------------------------------------------------------------
+	 * Spectra are packed split complex (see FFTBackend_Abstract), and
+	 * scaled by 2 in the forward transform only, so each level is scaled
+	 * by 1 / (2 * period) to restore the frame's amplitude.
+	 *-----------------------------------------------------------------------*/
+	std::unique_ptr<FFTBackend_Abstract> analysis(FFTBackend_Abstract::create(period));
+	std::unique_ptr<FFTBackend_Abstract> synthesis(FFTBackend_Abstract::create(this->length));
+	std::vector<sample> frame(period);
+	std::vector<sample> harmonics(period);
+	std::vector<sample> spectrum(this->length);
+	int num_bins = this->length / 2;
+
+	for (int channel = 0; channel < this->num_channels; channel++)
+	{
+		for (int waveform = 0; waveform < this->num_waveforms; waveform++)
+		{
+			const sample *source = table->data[channel] + waveform * frame_size;
+			for (int index = 0; index < period; index++)
+			{
+				double offset = (double) index * frame_size / period;
+				int whole = (int) offset;
+				frame[index] = interpolate_cubic(source[(whole + frame_size - 1) % frame_size],
+				                                 source[whole],
+				                                 source[(whole + 1) % frame_size],
+				                                 source[(whole + 2) % frame_size],
+				                                 offset - whole);
+			}
+			analysis->forward(frame.data(), harmonics.data());
+
+			for (int level = 0; level < this->num_levels; level++)
+			{
+				/*------------------------------------------------------------------------
+				 * Keep the lowest `num_harmonics >> level` harmonics, and
+				 * resynthesise at the stored length. The component at the
+				 * frame's own Nyquist frequency (held in place of the DC
+				 * bin's imaginary part) is real, and is halved unless it is
+				 * also the Nyquist frequency of the stored length.
+				 *-----------------------------------------------------------------------*/
+				std::fill(spectrum.begin(), spectrum.end(), 0.0f);
+				spectrum[0] = harmonics[0];
+				for (int harmonic = 1; harmonic <= (this->num_harmonics >> level); harmonic++)
+				{
+					if (harmonic == period / 2)
+					{
+						if (harmonic == num_bins)
+							spectrum[num_bins] = harmonics[period / 2];
+						else
+							spectrum[harmonic] = 0.5f * harmonics[period / 2];
+					}
+					else
+					{
+						spectrum[harmonic] = harmonics[harmonic];
+						spectrum[num_bins + harmonic] = harmonics[period / 2 + harmonic];
+					}
+				}
+
+				sample *out = this->get_level(channel, waveform, level);
+				synthesis->inverse(spectrum.data(), out);
+				vector_multiply_scalar(out, 0.5f / period, out, this->length);
+				out[-1] = out[this->length - 1];
+				out[this->length] = out[0];
+				out[this->length + 1] = out[1];
+			}
+		}
+	}
+}
+
+int WavetableMipmap::get_level_index(sample normalised_frequency) const
+{
+	/*------------------------------------------------------------------------
+	 * Level n holds harmonics up to (num_harmonics >> n), which stay
+	 * below Nyquist if 2^n >= 2 * num_harmonics * frequency / sample_rate.
+	 *-----------------------------------------------------------------------*/
+	int exponent;
+	sample mantissa = frexpf(fabsf(normalised_frequency) * 2 * this->num_harmonics, &exponent);
+	int level = (mantissa == 0.5f) ? exponent - 1 : exponent;
+	return std::max(0, std::min(level, this->num_levels - 1));
+}
+
+Wavetable::Wavetable(BufferRef table, NodeRef frequency, signal_interpolate_t interpolate, NodeRef position, int frame_size) :
+	Oscillator(frequency), table(table), position(position), interpolate(interpolate), frame_size(frame_size)
+{
+	this->name = "wavetable";
+
+	this->add_input("position", this->position);
+	this->add_buffer("table", this->table);
+
+	if (this->table)
+		this->mipmap = std::shared_ptr<WavetableMipmap>(new WavetableMipmap(this->table, this->frame_size));
+}
+
+void Wavetable::set_buffer(std::string name, BufferRef buffer)
+{
+	if (name != "table")
+	{
+		Node::set_buffer(name, buffer);
+		return;
+	}
+
+	/*------------------------------------------------------------------------
+	 * Building mip levels is slow, so do it on the calling thread, and
+	 * only swap the table and its mip levels on the audio thread.
+	 *-----------------------------------------------------------------------*/
+	std::shared_ptr<WavetableMipmap> mipmap;
+	if (buffer)
+		mipmap = std::shared_ptr<WavetableMipmap>(new WavetableMipmap(buffer, this->frame_size));
+
+	this->defer_edit([this, buffer, mipmap]
+	{
+		this->Node::set_buffer("table", buffer);
+		std::shared_ptr<WavetableMipmap> previous = this->mipmap;
+		this->mipmap = mipmap;
+		if (this->graph)
+			this->graph->retire(std::move(previous));
+	});
+}
+
+/*------------------------------------------------------------------------
+ * Read a mip level at a block of phases, with the given interpolation.
+ *-----------------------------------------------------------------------*/
+static inline void wavetable_read(signal_interpolate_t interpolate, const sample *table, sample length,
+                                  const sample *phase, sample *out, int num_frames)
+{
+	switch (interpolate)
+	{
+		case SIGNAL_INTERPOLATE_NONE:
+			vector_table_read(table, length, phase, out, num_frames);
+			break;
+		case SIGNAL_INTERPOLATE_LINEAR:
+			vector_table_read_linear(table, length, phase, out, num_frames);
+			break;
+		default:
+			vector_table_read_cubic(table, length, phase, out, num_frames);
+			break;
+	}
+}
+
+void Wavetable::render(int channel, sample *buffer, int num_frames)
+{
+	if (!this->mipmap)
+	{
+		vector_fill(buffer, 0.0, num_frames);
+		return;
+	}
+
+	WavetableMipmap *mipmap = this->mipmap.get();
+	int table_channel = channel % mipmap->num_channels;
+	int last_waveform = mipmap->num_waveforms - 1;
+	sample length = mipmap->length;
+	sample inverse_sample_rate = 1.0 / this->graph->sample_rate;
+
+	sample *frequency = this->frequency->out[channel];
+	sample *position = this->position->out[channel];
+	bool constant_inputs = this->frequency->is_constant && this->position->is_constant;
+
+	/*------------------------------------------------------------------------
+	 * Find the mip level for the frequency at a given frame, and the pair
+	 * of table frames to crossfade between for its position.
+	 *-----------------------------------------------------------------------*/
+	auto locate = [&](int frame, int &level, int &waveform, sample &mix)
+	{
+		level = mipmap->get_level_index(frequency[frame] * inverse_sample_rate);
+		sample offset = std::min(std::max(position[frame], 0.0f), 1.0f) * last_waveform;
+		waveform = std::min((int) offset, std::max(last_waveform - 1, 0));
+		mix = offset - waveform;
+	};
+
+	/*------------------------------------------------------------------------
+	 * Frames are read in runs that share a level and pair of table frames,
+	 * so that each run can be read with the vector kernels. With constant
+	 * inputs, a run is the whole block.
+	 *-----------------------------------------------------------------------*/
+	sample from_values[SIGNAL_WAVETABLE_RUN_LENGTH];
+	sample mix[SIGNAL_WAVETABLE_RUN_LENGTH];
+
+	int frame = 0;
+	while (frame < num_frames)
+	{
+		int level, waveform;
+		locate(frame, level, waveform, mix[0]);
+
+		int run = 1;
+		int max_run = std::min(num_frames - frame, SIGNAL_WAVETABLE_RUN_LENGTH);
+		if (constant_inputs)
+		{
+			run = max_run;
+			vector_fill(mix, mix[0], run);
+		}
+		else
+		{
+			for (; run < max_run; run++)
+			{
+				int next_level, next_waveform;
+				locate(frame + run, next_level, next_waveform, mix[run]);
+				if (next_level != level || next_waveform != waveform)
+					break;
+			}
+		}
+
+		bool crossfade = false;
+		for (int index = 0; index < run; index++)
+			crossfade = crossfade || (mix[index] > 0);
+
+		sample *phase = buffer + frame;
+		sample *from = mipmap->get_level(table_channel, waveform, level);
+		if (!crossfade)
+		{
+			wavetable_read(this->interpolate, from, length, phase, phase, run);
+		}
+		else
+		{
+			sample *to = mipmap->get_level(table_channel, std::min(waveform + 1, last_waveform), level);
+			wavetable_read(this->interpolate, from, length, phase, from_values, run);
+			wavetable_read(this->interpolate, to, length, phase, phase, run);
+			for (int index = 0; index < run; index++)
+				phase[index] = from_values[index] + (phase[index] - from_values[index]) * mix[index];
+		}
+
+		frame += run;
+	}
+}
+
+}
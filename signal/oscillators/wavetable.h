@@ -1,42 +1,85 @@
-#pragma once 
+#pragma once
 
-#include "../node.h"
+#include "oscillator.h"
+
+#include <memory>
+#include <vector>
+
+#define SIGNAL_WAVETABLE_MIN_LENGTH 1024
+#define SIGNAL_WAVETABLE_RUN_LENGTH 256
 
 namespace libsignal
 {
-	class Wavetable : public Node
+	/**------------------------------------------------------------------------
+	 * Band-limited copies ("mip levels") of each frame of a wavetable.
+	 *
+	 * The table is read as a sequence of single-cycle frames, each
+	 * `frame_size` samples long. Each frame is resampled to a common
+	 * length, and each successive level keeps half as many harmonics as
+	 * the one before. A level can then be chosen for any fundamental
+	 * frequency such that no harmonic exceeds the Nyquist frequency.
+	 *
+	 * Built once, with an FFT, when the table is assigned.
+	 *------------------------------------------------------------------------*/
+	class WavetableMipmap
 	{
-	public:
-		Wavetable(BufferRef table = nullptr, NodeRef frequency = 440, bool interpolate = true) :
-			table(table), frequency(frequency), interpolate(interpolate)
-		{
-			this->name = "wavetable";
-			this->phase = 0.0;
-
-			this->add_input("frequency", this->frequency);
-		}
-
-		virtual void process(sample **out, int num_frames)
-		{
-			for (int frame = 0; frame < num_frames; frame++)
+		public:
+			WavetableMipmap(BufferRef table, int frame_size = 0);
+
+			/*------------------------------------------------------------------------
+			 * Returns the samples of the given channel, frame and level.
+			 * The pointer may be indexed from -1 to `length` + 1, with
+			 * samples outside [0, length) wrapping around the cycle.
+			 *-----------------------------------------------------------------------*/
+			sample *get_level(int channel, int waveform, int level)
 			{
-				float frequency = this->frequency->out[0][frame];
-				int index = this->phase * this->table->num_frames;
-				float rv = this->table->data[0][index];
+				int index = (channel * this->num_waveforms + waveform) * this->num_levels + level;
+				return &this->data[index * (this->length + 3) + 1];
+			}
 
-				this->out[0][frame] = rv;
+			/*------------------------------------------------------------------------
+			 * Returns the level to use for a fundamental frequency, given as
+			 * a multiple of the sample rate.
+			 *-----------------------------------------------------------------------*/
+			int get_level_index(sample normalised_frequency) const;
 
-				this->phase += (frequency / this->graph->sample_rate);
-				while (this->phase >= 1.0)
-					this->phase -= 1.0;
-			}
-		}
+			int num_channels;
+			int num_waveforms;
+			int num_levels;
+			int num_harmonics;
+			int length;
+
+		private:
+			std::vector<sample> data;
+	};
+
+	/**------------------------------------------------------------------------
+	 * Wavetable oscillator.
+	 *
+	 * Reads a single-cycle waveform from `table` without aliasing, using
+	 * band-limited mip levels, with no, linear or cubic interpolation.
+	 * Each output channel reads the corresponding channel of the table.
+	 *
+	 * If `frame_size` is set, the table holds several frames of that
+	 * size, and `position` (from 0 to 1) crossfades between them.
+	 *------------------------------------------------------------------------*/
+	class Wavetable : public Oscillator
+	{
+	public:
+		Wavetable(BufferRef table = nullptr, NodeRef frequency = 440,
+		          signal_interpolate_t interpolate = SIGNAL_INTERPOLATE_LINEAR,
+		          NodeRef position = 0.0, int frame_size = 0);
+
+		virtual void render(int channel, sample *buffer, int num_frames);
+		virtual void set_buffer(std::string name, BufferRef buffer);
 
 		BufferRef table;
-		NodeRef frequency;
-		float phase;
-		bool interpolate;
+		NodeRef position;
+		signal_interpolate_t interpolate;
+		int frame_size;
 
+	private:
+		std::shared_ptr<WavetableMipmap> mipmap;
 	};
 
 	REGISTER(Wavetable, "wavetable");
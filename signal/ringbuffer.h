@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <atomic>
+#include <utility>
 
 template <class T>
 class RingBuffer
@@ -62,3 +64,70 @@ T RingBuffer<T>::get(int index)
 	return data[new_index];
 }
 
+
+/*------------------------------------------------------------------------
+ * Wait-free single-producer, single-consumer queue.
+ *
+ * Exactly one thread may call push() and exactly one (other) thread may
+ * call pop(). Neither call ever blocks or allocates: push() returns false
+ * if the queue is full, and pop() returns false if it is empty.
+ * One slot is kept free to distinguish full from empty, so the queue
+ * holds up to (size - 1) items. Items are moved in and out, so a slot
+ * never holds a stale copy once popped.
+ *-----------------------------------------------------------------------*/
+template <class T>
+class LockFreeRingBuffer
+{
+	public:
+		LockFreeRingBuffer(int size);
+		~LockFreeRingBuffer();
+
+		bool push(T value);
+		bool pop(T &value);
+
+	private:
+		T *data = nullptr;
+		int size;
+		std::atomic<int> read_position;
+		std::atomic<int> write_position;
+};
+
+template <class T>
+LockFreeRingBuffer<T>::LockFreeRingBuffer(int size)
+{
+	this->data = new T[size]();
+	this->size = size;
+	this->read_position = 0;
+	this->write_position = 0;
+}
+
+template <class T>
+LockFreeRingBuffer<T>::~LockFreeRingBuffer()
+{
+	delete[] this->data;
+}
+
+template <class T>
+bool LockFreeRingBuffer<T>::push(T value)
+{
+	int write_position = this->write_position.load(std::memory_order_relaxed);
+	int next_position = (write_position + 1) % this->size;
+	if (next_position == this->read_position.load(std::memory_order_acquire))
+		return false;
+
+	this->data[write_position] = std::move(value);
+	this->write_position.store(next_position, std::memory_order_release);
+	return true;
+}
+
+template <class T>
+bool LockFreeRingBuffer<T>::pop(T &value)
+{
+	int read_position = this->read_position.load(std::memory_order_relaxed);
+	if (read_position == this->write_position.load(std::memory_order_acquire))
+		return false;
+
+	value = std::move(this->data[read_position]);
+	this->read_position.store((read_position + 1) % this->size, std::memory_order_release);
+	return true;
+}
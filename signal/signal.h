@@ -7,8 +7,11 @@
 #include "property.h"
 #include "node.h"
 #include "graph.h"
+#include "executor.h"
 #include "buffer.h"
 #include "ringbuffer.h"
+#include "fastmath.h"
+#include "kernels/kernels.h"
 
 #include "registry.h"
 #include "nodedef.h"
@@ -42,6 +45,8 @@
  * Generators
  *-----------------------------------------------------------------------*/
 #include "oscillators/constant.h"
+#include "oscillators/oscillator.h"
+#include "oscillators/polyblep.h"
 #include "oscillators/sine.h"
 #include "oscillators/square.h"
 #include "oscillators/saw.h"
@@ -50,6 +55,8 @@
 #include "oscillators/recorder.h"
 #include "oscillators/granulator.h"
 #include "oscillators/wavetable.h"
+#include "oscillators/oscillator_bank.h"
+#include "oscillators/unison.h"
 #include "oscillators/tick.h"
 #include "oscillators/line.h"
 
@@ -68,7 +75,9 @@
 /*------------------------------------------------------------------------
  * Effects
  *-----------------------------------------------------------------------*/
+#include "filters/delay_line.h"
 #include "filters/delay.h"
+#include "filters/multi_tap_delay.h"
 #include "filters/resample.h"
 #include "filters/pan.h"
 #include "filters/width.h"
@@ -76,6 +85,9 @@
 #include "filters/gate.h"
 #include "filters/eq.h"
 #include "filters/moog.h"
+#include "filters/lane_filter.h"
+#include "filters/svf.h"
+#include "filters/biquad.h"
 #include "filters/waveshaper.h"
 
 /*------------------------------------------------------------------------
@@ -96,12 +108,16 @@
 /*------------------------------------------------------------------------
  * Spectral processing
  *-----------------------------------------------------------------------*/
-#ifdef __APPLE__
+#include "fft/backend/abstract.h"
 #include "fft/fft.h"
 #include "fft/ifft.h"
 #include "fft/lpf.h"
 #include "fft/phase_vocoder.h"
-#endif
+#include "fft/noise_gate.h"
+#include "fft/zero_phase.h"
+#include "fft/cross_synthesis.h"
+#include "fft/bin_shift.h"
+#include "fft/convolver.h"
 
 /*------------------------------------------------------------------------
  * Local headers (not included in production distribution)
@@ -1,4 +1,5 @@
 #include "synth.h"
+#include "graph.h"
 
 #include "oscillators/constant.h"
 #include "synthregistry.h"
@@ -10,10 +11,19 @@
 namespace libsignal
 {
 
+extern AudioGraph *shared_graph;
+
 Synth::Synth(SynthSpecRef synthspec)
 {
+	/*------------------------------------------------------------------------
+	 * Wire up the synth's subgraph as a single transaction, so that the
+	 * audio thread never sees it partially connected, nor sees any of it
+	 * if instantiating it fails.
+	 *-----------------------------------------------------------------------*/
 	NodeDefinition nodedef = synthspec->get_root();
+	AudioGraphTransactionScope transaction(shared_graph);
 	this->output = this->instantiate(&nodedef);
+	transaction.commit();
 }
 
 Synth::Synth(SynthTemplateRef synthtemplate) : Synth(synthtemplate->parse())
@@ -26,7 +36,9 @@ Synth::Synth(std::string name)
 	if (synthspec)
 	{
 		NodeDefinition nodedef = synthspec->get_root();
+		AudioGraphTransactionScope transaction(shared_graph);
 		this->output = this->instantiate(&nodedef);
+		transaction.commit();
 	}
 }
 
@@ -83,14 +95,21 @@ void Synth::set_input(std::string name, NodeRef value)
 	 * Replace a named input with another node.
 	 * Iterate over this synth's nodes, replacing the prior input with
 	 * the new node. (Inefficient, should be rethought.)
+	 *
+	 * While the graph is running, each node's inputs are compared as they
+	 * will be once any staged edits are made, and the edits are made as one.
 	 *-----------------------------------------------------------------------*/
 	signal_assert(this->inputs[name] != nullptr, "Synth has no such parameter: %s", name.c_str());
 	NodeRef current = this->inputs[name];
+	AudioGraph *graph = (shared_graph && shared_graph->is_deferring()) ? shared_graph : NULL;
+	AudioGraphTransactionScope transaction(graph);
+
 	for (NodeRef node : this->nodes)
 	{
 		for (auto param : node->params)
 		{
-			if ((param.second)->get() == current.get())
+			NodeRef input = graph ? graph->get_staged_input(node.get(), param.first) : *(param.second);
+			if (input.get() == current.get())
 			{
 				// Update routing
 				// printf("Updating '%s' input of %s\n", param.first.c_str(), node->name.c_str());
@@ -98,17 +117,21 @@ void Synth::set_input(std::string name, NodeRef value)
 			}
 		}
 	}
+
+	transaction.commit();
 	this->inputs[name] = value;
 }
 
 void Synth::disconnect()
 {
+	AudioGraphTransactionScope transaction(shared_graph);
 	this->output->disconnect_outputs();
 	for (auto input : this->inputs)
 	{
 		std::string name = input.first;
 		this->set_input(name, 0);
 	}
+	transaction.commit();
 }
 
 }
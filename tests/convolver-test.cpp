@@ -0,0 +1,131 @@
+/*------------------------------------------------------------------------
+ * Convolver test
+ *
+ * Checks Convolver against direct convolution, for responses whose
+ * lengths fall either side of the head, of the first partitions and of
+ * the levels processed on the background thread, with blocks of odd
+ * and power-of-two sizes, and with and without the background thread.
+ *
+ * Nodes are processed directly, without a graph, so the engine's
+ * blocks are SIGNAL_DEFAULT_BLOCK_SIZE frames, and longer blocks are
+ * convolved in parts.
+ *-----------------------------------------------------------------------*/
+
+#include <signal/signal.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+using namespace libsignal;
+
+static int failures = 0;
+
+/*------------------------------------------------------------------------
+ * Outputs `signal`, then silence.
+ *-----------------------------------------------------------------------*/
+class TestSource : public Node
+{
+	public:
+		TestSource(const std::vector<sample> &signal) : signal(signal), position(0)
+		{
+			this->name = "test-source";
+		}
+
+		virtual void process(sample **out, int num_frames)
+		{
+			for (int frame = 0; frame < num_frames; frame++, this->position++)
+				out[0][frame] = (this->position < (int) this->signal.size()) ? this->signal[this->position] : 0.0;
+		}
+
+		std::vector<sample> signal;
+		int position;
+};
+
+static std::vector<sample> random_signal(int length)
+{
+	std::vector<sample> signal(length);
+	for (int index = 0; index < length; index++)
+		signal[index] = 2.0 * rand() / RAND_MAX - 1.0;
+	return signal;
+}
+
+static std::vector<double> convolve(const std::vector<sample> &signal, const sample *response, int length)
+{
+	std::vector<double> output(signal.size());
+	for (int index = 0; index < (int) signal.size(); index++)
+	{
+		double value = 0.0;
+		for (int tap = 0; tap < length && tap <= index; tap++)
+			value += (double) response[tap] * signal[index - tap];
+		output[index] = value;
+	}
+	return output;
+}
+
+static void test_convolver(int length, int block_size, bool background)
+{
+	/*------------------------------------------------------------------------
+	 * A stereo response, each channel of which convolves the mono input,
+	 * run for long enough that every level of the response is reached.
+	 *-----------------------------------------------------------------------*/
+	BufferRef buffer = new Buffer(2, length);
+	for (int channel = 0; channel < 2; channel++)
+		for (int index = 0; index < length; index++)
+			buffer->data[channel][index] = (2.0 * rand() / RAND_MAX - 1.0) / sqrt(length);
+
+	int num_frames = length + 4 * SIGNAL_CONVOLVER_BACKGROUND_PARTITION_SIZE;
+	std::vector<sample> signal = random_signal(num_frames);
+
+	NodeRef source = new TestSource(signal);
+	source->allocate_output(1, block_size);
+	NodeRef convolver = new Convolver(source, buffer, background);
+
+	std::vector<sample> left(block_size), right(block_size);
+	sample *out[SIGNAL_MAX_CHANNELS] = { left.data(), right.data() };
+	std::vector<sample> output[2];
+	for (int offset = 0; offset < num_frames; offset += block_size)
+	{
+		source->process(source->out, block_size);
+		convolver->process(out, block_size);
+		output[0].insert(output[0].end(), left.begin(), left.end());
+		output[1].insert(output[1].end(), right.begin(), right.end());
+	}
+
+	for (int channel = 0; channel < 2; channel++)
+	{
+		std::vector<double> expected = convolve(signal, buffer->data[channel], length);
+		double error = 0.0, peak = 1e-30;
+		for (int index = 0; index < num_frames; index++)
+		{
+			error = fmax(error, fabs(output[channel][index] - expected[index]));
+			peak = fmax(peak, fabs(expected[index]));
+		}
+
+		if (error / peak > 1e-4)
+		{
+			printf("FAIL: response %d, block %d, background %d, channel %d: relative error %g\n",
+			       length, block_size, background, channel, error / peak);
+			failures++;
+		}
+	}
+}
+
+int main()
+{
+	vector_kernels_init();
+	srand(1);
+
+	int lengths[] = { 1, 63, 64, 65, 127, 128, 129, 1000, 1023, 1024, 1025, 3000, 6000 };
+	int block_sizes[] = { 37, 64, 512 };
+
+	for (int length : lengths)
+		for (int block_size : block_sizes)
+			for (bool background : { false, true })
+				test_convolver(length, block_size, background);
+
+	printf("Convolver: %s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+/*------------------------------------------------------------------------
+ * DelayLine test
+ *
+ * Checks reads of a delay line against the signal written to it, for
+ * runs of several sizes that wrap its buffer many times. Block reads
+ * at a fractional delay are checked against the per-frame reads that
+ * they stand in for, and those against the interpolators' formulas.
+ *-----------------------------------------------------------------------*/
+
+#include <signal/signal.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace libsignal;
+
+static int failures = 0;
+
+static void check(const char *test, int block_size, double delay, double error, double tolerance)
+{
+	if (error > tolerance)
+	{
+		printf("FAIL: %s, block %d, delay %g: error %g (tolerance %g)\n", test, block_size, delay, error, tolerance);
+		failures++;
+	}
+}
+
+/*------------------------------------------------------------------------
+ * The signal at `index`, which is silent before it starts.
+ *-----------------------------------------------------------------------*/
+static double at(const std::vector<sample> &signal, int index)
+{
+	return (index >= 0) ? signal[index] : 0.0;
+}
+
+/*------------------------------------------------------------------------
+ * Reads each block at a constant `delay`, before writing it, and checks
+ * each frame against the signal `delay` samples before it.
+ *-----------------------------------------------------------------------*/
+static void test_block_reads(int block_size, double delay)
+{
+	const int length = 20000;
+	std::vector<sample> signal(length);
+	for (int index = 0; index < length; index++)
+		signal[index] = 2.0 * rand() / RAND_MAX - 1.0;
+
+	DelayLine block_line(1100), frame_line(1100);
+	std::vector<sample> delays(block_size, delay);
+	std::vector<sample> block(block_size), frames(block_size);
+
+	double exact_error = 0.0, interpolated_error = 0.0;
+	double linear_error = 0.0, cubic_error = 0.0, allpass_error = 0.0;
+
+	for (int offset = 0; offset + block_size <= length; offset += block_size)
+	{
+		const sample *in = &signal[offset];
+		int whole = (int) delay;
+		double frac = delay - whole;
+
+		if (delay == whole)
+		{
+			block_line.read(whole, block.data(), block_size);
+			for (int frame = 0; frame < block_size; frame++)
+				exact_error = fmax(exact_error, fabs(block[frame] - at(signal, offset + frame - whole)));
+		}
+
+		/*------------------------------------------------------------------------
+		 * Linear and cubic reads of each frame are given by the samples
+		 * either side of it.
+		 *-----------------------------------------------------------------------*/
+		block_line.read(delay, SIGNAL_INTERPOLATE_LINEAR, block.data(), block_size);
+		frame_line.read(delays.data(), SIGNAL_INTERPOLATE_LINEAR, frames.data(), block_size);
+		for (int frame = 0; frame < block_size; frame++)
+		{
+			int index = offset + frame - whole;
+			double expected = at(signal, index) + (at(signal, index - 1) - at(signal, index)) * frac;
+			interpolated_error = fmax(interpolated_error, fabs(block[frame] - frames[frame]));
+			linear_error = fmax(linear_error, fabs(frames[frame] - expected));
+		}
+
+		block_line.read(delay, SIGNAL_INTERPOLATE_CUBIC, block.data(), block_size);
+		frame_line.read(delays.data(), SIGNAL_INTERPOLATE_CUBIC, frames.data(), block_size);
+		for (int frame = 0; frame < block_size; frame++)
+		{
+			int index = offset + frame - whole;
+			double y0 = at(signal, index + 1), y1 = at(signal, index);
+			double y2 = at(signal, index - 1), y3 = at(signal, index - 2);
+			double c1 = 0.5 * (y2 - y0);
+			double c2 = y0 - 2.5 * y1 + 2.0 * y2 - 0.5 * y3;
+			double c3 = 0.5 * (y3 - y0) + 1.5 * (y1 - y2);
+			double expected = ((c3 * frac + c2) * frac + c1) * frac + y1;
+			interpolated_error = fmax(interpolated_error, fabs(block[frame] - frames[frame]));
+			cubic_error = fmax(cubic_error, fabs(frames[frame] - expected));
+		}
+
+		/*------------------------------------------------------------------------
+		 * Allpass reads depend on the last, so are only compared with each
+		 * other. The same run of reads is made of each line, so that their
+		 * states stay in step.
+		 *-----------------------------------------------------------------------*/
+		block_line.read(delay, SIGNAL_INTERPOLATE_ALLPASS, block.data(), block_size);
+		frame_line.read(delays.data(), SIGNAL_INTERPOLATE_ALLPASS, frames.data(), block_size);
+		for (int frame = 0; frame < block_size; frame++)
+			allpass_error = fmax(allpass_error, fabs(block[frame] - frames[frame]));
+
+		block_line.write(in, block_size);
+		for (int frame = 0; frame < block_size; frame++)
+			frame_line.write(in[frame]);
+	}
+
+	check("integer read", block_size, delay, exact_error, 0.0);
+	check("block against per-frame read", block_size, delay, interpolated_error, 1e-5);
+	check("linear", block_size, delay, linear_error, 1e-5);
+	check("cubic", block_size, delay, cubic_error, 1e-5);
+	check("allpass block against per-frame read", block_size, delay, allpass_error, 1e-5);
+}
+
+/*------------------------------------------------------------------------
+ * A slow sinusoid, read one frame at a time through the allpass
+ * interpolator, comes out delayed by the fractional delay.
+ *-----------------------------------------------------------------------*/
+static void test_allpass_delay(double delay)
+{
+	const double frequency = 0.005;
+	DelayLine line(200);
+	double error = 0.0;
+	for (int index = 0; index < 5000; index++)
+	{
+		sample value = line.read(delay, SIGNAL_INTERPOLATE_ALLPASS);
+		if (index > 1000)
+			error = fmax(error, fabs(value - sin(2.0 * M_PI * frequency * (index - delay))));
+		line.write((sample) sin(2.0 * M_PI * frequency * index));
+	}
+	check("allpass delay", 1, delay, error, 1e-4);
+}
+
+int main()
+{
+	vector_kernels_init();
+	srand(1);
+
+	int block_sizes[] = { 1, 17, 64 };
+	double delays[] = { 66.0, 70.25, 100.5, 500.0, 1000.75 };
+
+	for (int block_size : block_sizes)
+		for (double delay : delays)
+			test_block_reads(block_size, delay);
+
+	for (double delay : { 2.3, 10.5, 99.9 })
+		test_allpass_delay(delay);
+
+	printf("DelayLine: %s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+/*------------------------------------------------------------------------
+ * FFT backends test
+ *
+ * Checks each FFT backend compiled into this build against a
+ * double-precision DFT, in the packed split format and scaling of
+ * FFTBackend_Abstract: the forward transform is twice the DFT, and a
+ * forward then inverse transform scales the signal by 2 * fft_size.
+ *-----------------------------------------------------------------------*/
+
+#include <signal/signal.h>
+
+#include <math.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace libsignal;
+
+static int failures = 0;
+
+/*------------------------------------------------------------------------
+ * Returns the largest difference between `actual` and `expected`,
+ * relative to the largest value of `expected`.
+ *-----------------------------------------------------------------------*/
+static double relative_error(const std::vector<sample> &actual, const std::vector<double> &expected)
+{
+	double error = 0.0, peak = 1e-30;
+	for (int index = 0; index < (int) expected.size(); index++)
+	{
+		error = fmax(error, fabs(actual[index] - expected[index]));
+		peak = fmax(peak, fabs(expected[index]));
+	}
+	return error / peak;
+}
+
+static void check(const char *backend, const char *test, int fft_size, double error, double tolerance)
+{
+	if (error > tolerance)
+	{
+		printf("FAIL: %s, %s, size %d: relative error %g (tolerance %g)\n", backend, test, fft_size, error, tolerance);
+		failures++;
+	}
+}
+
+static void test_backend(signal_fft_backend_t type, const char *name, int fft_size)
+{
+	FFTBackend_Abstract *backend = FFTBackend_Abstract::create(fft_size, type);
+	int num_bins = fft_size / 2;
+
+	/*------------------------------------------------------------------------
+	 * Tolerances allow for single-precision rounding over log2(fft_size)
+	 * passes.
+	 *-----------------------------------------------------------------------*/
+	double tolerance = 1e-6 * log2(fft_size) + 1e-6;
+
+	std::vector<sample> signal(fft_size);
+	for (int index = 0; index < fft_size; index++)
+		signal[index] = 2.0 * rand() / RAND_MAX - 1.0;
+
+	/*------------------------------------------------------------------------
+	 * Forward: twice the DFT, with the Nyquist bin in place of bin 0's
+	 * imaginary part.
+	 *-----------------------------------------------------------------------*/
+	std::vector<double> expected(fft_size);
+	for (int bin = 0; bin <= num_bins; bin++)
+	{
+		double real = 0.0, imag = 0.0;
+		for (int index = 0; index < fft_size; index++)
+		{
+			double angle = -2.0 * M_PI * (double) bin * index / fft_size;
+			real += signal[index] * cos(angle);
+			imag += signal[index] * sin(angle);
+		}
+
+		if (bin == 0)
+			expected[0] = 2.0 * real;
+		else if (bin == num_bins)
+			expected[num_bins] = 2.0 * real;
+		else
+		{
+			expected[bin] = 2.0 * real;
+			expected[num_bins + bin] = 2.0 * imag;
+		}
+	}
+
+	std::vector<sample> spectrum(fft_size);
+	backend->forward(signal.data(), spectrum.data());
+	check(name, "forward", fft_size, relative_error(spectrum, expected), tolerance);
+
+	/*------------------------------------------------------------------------
+	 * Round trip: the signal, scaled by 2 * fft_size.
+	 *-----------------------------------------------------------------------*/
+	std::vector<sample> output(fft_size);
+	std::vector<double> scaled(fft_size);
+	backend->inverse(spectrum.data(), output.data());
+	for (int index = 0; index < fft_size; index++)
+		scaled[index] = signal[index] * 2.0 * fft_size;
+	check(name, "round trip", fft_size, relative_error(output, scaled), tolerance);
+
+	/*------------------------------------------------------------------------
+	 * Inverse of an arbitrary spectrum: the unscaled inverse DFT of the
+	 * spectrum it packs.
+	 *-----------------------------------------------------------------------*/
+	for (int index = 0; index < fft_size; index++)
+		spectrum[index] = 2.0 * rand() / RAND_MAX - 1.0;
+	for (int index = 0; index < fft_size; index++)
+	{
+		double value = spectrum[0] + ((index % 2) ? -spectrum[num_bins] : spectrum[num_bins]);
+		for (int bin = 1; bin < num_bins; bin++)
+		{
+			double angle = 2.0 * M_PI * (double) bin * index / fft_size;
+			value += 2.0 * (spectrum[bin] * cos(angle) - spectrum[num_bins + bin] * sin(angle));
+		}
+		expected[index] = value;
+	}
+	backend->inverse(spectrum.data(), output.data());
+	check(name, "inverse", fft_size, relative_error(output, expected), tolerance);
+
+	/*------------------------------------------------------------------------
+	 * Batches: the same as transforming each frame in turn.
+	 *-----------------------------------------------------------------------*/
+	const int count = 3;
+	std::vector<sample> frames(count * fft_size), batch(count * fft_size);
+	std::vector<double> single(count * fft_size);
+	for (int index = 0; index < count * fft_size; index++)
+		frames[index] = 2.0 * rand() / RAND_MAX - 1.0;
+	for (int frame = 0; frame < count; frame++)
+	{
+		backend->forward(&frames[frame * fft_size], spectrum.data());
+		for (int index = 0; index < fft_size; index++)
+			single[frame * fft_size + index] = spectrum[index];
+	}
+	backend->forward_batch(frames.data(), batch.data(), count);
+	check(name, "forward_batch", fft_size, relative_error(batch, single), tolerance);
+
+	for (int frame = 0; frame < count; frame++)
+	{
+		backend->inverse(&frames[frame * fft_size], output.data());
+		for (int index = 0; index < fft_size; index++)
+			single[frame * fft_size + index] = output[index];
+	}
+	backend->inverse_batch(frames.data(), batch.data(), count);
+	check(name, "inverse_batch", fft_size, relative_error(batch, single), tolerance);
+
+	delete backend;
+}
+
+int main()
+{
+	vector_kernels_init();
+	srand(1);
+
+	struct
+	{
+		signal_fft_backend_t type;
+		const char *name;
+	} backends[] =
+	{
+		{ SIGNAL_FFT_BACKEND_PORTABLE, "portable" },
+		{ SIGNAL_FFT_BACKEND_FFTW, "fftw" },
+		{ SIGNAL_FFT_BACKEND_ACCELERATE, "accelerate" }
+	};
+
+	for (auto backend : backends)
+	{
+		/*------------------------------------------------------------------------
+		 * Backends not compiled into this build are skipped.
+		 *-----------------------------------------------------------------------*/
+		try
+		{
+			delete FFTBackend_Abstract::create(4, backend.type);
+		}
+		catch (std::runtime_error &e)
+		{
+			printf("FFT backend %s: not available, skipping\n", backend.name);
+			continue;
+		}
+
+		int before = failures;
+		for (int fft_size = 4; fft_size <= 8192; fft_size *= 2)
+			test_backend(backend.type, backend.name, fft_size);
+		printf("FFT backend %s: %s\n", backend.name, failures > before ? "FAILED" : "OK");
+	}
+
+	return failures ? 1 : 0;
+}
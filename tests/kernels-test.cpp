@@ -0,0 +1,425 @@
+/*------------------------------------------------------------------------
+ * Vector kernels test
+ *
+ * Compares every kernel of the implementation in use with the scalar
+ * reference, over buffers whose lengths leave partial vectors. Run
+ * with SIGNAL_SIMD set to force each implementation in turn (see
+ * `./waf test`); exits without testing if it is not available here.
+ *
+ * Element-wise kernels must match the reference exactly. Those whose
+ * order of summation may differ (dot, sine_bank and unison) must match
+ * to within a small tolerance.
+ *-----------------------------------------------------------------------*/
+
+#include <signal/signal.h>
+
+#include <functional>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace libsignal;
+
+typedef std::vector<sample> samples;
+
+static int failures = 0;
+
+/*------------------------------------------------------------------------
+ * Uniform random values in [low, high).
+ *-----------------------------------------------------------------------*/
+static samples random_samples(int count, sample low, sample high)
+{
+	samples values(count);
+	for (int index = 0; index < count; index++)
+		values[index] = low + (high - low) * (rand() / (RAND_MAX + 1.0));
+	return values;
+}
+
+/*------------------------------------------------------------------------
+ * Run `kernel` with the scalar reference and with the kernels under
+ * test, and compare everything it returns. A tolerance of zero
+ * requires identical results (with NaNs equal to each other).
+ *-----------------------------------------------------------------------*/
+static void compare(const char *name, int num_frames, std::function<samples(const VectorKernels *)> kernel,
+                    sample tolerance = 0.0)
+{
+	samples expected = kernel(vector_kernels_scalar);
+	samples actual = kernel(vector_kernels);
+
+	for (int index = 0; index < (int) expected.size(); index++)
+	{
+		sample a = expected[index], b = actual[index];
+		bool equal = (a == b) || (isnan(a) && isnan(b));
+		if (!equal && tolerance > 0)
+			equal = fabsf(a - b) <= tolerance * fmaxf(1.0f, fabsf(a));
+
+		if (!equal)
+		{
+			printf("FAIL: %s (%s), %d frames: index %d is %.9g, expected %.9g\n",
+			       name, vector_kernels->name, num_frames, index, b, a);
+			failures++;
+			return;
+		}
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Coefficients for the channel-parallel filters, kept stable: one set
+ * per lane, or one per lane for every frame.
+ *-----------------------------------------------------------------------*/
+static samples filter_coefficients(const char *filter, int num_lanes, int num_sets)
+{
+	int count = !strcmp(filter, "moog") ? 2 : !strcmp(filter, "svf") ? 6 : 5;
+	samples coefficients(num_sets * count * num_lanes);
+
+	for (int set = 0; set < num_sets; set++)
+	{
+		for (int lane = 0; lane < num_lanes; lane++)
+		{
+			sample *row = &coefficients[set * count * num_lanes + lane];
+			sample cutoff = random_samples(1, 0.01, 0.4)[0];
+			sample q = random_samples(1, 0.5, 4.0)[0];
+
+			if (!strcmp(filter, "moog"))
+			{
+				row[0] = 1.16f * cutoff;
+				row[num_lanes] = random_samples(1, 0.0, 3.5)[0];
+			}
+			else if (!strcmp(filter, "eq"))
+			{
+				samples values = random_samples(5, 0.5, 1.5);
+				row[0] = cutoff;
+				row[num_lanes] = cutoff * 0.5f;
+				for (int index = 2; index < 5; index++)
+					row[index * num_lanes] = values[index];
+			}
+			else if (!strcmp(filter, "svf"))
+			{
+				sample g = tanf(M_PI * cutoff * 0.5f);
+				sample k = 1.0f / q;
+				samples mix = random_samples(3, -1.0, 1.0);
+				row[0] = 1.0f / (1.0f + g * (g + k));
+				row[num_lanes] = g * row[0];
+				row[2 * num_lanes] = g * row[num_lanes];
+				for (int index = 0; index < 3; index++)
+					row[(3 + index) * num_lanes] = mix[index];
+			}
+			else
+			{
+				sample w = 2.0f * M_PI * cutoff * 0.5f;
+				sample alpha = sinf(w) / (2.0f * q);
+				sample a0 = 1.0f + alpha;
+				row[0] = (1.0f - cosf(w)) / 2.0f / a0;
+				row[num_lanes] = (1.0f - cosf(w)) / a0;
+				row[2 * num_lanes] = row[0];
+				row[3 * num_lanes] = -2.0f * cosf(w) / a0;
+				row[4 * num_lanes] = (1.0f - alpha) / a0;
+			}
+		}
+	}
+
+	return coefficients;
+}
+
+static void test_elementwise(int n)
+{
+	samples a = random_samples(n, -1.0, 1.0);
+	samples b = random_samples(n, 0.25, 2.0);
+	samples c = random_samples(n, -1.0, 1.0);
+	samples phase = random_samples(n, 0.0, 1.0);
+
+	compare("fill", n, [&](const VectorKernels *k) { samples out(n); k->fill(out.data(), 0.3, n); return out; });
+	compare("copy", n, [&](const VectorKernels *k) { samples out(n); k->copy(a.data(), out.data(), n); return out; });
+	compare("add", n, [&](const VectorKernels *k) { samples out(n); k->add(a.data(), b.data(), out.data(), n); return out; });
+	compare("subtract", n, [&](const VectorKernels *k) { samples out(n); k->subtract(a.data(), b.data(), out.data(), n); return out; });
+	compare("multiply", n, [&](const VectorKernels *k) { samples out(n); k->multiply(a.data(), b.data(), out.data(), n); return out; });
+	compare("divide", n, [&](const VectorKernels *k) { samples out(n); k->divide(a.data(), b.data(), out.data(), n); return out; });
+	compare("add_scalar", n, [&](const VectorKernels *k) { samples out(n); k->add_scalar(a.data(), 0.7, out.data(), n); return out; });
+	compare("multiply_scalar", n, [&](const VectorKernels *k) { samples out(n); k->multiply_scalar(a.data(), 0.7, out.data(), n); return out; });
+	compare("divide_scalar", n, [&](const VectorKernels *k) { samples out(n); k->divide_scalar(a.data(), 0.7, out.data(), n); return out; });
+	compare("mac", n, [&](const VectorKernels *k) { samples out = c; k->mac(a.data(), b.data(), out.data(), n); return out; });
+	compare("mac_scalar", n, [&](const VectorKernels *k) { samples out = c; k->mac_scalar(a.data(), 0.7, out.data(), n); return out; });
+	compare("scale_offset", n, [&](const VectorKernels *k) { samples out(n); k->scale_offset(a.data(), 1.5, -0.25, out.data(), n); return out; });
+	compare("clip", n, [&](const VectorKernels *k) { samples out(n); k->clip(a.data(), -0.3, 0.4, out.data(), n); return out; });
+	compare("mix", n, [&](const VectorKernels *k) { samples out(n); k->mix(a.data(), c.data(), 0.3, out.data(), n); return out; });
+	compare("sine", n, [&](const VectorKernels *k) { samples out(n); k->sine(phase.data(), out.data(), n); return out; });
+
+	/*------------------------------------------------------------------------
+	 * In place, as the kernels allow.
+	 *-----------------------------------------------------------------------*/
+	compare("add (in place)", n, [&](const VectorKernels *k) { samples out = a; k->add(out.data(), b.data(), out.data(), n); return out; });
+	compare("multiply_scalar (in place)", n, [&](const VectorKernels *k) { samples out = a; k->multiply_scalar(out.data(), 0.7, out.data(), n); return out; });
+
+	compare("dot", n, [&](const VectorKernels *k) { return samples(1, k->dot(a.data(), c.data(), n)); }, 1e-5);
+}
+
+static void test_interleave(int n)
+{
+	const int num_channels = 3;
+	samples interleaved = random_samples(n * num_channels, -1.0, 1.0);
+	std::vector<samples> channels(num_channels);
+	for (int channel = 0; channel < num_channels; channel++)
+		channels[channel] = random_samples(n, -1.0, 1.0);
+
+	compare("interleave", n, [&](const VectorKernels *k)
+	{
+		sample *in[num_channels];
+		for (int channel = 0; channel < num_channels; channel++)
+			in[channel] = channels[channel].data();
+		samples out(n * num_channels);
+		k->interleave(in, num_channels, out.data(), n);
+		return out;
+	});
+
+	compare("deinterleave", n, [&](const VectorKernels *k)
+	{
+		samples out(n * num_channels);
+		sample *channel_out[num_channels];
+		for (int channel = 0; channel < num_channels; channel++)
+			channel_out[channel] = &out[channel * n];
+		k->deinterleave(interleaved.data(), num_channels, channel_out, n);
+		return out;
+	});
+}
+
+static void test_table_read(int n)
+{
+	/*------------------------------------------------------------------------
+	 * Readable from index -1 to length + 1, wrapping around.
+	 *-----------------------------------------------------------------------*/
+	const int length = 64;
+	samples storage = random_samples(length + 3, -1.0, 1.0);
+	storage[0] = storage[length];
+	storage[length + 1] = storage[1];
+	storage[length + 2] = storage[2];
+	const sample *table = &storage[1];
+	samples phase = random_samples(n, 0.0, 1.0);
+
+	compare("table_read", n, [&](const VectorKernels *k) { samples out(n); k->table_read(table, length, phase.data(), out.data(), n); return out; });
+	compare("table_read_linear", n, [&](const VectorKernels *k) { samples out(n); k->table_read_linear(table, length, phase.data(), out.data(), n); return out; });
+	compare("table_read_cubic", n, [&](const VectorKernels *k) { samples out(n); k->table_read_cubic(table, length, phase.data(), out.data(), n); return out; });
+}
+
+static void test_oscillators(int n)
+{
+	const int num_partials = 13;
+	samples angle = random_samples(num_partials, 0.0, 2 * M_PI);
+	samples step = random_samples(num_partials, 0.0, 0.5);
+	samples amplitude = random_samples(num_partials, 0.0, 0.1);
+	samples initial = random_samples(n, -1.0, 1.0);
+
+	compare("sine_bank", n, [&](const VectorKernels *k)
+	{
+		samples real(num_partials), imag(num_partials), rotation_real(num_partials), rotation_imag(num_partials);
+		for (int partial = 0; partial < num_partials; partial++)
+		{
+			real[partial] = cosf(angle[partial]);
+			imag[partial] = sinf(angle[partial]);
+			rotation_real[partial] = cosf(step[partial]);
+			rotation_imag[partial] = sinf(step[partial]);
+		}
+
+		samples out = initial;
+		k->sine_bank(real.data(), imag.data(), rotation_real.data(), rotation_imag.data(),
+		             amplitude.data(), num_partials, out.data(), n);
+		out.insert(out.end(), real.begin(), real.end());
+		out.insert(out.end(), imag.begin(), imag.end());
+		return out;
+	}, 1e-5);
+
+	const int num_voices = 7;
+	const int num_channels = 2;
+	samples start = random_samples(num_voices, 0.0, 1.0);
+	samples increment = random_samples(num_voices, 0.98, 1.02);
+	samples gain = random_samples(num_voices * num_channels, 0.0, 0.2);
+	samples frequency = random_samples(n, 0.001, 0.05);
+
+	signal_shape_t shapes[] = { SIGNAL_SHAPE_SAW, SIGNAL_SHAPE_SQUARE, SIGNAL_SHAPE_TRIANGLE };
+	for (signal_shape_t shape : shapes)
+	{
+		compare("unison", n, [&](const VectorKernels *k)
+		{
+			samples phase = start;
+			samples out(n * num_channels);
+			sample *channel_out[num_channels] = { &out[0], &out[n] };
+			k->unison(phase.data(), increment.data(), gain.data(), num_voices, num_channels,
+			          shape, frequency.data(), channel_out, n);
+			out.insert(out.end(), phase.begin(), phase.end());
+			return out;
+		}, 1e-5);
+	}
+}
+
+static void test_filters(int n)
+{
+	/*------------------------------------------------------------------------
+	 * A multiple of every vector width.
+	 *-----------------------------------------------------------------------*/
+	const int num_lanes = 16;
+	samples in = random_samples(n * num_lanes, -0.5, 0.5);
+	samples initial_state = random_samples(11 * SIGNAL_MAX_CHANNELS, -0.1, 0.1);
+
+	typedef void (*filter_t)(const sample *, const sample *, int, sample *, int, sample *, int);
+	const char *names[] = { "moog", "eq", "svf", "biquad" };
+
+	for (const char *name : names)
+	{
+		int count = !strcmp(name, "moog") ? 2 : !strcmp(name, "svf") ? 6 : 5;
+		samples block_coefficients = filter_coefficients(name, num_lanes, 1);
+		samples frame_coefficients = filter_coefficients(name, num_lanes, n);
+
+		for (int per_frame = 0; per_frame < 2; per_frame++)
+		{
+			compare(name, n, [&](const VectorKernels *k)
+			{
+				filter_t filter = !strcmp(name, "moog") ? k->moog : !strcmp(name, "eq") ? k->eq :
+				                  !strcmp(name, "svf") ? k->svf : k->biquad;
+				const samples &coefficients = per_frame ? frame_coefficients : block_coefficients;
+				samples state = initial_state;
+				samples out(n * num_lanes);
+				filter(in.data(), coefficients.data(), per_frame ? count * num_lanes : 0,
+				       state.data(), num_lanes, out.data(), n);
+				out.insert(out.end(), state.begin(), state.end());
+				return out;
+			});
+		}
+	}
+}
+
+static void test_spectral(int n)
+{
+	samples real = random_samples(n, -1.0, 1.0);
+	samples imag = random_samples(n, -1.0, 1.0);
+	samples magnitudes = random_samples(n, 0.0, 1.0);
+	samples phases = random_samples(n, -M_PI, M_PI);
+	samples increments = random_samples(n, -4 * M_PI, 4 * M_PI);
+	samples initial_gain = random_samples(n, 0.0, 1.0);
+	samples out_real = random_samples(n, -1.0, 1.0);
+	samples out_imag = random_samples(n, -1.0, 1.0);
+
+	compare("fft_polar", n, [&](const VectorKernels *k)
+	{
+		samples out(2 * n);
+		k->fft_polar(real.data(), imag.data(), &out[0], &out[n], n);
+		return out;
+	});
+
+	compare("fft_cartesian", n, [&](const VectorKernels *k)
+	{
+		samples out(2 * n);
+		k->fft_cartesian(magnitudes.data(), phases.data(), &out[0], &out[n], n);
+		return out;
+	});
+
+	compare("complex_mac", n, [&](const VectorKernels *k)
+	{
+		samples out = out_real;
+		out.insert(out.end(), out_imag.begin(), out_imag.end());
+		k->complex_mac(real.data(), imag.data(), magnitudes.data(), phases.data(), &out[0], &out[n], n);
+		return out;
+	});
+
+	compare("phase_advance", n, [&](const VectorKernels *k)
+	{
+		samples out(n);
+		k->phase_advance(phases.data(), increments.data(), out.data(), n);
+		return out;
+	});
+
+	compare("spectral_gate", n, [&](const VectorKernels *k)
+	{
+		samples gain = initial_gain;
+		samples out(n);
+		k->spectral_gate(magnitudes.data(), 0.5, 0.3, 0.1, gain.data(), out.data(), n);
+		out.insert(out.end(), gain.begin(), gain.end());
+		return out;
+	});
+}
+
+static void test_fft_passes(int size)
+{
+	/*------------------------------------------------------------------------
+	 * Every radix-4 pass of a transform of `size` points, from strides of
+	 * a partial vector to whole vectors, and the final radix-2 pass.
+	 *-----------------------------------------------------------------------*/
+	samples in_real = random_samples(size, -1.0, 1.0);
+	samples in_imag = random_samples(size, -1.0, 1.0);
+
+	for (int stride = 1; stride * 4 <= size; stride *= 4)
+	{
+		int num_groups = size / (4 * stride);
+		samples twiddles(6 * num_groups);
+		for (int group = 0; group < num_groups; group++)
+		{
+			for (int j = 1; j <= 3; j++)
+			{
+				double angle = -2.0 * M_PI * j * group / (4 * num_groups);
+				twiddles[(2 * j - 2) * num_groups + group] = cos(angle);
+				twiddles[(2 * j - 1) * num_groups + group] = sin(angle);
+			}
+		}
+
+		compare("fft_radix4", size, [&](const VectorKernels *k)
+		{
+			samples out(2 * size);
+			k->fft_radix4(in_real.data(), in_imag.data(), twiddles.data(), num_groups, stride, &out[0], &out[size]);
+			return out;
+		});
+	}
+
+	compare("fft_radix2", size, [&](const VectorKernels *k)
+	{
+		samples out(2 * size);
+		k->fft_radix2(in_real.data(), in_imag.data(), size / 2, &out[0], &out[size]);
+		return out;
+	});
+
+	samples rotation_real(size), rotation_imag(size);
+	for (int index = 0; index < size; index++)
+	{
+		rotation_real[index] = cos(M_PI * index / size);
+		rotation_imag[index] = sin(M_PI * index / size);
+	}
+
+	compare("fft_real_split", size, [&](const VectorKernels *k)
+	{
+		samples out(2 * size);
+		k->fft_real_split(in_real.data(), in_imag.data(), rotation_real.data(), rotation_imag.data(),
+		                  size, &out[0], &out[size]);
+		return out;
+	});
+}
+
+int main()
+{
+	vector_kernels_init();
+
+	const char *forced = getenv("SIGNAL_SIMD");
+	if (forced && *forced && strcmp(forced, vector_kernels->name) != 0)
+	{
+		printf("Vector kernels: %s is not available, skipping\n", forced);
+		return 0;
+	}
+
+	srand(1);
+
+	int lengths[] = { 1, 3, 4, 15, 16, 17, 63, 64, 100, 257 };
+	for (int n : lengths)
+	{
+		test_elementwise(n);
+		test_interleave(n);
+		test_table_read(n);
+		test_oscillators(n);
+		test_filters(n);
+		test_spectral(n);
+	}
+
+	int sizes[] = { 4, 8, 16, 64, 128, 1024 };
+	for (int size : sizes)
+		test_fft_passes(size);
+
+	printf("Vector kernels: %s, %s\n", vector_kernels->name, failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
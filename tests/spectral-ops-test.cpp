@@ -0,0 +1,210 @@
+/*------------------------------------------------------------------------
+ * Spectral ops test
+ *
+ * Checks spectral_shift, which keeps bin 0 (DC and Nyquist) in place,
+ * and the FFTBinShift and FFTCrossSynthesis nodes built on the spectral
+ * kernels: a sinusoid shifted by FFTBinShift comes out as a sinusoid at
+ * the new bin, and cross-synthesis gives the carrier's phases with
+ * magnitudes crossfaded towards the modulator's.
+ *
+ * Nodes are processed directly, without a graph, with their outputs
+ * allocated as a schedule would.
+ *-----------------------------------------------------------------------*/
+
+#include <signal/signal.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace libsignal;
+
+static int failures = 0;
+
+static void check(const char *test, double error, double tolerance)
+{
+	if (error > tolerance)
+	{
+		printf("FAIL: %s: error %g (tolerance %g)\n", test, error, tolerance);
+		failures++;
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Outputs `signal`, then silence.
+ *-----------------------------------------------------------------------*/
+class TestSource : public Node
+{
+	public:
+		TestSource(const std::vector<sample> &signal) : signal(signal), position(0)
+		{
+			this->name = "test-source";
+		}
+
+		virtual void process(sample **out, int num_frames)
+		{
+			for (int frame = 0; frame < num_frames; frame++, this->position++)
+				out[0][frame] = (this->position < (int) this->signal.size()) ? this->signal[this->position] : 0.0;
+		}
+
+		std::vector<sample> signal;
+		int position;
+};
+
+static void test_shift_kernel()
+{
+	const int num_bins = 16;
+	for (int shift = -num_bins - 2; shift <= num_bins + 2; shift++)
+	{
+		std::vector<sample> in(num_bins), out(num_bins), in_place(num_bins);
+		for (int bin = 0; bin < num_bins; bin++)
+			in[bin] = in_place[bin] = bin + 1;
+
+		spectral_shift(in.data(), shift, out.data(), num_bins);
+		spectral_shift(in_place.data(), shift, in_place.data(), num_bins);
+
+		double error = fabs(out[0] - in[0]);
+		for (int bin = 1; bin < num_bins; bin++)
+		{
+			int source = bin - shift;
+			double expected = (source >= 1 && source < num_bins) ? in[source] : 0.0;
+			error = fmax(error, fabs(out[bin] - expected));
+			error = fmax(error, fabs(in_place[bin] - expected));
+		}
+		check("spectral_shift", error, 0.0);
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Returns the amplitude of `signal` at `frequency` cycles per sample,
+ * and the largest residual after subtracting that sinusoid.
+ *-----------------------------------------------------------------------*/
+static void fit_sinusoid(const std::vector<sample> &signal, int start, int end, double frequency,
+                         double &amplitude, double &residual)
+{
+	double real = 0.0, imag = 0.0;
+	for (int index = start; index < end; index++)
+	{
+		real += signal[index] * cos(2.0 * M_PI * frequency * index);
+		imag += signal[index] * sin(2.0 * M_PI * frequency * index);
+	}
+	real *= 2.0 / (end - start);
+	imag *= 2.0 / (end - start);
+	amplitude = sqrt(real * real + imag * imag);
+
+	residual = 0.0;
+	for (int index = start; index < end; index++)
+	{
+		double fitted = real * cos(2.0 * M_PI * frequency * index) + imag * sin(2.0 * M_PI * frequency * index);
+		residual = fmax(residual, fabs(signal[index] - fitted));
+	}
+}
+
+static void test_bin_shift(int fft_size, int hop_size, int bin, int shift)
+{
+	const int block_size = 256;
+	int num_frames = 16 * fft_size;
+	std::vector<sample> signal(num_frames);
+	for (int index = 0; index < num_frames; index++)
+		signal[index] = 0.5 * sin(2.0 * M_PI * bin * index / fft_size);
+
+	NodeRef source = new TestSource(signal);
+	NodeRef shift_bins = shift;
+	NodeRef fft = new FFT(source, fft_size, hop_size);
+	NodeRef shifter = new FFTBinShift(fft, shift_bins);
+	NodeRef ifft = new IFFT(shifter);
+	NodeRef nodes[] = { source, shift_bins, fft, shifter, ifft };
+	for (NodeRef node : nodes)
+		node->allocate_output(1, block_size);
+
+	std::vector<sample> output;
+	for (int offset = 0; offset < num_frames; offset += block_size)
+	{
+		for (NodeRef node : nodes)
+			node->process(node->out, block_size);
+		output.insert(output.end(), ifft->out[0], ifft->out[0] + block_size);
+	}
+
+	double amplitude, residual;
+	fit_sinusoid(output, 4 * fft_size, num_frames, (double) (bin + shift) / fft_size, amplitude, residual);
+	check("FFTBinShift amplitude", fabs(amplitude - 0.5), 1e-3);
+	check("FFTBinShift residual", residual, 1e-3);
+}
+
+static void test_cross_synthesis(double amount, int modulator_fft_size)
+{
+	const int fft_size = 512, hop_size = 128, block_size = 256;
+	int num_frames = 8 * fft_size;
+	std::vector<sample> carrier_signal(num_frames), modulator_signal(num_frames);
+	for (int index = 0; index < num_frames; index++)
+	{
+		carrier_signal[index] = 2.0 * rand() / RAND_MAX - 1.0;
+		modulator_signal[index] = 2.0 * rand() / RAND_MAX - 1.0;
+	}
+
+	NodeRef carrier_source = new TestSource(carrier_signal);
+	NodeRef modulator_source = new TestSource(modulator_signal);
+	NodeRef carrier = new FFT(carrier_source, fft_size, hop_size);
+	NodeRef modulator = new FFT(modulator_source, modulator_fft_size, modulator_fft_size / 4);
+	NodeRef cross_amount = amount;
+	NodeRef cross = new FFTCrossSynthesis(carrier, modulator, cross_amount);
+	NodeRef nodes[] = { carrier_source, modulator_source, cross_amount, carrier, modulator, cross };
+	for (NodeRef node : nodes)
+		node->allocate_output(1, block_size);
+
+	SpectralStream *carrier_stream = ((FFTNode *) carrier.get())->stream.get();
+	SpectralStream *modulator_stream = ((FFTNode *) modulator.get())->stream.get();
+	SpectralStream *cross_stream = ((FFTNode *) cross.get())->stream.get();
+	bool in_step = modulator_fft_size == fft_size;
+	int num_bins = fft_size / 2;
+
+	double magnitude_error = 0.0, phase_error = 0.0;
+	int frames_seen = 0;
+	for (int offset = 0; offset < num_frames; offset += block_size)
+	{
+		for (NodeRef node : nodes)
+			node->process(node->out, block_size);
+
+		if (cross_stream->num_frames != carrier_stream->num_frames)
+			check("FFTCrossSynthesis frame count", 1.0, 0.0);
+
+		for (int index = 0; index < cross_stream->num_frames; index++, frames_seen++)
+		{
+			const sample *magnitudes = cross_stream->magnitudes(index);
+			const sample *phases = cross_stream->phases(index);
+			const sample *carrier_magnitudes = carrier_stream->magnitudes(index);
+			for (int bin = 0; bin < num_bins; bin++)
+			{
+				double expected = carrier_magnitudes[bin];
+				if (in_step)
+					expected += amount * (modulator_stream->magnitudes(index)[bin] - carrier_magnitudes[bin]);
+				magnitude_error = fmax(magnitude_error, fabs(magnitudes[bin] - expected) / fmax(1.0, fabs(expected)));
+				phase_error = fmax(phase_error, fabs(phases[bin] - carrier_stream->phases(index)[bin]));
+			}
+		}
+	}
+
+	check("FFTCrossSynthesis magnitudes", magnitude_error, 1e-5);
+	check("FFTCrossSynthesis phases", phase_error, 0.0);
+	check("FFTCrossSynthesis produced frames", frames_seen > 0 ? 0.0 : 1.0, 0.0);
+}
+
+int main()
+{
+	vector_kernels_init();
+	srand(1);
+
+	test_shift_kernel();
+
+	test_bin_shift(512, 128, 20, 7);
+	test_bin_shift(512, 128, 40, -13);
+	test_bin_shift(1024, 256, 100, 1);
+
+	for (double amount : { 0.0, 0.3, 1.0 })
+		test_cross_synthesis(amount, 512);
+	test_cross_synthesis(0.5, 1024);
+
+	printf("Spectral ops: %s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
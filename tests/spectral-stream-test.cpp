@@ -0,0 +1,199 @@
+/*------------------------------------------------------------------------
+ * SpectralStream test
+ *
+ * Checks the frames, timestamps and history of a SpectralStream, and
+ * that an FFT followed by an IFFT reconstructs its input delayed by
+ * fft_size samples, for several FFT, hop and block sizes.
+ *
+ * Nodes are processed directly, without a graph, with their outputs
+ * allocated as a schedule would.
+ *-----------------------------------------------------------------------*/
+
+#include <signal/signal.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+using namespace libsignal;
+
+static int failures = 0;
+
+static void fail(const char *test, int fft_size, int hop_size, int block_size, const char *detail)
+{
+	printf("FAIL: %s, fft %d, hop %d, block %d: %s\n", test, fft_size, hop_size, block_size, detail);
+	failures++;
+}
+
+/*------------------------------------------------------------------------
+ * Outputs `signal`, then silence.
+ *-----------------------------------------------------------------------*/
+class TestSource : public Node
+{
+	public:
+		TestSource(const std::vector<sample> &signal) : signal(signal), position(0)
+		{
+			this->name = "test-source";
+		}
+
+		virtual void process(sample **out, int num_frames)
+		{
+			for (int frame = 0; frame < num_frames; frame++, this->position++)
+				out[0][frame] = (this->position < (int) this->signal.size()) ? this->signal[this->position] : 0.0;
+		}
+
+		std::vector<sample> signal;
+		int position;
+};
+
+/*------------------------------------------------------------------------
+ * Appends a frame of each block's windows, marking each with its
+ * timestamp, and checks what is read back, including the history.
+ *-----------------------------------------------------------------------*/
+static void test_stream(int fft_size, int hop_size, int block_size)
+{
+	SpectralStream stream(fft_size, hop_size, 2, block_size);
+	int64_t next_window = 0;
+	int64_t last_timestamps[SIGNAL_SPECTRAL_STREAM_HISTORY];
+	int history = 0;
+
+	for (int64_t position = block_size; position < 50 * fft_size; position += block_size)
+	{
+		stream.begin_block(position);
+		while (next_window + fft_size <= position)
+		{
+			sample *frame = stream.append(next_window);
+			if (!frame)
+			{
+				fail("stream", fft_size, hop_size, block_size, "append returned NULL within capacity");
+				return;
+			}
+			frame[0] = (sample) next_window;
+			frame[fft_size] = (sample) -next_window;
+			next_window += hop_size;
+		}
+
+		for (int index = 0; index < stream.num_frames; index++)
+		{
+			int64_t timestamp = stream.timestamp(index);
+			if (stream.frame(index, 0)[0] != (sample) timestamp || stream.frame(index, 1)[0] != (sample) -timestamp)
+				fail("stream", fft_size, hop_size, block_size, "frame does not hold what was appended");
+		}
+
+		for (int index = -history; index < 0; index++)
+		{
+			if (stream.timestamp(index) != last_timestamps[SIGNAL_SPECTRAL_STREAM_HISTORY + index])
+				fail("stream", fft_size, hop_size, block_size, "history does not hold earlier frames");
+		}
+
+		for (int index = 0; index < stream.num_frames; index++)
+		{
+			for (int last = 0; last < SIGNAL_SPECTRAL_STREAM_HISTORY - 1; last++)
+				last_timestamps[last] = last_timestamps[last + 1];
+			last_timestamps[SIGNAL_SPECTRAL_STREAM_HISTORY - 1] = stream.timestamp(index);
+			history = std::min(history + 1, SIGNAL_SPECTRAL_STREAM_HISTORY);
+		}
+	}
+}
+
+/*------------------------------------------------------------------------
+ * A block holds as many frames as block_size samples can complete, and
+ * append returns NULL beyond that, rather than overwrite the history.
+ *-----------------------------------------------------------------------*/
+static void test_capacity(int fft_size, int hop_size, int block_size)
+{
+	SpectralStream stream(fft_size, hop_size, 1, block_size);
+	int max_frames = (block_size + hop_size - 1) / hop_size;
+	for (int block = 1; block <= 3; block++)
+	{
+		stream.begin_block(block * block_size);
+		for (int index = 0; index < max_frames; index++)
+		{
+			if (!stream.append(index * hop_size))
+				fail("capacity", fft_size, hop_size, block_size, "append returned NULL within capacity");
+		}
+		if (stream.append(max_frames * hop_size))
+			fail("capacity", fft_size, hop_size, block_size, "append succeeded beyond capacity");
+		if (stream.num_frames != max_frames)
+			fail("capacity", fft_size, hop_size, block_size, "block holds the wrong number of frames");
+	}
+}
+
+/*------------------------------------------------------------------------
+ * Resynthesises a signal by FFT and IFFT, and checks it against the
+ * signal fft_size samples earlier. The squared Hann window only sums
+ * to a constant at hops of up to a quarter of fft_size, so only those
+ * are checked.
+ *-----------------------------------------------------------------------*/
+static void test_round_trip(int fft_size, int hop_size, int block_size)
+{
+	int num_frames = 8 * fft_size + 1000;
+	std::vector<sample> signal(num_frames);
+	for (int index = 0; index < num_frames; index++)
+		signal[index] = 2.0 * rand() / RAND_MAX - 1.0;
+
+	NodeRef source = new TestSource(signal);
+	NodeRef fft = new FFT(source, fft_size, hop_size);
+	NodeRef ifft = new IFFT(fft);
+	source->allocate_output(1, block_size);
+	fft->allocate_output(1, block_size);
+	ifft->allocate_output(1, block_size);
+
+	std::vector<sample> output;
+	for (int offset = 0; offset < num_frames; offset += block_size)
+	{
+		source->process(source->out, block_size);
+		fft->process(fft->out, block_size);
+		ifft->process(ifft->out, block_size);
+		output.insert(output.end(), ifft->out[0], ifft->out[0] + block_size);
+	}
+
+	/*------------------------------------------------------------------------
+	 * Output is silent until the first window completes, and exact once
+	 * every window overlapping a sample has, fft_size - hop_size samples
+	 * later.
+	 *-----------------------------------------------------------------------*/
+	double error = 0.0;
+	for (int index = 0; index < num_frames; index++)
+	{
+		if (index < fft_size)
+			error = fmax(error, fabs(output[index]));
+		else if (index >= 2 * fft_size - hop_size)
+			error = fmax(error, fabs(output[index] - signal[index - fft_size]));
+	}
+
+	if (error > 1e-4)
+	{
+		char detail[64];
+		snprintf(detail, sizeof(detail), "round trip error %g", error);
+		fail("round trip", fft_size, hop_size, block_size, detail);
+	}
+}
+
+int main()
+{
+	vector_kernels_init();
+	srand(1);
+
+	int block_sizes[] = { 1, 37, 256, 1024 };
+	struct
+	{
+		int fft_size;
+		int hop_size;
+	} sizes[] = { { 64, 16 }, { 256, 64 }, { 512, 128 }, { 1024, 256 }, { 1024, 128 }, { 2048, 512 } };
+
+	for (auto size : sizes)
+	{
+		for (int block_size : block_sizes)
+		{
+			test_stream(size.fft_size, size.hop_size, block_size);
+			test_capacity(size.fft_size, size.hop_size, block_size);
+			test_round_trip(size.fft_size, size.hop_size, block_size);
+		}
+	}
+
+	printf("SpectralStream: %s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}